@@ -52,10 +52,10 @@ void loop() {
   // the reward probability of the previous block.
   if (pellet_counter == fed3.pelletsToSwitch) {
     pellet_counter = 0;
-    new_prob = probs[random(0,2)];
+    new_prob = probs[fed3.randomBelow(2)];
     if (! fed3.allowBlockRepeat) {
       while (new_prob == fed3.prob_left) {
-        new_prob = probs[random(0,2)];
+        new_prob = probs[fed3.randomBelow(2)];
       }
       fed3.prob_left = new_prob;
       fed3.prob_right = 100 - fed3.prob_left;
@@ -75,7 +75,7 @@ void loop() {
     fed3.BlockPelletCount = pellet_counter;
     fed3.logLeftPoke();                                   //Log left poke
     delay(1000);
-    if (random(100) < fed3.prob_left) {                        //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
+    if (fed3.randomBelow(100) < fed3.prob_left) {              //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
       fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                        //Deliver pellet
       pellet_counter ++;                                  //Increase pellet counter by one
@@ -94,7 +94,7 @@ void loop() {
     fed3.BlockPelletCount = pellet_counter;
     fed3.logRightPoke();                                  //Log Right poke
     delay(1000);
-    if (random(100) < fed3.prob_right) {                       //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
+    if (fed3.randomBelow(100) < fed3.prob_right) {             //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
       fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                        //Deliver pellet
       pellet_counter ++;                                  //Increase pellet counter by one
@@ -32,8 +32,7 @@ String sketch = "Classic";       //Unique identifier text for each sketch
 FED3 fed3 (sketch);              //Start the FED3 object
 
 //variables for PR tasks
-int poke_num = 0;                                      // this variable is the number of pokes since last pellet
-int pokes_required = 1;                                // increase the number of pokes required each time a pellet is received using an exponential equation
+FED3_PRSchedule schedule(FED3_PRTable<FED3_PRExponential, 30>::steps);  // pokes required after each pellet: 1, 2, 4, 6, 9, 12... (Richardson & Roberts, 1996)
 
 void setup() {
   fed3.ClassicFED3 = true;
@@ -80,13 +79,10 @@ void loop() {
     if (fed3.Left) {                                     //If left poke is triggered and pellet is not in the well
       fed3.logLeftPoke();                                //Log left poke
       fed3.Click();                                      //Click
-      poke_num++;                                        //store this new poke number as current poke number.
-      if (poke_num == pokes_required) {                  //check to see if the mouse has acheived the correct number of pokes in order to receive the pellet
+      if (schedule.poke()) {                             //count the poke, true when the mouse has acheived the correct number of pokes in order to receive the pellet
         fed3.ConditionedStimulus();                      //Deliver conditioned stimulus (tone and lights)
         fed3.Feed();                                     //Deliver pellet
-        pokes_required = round((5 * exp((fed3.PelletCount + 1) * 0.2)) - 5);  //increment the number of pokes required according to the progressive ratio:
-        fed3.FR = pokes_required;
-        poke_num = 0;                                    //reset poke_num back to 0 for the next trial
+        fed3.FR = schedule.required();                   //the schedule has moved on to the next ratio
       }
     }
     if (fed3.Right) {                                    //If right poke is triggered and pellet is not in the well
@@ -176,14 +172,10 @@ void loop() {
     fed3.activePoke = 0;                                //Right poke is active
     if (fed3.Right) {                                   //If Right poke is triggered
       fed3.logRightPoke();                              //Log Right poke
-      poke_num++;                                       //store this new poke number as current poke number.
-      if (poke_num == pokes_required) {                 //check to see if the mouse has acheived the correct number of pokes in order to receive the pellet
+      if (schedule.poke()) {                            //count the poke, true when the mouse has acheived the correct number of pokes in order to receive the pellet
         fed3.ConditionedStimulus();                     //Deliver conditioned stimulus (tone and lights)
         fed3.Feed();                                    //Deliver pellet
-        //increment the number of pokes required according to the progressive ratio:
-        pokes_required = round((5 * exp((fed3.PelletCount + 1) * 0.2)) - 5);
-        fed3.FR = pokes_required;
-        poke_num = 0;                                   //reset the number of pokes back to 0, for the next trial
+        fed3.FR = schedule.required();                  //the schedule has moved on to the next ratio
         fed3.Right = false;
       }
       else {
@@ -16,9 +16,8 @@
 
 #include <FED3.h>                                      //Include the FED3 library 
 
-int poke_num = 0;                                      //number of pokes since last pellet
+FED3_PRSchedule schedule(FED3_PRTable<FED3_PRArithmetic<1, 1>, 250>::steps);  //FR1, FR2, FR3... Edit this line to change the PR incrementing formula
 int pellets_in_current_block = 0;                      //pellet number in current block
-int pokes_required = 1;                                //current FR
 unsigned long poketime = 0;                            //time of poke
 int resetInterval = 1800;                              //number of seconds without a poke to reset
 
@@ -29,7 +28,7 @@ void setup() {
   fed3.begin();                                        //Setup the FED3 hardware
   fed3.FEDmode = 1;                                    //Customize the display options to FEDmode 1 for an operant session
   fed3.EnableSleep = true;                             //Set to false to inhibit sleeping to use the Serial port; Set to true to reduce battery power
-  fed3.FR = pokes_required;
+  fed3.FR = schedule.required();
 }
 
 void loop() {
@@ -37,18 +36,16 @@ void loop() {
   checkReset();                                        //Check if it's time to reset to FR1
   if (fed3.Left) {                                     //If left poke is triggered
     fed3.logLeftPoke();                                //log Left poke
-    poke_num++;                                        //increment poke number.
     poketime = fed3.unixtime;                          //update the current time of poke
+    bool earned = schedule.poke();                     //count the poke, true when the current FR has been achieved
     serialoutput();                                    //print data to the Serial monitor - EnableSleep must be false to use Serial monitor
-    if (poke_num == pokes_required) {                  //check if current FR has been achieved
+    if (earned) {
       fed3.ConditionedStimulus();                      //Deliver conditioned stimulus (tone and lights)
       pellets_in_current_block++;                      //increment the pellet number by 1
       fed3.BlockPelletCount = pellets_in_current_block;
       fed3.Feed();                                     //Deliver pellet
       fed3.BNC(500, 1);                                //Send 500ms pulse to the BNC output when pellet is detected (move this line to deliver this pulse elsewhere)
-      pokes_required += 1;                             //Edit this line to change the PR incremementing formula.  Default is for each pellet add 1 to the pokes required.
-      fed3.FR = pokes_required;                        //Update the FR requirement in the functions in the FED3 library
-      poke_num = 0;                                    //reset poke_num to 0
+      fed3.FR = schedule.required();                   //Update the FR requirement in the functions in the FED3 library
     }
   }
 
@@ -64,9 +61,8 @@ void checkReset() {
   if (fed3.unixtime - poketime >= resetInterval) {   //if the reset interval has elapsed since last poke
     pellets_in_current_block = 0;
     fed3.BlockPelletCount = pellets_in_current_block;
-    poke_num = 0;
-    pokes_required = 1;
-    fed3.FR = pokes_required;
+    schedule.reset();                                 //back to FR1
+    fed3.FR = schedule.required();
     Serial.println("          ");
     Serial.println("****");                           //print **** on the serial monitor
 
@@ -91,15 +87,19 @@ void serialoutput() {
   Serial.print("          ");
   Serial.print(fed3.LeftCount);
   Serial.print("          ");
-  Serial.print(poke_num);
+  Serial.print(schedule.required() - schedule.remaining());
   Serial.print("          ");
   Serial.print(pellets_in_current_block);
   Serial.print("          ");
-  Serial.print(pokes_required);
+  Serial.print(schedule.required());
   Serial.print("       ");
   Serial.print(poketime);
   Serial.print("          ");
   Serial.print(fed3.FR);
   Serial.println(" ");
+  Serial.print("Pellets in the last hour: ");
+  Serial.print(fed3.pelletsLastHour());                //rolling count kept by the library, see FED3_Stats.cpp
+  Serial.print("   Meals: ");
+  Serial.println(fed3.mealCount);
   Serial.println(" ");
 }
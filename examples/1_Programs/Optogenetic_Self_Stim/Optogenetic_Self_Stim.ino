@@ -25,7 +25,8 @@ void loop() {
     fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights for 200ms)
     fed3.Event = "20HzStim";                            //Label the event "20HzStim" - Event is a text string and can be set to anything
     fed3.logdata();                                     //log data without incrementing left or right pokes
-    fed3.pulseGenerator(10, 20, 20);                    //Deliver a traing of 10ms pulses at 20Hz for 1 sec
+    fed3.startPulseTrain(10000, 50000, 20);             //Start a train of 10ms (10000us) pulses at 20Hz (50000us period) for 1 sec, pokes are still detected while it runs
+                                                        //fed3.pulseGenerator(10, 20, 20) delivers the same train but waits for it to finish
   }
 
   if (fed3.Right) {                                     //If right poke is triggered
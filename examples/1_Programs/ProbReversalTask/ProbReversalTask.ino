@@ -49,7 +49,7 @@ void loop() {
   // Case 1: The *left* poke is the high probability poke and animal pokes *left*
   if (fed3.activePoke == 1 and fed3.Left) {
     fed3.logLeftPoke();                                 //Log left poke
-    if (random(100) < probability) {                    //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
+    if (fed3.randomBelow(100) < probability) {          //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
       fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                        //Deliver pellet
     }
@@ -63,7 +63,7 @@ void loop() {
   // Case 2: The *left* poke is the high probability poke and animal pokes *right*
   if (fed3.activePoke == 1 and fed3.Right) {
     fed3.logRightPoke();                                //Log Right poke
-    if (random(100) > probability) {                    //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
+    if (fed3.randomBelow(100) > probability) {          //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
       fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                        //Deliver pellet
     }
@@ -77,7 +77,7 @@ void loop() {
   // Case 3: The *right* poke is the high probability poke and animal pokes *left*
   if (fed3.activePoke == 0 and fed3.Left) {
     fed3.logLeftPoke();                                 //Log left poke
-    if (random(100) > probability) {                    //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
+    if (fed3.randomBelow(100) > probability) {          //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
       fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                        //Deliver pellet
     }
@@ -91,7 +91,7 @@ void loop() {
   // Case 4: The *right* poke is the high probability poke and animal pokes *right*
   if (fed3.activePoke == 0 and fed3.Right) {
     fed3.logRightPoke();                                //Log Right poke
-    if (random(100) < probability) {                    //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
+    if (fed3.randomBelow(100) < probability) {          //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
       fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                        //Deliver pellet
     }
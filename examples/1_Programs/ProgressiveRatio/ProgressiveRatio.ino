@@ -13,12 +13,16 @@
 */
 
 #include <FED3.h>                                      //Include the FED3 library 
-int poke_num = 0;                                      // this variable is the number of pokes since last pellet
-int pokes_required = 1;                                //increase the number of pokes required each time a pellet is received using an exponential equation
 String sketch = "ProgRat";                            //Unique identifier text for each sketch
 FED3 fed3 (sketch);                                    //Start the FED3 object
 
+//The number of pokes required after each pellet: 1, 2, 4, 6, 9, 12, 15, 20, 25, 32...  This table is built when the sketch compiles.
+//To use a different ratio, change this line, e.g. FED3_PRTable<FED3_PRArithmetic<1, 2>, 100> for FR1, FR3, FR5...
+FED3_PRSchedule schedule(FED3_PRTable<FED3_PRExponential, 30>::steps);
+
 void setup() {
+  fed3.prSchedule = &schedule;                         //Log the step of the schedule in the PR_Step column
+  fed3.FR = schedule.required();                       //Start on the first ratio
   fed3.begin();                                        //Setup the FED3 hardware
 }
 
@@ -26,16 +30,10 @@ void loop() {
   fed3.run();                                          //Call fed.run at least once per loop
   if (fed3.Left) {                                     //If left poke is triggered and pellet is not in the well
     fed3.logLeftPoke();                                //Log left poke
-    poke_num++;                                        //store this new poke number as current poke number.
-    if (poke_num == pokes_required) {                  //check to see if the mouse has acheived the correct number of pokes in order to receive the pellet
+    if (schedule.poke()) {                             //count the poke, true when the mouse has acheived the correct number of pokes in order to receive the pellet
       fed3.ConditionedStimulus();                      //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                     //Deliver pellet
-      
-      //increment the number of pokes required according to the progressive ratio:
-      pokes_required = round((5 * exp((fed3.PelletCount + 1) * 0.2)) - 5);  //this is an exponential ratio, change this line to edit ratio formula
-      
-      fed3.FR = pokes_required;
-      poke_num = 0;                                    //reset the number of pokes back to 0, for the next trial
+      fed3.FR = schedule.required();                   //the schedule has moved on to the next ratio
       fed3.Left = false;
     }
     else {
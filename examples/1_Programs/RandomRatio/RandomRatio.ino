@@ -15,7 +15,9 @@
 ////////////////////////////////////////////////////
 // Set the FR limits for the random ratio
 ////////////////////////////////////////////////////
-int FR = random(1, 11);                               //Set the min and max for the random ratio.  In this example this is set between 1 and 10.
+int minFR = 1;                                        //Set the min and max for the random ratio.  In this example this is set between 1 and 10.
+int maxFR = 10;
+int FR = 1;
 
 ////////////////////////////////////////////////////
 // Start FED3 library and make the fed3 object
@@ -25,8 +27,8 @@ String sketch = "RndRatio";                           //Unique identifier text f
 FED3 fed3 (sketch);                                   //Start the FED3 object
 
 void setup() {
-  randomSeed(analogRead(0));
-  fed3.begin();                                       //Setup the FED3 hardware
+  fed3.begin();                                       //Setup the FED3 hardware, the random seed is logged in the Seed column
+  FR = fed3.randomRange(minFR, maxFR + 1);            //randomize the number of pokes required for the first pellet
   fed3.FR = FR;                                       //share starting FR ratio with the fed3 library for logging
 }
 
@@ -40,7 +42,7 @@ void loop() {
     if (fed3.LeftCount % FR == 0) {                   //if random ratio is  met
       fed3.ConditionedStimulus();                     //deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                    //deliver pellet
-      FR = random(1, 11);                             //randomize the number of pokes required for next pellet
+      FR = fed3.randomRange(minFR, maxFR + 1);        //randomize the number of pokes required for next pellet
       fed3.FR = FR;                                   //share this new ratio with the fed3 library for logging
     }
   }
@@ -21,6 +21,7 @@ int resetInterval = 1800;          //number of seconds without a poke to reset
 
 void setup() {
   fed3.psygene = true;
+  fed3.randomSeedValue = 12;  //Same reward sequence every session, logged in the Seed column
   fed3.begin();  //Setup the FED3 hardware
 }
 
@@ -55,7 +56,6 @@ void loop() {
     fed3.countAllPokes = false;
     fed3.pelletsToSwitch = 20;      // Number of pellets required to finish the block and change reward probabilities
     fed3.allowBlockRepeat = false;  // Whether the same probabilities can be used for two blocks in a row
-    randomSeed(12);
     fed3.writeHeader();
 
     while (true) {
@@ -74,10 +74,10 @@ void loop() {
       // the reward probability of the previous block.
       if (pellet_counter == fed3.pelletsToSwitch) {
         pellet_counter = 0;
-        new_prob = probs[random(0, 2)];
+        new_prob = probs[fed3.randomBelow(2)];
         if (!fed3.allowBlockRepeat) {
           while (new_prob == fed3.prob_left) {
-            new_prob = probs[random(0, 2)];
+            new_prob = probs[fed3.randomBelow(2)];
           }
           fed3.prob_left = new_prob;
           fed3.prob_right = 100 - fed3.prob_left;
@@ -96,8 +96,8 @@ void loop() {
         //fed3.BNC(50,1);
         fed3.BlockPelletCount = pellet_counter;
         fed3.logLeftPoke();  //Log left poke
-        random_n = random(100);
-        if (random(100) < fed3.prob_left) {  //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
+        random_n = fed3.randomBelow(100);
+        if (fed3.randomBelow(100) < fed3.prob_left) { //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
           //fed3.BNC(50,3);
           fed3.ConditionedStimulus();  //Deliver conditioned stimulus (tone and lights)
           fed3.Feed();                 //Deliver pellet
@@ -117,7 +117,7 @@ void loop() {
       if (fed3.Right) {
         fed3.BlockPelletCount = pellet_counter;
         fed3.logRightPoke();                  //Log Right poke
-        if (random(100) < fed3.prob_right) {  //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
+        if (fed3.randomBelow(100) < fed3.prob_right) { //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
           fed3.ConditionedStimulus();         //Deliver conditioned stimulus (tone and lights)
           fed3.Feed();                        //Deliver pellet
           pellet_counter++;                   //Increase pellet counter by one
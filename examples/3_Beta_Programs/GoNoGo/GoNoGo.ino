@@ -18,12 +18,19 @@
 #include <FED3.h>                                       //Include the FED3 library 
 String sketch = "GoNoGo";                               //Unique identifier text for each sketch
 FED3 fed3 (sketch);                                     //Start the FED3 object
-int highOrLow = random(0, 2);                           //Set a random variable called highOrLow. 0 means low tone, 1 means high tone
+int highOrLow = 0;                                      //Set a random variable called highOrLow. 0 means low tone, 1 means high tone
 int gotime = 200;                                       //This is the duration in ms which the mouse must remove from the poke on a go trial to get pellet
 int nogotime = 200;                                    //This is the duration in ms which the mouse must remain in the well on a nogo trial to get pellet
 
+const FED3_Stimulus highTone[] = {{0, STIMULUS_TONE, 2500, 500}};                   //High tone, timed from the poke
+const FED3_Stimulus lowTone[] = {{0, STIMULUS_TONE, 50, 500}};                      //Low tone, timed from the poke
+const FED3_Stimulus clicks[] = {{0, STIMULUS_TONE, 800, 8},                         //Three clicks 50ms apart
+                                {50000, STIMULUS_TONE, 800, 8},
+                                {100000, STIMULUS_TONE, 800, 8}};
+
 void setup() {
   fed3.begin();                                         //Setup the FED3 hardware
+  highOrLow = fed3.randomBelow(2);                      //Pick the first trial type
 }
 
 void loop() {
@@ -31,30 +38,34 @@ void loop() {
 
   if (fed3.Left) {                                      //If left poke is triggered
     if (highOrLow == 1) {                               //If it is a high tone trial
-      fed3.Tone(2500, 500);                             //Pley high tone
+      fed3.startTrial(highTone, 1, fed3.pokeEdgeUs);    //Play high tone
       fed3.logLeftPoke();                               //Log left poke
       if (fed3.leftInterval < gotime) {                 //If poke duration is less than the gotime 
         fed3.Feed();                                    //Feed
       }
       else {                                            //Otherwise
-        fed3.Click(); delay(50); fed3.Click(); 
-        delay(50); fed3.Click() ;delay(50);             //Play some clicks
+        fed3.startTrial(clicks, 3);                     //Play some clicks
+        while (fed3.trialRunning() or fed3.isPlaying()) {
+          delay(1);                                     //Let the clicks finish before the timeout noise
+        }
         fed3.Timeout(10);                               //Timeout
       }
     }
     else if (highOrLow == 0) {                          //If it is a low tone trial
-      fed3.Tone(50, 500);                               //Play low tone
+      fed3.startTrial(lowTone, 1, fed3.pokeEdgeUs);     //Play low tone
       fed3.logLeftPoke();                               //Log left poke
       if (fed3.leftInterval > nogotime) {               //If poke duration is more than the nogo time
         fed3.Feed();                                    //Feed
       } 
       else {                                            //Otherwise
-        fed3.Click(); delay(50); fed3.Click(); 
-        delay(50); fed3.Click() ;delay(50);             //Play some clicks
+        fed3.startTrial(clicks, 3);                     //Play some clicks
+        while (fed3.trialRunning() or fed3.isPlaying()) {
+          delay(1);                                     //Let the clicks finish before the timeout noise
+        }
         fed3.Timeout(10);                               //Timeout
       }
     }
-    highOrLow = random(0, 2);                           //re-randomize highOrLow
+    highOrLow = fed3.randomBelow(2);                    //re-randomize highOrLow
   }
 
   if (fed3.Right) {                                     //If right poke is triggered
@@ -13,59 +13,38 @@
 #include <FED3.h>                                       //Include the FED3 library 
 String sketch = "LeftRight";                            //Unique identifier text for each sketch
 FED3 fed3 (sketch);                                     //Start the FED3 object
-bool leftTriggered = false;
-unsigned long poketime = 0;                             //time of poke
-byte resetInterval = 60;                                //How long do they have to poke right (in seconds)?
+
+//How long do they have to poke right after poking left? The window gets shorter as they earn pellets
+const FED3_SequenceWindow windows[] = {
+  {0, 60000},                                           //60 s to start with
+  {60, 30000},                                          //after 60 pellets make the left-right window 30 s
+  {120, 10000},
+  {160, 8000},
+  {200, 6000},
+  {240, 5000},
+  {280, 4000},
+};
+
+void reward() {                                         //Called when a left poke is followed by a right poke within the window
+  fed3.pixelsOn(0, 0, 10, 0);
+  fed3.Feed();                                          //Deliver pellet
+  fed3.BNC(500, 1);
+}
 
 void setup() {
   fed3.begin();                                         //Setup the FED3 hardware
-  fed3.disableSleep();
+  fed3.startSequence("LR", 60000, reward);              //Left then right, logged as "SeqMatch", or "SeqReset" when the window runs out
+  fed3.setSequenceWindows(windows, 7);
 }
 
 void loop() {
   fed3.run();                                           //Call fed.run at least once per loop
-  leftReset();
-
-  if (fed3.PelletCount == 60)  resetInterval = 30;       // after 40 pellets make left-right reset interval = 9
-  if (fed3.PelletCount == 120) resetInterval = 10;       // after 40 pellets make left-right reset interval = 8
-  if (fed3.PelletCount == 160) resetInterval = 8;       // after 80 pellets make left-right reset interval = 7
-  if (fed3.PelletCount == 200) resetInterval = 6;      // after 120 pellets make left-right reset interval = 6
-  if (fed3.PelletCount == 240) resetInterval = 5;      // after 120 pellets make left-right reset interval = 6
-  if (fed3.PelletCount == 280) resetInterval = 4;      // after 120 pellets make left-right reset interval = 6
 
-  //if left poke is triggered
   if (fed3.Left) {                                      //If left poke is triggered
-    Serial.println ("Left");
-    fed3.BlockPelletCount = millis();
-    fed3.logLeftPoke();                                 //Log left poke
-    leftTriggered = true;
-    poketime = fed3.unixtime;                          //update the current time of poke
+    fed3.logLeftPoke();                                 //Log left poke, this also steps the sequence
   }
 
-  if (fed3.Right and leftTriggered == true) {                                     //If right poke is triggered
-    Serial.println ("Right_after_left");
-    fed3.BlockPelletCount = millis();
+  if (fed3.Right) {                                     //If right poke is triggered
     fed3.logRightPoke();                                //Log right poke
-    fed3.pixelsOn(0, 0, 10, 0);
-    fed3.Feed();                                        //Deliver pellet
-    fed3.BNC(500, 1);
-    leftTriggered = false;
-  }
-
-  if (fed3.Right and leftTriggered == false) {                                     //If right poke is triggered
-    Serial.println ("Right_no_left");
-    fed3.BlockPelletCount = millis();
-    fed3.logRightPoke();                                //Log right poke
-  }
-}
-
-void leftReset() {
-  if ((fed3.unixtime - poketime >= resetInterval) and leftTriggered == true) {   //if the reset interval has elapsed since last poke
-    Serial.print (resetInterval);
-    Serial.println ("s, LeftTriggered RESET");
-    leftTriggered = false;
-    fed3.BlockPelletCount = millis();
-    fed3.Event = "RESET";
-    fed3.logdata();
   }
 }
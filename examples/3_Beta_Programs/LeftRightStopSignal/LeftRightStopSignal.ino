@@ -10,138 +10,135 @@
   Copyright (c) 2020 Lex Kravitz
 */
 
-#include <FED3.h>                                       //Include the FED3 library 
+#include <FED3.h>                                       //Include the FED3 library
 String sketch = "StopSig";                            //Unique identifier text for each sketch
 FED3 fed3 (sketch);                                     //Start the FED3 object
 
 //Poke variables
-bool leftTriggered = false;
-unsigned long poketime = 0;                            //time of left poke
-byte resetInterval = 4;
+unsigned long resetWindow = 4000;                      //ms after the left poke to poke right
+unsigned long resetsSeen = 0;                          //window resets handled so far
 
 //stop sig variables
 bool stopTrial = false;
-int stopSigTime = 0;
 byte stopProb = 30;
 byte consecutiveRegulars = 0;
+const FED3_Stimulus stopSignal[] = {
+  {500000, STIMULUS_TONE, 6000, 3000},                  //6 kHz tone for 3 s, 500 ms after the left poke
+};
+
+/////////////////////////////////
+//Right poke within the window after a left poke
+/////////////////////////////////
+void rightAfterLeft() {
+  //no stop signal - right poke delivers pellet
+  if (stopTrial == false) {
+    Serial.println ("Right_Regular_(correct)");
+    fed3.Event = "Right_Regular_(correct)";
+    fed3.logdata();
+    fed3.Feed();                                        //Deliver pellet
+    //fed3.BNC(500, 1);
+  }
+
+  //stop signal trial - right poke enters timeout
+  else {
+    fed3.stopTrial();                                   //No stop signal if it hasn't started yet
+    Serial.println ("Right_STOP_SIGNAL");
+    Serial.print ("Reaction time to the stop signal (us): ");
+    Serial.println (fed3.reactionTimeUs(0));            //-1 if the right poke came before the signal
+    fed3.Event = "Right_STOP_(incorrect)";
+    fed3.logdata();
+    fed3.Noise(2000);
+    fed3.pixelsOn(2, 2, 2, 2);
+    fed3.Timeout(30);
+    fed3.pixelsOff();
+  }
+}
 
 void setup() {
   randomSeed(analogRead(0));
   fed3.begin();                                         //Setup the FED3 hardware
-  fed3.disableSleep();                                  //Disable sleep so we can use millis() and Serial.print statements
+  fed3.disableSleep();                                  //Disable sleep so we can use Serial.print statements
+  fed3.logSequenceEvents = false;                       //The trial outcomes below are logged instead of SeqMatch and SeqReset
+  fed3.startSequence("LR", resetWindow, rightAfterLeft); //Left then right within the window
 }
 
 void loop() {
   fed3.run();                                           //Call fed.run at least once per loop
 
   /////////////////////////////////
-  //Right poke without left
+  //Right poke
   /////////////////////////////////
-  if (fed3.Right and leftTriggered == false) {                                     //If right poke is triggered
+  if (fed3.Right) {                                     //If right poke is triggered
+    fed3.Right = false;
     fed3.RightCount ++;
     fed3.Click();
-    Serial.println ("Right_no_left");
-    fed3.Event = "Right_no_left";
-    fed3.logdata();
-    fed3.BlockPelletCount = millis();
-    fed3.Right = false;
+    if (fed3.sequenceState == 0) {                      //Right poke without left
+      Serial.println ("Right_no_left");
+      fed3.Event = "Right_no_left";
+      fed3.logdata();
+    }
+    fed3.sequenceEvent(false);                          //After a left poke this completes the sequence and calls rightAfterLeft()
   }
 
   /////////////////////////////////
   //if left poke is triggered
   /////////////////////////////////
-  if (fed3.Left and leftTriggered == false) {                                      //If left poke is triggered
+  if (fed3.Left) {                                      //If left poke is triggered
+    fed3.Left = false;
     fed3.LeftCount ++;
     Serial.println ("Left");
     fed3.Click();
-    fed3.BlockPelletCount = millis();
-    leftTriggered = true;
-    fed3.run();
-    poketime = fed3.unixtime;                          //update the current time of poke
-
-    // Is it a stop trial?
-    if ((random (0, 10) < (stopProb / 10)) or consecutiveRegulars > 4) {
-      Serial.println ("Stop signal!");
-      stopSigTime = fed3.unixtime;
-      delay (500);
-      fed3.Tone (6000, 3000);
-      stopTrial = true;
-      fed3.Event = ">Left_Stop_trial";
-      consecutiveRegulars = 0;
-    }
+    bool newTrial = (fed3.sequenceState == 0);
+    fed3.sequenceEvent(true);                           //Starts the window again
 
-    //if it is NOT a stop trial
-    else {
-      Serial.println ("Regular_trial");
-      stopTrial = false;
-      fed3.Event = ">Left_Regular_trial";
-      consecutiveRegulars ++;
-    }
+    if (newTrial) {
+      // Is it a stop trial?
+      if ((random (0, 10) < (stopProb / 10)) or consecutiveRegulars > 4) {
+        Serial.println ("Stop signal!");
+        fed3.startTrial(stopSignal, 1, fed3.pokeEdgeUs); //Scheduled from the left poke, loop() keeps running
+        stopTrial = true;
+        fed3.Event = ">Left_Stop_trial";
+        consecutiveRegulars = 0;
+      }
 
-    Serial.print ("Consecutive regular trials: ");
-    Serial.println(consecutiveRegulars);
-    fed3.logdata();
-    fed3.Left = false;
-  }
+      //if it is NOT a stop trial
+      else {
+        Serial.println ("Regular_trial");
+        stopTrial = false;
+        fed3.Event = ">Left_Regular_trial";
+        consecutiveRegulars ++;
+      }
 
-  /////////////////////////////////
-  //no stop signal - right poke delivers pellet
-  /////////////////////////////////
-  if (fed3.Right and leftTriggered == true and stopTrial == false) {                                    //If right poke is triggered
-    fed3.RightCount ++;
-    fed3.Click();
-    fed3.BlockPelletCount = millis();
-    Serial.println ("Right_Regular_(correct)");
-    fed3.Event = "Right_Regular_(correct)";
-    fed3.logdata();
-    fed3.Feed();                                        //Deliver pellet
-    //fed3.BNC(500, 1);
-    leftTriggered = false;
-    fed3.Right = false;
+      Serial.print ("Consecutive regular trials: ");
+      Serial.println(consecutiveRegulars);
+      fed3.logdata();
+    }
   }
 
   /////////////////////////////////
-  //stop signal trial - right poke enters timeout
+  //The window ran out without a right poke
   /////////////////////////////////
-  if (fed3.Right and leftTriggered == true and stopTrial == true) {                                    //If right poke is triggered
-    fed3.RightCount ++;
-    fed3.Click();
-    Serial.println ("Right_STOP_SIGNAL");
-    fed3.BlockPelletCount = millis();
-    fed3.Event = "Right_STOP_(incorrect)";
-    fed3.logdata();
-    fed3.Noise(2000);
-    fed3.pixelsOn(2, 2, 2, 2);
-    fed3.Timeout(30);
-    fed3.pixelsOff();
-    leftTriggered = false;
-    fed3.Right = false;
-  }
+  if (fed3.sequenceResets != resetsSeen) {
+    resetsSeen = fed3.sequenceResets;
 
-  /////////////////////////////////
-  //stop signal trial - withholding right poke delivers pellet!
-  /////////////////////////////////
-  if ((fed3.unixtime - poketime >= resetInterval) and leftTriggered == true and stopTrial == true) {                                    //If right poke is triggered
-    Serial.println ("Withheld poking, get pellet!");
-    fed3.Event = "NoPoke_STOP_(correct)";
-    fed3.BlockPelletCount = millis();
-    fed3.logdata();
-    fed3.Feed();                                        //Deliver pellet
-    //fed3.BNC(500, 1);
-    leftTriggered = false;
-  }
+    //stop signal trial - withholding right poke delivers pellet!
+    if (stopTrial == true) {
+      fed3.stopTrial();
+      Serial.println ("Withheld poking, get pellet!");
+      fed3.Event = "NoPoke_STOP_(correct)";
+      fed3.logdata();
+      fed3.Feed();                                      //Deliver pellet
+      //fed3.BNC(500, 1);
+    }
 
-  /////////////////////////////////
-  // If it is a regular trial but he does NOT poke on right, reset and give timeout
-  /////////////////////////////////
-  if ((fed3.unixtime - poketime >= resetInterval) and leftTriggered == true and stopTrial == false) {   //if the reset interval has elapsed since last poke
-    Serial.println ("No_poke, left poke reset");
-    leftTriggered = false;
-    fed3.BlockPelletCount = millis();
-    fed3.Event = "NoPoke_Regular_(incorrect)";
-    fed3.logdata();
-    fed3.Left = false;
-    fed3.Right = false;
-    fed3.Timeout(30);
+    // If it is a regular trial but he does NOT poke on right, reset and give timeout
+    else {
+      Serial.println ("No_poke, left poke reset");
+      fed3.Event = "NoPoke_Regular_(incorrect)";
+      fed3.logdata();
+      fed3.Left = false;
+      fed3.Right = false;
+      fed3.Timeout(30);
+    }
   }
 }
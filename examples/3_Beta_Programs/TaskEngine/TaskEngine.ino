@@ -0,0 +1,40 @@
+/*
+  Feeding experimentation device 3 (FED3)
+  Task engine example. The session is described as a table of transitions and fed3.run() does the rest,
+  FED3 sleeps between pokes and timers. Built-in tasks: FED3_FixedRatio, FED3_ProgressiveRatio,
+  FED3_Extinction, FED3_Pavlovian, FED3_Bandit and FED3_TimedFeeding.
+
+  Below, a custom task: left pokes on a FR3 schedule, a pellet is followed by a 10 second timeout in
+  which pokes are logged but not counted, right pokes are logged and do nothing.
+
+  This project is released under the terms of the Creative Commons - Attribution - ShareAlike 3.0 license:
+  human readable: https://creativecommons.org/licenses/by-sa/3.0/
+  legal wording: https://creativecommons.org/licenses/by-sa/3.0/legalcode
+  Copyright (c) 2020 Lex Kravitz
+*/
+
+#include <FED3.h>                                       //Include the FED3 library 
+String sketch = "TaskFR3";                              //Unique identifier text for each sketch
+FED3 fed3 (sketch);                                     //Start the FED3 object
+
+// {state, event, guard, actions, next state}, the first matching row is taken
+const FED3_Transition fr3Table[] = {
+  {0, TASK_EVENT_LEFT, TASK_GUARD_RATIO, TASK_LOG_POKE | TASK_STIMULUS | TASK_FEED | TASK_RESET_COUNT, 1},
+  {0, TASK_EVENT_LEFT, TASK_GUARD_NONE, TASK_LOG_POKE | TASK_COUNT, TASK_STAY},
+  {0, TASK_EVENT_RIGHT, TASK_GUARD_NONE, TASK_LOG_POKE, TASK_STAY},
+  {1, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_TIMEOUT_POKE, TASK_STAY},
+  {1, TASK_EVENT_TIMER, TASK_GUARD_NONE, 0, 0},
+};
+const byte fr3Timers[] = {TASK_TIMER_NONE, TASK_TIMER_TIMEOUT};  //State 1 lasts fed3.timeout seconds
+const FED3_Task fr3Task = {NULL, fr3Table, 5, fr3Timers, 2};
+
+void setup() {
+  fed3.FR = 3;
+  fed3.timeout = 10;
+  fed3.startTask(fr3Task);                              //Or a built-in task, e.g. fed3.startTask(FED3_ProgressiveRatio);
+  fed3.begin();                                         //Setup the FED3 hardware
+}
+
+void loop() {
+  fed3.run();                                           //Pokes and timers are handled by the task
+}
@@ -0,0 +1,36 @@
+/*
+  Feeding experimentation device 3 (FED3)
+  Bandit task with a block plan
+
+  Four sets of reward probabilities, blocks of 20 to 40 pellets. A set never follows itself and the
+  better side changes after at most 2 blocks. The whole block sequence is drawn when the task starts
+  from the random seed in the Seed column of the log, set fed3.randomSeedValue to that seed to replay it.
+  After a poke FED3 waits choiceDelayMs before the outcome, misses are followed by a timeout with white
+  noise. FED3 keeps sleeping between pokes through both. Block statistics are written to a BLK file next
+  to the log file.
+
+  This project is released under the terms of the Creative Commons - Attribution - ShareAlike 3.0 license:
+  human readable: https://creativecommons.org/licenses/by-sa/3.0/
+  legal wording: https://creativecommons.org/licenses/by-sa/3.0/legalcode
+  Copyright (c) 2020 Lex Kravitz
+*/
+
+#include <FED3.h>                                      //Include the FED3 library 
+String sketch = "Bandit";                             //Unique identifier text for each sketch, "Bandit" logs the reward probabilities
+FED3 fed3 (sketch);                                   //Start the FED3 object - don't change
+
+const FED3_BanditSet sets[] = {{90, 10}, {70, 30}, {30, 70}, {10, 90}};  //Reward probability of left and right in each set
+
+void setup() {
+  FED3_BanditConfig config = {sets, 4, 20, 40, false, 2};  //sets, number of sets, min and max pellets per block, allow repeats, max blocks with the same better side
+  fed3.planBandit(config);
+  fed3.countAllPokes = false;
+  fed3.choiceDelayMs = 1000;                          //Delay between a poke and its outcome
+  fed3.timeout = 10;                                  //Timeout after an unrewarded poke, in seconds
+  fed3.startTask(FED3_Bandit);
+  fed3.begin();                                       //Setup the FED3 hardware
+}
+
+void loop() {
+  fed3.run();                                         //Pokes, delays and timeouts are handled by the task
+}
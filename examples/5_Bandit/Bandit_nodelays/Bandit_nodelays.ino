@@ -32,8 +32,8 @@ void setup() {
   fed3.prob_left = 100;                                // Initial reward probability of left poke
   fed3.prob_right =  0;                               // Initial reward probability of right poke
   fed3.allowBlockRepeat = false;                      // Whether the same probabilities can be used for two blocks in a row
+  fed3.randomSeedValue = 12;                          // Same reward sequence every session, the seed is logged in the Seed column
   fed3.begin();                                       // Setup the FED3 hardware, all pinmode screen etc, initialize SD card
-  randomSeed(12);
 }
 
 void loop() {
@@ -52,10 +52,10 @@ void loop() {
   // the reward probability of the previous block.
   if (pellet_counter == fed3.pelletsToSwitch) {
     pellet_counter = 0;
-    new_prob = probs[random(0,2)];
+    new_prob = probs[fed3.randomBelow(2)];
     if (! fed3.allowBlockRepeat) {
       while (new_prob == fed3.prob_left) {
-        new_prob = probs[random(0,2)];
+        new_prob = probs[fed3.randomBelow(2)];
       }
       fed3.prob_left = new_prob;
       fed3.prob_right = 100 - fed3.prob_left;
@@ -74,8 +74,8 @@ void loop() {
   if (fed3.Left) {
     fed3.BlockPelletCount = pellet_counter;
     fed3.logLeftPoke();                                   //Log left poke
-    random_n = random(100);
-    if (random(100) < fed3.prob_left) {                        //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
+    random_n = fed3.randomBelow(100);
+    if (fed3.randomBelow(100) < fed3.prob_left) {              //Select a random number between 0-100 and ask if it is between 0-80 (80% of the time).  If so:
       fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                        //Deliver pellet
       pellet_counter ++;                                  //Increase pellet counter by one
@@ -92,7 +92,7 @@ void loop() {
   if (fed3.Right) {
     fed3.BlockPelletCount = pellet_counter;
     fed3.logRightPoke();                                  //Log Right poke
-    if (random(100) < fed3.prob_right) {                       //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
+    if (fed3.randomBelow(100) < fed3.prob_right) {             //Select a random number between 0-100 and ask if it is between 80-100 (20% of the time).  If so:
       fed3.ConditionedStimulus();                         //Deliver conditioned stimulus (tone and lights)
       fed3.Feed();                                        //Deliver pellet
       pellet_counter ++;                                  //Increase pellet counter by one
@@ -0,0 +1,739 @@
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <ArduinoLowPower.h>
+#include <Stepper.h>
+#include <Adafruit_NeoPixel.h>
+#include <Adafruit_AHTX0.h>
+#include <RTClib.h>
+#include <sys/stat.h>
+
+/**************************************************************************************************************************************************
+                                                                                               Random numbers
+**************************************************************************************************************************************************/
+static uint64_t splitMix64(uint64_t &x)
+{
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl64(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+void FED3SimRandom::seed64(uint64_t seed)
+{
+    for (int i = 0; i < 4; i++)
+        s[i] = splitMix64(seed);
+}
+
+uint64_t FED3SimRandom::next()
+{
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+double FED3SimRandom::uniform()
+{
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double FED3SimRandom::normal()
+{
+    double u = 1.0 - uniform();
+    double v = uniform();
+    return sqrt(-2.0 * log(u)) * cos(TWO_PI * v);
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Board
+**************************************************************************************************************************************************/
+static thread_local FED3SimBoard *currentBoard = NULL;
+
+FED3SimBoard &FED3SimBoard::current()
+{
+    if (currentBoard == NULL)
+    {
+        static FED3SimBoard defaultBoard;
+        return defaultBoard;
+    }
+    return *currentBoard;
+}
+
+void FED3SimBoard::makeCurrent()
+{
+    currentBoard = this;
+}
+
+FED3SimBoard::FED3SimBoard(const FED3SimConfig &config)
+    : config(config), random(config.seed), sketchRandom(config.seed ^ 0x5EEDULL)
+{
+    quantumNs = (uint64_t)(config.quantumUs * 1000.0);
+    if (quantumNs == 0)
+        quantumNs = 1;
+    endNs = (uint64_t)(config.durationS * 1e9);
+    hopper = config.hopperPellets;
+    for (int i = 0; i < 3; i++)
+        timers[i].irq = TC3_IRQn + i;
+}
+
+FED3SimBoard::~FED3SimBoard()
+{
+    if (currentBoard == this)
+        currentBoard = NULL;
+}
+
+const char *FED3SimBoard::run(std::function<void()> setup, std::function<void()> loop)
+{
+    makeCurrent();
+    ::mkdir(config.sdDir.c_str(), 0777);
+    if (config.deviceNumber >= 0)
+    {
+        FILE *f = fopen(sdPath("DeviceNumber.csv").c_str(), "w");
+        if (f)
+        {
+            fprintf(f, "%d", config.deviceNumber);
+            fclose(f);
+        }
+    }
+
+    if (mouse)
+    {
+        plannedPoke = mouse->nextPoke(*this);
+        plannedPoke.waitS += config.mouseStartS;
+        schedule((uint64_t)(plannedPoke.waitS * 1e9), EVENT_POKE_START, ++pokeGeneration);
+    }
+
+    try
+    {
+        setup();
+        for (;;)
+            loop();
+    }
+    catch (const FED3SimStop &stop)
+    {
+        asleep = false;
+        inIsr = false;
+        return stop.reason;
+    }
+}
+
+void FED3SimBoard::adjustRTC(uint32_t unixTime)
+{
+    rtcOffset = (int32_t)(unixTime - config.startUnix - (uint32_t)(wallNs / 1000000000ULL));
+}
+
+int FED3SimBoard::hourOfDay() const
+{
+    return rtcUnix() % 86400UL / 3600;
+}
+
+// LiPo from 4.2 V full to 3.3 V empty, with the knee near the end
+double FED3SimBoard::batteryVolts() const
+{
+    double left = 1.0 - stats.batteryUsedMah / config.batteryMah;
+    if (left < 0)
+        left = 0;
+    return left > 0.1 ? 3.65 + 0.55 * (left - 0.1) / 0.9 : 3.3 + 3.5 * left;
+}
+
+std::string FED3SimBoard::sdPath(const char *name) const
+{
+    while (*name == '/')
+        name++;
+    return config.sdDir + "/" + name;
+}
+
+void FED3SimBoard::sdSynced()
+{
+    stats.sdSyncs++;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Time
+**************************************************************************************************************************************************/
+// Move both clocks to wall time "at", charging the battery for the time in between
+void FED3SimBoard::moveTo(uint64_t at)
+{
+    if (at > endNs)
+        at = endNs;
+    if (at > wallNs)
+    {
+        uint64_t dt = at - wallNs;
+        bool rail = pins[MOTOR_ENABLE].mode == OUTPUT && pins[MOTOR_ENABLE].out == HIGH;
+        double ma = (asleep ? config.sleepMa : config.awakeMa) + (rail ? config.railMa : 0);
+        stats.batteryUsedMah += ma * dt / 3.6e12;
+        if (rail)
+            stats.railNs += dt;
+        if (asleep)
+            stats.sleptNs += dt;
+        else
+            awakeNs += dt;
+        wallNs = at;
+    }
+    if (wallNs >= endNs)
+        throw FED3SimStop{"time"};
+    if (stats.batteryUsedMah >= config.batteryMah)
+        throw FED3SimStop{"battery"};
+}
+
+bool FED3SimBoard::timerReady(const Timer &t) const
+{
+    return t.running && t.nvic && (t.regs.COUNT16.INTENSET.reg & TC_INTENSET_MC0) && irqEnabled && !inIsr && !asleep;
+}
+
+// Earliest wall time of the next event or running timer match, while awake
+void FED3SimBoard::findHorizon()
+{
+    horizonNs = events.empty() ? endNs : events.top().at;
+    for (int i = 0; i < 3; i++)
+    {
+        if (timers[i].running)
+        {
+            uint64_t at = wallNs + (timers[i].dueNs > awakeNs ? timers[i].dueNs - awakeNs : 0);
+            if (at < horizonNs)
+                horizonNs = at;
+        }
+    }
+    horizonDirty = false;
+}
+
+// Let ns of sketch time pass, handling world events and timer interrupts on the way. While asleep
+// it returns early when a pin interrupt wakes the board.
+void FED3SimBoard::advance(uint64_t ns)
+{
+    uint64_t target = wallNs + ns;
+    bool sleeping = asleep;
+
+    // Most calls are clock and pin reads with nothing due, skip the event loop for those
+    if (!sleeping)
+    {
+        if (horizonDirty)
+            findHorizon();
+        if (target < horizonNs)
+        {
+            moveTo(target);
+            return;
+        }
+    }
+    while (wallNs < target || (!events.empty() && events.top().at <= wallNs))
+    {
+        if (sleeping && woke)
+            return;
+
+        uint64_t next = target;
+        if (!events.empty() && events.top().at < next)
+            next = events.top().at;
+        for (int i = 0; i < 3; i++)
+        {
+            if (timerReady(timers[i]))
+            {
+                uint64_t at = wallNs + (timers[i].dueNs > awakeNs ? timers[i].dueNs - awakeNs : 0);
+                if (at < next)
+                    next = at;
+            }
+        }
+        moveTo(next);
+
+        if (!events.empty() && events.top().at <= wallNs)
+        {
+            Event event = events.top();
+            events.pop();
+            horizonDirty = true;
+            handleEvent(event);
+            continue;
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            if (timerReady(timers[i]) && timers[i].dueNs <= awakeNs)
+            {
+                fireTimer(timers[i]);
+                break;
+            }
+        }
+    }
+}
+
+void FED3SimBoard::sleep(uint64_t ns)
+{
+    stats.sleeps++;
+    asleep = true;
+    woke = false;
+    advance(ns);
+    asleep = false;
+    woke = false;
+    horizonDirty = true; // the processor clock stood still
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Pins and interrupts
+**************************************************************************************************************************************************/
+int FED3SimBoard::level(uint8_t pin) const
+{
+    const Pin &p = pins[pin];
+    if (p.drive >= 0)
+        return p.drive;
+    if (p.mode == OUTPUT)
+        return p.out;
+    return p.mode == INPUT_PULLDOWN ? LOW : HIGH;
+}
+
+void FED3SimBoard::pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < NUM_DIGITAL_PINS)
+        pins[pin].mode = mode;
+}
+
+void FED3SimBoard::digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    uint8_t out = value ? HIGH : LOW;
+    bool changed = pins[pin].mode == OUTPUT && pins[pin].out != out;
+    pins[pin].out = out;
+    if (changed && onOutput)
+        onOutput(pin, out);
+}
+
+int FED3SimBoard::digitalRead(uint8_t pin)
+{
+    tick();
+    return pin < NUM_DIGITAL_PINS ? level(pin) : LOW;
+}
+
+int FED3SimBoard::analogRead(uint8_t pin)
+{
+    tick();
+    double full = (1 << adcBits) - 1;
+    double volts = pin == A7 ? batteryVolts() / 2 : 0.01;
+    long counts = lround(volts / 3.3 * full + random.normal() * 0.7);
+    return constrain(counts, 0L, (long)full);
+}
+
+void FED3SimBoard::attachInterrupt(uint8_t pin, voidFuncPtr callback, int mode)
+{
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    pins[pin].isr = callback;
+    pins[pin].isrMode = mode;
+    pins[pin].pending = false;
+}
+
+void FED3SimBoard::detachInterrupt(uint8_t pin)
+{
+    if (pin < NUM_DIGITAL_PINS)
+        pins[pin].isr = NULL;
+}
+
+void FED3SimBoard::interrupts()
+{
+    irqEnabled = true;
+    dispatch();
+}
+
+// The outside world sets a pin, -1 lets it go back to its pull
+void FED3SimBoard::drive(uint8_t pin, int value)
+{
+    int before = level(pin);
+    pins[pin].drive = value;
+    int after = level(pin);
+    if (before != after)
+        raise(pin);
+}
+
+void FED3SimBoard::raise(uint8_t pin)
+{
+    Pin &p = pins[pin];
+    if (p.isr == NULL)
+        return;
+    int now = level(pin);
+    bool match = p.isrMode == CHANGE || (p.isrMode == FALLING && now == LOW) || (p.isrMode == RISING && now == HIGH) ||
+                 (p.isrMode == LOW && now == LOW) || (p.isrMode == HIGH && now == HIGH);
+    if (!match)
+        return;
+    p.pending = true;
+    if (asleep)
+    {
+        woke = true;
+        asleep = false; // the core runs the handler awake
+        horizonDirty = true;
+    }
+    dispatch();
+}
+
+// Run pending pin and timer handlers, unless interrupts are off or a handler is running
+void FED3SimBoard::dispatch()
+{
+    for (;;)
+    {
+        if (!irqEnabled || inIsr)
+            return;
+        bool ran = false;
+        for (int pin = 0; pin < NUM_DIGITAL_PINS && !ran; pin++)
+        {
+            if (pins[pin].pending)
+            {
+                pins[pin].pending = false;
+                if (pins[pin].isr)
+                {
+                    inIsr = true;
+                    stats.isrCalls++;
+                    pins[pin].isr();
+                    inIsr = false;
+                    ran = true;
+                }
+            }
+        }
+        for (int i = 0; i < 3 && !ran; i++)
+        {
+            if (timerReady(timers[i]) && timers[i].dueNs <= awakeNs)
+            {
+                fireTimer(timers[i]);
+                ran = true;
+            }
+        }
+        if (!ran)
+            return;
+    }
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Timers
+**************************************************************************************************************************************************/
+// The library defines TC3_Handler() and a weak TC4_Handler() (see src/FED3_Timer.cpp)
+extern "C" void __attribute__((weak)) TC3_Handler() {}
+extern "C" void TC4_Handler();
+extern "C" void __attribute__((weak)) TC5_Handler() {}
+
+Tc *FED3SimBoard::timer(int n)
+{
+    return &timers[n - 3].regs;
+}
+
+void FED3SimBoard::enableIRQ(int irq, bool enable)
+{
+    if (irq >= TC3_IRQn && irq <= TC5_IRQn)
+        timers[irq - TC3_IRQn].nvic = enable;
+}
+
+// Only the control, count and compare registers move the match time
+void FED3SimBoard::registerWritten(const void *reg)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        TcCount16 &r = timers[i].regs.COUNT16;
+        if (reg == &r.CTRLA.reg || reg == &r.COUNT.reg || reg == &r.CC[0].reg)
+        {
+            horizonDirty = true;
+            bool enabled = r.CTRLA.reg & TC_CTRLA_ENABLE;
+            if (!enabled)
+            {
+                if (timers[i].running)
+                    timers[i].generation++;
+                timers[i].running = false;
+            }
+            else if (!timers[i].running || reg != &r.CTRLA.reg)
+            {
+                retime(timers[i]);
+            }
+            return;
+        }
+    }
+}
+
+// Counting starts now from COUNT, the first match is at CC and then every CC + 1 ticks
+void FED3SimBoard::retime(Timer &t)
+{
+    static const int prescalerShift[8] = {0, 1, 2, 3, 4, 6, 8, 10};
+    TcCount16 &r = t.regs.COUNT16;
+    double tickNs = (1 << prescalerShift[(r.CTRLA.reg >> TC_CTRLA_PRESCALER_Pos) & 7]) * 1e9 / 48e6;
+    uint32_t cc = r.CC[0].reg;
+    uint32_t count = r.COUNT.reg;
+    uint32_t ticks = count <= cc ? cc - count : 65536 - count + cc;
+    t.running = true;
+    t.generation++;
+    t.dueNs = awakeNs + (uint64_t)(ticks * tickNs);
+    t.periodNs = (uint64_t)((cc + 1) * tickNs);
+    if (t.periodNs == 0)
+        t.periodNs = 1;
+}
+
+void FED3SimBoard::fireTimer(Timer &t)
+{
+    unsigned long generation = t.generation;
+    inIsr = true;
+    stats.isrCalls++;
+    if (t.irq == TC3_IRQn)
+        TC3_Handler();
+    else if (t.irq == TC4_IRQn)
+        TC4_Handler();
+    else
+        TC5_Handler();
+    inIsr = false;
+    if (t.running && t.generation == generation)
+        t.dueNs += t.periodNs; // left running by the handler
+    horizonDirty = true;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Mouse, disk and well
+**************************************************************************************************************************************************/
+void FED3SimBoard::schedule(uint64_t delayNs, EventType type, unsigned long generation)
+{
+    Event event;
+    event.at = wallNs + delayNs;
+    event.order = eventOrder++;
+    event.type = type;
+    event.generation = generation;
+    events.push(event);
+    horizonDirty = true;
+}
+
+void FED3SimBoard::scheduleNextPoke()
+{
+    if (mouse == NULL)
+        return;
+    plannedPoke = mouse->nextPoke(*this);
+    schedule((uint64_t)(plannedPoke.waitS * 1e9), EVENT_POKE_START, ++pokeGeneration);
+}
+
+void FED3SimBoard::handleEvent(const Event &event)
+{
+    switch (event.type)
+    {
+    case EVENT_POKE_START:
+        if (event.generation != pokeGeneration || pokeSide >= 0 || wellPellet)
+            return;
+        pokeSide = plannedPoke.left ? 1 : 0;
+        if (plannedPoke.left)
+            stats.leftPokes++;
+        else
+            stats.rightPokes++;
+        if (mouse)
+            mouse->poked(*this, plannedPoke.left);
+        schedule((uint64_t)(plannedPoke.holdS * 1e9), EVENT_POKE_END);
+        drive(plannedPoke.left ? LEFT_POKE : RIGHT_POKE, LOW);
+        break;
+
+    case EVENT_POKE_END:
+    {
+        uint8_t pin = pokeSide == 1 ? LEFT_POKE : RIGHT_POKE;
+        pokeSide = -1;
+        if (!wellPellet)
+            scheduleNextPoke();
+        drive(pin, -1);
+        break;
+    }
+
+    case EVENT_PELLET_LANDS:
+        pelletFalling = false;
+        wellPellet = true;
+        pelletLandedNs = wallNs;
+        stats.pelletsDropped++;
+        pokeGeneration++; // the mouse goes for the pellet
+        if (mouse)
+        {
+            mouse->pelletLanded(*this);
+            schedule((uint64_t)(mouse->retrievalDelay(*this) * 1e9), EVENT_PELLET_TAKEN);
+        }
+        drive(PELLET_WELL, LOW);
+        break;
+
+    case EVENT_PELLET_TAKEN:
+        wellPellet = false;
+        stats.pelletsEaten++;
+        stats.retrievalNs += wallNs - pelletLandedNs;
+        if (config.criterionPellets > 0 && stats.pelletsEaten == (unsigned long)config.criterionPellets)
+            stats.criterionNs = wallNs;
+        if (mouse)
+            mouse->pelletEaten(*this);
+        if (pokeSide < 0)
+            scheduleNextPoke();
+        drive(PELLET_WELL, -1);
+        break;
+    }
+}
+
+// One step of the pellet disk. It only turns with the motor driver powered, may jam on a pellet,
+// and a jam can come free when the disk changes direction.
+void FED3SimBoard::stepDisk(int direction)
+{
+    stats.diskSteps++;
+    if (!(pins[MOTOR_ENABLE].mode == OUTPUT && pins[MOTOR_ENABLE].out == HIGH))
+        return;
+    bool reversed = diskDirection != 0 && direction != diskDirection;
+    diskDirection = direction;
+    if (diskJammed)
+    {
+        if (reversed && random.chance(config.jamClearChance))
+        {
+            diskJammed = false;
+            stats.jamsCleared++;
+        }
+        return;
+    }
+    if (hopper == 0 || wellPellet || pelletFalling)
+        return;
+    if (!random.chance(1.0 / config.stepsPerPellet))
+        return;
+    if (random.chance(config.jamProbability))
+    {
+        diskJammed = true;
+        stats.jams++;
+        return;
+    }
+    if (hopper > 0)
+        hopper--;
+    pelletFalling = true;
+    schedule(10000000ULL, EVENT_PELLET_LANDS); // 10 ms down the chute
+}
+
+void FED3SimBoard::pixelsShown(unsigned int count)
+{
+    stats.pixelFrames++;
+    advance(50000ULL + count * 30000ULL); // 30 us per pixel on the wire plus the latch
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Arduino API on the current board
+**************************************************************************************************************************************************/
+#define BOARD FED3SimBoard::current()
+
+HardwareSerial Serial;
+TwoWire Wire;
+ArduinoLowPowerClass LowPower;
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    if (BOARD.config.echoSerial)
+        putchar(c);
+    return 1;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) { BOARD.pinMode(pin, mode); }
+void digitalWrite(uint8_t pin, uint8_t value) { BOARD.digitalWrite(pin, value); }
+int digitalRead(uint8_t pin) { return BOARD.digitalRead(pin); }
+int analogRead(uint8_t pin) { return BOARD.analogRead(pin); }
+void analogReadResolution(int bits) { BOARD.analogReadResolution(bits); }
+void analogWrite(uint8_t pin, int value) { BOARD.digitalWrite(pin, value > 127); }
+
+unsigned long millis()
+{
+    FED3SimBoard &board = BOARD;
+    board.tick();
+    return (unsigned long)(board.awakeNs / 1000000ULL);
+}
+
+unsigned long micros()
+{
+    FED3SimBoard &board = BOARD;
+    board.tick();
+    return (unsigned long)(board.awakeNs / 1000ULL);
+}
+
+void delay(unsigned long ms) { BOARD.advance(ms * 1000000ULL); }
+void delayMicroseconds(unsigned int us) { BOARD.advance(us * 1000ULL); }
+void yield() { BOARD.tick(); }
+void fed3SimBusy(unsigned long ns) { BOARD.advance(ns); }
+
+// tone() runs from TC5 on the board, the simulator doesn't play it
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {}
+void noTone(uint8_t pin) {}
+
+long random(long max)
+{
+    return max <= 0 ? 0 : (long)(BOARD.sketchRandom.next() % (uint64_t)max);
+}
+
+long random(long min, long max)
+{
+    return max <= min ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed)
+{
+    if (seed != 0)
+        BOARD.sketchRandom.seed64(seed);
+}
+
+void attachInterrupt(uint8_t pin, voidFuncPtr callback, int mode) { BOARD.attachInterrupt(pin, callback, mode); }
+void detachInterrupt(uint8_t pin) { BOARD.detachInterrupt(pin); }
+void noInterrupts() { BOARD.noInterrupts(); }
+void interrupts() { BOARD.interrupts(); }
+
+// Several boards can run in one process, each keeps its own FED3 for the interrupt handlers; the deprecated
+// FED3::staticFED is left unset, it can't name the FED3 of more than one board
+void fed3BindBoard(FED3 *fed3) { BOARD.device = fed3; }
+FED3 *fed3BoardFED() { return BOARD.device; }
+
+void fed3SimRegisterWritten(const void *reg) { BOARD.registerWritten(reg); }
+Tc *fed3SimTimer(int n) { return BOARD.timer(n); }
+Gclk *fed3SimGclk() { return &BOARD.gclk; }
+Pm *fed3SimPm() { return &BOARD.pm; }
+void NVIC_EnableIRQ(IRQn_Type irq) { BOARD.enableIRQ(irq, true); }
+void NVIC_DisableIRQ(IRQn_Type irq) { BOARD.enableIRQ(irq, false); }
+void NVIC_SystemReset() { throw FED3SimStop{"reset"}; }
+
+void ArduinoLowPowerClass::sleep()
+{
+    BOARD.sleep(~0ULL / 2);
+}
+
+void ArduinoLowPowerClass::sleep(int ms)
+{
+    BOARD.sleep((uint64_t)ms * 1000000ULL);
+}
+
+void Stepper::step(int steps)
+{
+    FED3SimBoard &board = BOARD;
+    for (int i = 0; i < abs(steps); i++)
+    {
+        board.advance(stepDelayUs * 1000ULL);
+        board.stepDisk(steps > 0 ? 1 : -1);
+    }
+}
+
+void Adafruit_NeoPixel::show()
+{
+    BOARD.pixelsShown(n);
+}
+
+bool Adafruit_AHTX0::begin()
+{
+    fed3SimBusy(20000000UL);
+    return BOARD.config.tempSensor;
+}
+
+// Room temperature with a small daily swing
+bool Adafruit_AHTX0::getEvent(sensors_event_t *humidity, sensors_event_t *temp)
+{
+    FED3SimBoard &board = BOARD;
+    if (!board.config.tempSensor)
+        return false;
+    fed3SimBusy(80000000UL); // measurement time
+    double day = (board.rtcUnix() % 86400UL) / 86400.0;
+    temp->temperature = (float)(22.0 + 1.0 * sin(TWO_PI * (day - 0.4)) + 0.05 * board.random.normal());
+    humidity->relative_humidity = (float)(40.0 - 3.0 * sin(TWO_PI * (day - 0.4)) + 0.3 * board.random.normal());
+    return true;
+}
+
+void RTC_PCF8523::adjust(const DateTime &dt)
+{
+    BOARD.adjustRTC(dt.unixtime());
+}
+
+DateTime RTC_PCF8523::now()
+{
+    fed3SimBusy(250000UL); // I2C read
+    return DateTime(BOARD.rtcUnix());
+}
@@ -0,0 +1,332 @@
+/*
+  FED3 simulator
+
+  Runs the FED3 library and a sketch on the host against a simulated board, in virtual time. The board
+  has the pokes, the pellet disk and well, the RTC, the SD card (a directory on the host), the display,
+  the pixels, the timers the library uses and the battery. A behavior model plays the mouse: it pokes,
+  holds, and takes pellets from the well. Time jumps while the board sleeps and otherwise moves by the
+  time each wait, transfer or clock read would take, so a week runs in seconds and the SD card ends up
+  with the files the device would have written.
+
+  Everything is seeded, a run with the same sketch, options and seed gives the same files.
+*/
+
+#ifndef FED3_SIM_H
+#define FED3_SIM_H
+
+#include <Arduino.h>
+#include <samd.h>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+class FED3;
+class FED3SimBoard;
+struct FED3_Task;
+
+// Random numbers for the simulated world (xoshiro256**), separate from the device's own generators
+class FED3SimRandom
+{
+public:
+    explicit FED3SimRandom(uint64_t seed = 1) { seed64(seed); }
+    void seed64(uint64_t seed);
+    uint64_t next();
+    double uniform(); // [0, 1)
+    bool chance(double p) { return uniform() < p; }
+    double exponential(double mean) { return -mean * log(1.0 - uniform()); }
+    double normal();
+    double lognormal(double median, double sigma) { return median * exp(sigma * normal()); }
+
+private:
+    uint64_t s[4];
+};
+
+// Parameters of the behavior models. Activity follows the light cycle and comes in bouts of pokes.
+struct FED3SimBehavior
+{
+    double boutsPerHour = 12;      // bout starts per hour in the dark phase, when hungry
+    double lightPhaseFactor = 0.3; // activity in the light phase relative to the dark phase
+    int lightsOn = 7;              // hour the lights come on
+    int lightsOff = 19;            // hour they go off
+    double boutContinue = 0.8;     // chance of another poke in the same bout
+    double boutIntervalS = 2;      // mean time between pokes in a bout
+    double holdMedianS = 0.25;     // nose in the poke
+    double holdSigma = 0.6;
+    double retrievalMedianS = 3; // pellet in the well to pellet taken
+    double retrievalSigma = 0.8;
+    double leftBias = 0.5;          // random mouse: chance of poking left
+    double learningRate = 0.2;      // learning mouse: value update per outcome
+    double inverseTemperature = 4;  // learning mouse: how strongly choices follow the values
+    double satietyPellets = 40;     // learning mouse: recent pellets that halve the bout rate
+    double satietyHalfLifeH = 2;    // learning mouse: how fast recent pellets stop counting
+};
+
+// What the mouse does next: wait, then poke a side and hold it
+struct FED3SimPoke
+{
+    double waitS;
+    bool left;
+    double holdS;
+};
+
+// A behavior model plays the mouse
+class FED3SimMouse
+{
+public:
+    FED3SimMouse(const FED3SimBehavior &behavior) : behavior(behavior) {}
+    virtual ~FED3SimMouse() {}
+    virtual const char *name() const = 0;
+
+    // Drawn when the last poke ends or a pellet has been eaten
+    virtual FED3SimPoke nextPoke(FED3SimBoard &board) = 0;
+    // Seconds from a pellet landing in the well to the mouse taking it
+    virtual double retrievalDelay(FED3SimBoard &board);
+    virtual void poked(FED3SimBoard &board, bool left) {}
+    virtual void pelletLanded(FED3SimBoard &board) {}
+    virtual void pelletEaten(FED3SimBoard &board) {}
+
+    FED3SimBehavior behavior;
+
+protected:
+    double activity(FED3SimBoard &board); // light cycle factor, 1 in the dark phase
+    double boutWait(FED3SimBoard &board, double rateFactor);
+};
+
+// Pokes at random with a fixed side preference
+class FED3SimRandomMouse : public FED3SimMouse
+{
+public:
+    FED3SimRandomMouse(const FED3SimBehavior &behavior) : FED3SimMouse(behavior) {}
+    const char *name() const { return "random"; }
+    FED3SimPoke nextPoke(FED3SimBoard &board);
+};
+
+// Learns which side pays from the pellets that follow its pokes (delta rule, softmax choice) and
+// slows down as it eats
+class FED3SimLearningMouse : public FED3SimMouse
+{
+public:
+    FED3SimLearningMouse(const FED3SimBehavior &behavior) : FED3SimMouse(behavior) {}
+    const char *name() const { return "learning"; }
+    FED3SimPoke nextPoke(FED3SimBoard &board);
+    void poked(FED3SimBoard &board, bool left);
+    void pelletLanded(FED3SimBoard &board);
+    void pelletEaten(FED3SimBoard &board);
+
+    double value[2] = {0.5, 0.5}; // right, left
+
+private:
+    int lastSide = -1; // poke waiting for its outcome
+    bool rewarded = false;
+    double satiety = 0;
+    uint64_t satietyAtNs = 0;
+    void decaySatiety(FED3SimBoard &board);
+};
+
+FED3SimMouse *fed3SimMakeMouse(const char *name, const FED3SimBehavior &behavior);
+
+struct FED3SimConfig
+{
+    uint32_t startUnix = 1736150400UL; // RTC at power on, 2025-01-06 08:00:00
+    double durationS = 86400;
+    uint64_t seed = 1;
+    std::string sdDir = "sim_sd";
+    int deviceNumber = -1;     // written to DeviceNumber.csv when >= 0
+    double mouseStartS = 30;   // the mouse is put in the cage this long after power on
+    double quantumUs = 5;      // time taken by each clock read or pin read
+    bool echoSerial = false;   // Serial output to stdout
+    bool tempSensor = false;   // fit an AHT20
+    long criterionPellets = 0; // note when the mouse has eaten this many pellets
+
+    // Pellet disk and well
+    double stepsPerPellet = 150;  // mean disk steps before a pellet drops
+    double jamProbability = 0.01; // chance a pellet jams the disk instead of dropping
+    double jamClearChance = 0.15; // chance a change of direction frees a jam
+    long hopperPellets = -1;      // pellets in the hopper, -1 for no limit
+
+    // Battery
+    double batteryMah = 4400;
+    double awakeMa = 12;   // processor running
+    double sleepMa = 0.4;  // standby
+    double railMa = 160;   // motor driver and pixels powered
+};
+
+// The reason a run ended
+struct FED3SimStop
+{
+    const char *reason;
+};
+
+struct FED3SimStats
+{
+    unsigned long leftPokes = 0;
+    unsigned long rightPokes = 0;
+    unsigned long pelletsDropped = 0;
+    unsigned long pelletsEaten = 0;
+    uint64_t retrievalNs = 0; // summed over the pellets eaten
+    uint64_t criterionNs = 0; // when criterionPellets were eaten, 0 if not reached
+    unsigned long jams = 0;
+    unsigned long jamsCleared = 0;
+    unsigned long diskSteps = 0;
+    unsigned long sdBytes = 0;
+    unsigned long sdSyncs = 0;
+    unsigned long sdOpens = 0;
+    unsigned long pixelFrames = 0;
+    unsigned long sleeps = 0;
+    unsigned long isrCalls = 0;
+    uint64_t sleptNs = 0;
+    uint64_t railNs = 0;
+    double batteryUsedMah = 0;
+};
+
+class FED3SimBoard
+{
+public:
+    FED3SimBoard(const FED3SimConfig &config = FED3SimConfig());
+    ~FED3SimBoard();
+
+    // The board the calling thread runs, a default one until makeCurrent()
+    static FED3SimBoard &current();
+    void makeCurrent();
+
+    // Run a sketch until the configured duration has passed, returns why it stopped
+    const char *run(std::function<void()> setup, std::function<void()> loop);
+
+    FED3SimConfig config;
+    FED3SimStats stats;
+    FED3SimRandom random;       // the simulated world
+    FED3SimRandom sketchRandom; // random() and randomSeed() in the sketch
+    FED3SimMouse *mouse = NULL; // not owned
+    FED3 *device = NULL;        // the FED3 running on the board, bound by its begin()
+
+    // Called when the sketch changes the level of an output pin, e.g. by tools that time the BNC edges
+    std::function<void(uint8_t pin, int level)> onOutput;
+
+    // Clocks: wall time drives the RTC and the mouse, the processor clock stops in standby
+    uint64_t wallNs = 0;
+    uint64_t awakeNs = 0;
+    double hours() const { return wallNs / 3.6e12; }
+    uint32_t rtcUnix() const { return config.startUnix + rtcOffset + (uint32_t)(wallNs / 1000000000ULL); }
+    void adjustRTC(uint32_t unixTime);
+    int hourOfDay() const;
+    double batteryVolts() const;
+
+    // Time passing in the sketch: waits, transfers and busy loops
+    void advance(uint64_t ns);
+    void tick() { advance(quantumNs); }
+    void sleep(uint64_t ns);
+
+    // Pins and interrupts
+    void pinMode(uint8_t pin, uint8_t mode);
+    void digitalWrite(uint8_t pin, uint8_t value);
+    int digitalRead(uint8_t pin);
+    int analogRead(uint8_t pin);
+    void analogReadResolution(int bits) { adcBits = bits; }
+    void attachInterrupt(uint8_t pin, voidFuncPtr callback, int mode);
+    void detachInterrupt(uint8_t pin);
+    void noInterrupts() { irqEnabled = false; }
+    void interrupts();
+
+    // Peripherals
+    Tc *timer(int n);
+    Gclk gclk;
+    Pm pm;
+    void registerWritten(const void *reg);
+    void enableIRQ(int irq, bool enable);
+    void stepDisk(int direction);
+    void pixelsShown(unsigned int count);
+    void sdOpened() { stats.sdOpens++; }
+    void sdWritten(size_t bytes) { stats.sdBytes += bytes; }
+    void sdSynced();
+    std::string sdPath(const char *name) const;
+
+    bool pelletInWell() const { return wellPellet; }
+    bool poking() const { return pokeSide >= 0; }
+
+private:
+    struct Pin
+    {
+        uint8_t mode = INPUT;
+        uint8_t out = LOW;
+        int8_t drive = -1; // level forced by the outside world, -1 for none
+        voidFuncPtr isr = NULL;
+        int isrMode = CHANGE;
+        bool pending = false;
+    };
+
+    struct Timer
+    {
+        Tc regs;
+        int irq;
+        bool nvic = false;
+        bool running = false;
+        uint64_t dueNs = 0; // processor clock
+        uint64_t periodNs = 0;
+        unsigned long generation = 0;
+    };
+
+    enum EventType
+    {
+        EVENT_POKE_START,
+        EVENT_POKE_END,
+        EVENT_PELLET_LANDS,
+        EVENT_PELLET_TAKEN,
+    };
+
+    struct Event
+    {
+        uint64_t at;
+        uint64_t order;
+        EventType type;
+        unsigned long generation;
+        bool operator<(const Event &other) const { return at != other.at ? at > other.at : order > other.order; }
+    };
+
+    std::priority_queue<Event> events;
+    uint64_t eventOrder = 0;
+    Pin pins[NUM_DIGITAL_PINS];
+    Timer timers[3]; // TC3, TC4, TC5
+    uint64_t quantumNs;
+    uint64_t endNs;
+    uint64_t horizonNs = 0; // nothing can happen before this wall time, see advance()
+    bool horizonDirty = true;
+    int32_t rtcOffset = 0;
+    int adcBits = 10;
+    bool irqEnabled = true;
+    bool inIsr = false;
+    bool asleep = false;
+    bool woke = false;
+
+    // Mouse and dispenser state
+    int pokeSide = -1; // 1 left, 0 right while a poke is held
+    FED3SimPoke plannedPoke;
+    unsigned long pokeGeneration = 0;
+    bool wellPellet = false;
+    bool pelletFalling = false;
+    uint64_t pelletLandedNs = 0;
+    bool diskJammed = false;
+    int diskDirection = 0;
+    long hopper;
+
+    void schedule(uint64_t delayNs, EventType type, unsigned long generation = 0);
+    void scheduleNextPoke();
+    void handleEvent(const Event &event);
+    void moveTo(uint64_t at);
+    void findHorizon();
+    int level(uint8_t pin) const;
+    void drive(uint8_t pin, int value);
+    void raise(uint8_t pin);
+    void dispatch();
+    void fireTimer(Timer &t);
+    bool timerReady(const Timer &t) const;
+    void retime(Timer &t);
+};
+
+// The library's tasks and the FED3 variables they read, by name, for the tools that run a task without a sketch.
+// Variables: FR, timeout, minPokeTime, activePoke, prob_left, prob_right, pelletsToSwitch, taskDelaySec,
+// choiceDelayMs, timedStart, timedEnd.
+const FED3_Task *fed3SimTask(const char *name);
+bool fed3SimSetVariable(FED3 &fed3, const char *name, double value);
+
+#endif
@@ -0,0 +1,601 @@
+// Host versions of the Arduino String and Print classes, SdFat, RTClib's DateTime and the JSON reader
+// used by the simulator
+
+#include "fed3_sim.h"
+#include <SdFat.h>
+#include <RTClib.h>
+#include <ArduinoJson.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**************************************************************************************************************************************************
+                                                                                               String
+**************************************************************************************************************************************************/
+static std::string formatNumber(unsigned long long value, int base)
+{
+    if (base < 2)
+        base = 10;
+    char buffer[66];
+    char *p = buffer + sizeof(buffer) - 1;
+    *p = 0;
+    do
+    {
+        int digit = value % base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        value /= base;
+    } while (value);
+    return p;
+}
+
+// Arduino's float formatting: round to the given decimals, "nan", "inf" and "ovf" for what it can't print
+static std::string formatFloat(double value, int digits)
+{
+    if (isnan(value))
+        return "nan";
+    if (isinf(value))
+        return "inf";
+    if (value > 4294967040.0 || value < -4294967040.0)
+        return "ovf";
+
+    std::string out;
+    if (value < 0.0)
+    {
+        out += '-';
+        value = -value;
+    }
+    double rounding = 0.5;
+    for (int i = 0; i < digits; i++)
+        rounding /= 10.0;
+    value += rounding;
+
+    unsigned long whole = (unsigned long)value;
+    double remainder = value - (double)whole;
+    out += formatNumber(whole, 10);
+    if (digits > 0)
+        out += '.';
+    while (digits-- > 0)
+    {
+        remainder *= 10.0;
+        unsigned int digit = (unsigned int)remainder;
+        out += (char)('0' + digit);
+        remainder -= digit;
+    }
+    return out;
+}
+
+void String::setNumber(long value, unsigned char base)
+{
+    if (value < 0 && base == 10)
+        s = "-" + formatNumber(-(unsigned long long)value, base);
+    else
+        s = formatNumber((unsigned long)value, base);
+}
+
+void String::setNumber(unsigned long value, unsigned char base)
+{
+    s = formatNumber(value, base);
+}
+
+void String::setFloat(double value, unsigned char decimals)
+{
+    s = formatFloat(value, decimals);
+}
+
+bool String::equalsIgnoreCase(const String &other) const
+{
+    if (s.size() != other.s.size())
+        return false;
+    for (size_t i = 0; i < s.size(); i++)
+        if (tolower((unsigned char)s[i]) != tolower((unsigned char)other.s[i]))
+            return false;
+    return true;
+}
+
+void String::trim()
+{
+    size_t begin = 0;
+    while (begin < s.size() && isspace((unsigned char)s[begin]))
+        begin++;
+    size_t end = s.size();
+    while (end > begin && isspace((unsigned char)s[end - 1]))
+        end--;
+    s = s.substr(begin, end - begin);
+}
+
+void String::toUpperCase()
+{
+    for (size_t i = 0; i < s.size(); i++)
+        s[i] = toupper((unsigned char)s[i]);
+}
+
+void String::toLowerCase()
+{
+    for (size_t i = 0; i < s.size(); i++)
+        s[i] = tolower((unsigned char)s[i]);
+}
+
+void String::replace(const String &from, const String &to)
+{
+    if (from.s.empty())
+        return;
+    size_t pos = 0;
+    while ((pos = s.find(from.s, pos)) != std::string::npos)
+    {
+        s.replace(pos, from.s.size(), to.s);
+        pos += to.s.size();
+    }
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Print
+**************************************************************************************************************************************************/
+size_t Print::printNumber(unsigned long long value, int base)
+{
+    return write(formatNumber(value, base).c_str());
+}
+
+size_t Print::print(long value, int base)
+{
+    if (base == 10 && value < 0)
+        return write('-') + printNumber(-(unsigned long long)value, 10);
+    return printNumber((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    return printNumber(value, base);
+}
+
+size_t Print::print(long long value, int base)
+{
+    if (base == 10 && value < 0)
+        return write('-') + printNumber(-(unsigned long long)value, 10);
+    return printNumber((unsigned long long)value, base);
+}
+
+size_t Print::print(unsigned long long value, int base)
+{
+    return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits)
+{
+    return write(formatFloat(value, digits).c_str());
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (n < 0)
+        return 0;
+    return write((const uint8_t *)buffer, n < (int)sizeof(buffer) ? n : sizeof(buffer) - 1);
+}
+
+/**************************************************************************************************************************************************
+                                                                                               SdFat
+**************************************************************************************************************************************************/
+// Card timings: opening walks the FAT, a sync writes the data block, directory entry and FAT
+#define SD_OPEN_NS 2000000UL
+#define SD_SYNC_NS 8000000UL
+#define SD_BYTE_NS 2000UL
+
+thread_local void (*SdFile::dateTime)(uint16_t *date, uint16_t *time) = NULL;
+
+bool FatFile::open(const char *name, int oflag)
+{
+    close();
+    FED3SimBoard &board = FED3SimBoard::current();
+    std::string hostPath = board.sdPath(name);
+    struct stat st;
+    bool exists = ::stat(hostPath.c_str(), &st) == 0;
+    if (exists && S_ISDIR(st.st_mode))
+        return false;
+    if (!exists && !(oflag & O_CREAT))
+        return false;
+    if (exists && (oflag & O_CREAT) && (oflag & O_EXCL))
+        return false;
+
+    const char *mode = "rb";
+    if (oflag & O_WRITE)
+        mode = (!exists || (oflag & O_TRUNC)) ? "w+b" : "r+b";
+    file = fopen(hostPath.c_str(), mode);
+    if (file == NULL)
+        return false;
+    if (oflag & (O_AT_END | O_APPEND))
+        fseek(file, 0, SEEK_END);
+    flags = oflag;
+    path = hostPath;
+    board.sdOpened();
+    fed3SimBusy(SD_OPEN_NS);
+    return true;
+}
+
+bool FatFile::close()
+{
+    if (file == NULL)
+        return false;
+    bool wrote = flags & O_WRITE;
+    fclose(file);
+    file = NULL;
+    if (wrote)
+    {
+        FED3SimBoard::current().sdSynced();
+        fed3SimBusy(SD_SYNC_NS);
+    }
+    return true;
+}
+
+bool FatFile::sync()
+{
+    if (file == NULL)
+        return false;
+    fflush(file);
+    FED3SimBoard::current().sdSynced();
+    fed3SimBusy(SD_SYNC_NS);
+    return true;
+}
+
+bool FatFile::remove()
+{
+    if (file == NULL)
+        return false;
+    std::string victim = path;
+    fclose(file);
+    file = NULL;
+    return ::remove(victim.c_str()) == 0;
+}
+
+bool FatFile::truncate(uint32_t length)
+{
+    if (file == NULL || !(flags & O_WRITE))
+        return false;
+    fflush(file);
+    if (::truncate(path.c_str(), length) != 0)
+        return false;
+    fseek(file, 0, SEEK_END);
+    return true;
+}
+
+size_t FatFile::write(const uint8_t *buffer, size_t size)
+{
+    if (file == NULL || !(flags & O_WRITE))
+        return 0;
+    if (flags & O_APPEND)
+        fseek(file, 0, SEEK_END);
+    size_t n = fwrite(buffer, 1, size, file);
+    FED3SimBoard::current().sdWritten(n);
+    fed3SimBusy(SD_BYTE_NS * n);
+    return n;
+}
+
+int FatFile::available()
+{
+    if (file == NULL)
+        return 0;
+    long left = (long)fileSize() - (long)curPosition();
+    return left > 0 ? (int)left : 0;
+}
+
+int FatFile::read()
+{
+    if (file == NULL)
+        return -1;
+    int c = fgetc(file);
+    return c == EOF ? -1 : c;
+}
+
+int FatFile::read(void *buffer, size_t size)
+{
+    if (file == NULL)
+        return -1;
+    return (int)fread(buffer, 1, size, file);
+}
+
+int FatFile::peek()
+{
+    if (file == NULL)
+        return -1;
+    int c = fgetc(file);
+    if (c == EOF)
+        return -1;
+    ungetc(c, file);
+    return c;
+}
+
+bool FatFile::seekSet(uint32_t position)
+{
+    return file != NULL && fseek(file, position, SEEK_SET) == 0;
+}
+
+uint32_t FatFile::curPosition() const
+{
+    return file ? (uint32_t)ftell(file) : 0;
+}
+
+uint32_t FatFile::fileSize() const
+{
+    if (file == NULL)
+        return 0;
+    fflush(file);
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? (uint32_t)st.st_size : 0;
+}
+
+bool SdFat::begin(uint8_t csPin, uint32_t maxSck)
+{
+    FED3SimBoard &board = FED3SimBoard::current();
+    ::mkdir(board.config.sdDir.c_str(), 0777);
+    fed3SimBusy(100000000UL); // card init
+    struct stat st;
+    return ::stat(board.config.sdDir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool SdFat::exists(const char *name)
+{
+    struct stat st;
+    return ::stat(FED3SimBoard::current().sdPath(name).c_str(), &st) == 0;
+}
+
+bool SdFat::remove(const char *name)
+{
+    return ::remove(FED3SimBoard::current().sdPath(name).c_str()) == 0;
+}
+
+bool SdFat::rename(const char *oldName, const char *newName)
+{
+    FED3SimBoard &board = FED3SimBoard::current();
+    return ::rename(board.sdPath(oldName).c_str(), board.sdPath(newName).c_str()) == 0;
+}
+
+bool SdFat::mkdir(const char *name, bool parents)
+{
+    return ::mkdir(FED3SimBoard::current().sdPath(name).c_str(), 0777) == 0;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               DateTime
+**************************************************************************************************************************************************/
+static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+static uint16_t daysSince2000(uint16_t y, uint8_t m, uint8_t d)
+{
+    if (y >= 2000)
+        y -= 2000;
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; i++)
+        days += daysInMonth[i - 1];
+    if (m > 2 && y % 4 == 0)
+        days++;
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+DateTime::DateTime(uint32_t t)
+{
+    t -= 946684800UL; // seconds from 1970 to 2000
+    ss = t % 60;
+    t /= 60;
+    mm = t % 60;
+    t /= 60;
+    hh = t % 24;
+    uint16_t days = t / 24;
+    uint8_t leap;
+    for (yOff = 0;; yOff++)
+    {
+        leap = yOff % 4 == 0;
+        if (days < 365U + leap)
+            break;
+        days -= 365 + leap;
+    }
+    for (m = 1; m < 12; m++)
+    {
+        uint8_t length = daysInMonth[m - 1];
+        if (leap && m == 2)
+            length++;
+        if (days < length)
+            break;
+        days -= length;
+    }
+    d = days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
+{
+    if (year >= 2000U)
+        year -= 2000U;
+    yOff = year;
+    m = month;
+    d = day;
+    hh = hour;
+    mm = min;
+    ss = sec;
+}
+
+static uint8_t twoDigits(const char *p)
+{
+    return (isdigit((unsigned char)p[0]) ? 10 * (p[0] - '0') : 0) + (p[1] - '0');
+}
+
+// "Jan  6 2025" and "08:00:00"
+DateTime::DateTime(const char *date, const char *time)
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    yOff = twoDigits(date + 9);
+    m = 1;
+    for (int i = 0; i < 12; i++)
+        if (strncmp(date, months + 3 * i, 3) == 0)
+            m = i + 1;
+    d = twoDigits(date + 4);
+    hh = twoDigits(time);
+    mm = twoDigits(time + 3);
+    ss = twoDigits(time + 6);
+}
+
+uint8_t DateTime::dayOfTheWeek() const
+{
+    return (daysSince2000(yOff, m, d) + 6) % 7; // 2000-01-01 was a Saturday
+}
+
+uint32_t DateTime::unixtime() const
+{
+    uint32_t days = daysSince2000(yOff, m, d);
+    return 946684800UL + ((days * 24UL + hh) * 60 + mm) * 60 + ss;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               JSON
+**************************************************************************************************************************************************/
+class JsonReader
+{
+public:
+    JsonReader(const char *p) : p(p) {}
+
+    std::shared_ptr<JsonNode> value()
+    {
+        space();
+        std::shared_ptr<JsonNode> node(new JsonNode);
+        if (*p == '{')
+        {
+            p++;
+            node->isObject = true;
+            node->isNull = false;
+            space();
+            if (*p == '}')
+            {
+                p++;
+                return node;
+            }
+            for (;;)
+            {
+                space();
+                if (*p != '"')
+                    return fail();
+                std::string key = string();
+                space();
+                if (*p++ != ':')
+                    return fail();
+                std::shared_ptr<JsonNode> member = value();
+                if (!member)
+                    return member;
+                node->members[key] = member;
+                space();
+                if (*p == ',')
+                {
+                    p++;
+                    continue;
+                }
+                if (*p++ == '}')
+                    return node;
+                return fail();
+            }
+        }
+        if (*p == '[')
+        {
+            p++;
+            space();
+            if (*p == ']')
+            {
+                p++;
+                return node;
+            }
+            for (;;)
+            {
+                if (!value())
+                    return fail();
+                space();
+                if (*p == ',')
+                {
+                    p++;
+                    continue;
+                }
+                if (*p++ == ']')
+                    return node;
+                return fail();
+            }
+        }
+        if (*p == '"')
+        {
+            node->text = string();
+            node->isNull = false;
+            return node;
+        }
+        if (strncmp(p, "null", 4) == 0)
+        {
+            p += 4;
+            return node;
+        }
+        const char *start = p;
+        while (*p && (isalnum((unsigned char)*p) || *p == '-' || *p == '+' || *p == '.'))
+            p++;
+        if (p == start)
+            return fail();
+        node->text.assign(start, p - start);
+        node->isNull = false;
+        return node;
+    }
+
+    bool failed = false;
+
+private:
+    const char *p;
+
+    std::shared_ptr<JsonNode> fail()
+    {
+        failed = true;
+        return std::shared_ptr<JsonNode>();
+    }
+
+    void space()
+    {
+        while (*p && isspace((unsigned char)*p))
+            p++;
+    }
+
+    std::string string()
+    {
+        std::string out;
+        p++; // opening quote
+        while (*p && *p != '"')
+        {
+            if (*p == '\\' && p[1])
+            {
+                p++;
+                switch (*p)
+                {
+                case 'n':
+                    out += '\n';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                default:
+                    out += *p;
+                    break;
+                }
+                p++;
+                continue;
+            }
+            out += *p++;
+        }
+        if (*p == '"')
+            p++;
+        return out;
+    }
+};
+
+DeserializationError deserializeJson(JsonDocument &doc, const char *json)
+{
+    JsonReader reader(json);
+    std::shared_ptr<JsonNode> root = reader.value();
+    if (!root || reader.failed)
+    {
+        doc.root.reset();
+        return DeserializationError("InvalidInput");
+    }
+    doc.root = root;
+    return DeserializationError();
+}
@@ -0,0 +1,150 @@
+/*
+  Command line front end for the FED3 simulator, linked with one sketch.
+
+  Build (from the repository root, with the sketch's setup() and loop()):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Isrc -include Arduino.h \
+        -x c++ examples/1_Programs/FR_Customizable/FR_Customizable.ino -x none \
+        src/FED3*.cpp extras/sim/fed3_sim*.cpp -o fed3_sim
+
+  Usage:
+    fed3_sim [--days N | --hours N] [--seed N] [--sd DIR] [--mouse random|learning] [--jam P]
+             [--device N] [--start YYYY-MM-DDTHH:MM:SS] [--quantum-us N] [--serial] [--screen FILE.pbm]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <chrono>
+
+void setup();
+void loop();
+
+class FilePrint : public Print
+{
+public:
+    FilePrint(FILE *file) : file(file) {}
+    size_t write(uint8_t c) { return fputc(c, file) == EOF ? 0 : 1; }
+    using Print::write;
+
+private:
+    FILE *file;
+};
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: fed3_sim [--days N | --hours N] [--seed N] [--sd DIR] [--mouse random|learning] [--jam P]\n"
+            "                [--device N] [--start YYYY-MM-DDTHH:MM:SS] [--quantum-us N] [--serial] [--screen FILE.pbm]\n");
+}
+
+static bool parseStart(const char *text, uint32_t &unixTime)
+{
+    int y, mo, d, h = 0, mi = 0, s = 0;
+    if (sscanf(text, "%d-%d-%dT%d:%d:%d", &y, &mo, &d, &h, &mi, &s) < 3)
+        return false;
+    unixTime = DateTime(y, mo, d, h, mi, s).unixtime();
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    FED3SimConfig config;
+    const char *mouseName = "learning";
+    const char *screenPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool takesValue = true;
+        if (strcmp(arg, "--serial") == 0)
+        {
+            config.echoSerial = true;
+            takesValue = false;
+        }
+        else if (value == NULL)
+        {
+            usage();
+            return 2;
+        }
+        else if (strcmp(arg, "--days") == 0)
+            config.durationS = atof(value) * 86400.0;
+        else if (strcmp(arg, "--hours") == 0)
+            config.durationS = atof(value) * 3600.0;
+        else if (strcmp(arg, "--seed") == 0)
+            config.seed = strtoull(value, NULL, 10);
+        else if (strcmp(arg, "--sd") == 0)
+            config.sdDir = value;
+        else if (strcmp(arg, "--mouse") == 0)
+            mouseName = value;
+        else if (strcmp(arg, "--jam") == 0)
+            config.jamProbability = atof(value);
+        else if (strcmp(arg, "--device") == 0)
+            config.deviceNumber = atoi(value);
+        else if (strcmp(arg, "--quantum-us") == 0)
+            config.quantumUs = atof(value);
+        else if (strcmp(arg, "--screen") == 0)
+            screenPath = value;
+        else if (strcmp(arg, "--start") == 0)
+        {
+            if (!parseStart(value, config.startUnix))
+            {
+                usage();
+                return 2;
+            }
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+        if (takesValue)
+            i++;
+    }
+
+    FED3SimBehavior behavior;
+    FED3SimMouse *mouse = fed3SimMakeMouse(mouseName, behavior);
+    if (mouse == NULL)
+    {
+        usage();
+        return 2;
+    }
+
+    FED3SimBoard board(config);
+    board.mouse = mouse;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    const char *reason = board.run(setup, loop);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    FED3 *fed3 = board.device;
+    const FED3SimStats &stats = board.stats;
+    double days = board.wallNs / 8.64e13;
+    printf("stopped:          %s after %.2f days (%.2f s on the host)\n", reason, days, seconds);
+    printf("mouse:            %s, %lu left and %lu right pokes\n", mouse->name(), stats.leftPokes, stats.rightPokes);
+    if (fed3)
+        printf("device counts:    %d left, %d right, %d pellets\n", fed3->LeftCount, fed3->RightCount, fed3->PelletCount);
+    printf("pellets:          %lu dropped, %lu eaten, %lu jams (%lu cleared by reversing)\n", stats.pelletsDropped,
+           stats.pelletsEaten, stats.jams, stats.jamsCleared);
+    printf("disk steps:       %lu\n", stats.diskSteps);
+    if (fed3)
+        printf("display:          %lu frames, %lu requests coalesced, worst frame %lu us\n", fed3->displayFramesRendered,
+               fed3->displayUpdatesCoalesced, fed3->displayWorstRenderUs);
+    printf("pixels:           %lu frames, rail on %.1f s\n", stats.pixelFrames, stats.railNs / 1e9);
+    printf("SD card:          %lu bytes, %lu syncs, %lu opens\n", stats.sdBytes, stats.sdSyncs, stats.sdOpens);
+    printf("sleep:            %lu sleeps, %.1f%% of the time\n", stats.sleeps,
+           board.wallNs ? 100.0 * stats.sleptNs / board.wallNs : 0.0);
+    printf("battery:          %.1f mAh used, %.2f V, %.1f mAh/day\n", stats.batteryUsedMah, board.batteryVolts(),
+           days > 0 ? stats.batteryUsedMah / days : 0.0);
+
+    if (screenPath && fed3)
+    {
+        FILE *f = fopen(screenPath, "wb");
+        if (f)
+        {
+            FilePrint out(f);
+            fed3->display.writePBM(out);
+            fclose(f);
+        }
+    }
+    delete mouse;
+    return 0;
+}
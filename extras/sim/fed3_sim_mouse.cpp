@@ -0,0 +1,90 @@
+// Behavior models for the simulated mouse
+
+#include "fed3_sim.h"
+
+// Dark phase activity is 1, the light phase is scaled down
+double FED3SimMouse::activity(FED3SimBoard &board)
+{
+    int hour = board.hourOfDay();
+    bool dark = behavior.lightsOn < behavior.lightsOff ? (hour < behavior.lightsOn || hour >= behavior.lightsOff)
+                                                       : (hour >= behavior.lightsOff && hour < behavior.lightsOn);
+    return dark ? 1.0 : behavior.lightPhaseFactor;
+}
+
+// Time to the next poke: usually the next poke of the bout, otherwise the start of the next bout
+double FED3SimMouse::boutWait(FED3SimBoard &board, double rateFactor)
+{
+    if (board.random.chance(behavior.boutContinue))
+        return board.random.exponential(behavior.boutIntervalS);
+    double rate = behavior.boutsPerHour * activity(board) * rateFactor;
+    if (rate < 0.01)
+        rate = 0.01;
+    return board.random.exponential(3600.0 / rate);
+}
+
+double FED3SimMouse::retrievalDelay(FED3SimBoard &board)
+{
+    return board.random.lognormal(behavior.retrievalMedianS, behavior.retrievalSigma);
+}
+
+FED3SimPoke FED3SimRandomMouse::nextPoke(FED3SimBoard &board)
+{
+    FED3SimPoke poke;
+    poke.waitS = boutWait(board, 1.0);
+    poke.left = board.random.chance(behavior.leftBias);
+    poke.holdS = board.random.lognormal(behavior.holdMedianS, behavior.holdSigma);
+    return poke;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Learning mouse
+**************************************************************************************************************************************************/
+void FED3SimLearningMouse::decaySatiety(FED3SimBoard &board)
+{
+    double hours = (board.wallNs - satietyAtNs) / 3.6e12;
+    satiety *= pow(0.5, hours / behavior.satietyHalfLifeH);
+    satietyAtNs = board.wallNs;
+}
+
+// Sides are chosen by softmax over their values
+FED3SimPoke FED3SimLearningMouse::nextPoke(FED3SimBoard &board)
+{
+    decaySatiety(board);
+    double hunger = 1.0 / (1.0 + satiety / behavior.satietyPellets);
+
+    FED3SimPoke poke;
+    poke.waitS = boutWait(board, hunger);
+    double pLeft = 1.0 / (1.0 + exp(-behavior.inverseTemperature * (value[1] - value[0])));
+    poke.left = board.random.chance(pLeft);
+    poke.holdS = board.random.lognormal(behavior.holdMedianS, behavior.holdSigma);
+    return poke;
+}
+
+// A poke closes the previous one's outcome: rewarded if a pellet landed in between
+void FED3SimLearningMouse::poked(FED3SimBoard &board, bool left)
+{
+    if (lastSide >= 0)
+        value[lastSide] += behavior.learningRate * ((rewarded ? 1.0 : 0.0) - value[lastSide]);
+    lastSide = left ? 1 : 0;
+    rewarded = false;
+}
+
+void FED3SimLearningMouse::pelletLanded(FED3SimBoard &board)
+{
+    rewarded = true;
+}
+
+void FED3SimLearningMouse::pelletEaten(FED3SimBoard &board)
+{
+    decaySatiety(board);
+    satiety += 1;
+}
+
+FED3SimMouse *fed3SimMakeMouse(const char *name, const FED3SimBehavior &behavior)
+{
+    if (strcmp(name, "random") == 0)
+        return new FED3SimRandomMouse(behavior);
+    if (strcmp(name, "learning") == 0)
+        return new FED3SimLearningMouse(behavior);
+    return NULL;
+}
@@ -0,0 +1,60 @@
+// The library's tasks and task variables by name, for fed3_sweep and fed3_fleet
+
+#include "fed3_sim.h"
+#include <FED3.h>
+
+struct SimTask
+{
+    const char *name;
+    const FED3_Task *task;
+};
+
+static const SimTask simTasks[] = {
+    {"fr", &FED3_FixedRatio},
+    {"pr", &FED3_ProgressiveRatio},
+    {"extinction", &FED3_Extinction},
+    {"pavlovian", &FED3_Pavlovian},
+    {"bandit", &FED3_Bandit},
+    {"timed", &FED3_TimedFeeding},
+};
+
+struct SimVariable
+{
+    const char *name;
+    void (*set)(FED3 &fed3, double value);
+};
+
+static const SimVariable simVariables[] = {
+    {"FR", [](FED3 &f, double v) { f.FR = (int)v; }},
+    {"timeout", [](FED3 &f, double v) { f.timeout = (int)v; }},
+    {"minPokeTime", [](FED3 &f, double v) { f.minPokeTime = (int)v; }},
+    {"activePoke", [](FED3 &f, double v) { f.activePoke = v != 0; }},
+    {"prob_left", [](FED3 &f, double v) { f.prob_left = (int)v; }},
+    {"prob_right", [](FED3 &f, double v) { f.prob_right = (int)v; }},
+    {"pelletsToSwitch", [](FED3 &f, double v) { f.pelletsToSwitch = (int)v; }},
+    {"taskDelaySec", [](FED3 &f, double v) { f.taskDelaySec = (int)v; }},
+    {"choiceDelayMs", [](FED3 &f, double v) { f.choiceDelayMs = (unsigned long)v; }},
+    {"timedStart", [](FED3 &f, double v) { f.timedStart = (int)v; }},
+    {"timedEnd", [](FED3 &f, double v) { f.timedEnd = (int)v; }},
+};
+
+const FED3_Task *fed3SimTask(const char *name)
+{
+    for (size_t i = 0; i < sizeof(simTasks) / sizeof(simTasks[0]); i++)
+        if (strcmp(name, simTasks[i].name) == 0)
+            return simTasks[i].task;
+    return NULL;
+}
+
+bool fed3SimSetVariable(FED3 &fed3, const char *name, double value)
+{
+    for (size_t i = 0; i < sizeof(simVariables) / sizeof(simVariables[0]); i++)
+    {
+        if (strcmp(name, simVariables[i].name) == 0)
+        {
+            simVariables[i].set(fed3, value);
+            return true;
+        }
+    }
+    return false;
+}
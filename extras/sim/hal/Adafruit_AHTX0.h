@@ -0,0 +1,20 @@
+#ifndef FED3_SIM_ADAFRUIT_AHTX0_H
+#define FED3_SIM_ADAFRUIT_AHTX0_H
+
+#include <Arduino.h>
+
+typedef struct
+{
+    float temperature;
+    float relative_humidity;
+} sensors_event_t;
+
+// Present only when the simulated board is fitted with a sensor
+class Adafruit_AHTX0
+{
+public:
+    bool begin();
+    bool getEvent(sensors_event_t *humidity, sensors_event_t *temp);
+};
+
+#endif
@@ -0,0 +1,440 @@
+#ifndef FED3_SIM_ADAFRUIT_GFX_H
+#define FED3_SIM_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+// Drawing primitives and GFX font text with the Adafruit_GFX interface, so the FED3 screen is drawn
+// into the driver's frame buffer as on the device. The built-in 5x7 font is not included, text
+// without a font only moves the cursor.
+
+typedef struct
+{
+    uint16_t bitmapOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+} GFXglyph;
+
+typedef struct
+{
+    uint8_t *bitmap;
+    GFXglyph *glyph;
+    uint16_t first;
+    uint16_t last;
+    uint8_t yAdvance;
+} GFXfont;
+
+#ifndef _swap_int16_t
+#define _swap_int16_t(a, b) \
+    {                       \
+        int16_t t = a;      \
+        a = b;              \
+        b = t;              \
+    }
+#endif
+
+class Adafruit_GFX : public Print
+{
+public:
+    Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h) {}
+    virtual ~Adafruit_GFX() {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    virtual void startWrite() {}
+    virtual void writePixel(int16_t x, int16_t y, uint16_t color) { drawPixel(x, y, color); }
+    virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) { fillRect(x, y, w, h, color); }
+    virtual void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { drawFastVLine(x, y, h, color); }
+    virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { drawFastHLine(x, y, w, color); }
+    virtual void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+    {
+        bool steep = abs(y1 - y0) > abs(x1 - x0);
+        if (steep)
+        {
+            _swap_int16_t(x0, y0);
+            _swap_int16_t(x1, y1);
+        }
+        if (x0 > x1)
+        {
+            _swap_int16_t(x0, x1);
+            _swap_int16_t(y0, y1);
+        }
+        int16_t dx = x1 - x0, dy = abs(y1 - y0);
+        int16_t err = dx / 2;
+        int16_t ystep = y0 < y1 ? 1 : -1;
+        for (; x0 <= x1; x0++)
+        {
+            if (steep)
+                writePixel(y0, x0, color);
+            else
+                writePixel(x0, y0, color);
+            err -= dy;
+            if (err < 0)
+            {
+                y0 += ystep;
+                err += dx;
+            }
+        }
+    }
+    virtual void endWrite() {}
+
+    virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+    {
+        for (int16_t i = 0; i < h; i++)
+            drawPixel(x, y + i, color);
+    }
+    virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+    {
+        for (int16_t i = 0; i < w; i++)
+            drawPixel(x + i, y, color);
+    }
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        for (int16_t i = x; i < x + w; i++)
+            drawFastVLine(i, y, h, color);
+    }
+    virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+    virtual void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+    {
+        if (x0 == x1)
+        {
+            if (y0 > y1)
+                _swap_int16_t(y0, y1);
+            drawFastVLine(x0, y0, y1 - y0 + 1, color);
+        }
+        else if (y0 == y1)
+        {
+            if (x0 > x1)
+                _swap_int16_t(x0, x1);
+            drawFastHLine(x0, y0, x1 - x0 + 1, color);
+        }
+        else
+        {
+            writeLine(x0, y0, x1, y1, color);
+        }
+    }
+    virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        drawFastHLine(x, y, w, color);
+        drawFastHLine(x, y + h - 1, w, color);
+        drawFastVLine(x, y, h, color);
+        drawFastVLine(x + w - 1, y, h, color);
+    }
+
+    void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
+    {
+        int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+        drawPixel(x0, y0 + r, color);
+        drawPixel(x0, y0 - r, color);
+        drawPixel(x0 + r, y0, color);
+        drawPixel(x0 - r, y0, color);
+        while (x < y)
+        {
+            if (f >= 0)
+            {
+                y--;
+                ddF_y += 2;
+                f += ddF_y;
+            }
+            x++;
+            ddF_x += 2;
+            f += ddF_x;
+            drawPixel(x0 + x, y0 + y, color);
+            drawPixel(x0 - x, y0 + y, color);
+            drawPixel(x0 + x, y0 - y, color);
+            drawPixel(x0 - x, y0 - y, color);
+            drawPixel(x0 + y, y0 + x, color);
+            drawPixel(x0 - y, y0 + x, color);
+            drawPixel(x0 + y, y0 - x, color);
+            drawPixel(x0 - y, y0 - x, color);
+        }
+    }
+    void drawCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, uint16_t color)
+    {
+        int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+        while (x < y)
+        {
+            if (f >= 0)
+            {
+                y--;
+                ddF_y += 2;
+                f += ddF_y;
+            }
+            x++;
+            ddF_x += 2;
+            f += ddF_x;
+            if (corners & 0x4)
+            {
+                drawPixel(x0 + x, y0 + y, color);
+                drawPixel(x0 + y, y0 + x, color);
+            }
+            if (corners & 0x2)
+            {
+                drawPixel(x0 + x, y0 - y, color);
+                drawPixel(x0 + y, y0 - x, color);
+            }
+            if (corners & 0x8)
+            {
+                drawPixel(x0 - y, y0 + x, color);
+                drawPixel(x0 - x, y0 + y, color);
+            }
+            if (corners & 0x1)
+            {
+                drawPixel(x0 - y, y0 - x, color);
+                drawPixel(x0 - x, y0 - y, color);
+            }
+        }
+    }
+    void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
+    {
+        drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+        fillCircleHelper(x0, y0, r, 3, 0, color);
+    }
+    void fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta, uint16_t color)
+    {
+        int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r, px = x, py = y;
+        delta++;
+        while (x < y)
+        {
+            if (f >= 0)
+            {
+                y--;
+                ddF_y += 2;
+                f += ddF_y;
+            }
+            x++;
+            ddF_x += 2;
+            f += ddF_x;
+            if (x < (y + 1))
+            {
+                if (corners & 1)
+                    drawFastVLine(x0 + x, y0 - y, 2 * y + delta, color);
+                if (corners & 2)
+                    drawFastVLine(x0 - x, y0 - y, 2 * y + delta, color);
+            }
+            if (y != py)
+            {
+                if (corners & 1)
+                    drawFastVLine(x0 + py, y0 - px, 2 * px + delta, color);
+                if (corners & 2)
+                    drawFastVLine(x0 - py, y0 - px, 2 * px + delta, color);
+                py = y;
+            }
+            px = x;
+        }
+    }
+    void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color)
+    {
+        int16_t max_radius = ((w < h) ? w : h) / 2;
+        if (r > max_radius)
+            r = max_radius;
+        drawFastHLine(x + r, y, w - 2 * r, color);
+        drawFastHLine(x + r, y + h - 1, w - 2 * r, color);
+        drawFastVLine(x, y + r, h - 2 * r, color);
+        drawFastVLine(x + w - 1, y + r, h - 2 * r, color);
+        drawCircleHelper(x + r, y + r, r, 1, color);
+        drawCircleHelper(x + w - r - 1, y + r, r, 2, color);
+        drawCircleHelper(x + w - r - 1, y + h - r - 1, r, 4, color);
+        drawCircleHelper(x + r, y + h - r - 1, r, 8, color);
+    }
+    void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color)
+    {
+        int16_t max_radius = ((w < h) ? w : h) / 2;
+        if (r > max_radius)
+            r = max_radius;
+        fillRect(x + r, y, w - 2 * r, h, color);
+        fillCircleHelper(x + w - r - 1, y + r, r, 1, h - 2 * r - 1, color);
+        fillCircleHelper(x + r, y + r, r, 2, h - 2 * r - 1, color);
+    }
+    void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color)
+    {
+        drawLine(x0, y0, x1, y1, color);
+        drawLine(x1, y1, x2, y2, color);
+        drawLine(x2, y2, x0, y0, color);
+    }
+    void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color)
+    {
+        // Sort by y, then fill one scanline at a time between the long edge and the two short ones
+        if (y0 > y1)
+        {
+            _swap_int16_t(y0, y1);
+            _swap_int16_t(x0, x1);
+        }
+        if (y1 > y2)
+        {
+            _swap_int16_t(y2, y1);
+            _swap_int16_t(x2, x1);
+        }
+        if (y0 > y1)
+        {
+            _swap_int16_t(y0, y1);
+            _swap_int16_t(x0, x1);
+        }
+        if (y0 == y2)
+        {
+            int16_t a = min(min(x0, x1), x2), b = max(max(x0, x1), x2);
+            drawFastHLine(a, y0, b - a + 1, color);
+            return;
+        }
+        for (int16_t y = y0; y <= y2; y++)
+        {
+            int16_t a = x0 + (int32_t)(x2 - x0) * (y - y0) / (y2 - y0);
+            int16_t b;
+            if (y < y1 || y1 == y2)
+                b = (y1 == y0) ? x1 : x0 + (int32_t)(x1 - x0) * (y - y0) / (y1 - y0);
+            else
+                b = x1 + (int32_t)(x2 - x1) * (y - y1) / (y2 - y1);
+            if (a > b)
+                _swap_int16_t(a, b);
+            drawFastHLine(a, y, b - a + 1, color);
+        }
+    }
+    void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color)
+    {
+        int16_t byteWidth = (w + 7) / 8;
+        for (int16_t j = 0; j < h; j++)
+            for (int16_t i = 0; i < w; i++)
+                if (bitmap[j * byteWidth + i / 8] & (0x80 >> (i & 7)))
+                    drawPixel(x + i, y + j, color);
+    }
+
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size_x, uint8_t size_y)
+    {
+        if (!gfxFont || c < gfxFont->first || c > gfxFont->last)
+            return;
+        GFXglyph *glyph = &gfxFont->glyph[c - gfxFont->first];
+        const uint8_t *bitmap = gfxFont->bitmap;
+        uint16_t bo = glyph->bitmapOffset;
+        uint8_t w = glyph->width, h = glyph->height, bits = 0, bit = 0;
+        int8_t xo = glyph->xOffset, yo = glyph->yOffset;
+        for (uint8_t yy = 0; yy < h; yy++)
+        {
+            for (uint8_t xx = 0; xx < w; xx++)
+            {
+                if (!(bit++ & 7))
+                    bits = bitmap[bo++];
+                if (bits & 0x80)
+                {
+                    if (size_x == 1 && size_y == 1)
+                        writePixel(x + xo + xx, y + yo + yy, color);
+                    else
+                        writeFillRect(x + (xo + xx) * size_x, y + (yo + yy) * size_y, size_x, size_y, color);
+                }
+                bits <<= 1;
+            }
+        }
+    }
+
+    virtual size_t write(uint8_t c)
+    {
+        if (!gfxFont)
+        {
+            cursor_x += 6 * textsize_x;
+            return 1;
+        }
+        if (c == '\n')
+        {
+            cursor_x = 0;
+            cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+        }
+        else if (c != '\r' && c >= gfxFont->first && c <= gfxFont->last)
+        {
+            GFXglyph *glyph = &gfxFont->glyph[c - gfxFont->first];
+            if (glyph->width > 0 && glyph->height > 0)
+            {
+                if (wrap && (cursor_x + textsize_x * (glyph->xOffset + glyph->width)) > _width)
+                {
+                    cursor_x = 0;
+                    cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+                }
+                drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x, textsize_y);
+            }
+            cursor_x += glyph->xAdvance * (int16_t)textsize_x;
+        }
+        return 1;
+    }
+    using Print::write;
+
+    void getTextBounds(const char *str, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h)
+    {
+        int16_t minx = 0x7FFF, miny = 0x7FFF, maxx = -1, maxy = -1;
+        for (; str && *str; str++)
+        {
+            unsigned char c = *str;
+            if (!gfxFont)
+            {
+                minx = min(minx, x);
+                miny = min(miny, y);
+                x += 6 * textsize_x;
+                maxx = max(maxx, (int16_t)(x - 1));
+                maxy = max(maxy, (int16_t)(y + 8 * textsize_y - 1));
+                continue;
+            }
+            if (c < gfxFont->first || c > gfxFont->last)
+                continue;
+            GFXglyph *glyph = &gfxFont->glyph[c - gfxFont->first];
+            int16_t gx = x + glyph->xOffset * textsize_x, gy = y + glyph->yOffset * textsize_y;
+            minx = min(minx, gx);
+            miny = min(miny, gy);
+            maxx = max(maxx, (int16_t)(gx + glyph->width * textsize_x - 1));
+            maxy = max(maxy, (int16_t)(gy + glyph->height * textsize_y - 1));
+            x += glyph->xAdvance * textsize_x;
+        }
+        *x1 = maxx >= minx ? minx : x;
+        *y1 = maxy >= miny ? miny : y;
+        *w = maxx >= minx ? maxx - minx + 1 : 0;
+        *h = maxy >= miny ? maxy - miny + 1 : 0;
+    }
+    void getTextBounds(const String &str, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h)
+    {
+        getTextBounds(str.c_str(), x, y, x1, y1, w, h);
+    }
+
+    void setCursor(int16_t x, int16_t y)
+    {
+        cursor_x = x;
+        cursor_y = y;
+    }
+    void setTextColor(uint16_t c) { textcolor = textbgcolor = c; }
+    void setTextColor(uint16_t c, uint16_t bg)
+    {
+        textcolor = c;
+        textbgcolor = bg;
+    }
+    void setTextSize(uint8_t s) { textsize_x = textsize_y = s ? s : 1; }
+    void setTextSize(uint8_t sx, uint8_t sy)
+    {
+        textsize_x = sx ? sx : 1;
+        textsize_y = sy ? sy : 1;
+    }
+    void setTextWrap(bool w) { wrap = w; }
+    void cp437(bool x = true) { _cp437 = x; }
+    void setFont(const GFXfont *f) { gfxFont = (GFXfont *)f; }
+    void setRotation(uint8_t r)
+    {
+        rotation = r & 3;
+        _width = (rotation & 1) ? HEIGHT : WIDTH;
+        _height = (rotation & 1) ? WIDTH : HEIGHT;
+    }
+    uint8_t getRotation() const { return rotation; }
+    int16_t getCursorX() const { return cursor_x; }
+    int16_t getCursorY() const { return cursor_y; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+    void invertDisplay(bool) {}
+
+protected:
+    int16_t WIDTH, HEIGHT;
+    int16_t _width, _height;
+    int16_t cursor_x = 0, cursor_y = 0;
+    uint16_t textcolor = 0xFFFF, textbgcolor = 0xFFFF;
+    uint8_t textsize_x = 1, textsize_y = 1;
+    uint8_t rotation = 0;
+    bool wrap = true;
+    bool _cp437 = false;
+    GFXfont *gfxFont = NULL;
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef FED3_SIM_ADAFRUIT_I2CREGISTER_H
+#define FED3_SIM_ADAFRUIT_I2CREGISTER_H
+
+// Not used by the simulated peripherals
+#include <Arduino.h>
+
+#endif
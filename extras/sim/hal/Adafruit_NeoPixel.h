@@ -0,0 +1,49 @@
+#ifndef FED3_SIM_ADAFRUIT_NEOPIXEL_H
+#define FED3_SIM_ADAFRUIT_NEOPIXEL_H
+
+#include <Arduino.h>
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_GRBW ((3 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_RGBW ((3 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+// show() takes the time the frame takes on the wire and is reported to the board
+class Adafruit_NeoPixel
+{
+public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, uint16_t type = NEO_GRB + NEO_KHZ800)
+        : n(n > 64 ? 64 : n), brightness(0) { clear(); }
+
+    void begin() {}
+    void show();
+    void setPixelColor(uint16_t i, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) { setPixelColor(i, Color(r, g, b, w)); }
+    void setPixelColor(uint16_t i, uint32_t c)
+    {
+        if (i < n)
+            pixels[i] = c;
+    }
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0)
+    {
+        uint16_t end = (count == 0 || first + count > n) ? n : first + count;
+        for (uint16_t i = first; i < end; i++)
+            pixels[i] = c;
+    }
+    void clear() { fill(0); }
+    void setBrightness(uint8_t b) { brightness = b; }
+    uint8_t getBrightness() const { return brightness ? brightness - 1 : 255; }
+    uint32_t getPixelColor(uint16_t i) const { return i < n ? pixels[i] : 0; }
+    uint16_t numPixels() const { return n; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w) { return ((uint32_t)w << 24) | Color(r, g, b); }
+
+private:
+    uint16_t n;
+    uint8_t brightness;
+    uint32_t pixels[64];
+};
+
+#endif
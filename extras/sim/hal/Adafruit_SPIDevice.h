@@ -0,0 +1,40 @@
+#ifndef FED3_SIM_ADAFRUIT_SPIDEVICE_H
+#define FED3_SIM_ADAFRUIT_SPIDEVICE_H
+
+#include <Arduino.h>
+#include <SPI.h>
+
+typedef enum
+{
+    SPI_BITORDER_MSBFIRST,
+    SPI_BITORDER_LSBFIRST,
+} BusIOBitOrder;
+
+// Transfers go nowhere but take as long as the bits take to clock out
+class Adafruit_SPIDevice
+{
+public:
+    Adafruit_SPIDevice(int8_t cs, int8_t sck, int8_t miso, int8_t mosi, uint32_t freq = 1000000,
+                       BusIOBitOrder dataOrder = SPI_BITORDER_MSBFIRST, uint8_t dataMode = SPI_MODE0)
+        : freq(freq ? freq : 1000000) {}
+
+    bool begin() { return true; }
+    void beginTransaction() {}
+    void endTransaction() {}
+    uint8_t transfer(uint8_t)
+    {
+        fed3SimBusy(8000000000UL / freq);
+        return 0;
+    }
+    void transfer(uint8_t *, size_t len) { fed3SimBusy(8000000000UL / freq * len); }
+    bool write(const uint8_t *buffer, size_t len, const uint8_t * = NULL, size_t = 0)
+    {
+        transfer((uint8_t *)buffer, len);
+        return true;
+    }
+
+private:
+    uint32_t freq;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef FED3_SIM_ADAFRUIT_SHARPMEM_H
+#define FED3_SIM_ADAFRUIT_SHARPMEM_H
+
+#include "FED3_SharpMem.h"
+
+// Sketches that drive the display themselves get the library's driver, which speaks the same protocol
+class Adafruit_SharpMem : public FED3_SharpMem
+{
+public:
+    Adafruit_SharpMem(uint8_t clk, uint8_t mosi, uint8_t cs, uint16_t width = 96, uint16_t height = 96, uint32_t freq = 2000000)
+        : FED3_SharpMem(clk, mosi, cs, width, height, freq) {}
+};
+
+#endif
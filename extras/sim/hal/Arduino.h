@@ -0,0 +1,389 @@
+/*
+  Arduino core for the FED3 simulator
+
+  Just enough of the Arduino API for the FED3 library and its example sketches, running against the
+  simulated board in fed3_sim.h instead of hardware. Time only moves when the sketch waits or reads a
+  clock or an input, see FED3SimBoard::advance(). The pin map is the Feather M0 one, so the library
+  is built with -D__arm__ and takes its M0 code paths.
+*/
+
+#ifndef FED3_SIM_ARDUINO_H
+#define FED3_SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define INPUT_PULLDOWN 0x3
+
+// Interrupt modes, LOW and HIGH also trigger on the level
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+// Feather M0 pins
+#define NUM_DIGITAL_PINS 26
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 9 // battery divider
+#define LED_BUILTIN 13
+#define digitalPinToInterrupt(p) (p)
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b) (1UL << (b))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+template <class A, class B>
+inline auto min(A a, B b) -> decltype(a + b)
+{
+    return a < b ? a : b;
+}
+
+template <class A, class B>
+inline auto max(A a, B b) -> decltype(a + b)
+{
+    return a > b ? a : b;
+}
+
+template <class T, class L, class H>
+inline T constrain(T x, L low, H high)
+{
+    return x < low ? low : (x > high ? high : x);
+}
+
+template <class T>
+inline T sq(T x)
+{
+    return x * x;
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+inline double radians(double deg) { return deg * DEG_TO_RAD; }
+inline double degrees(double rad) { return rad * RAD_TO_DEG; }
+
+/**************************************************************************************************************************************************
+                                                                                               String
+**************************************************************************************************************************************************/
+class String
+{
+public:
+    String(const char *s = "") : s(s ? s : "") {}
+    String(const std::string &s) : s(s) {}
+    explicit String(char c) : s(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10) { setNumber(value, base); }
+    explicit String(int value, unsigned char base = 10) { setNumber(value, base); }
+    explicit String(unsigned int value, unsigned char base = 10) { setNumber(value, base); }
+    explicit String(long value, unsigned char base = 10) { setNumber(value, base); }
+    explicit String(unsigned long value, unsigned char base = 10) { setNumber(value, base); }
+    explicit String(float value, unsigned char decimals = 2) { setFloat(value, decimals); }
+    explicit String(double value, unsigned char decimals = 2) { setFloat(value, decimals); }
+
+    unsigned int length() const { return s.size(); }
+    bool isEmpty() const { return s.empty(); }
+    const char *c_str() const { return s.c_str(); }
+    void reserve(unsigned int size) { s.reserve(size); }
+
+    char charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+    void setCharAt(unsigned int i, char c)
+    {
+        if (i < s.size())
+            s[i] = c;
+    }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char &operator[](unsigned int i) { return s[i]; }
+
+    bool equals(const String &other) const { return s == other.s; }
+    bool equalsIgnoreCase(const String &other) const;
+    bool startsWith(const String &prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { return found(s.find(c, from)); }
+    int indexOf(const String &text, unsigned int from = 0) const { return found(s.find(text.s, from)); }
+    int lastIndexOf(char c) const { return found(s.rfind(c)); }
+    int lastIndexOf(const String &text) const { return found(s.rfind(text.s)); }
+    String substring(unsigned int from) const { return from < s.size() ? s.substr(from) : std::string(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+        {
+            unsigned int t = from;
+            from = to;
+            to = t;
+        }
+        return from < s.size() ? s.substr(from, to - from) : std::string();
+    }
+
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return (float)atof(s.c_str()); }
+    double toDouble() const { return atof(s.c_str()); }
+    void toCharArray(char *buf, unsigned int size) const
+    {
+        if (size == 0)
+            return;
+        strncpy(buf, s.c_str(), size - 1);
+        buf[size - 1] = 0;
+    }
+
+    void trim();
+    void toUpperCase();
+    void toLowerCase();
+    void replace(const String &from, const String &to);
+    void remove(unsigned int index) { remove(index, s.size()); }
+    void remove(unsigned int index, unsigned int count)
+    {
+        if (index < s.size())
+            s.erase(index, count);
+    }
+
+    bool concat(const String &other)
+    {
+        s += other.s;
+        return true;
+    }
+    String &operator+=(const String &other)
+    {
+        s += other.s;
+        return *this;
+    }
+    String &operator+=(const char *other)
+    {
+        s += other ? other : "";
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        s += c;
+        return *this;
+    }
+    String &operator+=(int value) { return *this += String(value); }
+    String &operator+=(unsigned int value) { return *this += String(value); }
+    String &operator+=(long value) { return *this += String(value); }
+    String &operator+=(unsigned long value) { return *this += String(value); }
+    String &operator+=(float value) { return *this += String(value); }
+    String &operator+=(double value) { return *this += String(value); }
+
+    bool operator==(const String &other) const { return s == other.s; }
+    bool operator==(const char *other) const { return s == (other ? other : ""); }
+    bool operator!=(const String &other) const { return s != other.s; }
+    bool operator!=(const char *other) const { return !(*this == other); }
+    bool operator<(const String &other) const { return s < other.s; }
+    bool operator>(const String &other) const { return s > other.s; }
+
+    std::string s;
+
+private:
+    static int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    void setNumber(long value, unsigned char base);
+    void setNumber(unsigned long value, unsigned char base);
+    void setNumber(int value, unsigned char base) { setNumber((long)value, base); }
+    void setNumber(unsigned int value, unsigned char base) { setNumber((unsigned long)value, base); }
+    void setNumber(unsigned char value, unsigned char base) { setNumber((unsigned long)value, base); }
+    void setFloat(double value, unsigned char decimals);
+};
+
+template <class T>
+inline String operator+(const String &a, const T &b)
+{
+    String r(a);
+    r += b;
+    return r;
+}
+
+inline String operator+(const char *a, const String &b)
+{
+    String r(a);
+    r += b;
+    return r;
+}
+
+inline String operator+(char a, const String &b)
+{
+    String r(a);
+    r += b;
+    return r;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Print and Stream
+**************************************************************************************************************************************************/
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+            n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual void flush() {}
+
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(long long value, int base = DEC);
+    size_t print(unsigned long long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <class T>
+    size_t println(const T &value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <class T>
+    size_t println(const T &value, int format)
+    {
+        size_t n = print(value, format);
+        return n + println();
+    }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    size_t printNumber(unsigned long long value, int base);
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    void setTimeout(unsigned long) {}
+};
+
+// Serial output is dropped unless the simulator is asked to echo it
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    size_t write(uint8_t c);
+    using Print::write;
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+/**************************************************************************************************************************************************
+                                                                                               Pins, time and interrupts
+**************************************************************************************************************************************************/
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReadResolution(int bits);
+void analogWrite(uint8_t pin, int value);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+typedef void (*voidFuncPtr)(void);
+void attachInterrupt(uint8_t pin, voidFuncPtr callback, int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+// Time spent by a peripheral transfer or other busy work, in nanoseconds
+void fed3SimBusy(unsigned long ns);
+
+inline char *ltoa(long value, char *buffer, int base)
+{
+    sprintf(buffer, base == 16 ? "%lx" : "%ld", value);
+    return buffer;
+}
+
+inline char *itoa(int value, char *buffer, int base)
+{
+    return ltoa(value, buffer, base);
+}
+
+inline char *ultoa(unsigned long value, char *buffer, int base)
+{
+    sprintf(buffer, base == 16 ? "%lx" : "%lu", value);
+    return buffer;
+}
+
+inline char *dtostrf(double value, signed char width, unsigned char precision, char *buffer)
+{
+    sprintf(buffer, "%*.*f", width, precision, value);
+    return buffer;
+}
+
+#if defined(__arm__)
+#include "samd.h"
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef FED3_SIM_ARDUINOJSON_H
+#define FED3_SIM_ARDUINOJSON_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+
+// The part of ArduinoJson that reads meta.json: objects, strings, numbers, true/false/null.
+// Arrays are parsed and skipped.
+
+struct JsonNode
+{
+    bool isObject = false;
+    bool isNull = true;
+    std::string text; // strings, and numbers and booleans as written
+    std::map<std::string, std::shared_ptr<JsonNode>> members;
+};
+
+class JsonVariant
+{
+public:
+    JsonVariant(std::shared_ptr<JsonNode> node = std::shared_ptr<JsonNode>()) : node(node) {}
+
+    JsonVariant operator[](const char *key) const
+    {
+        if (!node || !node->isObject)
+            return JsonVariant();
+        std::map<std::string, std::shared_ptr<JsonNode>>::const_iterator it = node->members.find(key);
+        return it == node->members.end() ? JsonVariant() : JsonVariant(it->second);
+    }
+    bool isNull() const { return !node || node->isNull; }
+    operator const char *() const { return (!node || node->isObject || node->isNull) ? NULL : node->text.c_str(); }
+    operator int() const { return isNull() ? 0 : atoi(node->text.c_str()); }
+    operator long() const { return isNull() ? 0 : atol(node->text.c_str()); }
+    operator float() const { return isNull() ? 0 : (float)atof(node->text.c_str()); }
+    operator bool() const { return !isNull() && node->text == "true"; }
+
+private:
+    std::shared_ptr<JsonNode> node;
+};
+
+typedef JsonVariant JsonObject;
+
+class JsonDocument
+{
+public:
+    JsonVariant operator[](const char *key) const { return JsonVariant(root)[key]; }
+    std::shared_ptr<JsonNode> root;
+};
+
+class DeserializationError
+{
+public:
+    DeserializationError(const char *message = NULL) : message(message) {}
+    operator bool() const { return message != NULL; }
+    const char *c_str() const { return message ? message : "Ok"; }
+
+private:
+    const char *message;
+};
+
+DeserializationError deserializeJson(JsonDocument &doc, const char *json);
+
+template <class TStream>
+DeserializationError deserializeJson(JsonDocument &doc, TStream &input)
+{
+    std::string json;
+    int c;
+    while ((c = input.read()) >= 0)
+        json += (char)c;
+    return deserializeJson(doc, json.c_str());
+}
+
+#endif
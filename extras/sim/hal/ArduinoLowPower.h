@@ -0,0 +1,22 @@
+#ifndef FED3_SIM_ARDUINOLOWPOWER_H
+#define FED3_SIM_ARDUINOLOWPOWER_H
+
+#include <Arduino.h>
+
+// Standby on the simulated board: millis() and the timers stop, the RTC keeps going, and any attached
+// pin interrupt wakes the board early
+class ArduinoLowPowerClass
+{
+public:
+    void sleep();
+    void sleep(int ms);
+    void deepSleep() { sleep(); }
+    void deepSleep(int ms) { sleep(ms); }
+    void idle() {}
+    void idle(int ms) { delay(ms); }
+    void attachInterruptWakeup(uint32_t pin, voidFuncPtr callback, uint32_t mode) { attachInterrupt(pin, callback, mode); }
+};
+
+extern ArduinoLowPowerClass LowPower;
+
+#endif
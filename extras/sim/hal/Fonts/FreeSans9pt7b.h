@@ -0,0 +1,33 @@
+// The real font when FED3 sits next to the Adafruit GFX library in the Arduino libraries folder,
+// otherwise solid blocks with the same spacing, so text shows where it is drawn but can't be read
+#if defined(__has_include) && __has_include("../../../../../Adafruit_GFX_Library/Fonts/FreeSans9pt7b.h")
+#include "../../../../../Adafruit_GFX_Library/Fonts/FreeSans9pt7b.h"
+#else
+#ifndef FED3_SIM_FREESANS9PT7B_H
+#define FED3_SIM_FREESANS9PT7B_H
+
+const uint8_t FreeSans9pt7bBitmaps[] PROGMEM = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+const GFXglyph FreeSans9pt7bGlyphs[] PROGMEM = {
+    {0, 0, 0, 5, 0, 1}, {0, 2, 13, 5, 1, -13}, {0, 3, 3, 6, 1, -13}, {0, 7, 13, 10, 1, -13}, {0, 7, 13, 10, 1, -13},
+    {0, 13, 13, 16, 1, -13}, {0, 9, 13, 12, 1, -13}, {0, 1, 3, 3, 1, -13}, {0, 3, 13, 6, 1, -13}, {0, 3, 13, 6, 1, -13},
+    {0, 4, 3, 7, 1, -13}, {0, 8, 13, 11, 1, -13}, {0, 2, 2, 5, 1, -2}, {0, 3, 2, 6, 1, -6}, {0, 2, 2, 5, 1, -2},
+    {0, 2, 13, 5, 1, -13}, {0, 7, 13, 10, 1, -13}, {0, 7, 13, 10, 1, -13}, {0, 7, 13, 10, 1, -13}, {0, 7, 13, 10, 1, -13},
+    {0, 7, 13, 10, 1, -13}, {0, 7, 13, 10, 1, -13}, {0, 7, 13, 10, 1, -13}, {0, 7, 13, 10, 1, -13}, {0, 7, 13, 10, 1, -13},
+    {0, 7, 13, 10, 1, -13}, {0, 2, 10, 5, 1, -10}, {0, 2, 10, 5, 1, -10}, {0, 8, 13, 11, 1, -13}, {0, 8, 2, 11, 1, -6},
+    {0, 8, 13, 11, 1, -13}, {0, 7, 13, 10, 1, -13}, {0, 15, 13, 18, 1, -13}, {0, 9, 13, 12, 1, -13}, {0, 9, 13, 12, 1, -13},
+    {0, 10, 13, 13, 1, -13}, {0, 10, 13, 13, 1, -13}, {0, 9, 13, 12, 1, -13}, {0, 8, 13, 11, 1, -13}, {0, 11, 13, 14, 1, -13},
+    {0, 10, 13, 13, 1, -13}, {0, 2, 13, 5, 1, -13}, {0, 6, 13, 9, 1, -13}, {0, 9, 13, 12, 1, -13}, {0, 7, 13, 10, 1, -13},
+    {0, 12, 13, 15, 1, -13}, {0, 10, 13, 13, 1, -13}, {0, 11, 13, 14, 1, -13}, {0, 9, 13, 12, 1, -13}, {0, 11, 13, 14, 1, -13},
+    {0, 10, 13, 13, 1, -13}, {0, 9, 13, 12, 1, -13}, {0, 8, 13, 11, 1, -13}, {0, 10, 13, 13, 1, -13}, {0, 9, 13, 12, 1, -13},
+    {0, 14, 13, 17, 1, -13}, {0, 9, 13, 12, 1, -13}, {0, 9, 13, 12, 1, -13}, {0, 8, 13, 11, 1, -13}, {0, 2, 13, 5, 1, -13},
+    {0, 2, 13, 5, 1, -13}, {0, 2, 13, 5, 1, -13}, {0, 5, 3, 8, 1, -13}, {0, 7, 2, 10, 1, -6}, {0, 1, 3, 4, 1, -13},
+    {0, 7, 10, 10, 1, -10}, {0, 7, 10, 10, 1, -10}, {0, 6, 10, 9, 1, -10}, {0, 7, 10, 10, 1, -10}, {0, 7, 10, 10, 1, -10},
+    {0, 2, 10, 5, 1, -10}, {0, 7, 10, 10, 1, -10}, {0, 7, 10, 10, 1, -10}, {0, 1, 10, 4, 1, -10}, {0, 1, 10, 4, 1, -10},
+    {0, 6, 10, 9, 1, -10}, {0, 1, 10, 4, 1, -10}, {0, 12, 10, 15, 1, -10}, {0, 7, 10, 10, 1, -10}, {0, 7, 10, 10, 1, -10},
+    {0, 7, 10, 10, 1, -10}, {0, 7, 10, 10, 1, -10}, {0, 3, 10, 6, 1, -10}, {0, 6, 10, 9, 1, -10}, {0, 2, 10, 5, 1, -10},
+    {0, 7, 10, 10, 1, -10}, {0, 6, 10, 9, 1, -10}, {0, 10, 10, 13, 1, -10}, {0, 5, 10, 8, 1, -10}, {0, 6, 10, 9, 1, -10},
+    {0, 6, 10, 9, 1, -10}, {0, 3, 13, 6, 1, -13}, {0, 2, 13, 5, 1, -13}, {0, 3, 13, 6, 1, -13}, {0, 7, 2, 10, 1, -6}};
+const GFXfont FreeSans9pt7b PROGMEM = {(uint8_t *)FreeSans9pt7bBitmaps, (GFXglyph *)FreeSans9pt7bGlyphs, 0x20, 0x7E, 22};
+
+#endif
+#endif
@@ -0,0 +1,33 @@
+// The real font when FED3 sits next to the Adafruit GFX library in the Arduino libraries folder,
+// otherwise solid blocks with the same spacing
+#if defined(__has_include) && __has_include("../../../../../Adafruit_GFX_Library/Fonts/Org_01.h")
+#include "../../../../../Adafruit_GFX_Library/Fonts/Org_01.h"
+#else
+#ifndef FED3_SIM_ORG_01_H
+#define FED3_SIM_ORG_01_H
+
+const uint8_t Org_01Bitmaps[] PROGMEM = {0xFF, 0xFF, 0xFF, 0xFF};
+const GFXglyph Org_01Glyphs[] PROGMEM = {
+    {0, 0, 0, 6, 0, 1}, {0, 5, 5, 6, 0, -5}, {0, 5, 3, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 3, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 3, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 2, 6, 0, -2}, {0, 5, 2, 6, 0, -3}, {0, 5, 2, 6, 0, -2},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 5, 6, 0, -5}, {0, 5, 2, 6, 0, -3},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5},
+    {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 3, 6, 0, -5}, {0, 5, 2, 6, 0, -3}, {0, 5, 3, 6, 0, -5},
+    {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4},
+    {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4},
+    {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4},
+    {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4},
+    {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4}, {0, 5, 4, 6, 0, -4},
+    {0, 5, 4, 6, 0, -4}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 5, 6, 0, -5}, {0, 5, 2, 6, 0, -3}};
+const GFXfont Org_01 PROGMEM = {(uint8_t *)Org_01Bitmaps, (GFXglyph *)Org_01Glyphs, 0x20, 0x7E, 7};
+
+#endif
+#endif
@@ -0,0 +1,72 @@
+#ifndef FED3_SIM_RTCLIB_H
+#define FED3_SIM_RTCLIB_H
+
+#include <Arduino.h>
+
+class TimeSpan
+{
+public:
+    TimeSpan(int32_t seconds = 0) : _seconds(seconds) {}
+    TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
+        : _seconds((int32_t)days * 86400L + (int32_t)hours * 3600 + (int32_t)minutes * 60 + seconds) {}
+
+    int16_t days() const { return _seconds / 86400L; }
+    int8_t hours() const { return _seconds / 3600 % 24; }
+    int8_t minutes() const { return _seconds / 60 % 60; }
+    int8_t seconds() const { return _seconds % 60; }
+    int32_t totalseconds() const { return _seconds; }
+
+    TimeSpan operator+(const TimeSpan &right) const { return TimeSpan(_seconds + right._seconds); }
+    TimeSpan operator-(const TimeSpan &right) const { return TimeSpan(_seconds - right._seconds); }
+
+private:
+    int32_t _seconds;
+};
+
+// Calendar time as in RTClib, valid from 2000 to 2099
+class DateTime
+{
+public:
+    DateTime(uint32_t t = 946684800UL);
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+    DateTime(const char *date, const char *time); // __DATE__ and __TIME__
+
+    uint16_t year() const { return 2000U + yOff; }
+    uint8_t month() const { return m; }
+    uint8_t day() const { return d; }
+    uint8_t hour() const { return hh; }
+    uint8_t twelveHour() const { return hh % 12 == 0 ? 12 : hh % 12; }
+    uint8_t isPM() const { return hh >= 12; }
+    uint8_t minute() const { return mm; }
+    uint8_t second() const { return ss; }
+    uint8_t dayOfTheWeek() const;
+    uint32_t secondstime() const { return unixtime() - 946684800UL; }
+    uint32_t unixtime() const;
+    bool isValid() const { return yOff < 100 && m >= 1 && m <= 12 && d >= 1 && d <= 31 && hh < 24 && mm < 60 && ss < 60; }
+
+    DateTime operator+(const TimeSpan &span) const { return DateTime(unixtime() + span.totalseconds()); }
+    DateTime operator-(const TimeSpan &span) const { return DateTime(unixtime() - span.totalseconds()); }
+    TimeSpan operator-(const DateTime &right) const { return TimeSpan((int32_t)(unixtime() - right.unixtime())); }
+    bool operator<(const DateTime &right) const { return unixtime() < right.unixtime(); }
+    bool operator==(const DateTime &right) const { return unixtime() == right.unixtime(); }
+    bool operator!=(const DateTime &right) const { return !(*this == right); }
+
+protected:
+    uint8_t yOff, m, d, hh, mm, ss;
+};
+
+// Reads the simulated clock, which starts at the time given to the simulator
+class RTC_PCF8523
+{
+public:
+    bool begin() { return true; }
+    void adjust(const DateTime &dt);
+    DateTime now();
+    bool lostPower() { return false; }
+    bool initialized() { return true; }
+    bool isrunning() { return true; }
+    void start() {}
+    void stop() {}
+};
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef FED3_SIM_SPI_H
+#define FED3_SIM_SPI_H
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef FED3_SIM_SDFAT_H
+#define FED3_SIM_SDFAT_H
+
+#include <Arduino.h>
+
+#define O_READ 0x01
+#define O_RDONLY O_READ
+#define O_WRITE 0x02
+#define O_WRONLY O_WRITE
+#define O_RDWR (O_READ | O_WRITE)
+#define O_AT_END 0x04
+#define O_APPEND 0x08
+#define O_CREAT 0x10
+#define O_TRUNC 0x20
+#define O_EXCL 0x40
+
+#define SD_SCK_MHZ(mhz) (1000000UL * (mhz))
+#define FAT_DATE(y, m, d) (uint16_t)(((y) - 1980) << 9 | (m) << 5 | (d))
+#define FAT_TIME(h, m, s) (uint16_t)((h) << 11 | (m) << 5 | (s) >> 1)
+
+// Files live in the simulated card's directory on the host. Bytes written and syncs are counted
+// for the card wear numbers.
+class FatFile : public Stream
+{
+public:
+    FatFile() : file(NULL), flags(0) {}
+    ~FatFile() { close(); }
+
+    bool open(const char *path, int oflag = O_READ);
+    bool close();
+    bool isOpen() const { return file != NULL; }
+    bool sync();
+    bool remove();
+    bool truncate(uint32_t length);
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size);
+    using Print::write;
+    int available();
+    int read();
+    int read(void *buffer, size_t size);
+    int peek();
+
+    bool seekSet(uint32_t position);
+    bool seekCur(int32_t offset) { return seekSet(curPosition() + offset); }
+    bool seekEnd(int32_t offset = 0) { return seekSet(fileSize() + offset); }
+    void rewind() { seekSet(0); }
+    uint32_t curPosition() const;
+    uint32_t fileSize() const;
+
+    operator bool() const { return isOpen(); }
+
+private:
+    FatFile(const FatFile &);
+    FatFile &operator=(const FatFile &);
+
+    FILE *file;
+    int flags;
+    std::string path;
+};
+
+class SdFile : public FatFile
+{
+public:
+    static void dateTimeCallback(void (*callback)(uint16_t *date, uint16_t *time)) { dateTime = callback; }
+    static void dateTimeCallbackCancel() { dateTime = NULL; }
+
+    static thread_local void (*dateTime)(uint16_t *date, uint16_t *time); // one per board
+};
+
+typedef FatFile File32;
+
+class SdFat
+{
+public:
+    bool begin(uint8_t csPin, uint32_t maxSck = SD_SCK_MHZ(50));
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *oldPath, const char *newPath);
+    bool mkdir(const char *path, bool parents = true);
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef FED3_SIM_STEPPER_H
+#define FED3_SIM_STEPPER_H
+
+#include <Arduino.h>
+
+// Each step turns the simulated pellet disk and takes the time set by setSpeed(), like the Arduino library
+class Stepper
+{
+public:
+    Stepper(int stepsPerRevolution, int pin1, int pin2, int pin3 = 0, int pin4 = 0)
+        : stepsPerRevolution(stepsPerRevolution), stepDelayUs(0) {}
+
+    void setSpeed(long rpm) { stepDelayUs = rpm > 0 ? 60UL * 1000UL * 1000UL / stepsPerRevolution / rpm : 0; }
+    void step(int steps);
+
+private:
+    int stepsPerRevolution;
+    unsigned long stepDelayUs;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef FED3_SIM_WIRE_H
+#define FED3_SIM_WIRE_H
+
+#include <Arduino.h>
+
+// The simulated RTC and sensors don't go through the bus
+class TwoWire
+{
+public:
+    void begin() {}
+    void end() {}
+    void setClock(uint32_t) {}
+};
+
+extern TwoWire Wire;
+
+#endif
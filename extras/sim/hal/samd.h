@@ -0,0 +1,139 @@
+/*
+  SAMD21 timer registers for the FED3 simulator
+
+  The registers the library touches to run TC3 (hardware timer) and TC4 (audio timer). Writes are
+  reported to the simulated board, which follows the counter settings and calls TC3_Handler() and
+  TC4_Handler() at the times the real counters would match.
+*/
+
+#ifndef FED3_SIM_SAMD_H
+#define FED3_SIM_SAMD_H
+
+#include <stdint.h>
+
+void fed3SimRegisterWritten(const void *reg);
+
+template <class T>
+class SimRegister
+{
+public:
+    SimRegister() : value(0) {}
+    operator T() const { return value; }
+    SimRegister &operator=(T v)
+    {
+        value = v;
+        fed3SimRegisterWritten(this);
+        return *this;
+    }
+    template <class V>
+    SimRegister &operator|=(V v)
+    {
+        return *this = (T)(value | v);
+    }
+    template <class V>
+    SimRegister &operator&=(V v)
+    {
+        return *this = (T)(value & v);
+    }
+
+    T value;
+};
+
+struct SimSyncStatus
+{
+    struct
+    {
+        uint8_t SYNCBUSY : 1; // writes take effect at once
+    } bit = {0};
+};
+
+struct TcCount16
+{
+    struct
+    {
+        SimRegister<uint16_t> reg;
+    } CTRLA, COUNT;
+    struct
+    {
+        SimRegister<uint8_t> reg;
+    } CTRLBSET, INTENSET, INTENCLR, INTFLAG;
+    struct
+    {
+        SimRegister<uint16_t> reg;
+    } CC[2];
+    SimSyncStatus STATUS;
+};
+
+struct Tc
+{
+    TcCount16 COUNT16;
+};
+
+struct Gclk
+{
+    struct
+    {
+        SimRegister<uint16_t> reg;
+    } CLKCTRL;
+    struct
+    {
+        SimRegister<uint32_t> reg;
+    } GENCTRL, GENDIV;
+    SimSyncStatus STATUS;
+};
+
+struct Pm
+{
+    struct
+    {
+        SimRegister<uint32_t> reg;
+    } APBCMASK;
+};
+
+Tc *fed3SimTimer(int n);
+Gclk *fed3SimGclk();
+Pm *fed3SimPm();
+
+#define TC3 fed3SimTimer(3)
+#define TC4 fed3SimTimer(4)
+#define TC5 fed3SimTimer(5)
+#define GCLK fed3SimGclk()
+#define PM fed3SimPm()
+
+#define PM_APBCMASK_TC3 (1u << 11)
+#define PM_APBCMASK_TC4 (1u << 12)
+#define PM_APBCMASK_TC5 (1u << 13)
+#define GCLK_CLKCTRL_CLKEN (1u << 14)
+#define GCLK_CLKCTRL_GEN_GCLK0 (0u << 8)
+#define GCLK_CLKCTRL_ID(x) (x)
+#define GCM_TCC2_TC3 0x1B
+#define GCM_TC4_TC5 0x1C
+
+#define TC_CTRLA_ENABLE (1u << 1)
+#define TC_CTRLA_MODE_COUNT16 (0u << 2)
+#define TC_CTRLA_WAVEGEN_MFRQ (1u << 5)
+#define TC_CTRLA_PRESCALER_Pos 8
+#define TC_CTRLA_PRESCALER_DIV1 (0u << 8)
+#define TC_CTRLA_PRESCALER_DIV2 (1u << 8)
+#define TC_CTRLA_PRESCALER_DIV4 (2u << 8)
+#define TC_CTRLA_PRESCALER_DIV8 (3u << 8)
+#define TC_CTRLA_PRESCALER_DIV16 (4u << 8)
+#define TC_CTRLA_PRESCALER_DIV64 (5u << 8)
+#define TC_CTRLA_PRESCALER_DIV256 (6u << 8)
+#define TC_CTRLA_PRESCALER_DIV1024 (7u << 8)
+#define TC_INTENSET_MC0 (1u << 4)
+#define TC_INTFLAG_MC0 (1u << 4)
+
+enum IRQn_Type
+{
+    TC3_IRQn = 18,
+    TC4_IRQn = 19,
+    TC5_IRQn = 20,
+};
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+inline void NVIC_SetPriority(IRQn_Type, uint32_t) {}
+void NVIC_SystemReset();
+
+#endif
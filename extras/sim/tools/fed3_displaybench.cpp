@@ -0,0 +1,272 @@
+/*
+  Display text check and benchmark
+
+  Checks that the glyph atlas text of FED3_SharpMem::printFast() (see src/FED3_SharpMem.cpp) draws the same
+  pixels as Adafruit_GFX's print(), then times both on the text of the main screen and times UpdateDisplay()
+  on a simulated FED3 with the atlas and without it.
+
+  The check runs on a font made up for it, with glyphs of random size, offset and bits in the spacing of
+  FreeSans9pt7b, so every column and row of the atlas code is exercised whether or not the real fonts are
+  installed. Strings mix atlas characters with others that fall back to Adafruit_GFX, in both colors, regular
+  and bold (bold on the GFX path is the old "print twice, one pixel apart"), at positions that wrap and clip at
+  every edge. The cursor after regular text is checked too. When the real FreeSans9pt7b is installed, it is
+  checked the same way.
+
+  UpdateDisplay() runs with the font the library is built with: the real one when installed, otherwise the
+  simulator's block glyphs. Its screen with the atlas is compared with its screen without it.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_displaybench.cpp -o fed3_displaybench
+
+  Usage:
+    fed3_displaybench [--strings N] [--seed N]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <algorithm>
+#include <chrono>
+
+#define SCREEN_BYTES (144 * 168 / 8)
+
+// A font with FreeSans9pt7b's spacing and random glyphs
+struct TestFont
+{
+    std::vector<uint8_t> bitmap;
+    std::vector<GFXglyph> glyphs;
+    GFXfont font;
+};
+
+static void makeTestFont(TestFont &test, uint64_t seed)
+{
+    FED3SimRandom random(seed);
+    const GFXglyph *sans = FreeSans9pt7b.glyph;
+    for (uint16_t c = FreeSans9pt7b.first; c <= FreeSans9pt7b.last; c++)
+    {
+        GFXglyph g;
+        g.xAdvance = sans[c - FreeSans9pt7b.first].xAdvance;
+        g.width = c == ' ' ? 0 : 1 + random.next() % (g.xAdvance + 1);
+        g.height = c == ' ' ? 0 : 1 + random.next() % 18;
+        g.xOffset = (int8_t)(random.next() % 4) - 1;
+        g.yOffset = -(int8_t)(random.next() % (g.height + 1)) + (int8_t)(random.next() % 3);
+        g.bitmapOffset = test.bitmap.size();
+        for (int i = 0; i < (g.width * g.height + 7) / 8; i++)
+            test.bitmap.push_back(random.next());
+        test.glyphs.push_back(g);
+    }
+    test.bitmap.push_back(0);
+    test.font.bitmap = &test.bitmap[0];
+    test.font.glyph = &test.glyphs[0];
+    test.font.first = FreeSans9pt7b.first;
+    test.font.last = FreeSans9pt7b.last;
+    test.font.yAdvance = FreeSans9pt7b.yAdvance;
+}
+
+static bool realFont()
+{
+    return FreeSans9pt7b.bitmap[0] != 0xFF || FreeSans9pt7b.bitmap[1] != 0xFF;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Check
+**************************************************************************************************************************************************/
+static std::string randomText(FED3SimRandom &random)
+{
+    const char atlas[] = FED3_ATLAS_CHARS;
+    std::string text;
+    int length = 1 + random.next() % 12;
+    for (int i = 0; i < length; i++)
+    {
+        if (random.chance(0.85))
+            text += atlas[random.next() % (sizeof(atlas) - 1)];
+        else
+            text += (char)(0x21 + random.next() % 94);
+    }
+    return text;
+}
+
+static void drawText(FED3_SharpMem &display, const std::string &text, int16_t x, int16_t y, bool bold, bool fast)
+{
+    display.setCursor(x, y);
+    if (fast)
+        display.printFast(text.c_str(), bold);
+    else if (bold)
+    {
+        display.setCursor(x + 1, y);
+        display.print(text.c_str());
+        display.setCursor(x, y);
+        display.print(text.c_str());
+    }
+    else
+        display.print(text.c_str());
+}
+
+// Draws each string both ways on a screen with some lines on it, returns the strings that differ
+static unsigned long checkFont(FED3_SharpMem &display, const GFXfont *font, const char *name, size_t strings, uint64_t seed)
+{
+    FED3SimRandom random(seed);
+    display.setFont(font);
+    display.buildGlyphAtlas(font);
+    unsigned long mismatches = 0;
+    uint8_t gfx[SCREEN_BYTES];
+    for (size_t i = 0; i < strings; i++)
+    {
+        std::string text = randomText(random);
+        int16_t x = (int16_t)(random.next() % 200) - 20;
+        int16_t y = (int16_t)(random.next() % 210) - 20;
+        bool bold = random.chance(0.3);
+        bool white = random.chance(0.2);
+        uint64_t background = random.next();
+
+        int16_t cursor[2][2];
+        for (int fast = 0; fast < 2; fast++)
+        {
+            display.fillScreen(white ? BLACK : WHITE);
+            for (int line = 0; line < 8; line++)
+                display.drawFastHLine(0, (background >> (line * 8)) % 144, 168, (line & 1) ? BLACK : WHITE);
+            display.setTextColor(white ? WHITE : BLACK);
+            drawText(display, text, x, y, bold, fast);
+            cursor[fast][0] = display.getCursorX();
+            cursor[fast][1] = display.getCursorY();
+            if (!fast)
+                memcpy(gfx, display.getBuffer(), SCREEN_BYTES);
+        }
+
+        bool same = memcmp(gfx, display.getBuffer(), SCREEN_BYTES) == 0 &&
+                    (bold || (cursor[0][0] == cursor[1][0] && cursor[0][1] == cursor[1][1]));
+        if (!same && mismatches++ < 5)
+            fprintf(stderr, "%s: \"%s\" at %d,%d%s%s differs\n", name, text.c_str(), x, y, bold ? " bold" : "",
+                    white ? " white" : "");
+    }
+    display.setTextColor(BLACK);
+    printf("check %-8s %zu strings, %lu differ\n", name, strings, mismatches);
+    return mismatches;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Timing
+**************************************************************************************************************************************************/
+// The text drawMainScreen() and DisplayDateTime() draw, in ns per screen
+static double mainScreenTextNs(FED3_SharpMem &display, const GFXfont *font, bool fast)
+{
+    display.setFont(font);
+    display.buildGlyphAtlas(font);
+    display.clearDisplayBuffer();
+    const int rounds = 2000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+    {
+        drawText(display, "FED:", 5, 15, true, fast);
+        drawText(display, "12", display.getCursorX(), 15, false, fast);
+        drawText(display, "Left: ", 35, 65, false, fast);
+        drawText(display, std::to_string(1200 + i % 100), 95, 65, false, fast);
+        drawText(display, "Right:  ", 35, 85, false, fast);
+        drawText(display, std::to_string(300 + i % 100), 95, 85, false, fast);
+        drawText(display, "Pellets:", 35, 105, false, fast);
+        drawText(display, std::to_string(900 + i % 100), 95, 105, false, fast);
+        drawText(display, "3/1/2025      08:15", 0, 135, false, fast);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+}
+
+// Best of five batches, in us per call
+static double updateDisplayUs(FED3 &fed3, bool refreshOnly = false)
+{
+    double best = INFINITY;
+    for (int batch = 0; batch < 5; batch++)
+    {
+        const int rounds = 200;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++)
+        {
+            if (refreshOnly)
+                fed3.display.refresh();
+            else
+                fed3.UpdateDisplay();
+        }
+        best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds);
+    }
+    return best;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_displaybench [--strings N] [--seed N]\n");
+}
+
+int main(int argc, char **argv)
+{
+    size_t strings = 20000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--strings")
+            strings = strtoul(value.c_str(), NULL, 10);
+        else if (arg == "--seed")
+            seed = strtoull(value.c_str(), NULL, 10);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    FED3SimConfig config;
+    config.sdDir = "displaybench_sd";
+    FED3SimBoard board(config);
+    FED3 fed3(String("Bench"));
+    unsigned long mismatches = 0;
+
+    board.run(
+        [&]() {
+            fed3.begin();
+            FED3_SharpMem &display = fed3.display;
+
+            // printFast() against print()
+            TestFont test;
+            makeTestFont(test, seed);
+            mismatches += checkFont(display, &test.font, "random", strings, seed);
+            if (realFont())
+                mismatches += checkFont(display, &FreeSans9pt7b, "FreeSans", strings, seed);
+
+            double gfxNs = mainScreenTextNs(display, &test.font, false);
+            double fastNs = mainScreenTextNs(display, &test.font, true);
+            printf("main screen text:  %.2f us with print(), %.2f us with printFast(), %.1fx\n", gfxNs / 1000,
+                   fastNs / 1000, gfxNs / fastNs);
+
+            // UpdateDisplay() as the library draws it, with its atlas and with the atlas on another font
+            display.setFont(&FreeSans9pt7b);
+            display.buildGlyphAtlas(&FreeSans9pt7b);
+            display.clearDisplay();
+            fed3.UpdateDisplay();
+            std::vector<uint8_t> atlasScreen(display.getBuffer(), display.getBuffer() + SCREEN_BYTES);
+            double atlasUs = updateDisplayUs(fed3);
+
+            display.buildGlyphAtlas(&Org_01);
+            display.clearDisplay();
+            fed3.UpdateDisplay();
+            bool same = memcmp(&atlasScreen[0], display.getBuffer(), SCREEN_BYTES) == 0;
+            double gfxUs = updateDisplayUs(fed3);
+            double refreshUs = updateDisplayUs(fed3, true);
+            mismatches += !same;
+
+            printf("UpdateDisplay():   %.2f us without the atlas, %.2f us with it (%s font), screens %s\n", gfxUs,
+                   atlasUs, realFont() ? "FreeSans9pt7b" : "block", same ? "match" : "DIFFER");
+            printf("  drawing only:    %.2f us without the atlas, %.2f us with it, %.1fx (refresh() %.2f us)\n",
+                   gfxUs - refreshUs, atlasUs - refreshUs, (gfxUs - refreshUs) / (atlasUs - refreshUs), refreshUs);
+            display.buildGlyphAtlas(&FreeSans9pt7b);
+            throw FED3SimStop{"done"};
+        },
+        []() {});
+
+    return mismatches == 0 ? 0 : 1;
+}
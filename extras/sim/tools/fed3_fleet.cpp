@@ -0,0 +1,291 @@
+/*
+  Fleet simulation: a room of FED3s
+
+  Runs many FED3 devices in one process, each with its own simulated board, FED3 object, mouse, SD
+  card directory and virtual clock, on a pool of worker threads. Devices share nothing, so a device's
+  files only depend on its number and the seed, not on the number of threads or the other devices.
+
+  Prints what the room needs for planning: how fast the host simulates (device-days per second), the
+  pellets per day, how much each device logs per day and how often it syncs the SD card, and the
+  battery drain with the days until the first battery runs out.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -pthread -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_fleet.cpp -o fed3_fleet
+
+  Usage:
+    fed3_fleet --devices N [--task fr|pr|extinction|pavlovian|bandit|timed] [--set NAME=VALUE]...
+               [--mouse random,learning] [--days N] [--seed N] [--stagger-min N] [--battery-mah N]
+               [--threads N] [--sd DIR] [--out FILE.csv]
+
+  Devices are numbered from 1, take the mouse models in turn and log to DIR/devNNN. --stagger-min
+  starts each device that many minutes after the previous one, as when a room is set up by hand.
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sys/stat.h>
+
+struct FleetDevice
+{
+    int number;
+    FED3SimConfig config;
+    std::string mouse;
+    const char *reason = "not run";
+    double days = 0;
+    unsigned long pokes = 0;
+    unsigned long pellets = 0;
+    unsigned long jams = 0;
+    unsigned long sdBytes = 0;
+    unsigned long sdSyncs = 0;
+    double batteryMah = 0;
+    double hostS = 0;
+
+    double perDay(double x) const { return days > 0 ? x / days : 0.0; }
+    // Days a full battery lasts at this device's drain
+    double batteryDays() const { return batteryMah > 0 ? config.batteryMah / perDay(batteryMah) : INFINITY; }
+};
+
+static void runDevice(const FED3_Task &task, const std::vector<std::pair<std::string, double> > &values,
+                      FleetDevice &device)
+{
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    FED3SimMouse *mouse = fed3SimMakeMouse(device.mouse.c_str(), FED3SimBehavior());
+    FED3SimBoard *board = new FED3SimBoard(device.config);
+    board->mouse = mouse;
+    FED3 *fed3 = new FED3(String("Fleet"));
+    for (size_t i = 0; i < values.size(); i++)
+        fed3SimSetVariable(*fed3, values[i].first.c_str(), values[i].second);
+    device.reason = board->run(
+        [&]() {
+            fed3->startTask(task);
+            fed3->begin();
+        },
+        [&]() { fed3->run(); });
+
+    const FED3SimStats &stats = board->stats;
+    device.days = board->wallNs / 8.64e13;
+    device.pokes = stats.leftPokes + stats.rightPokes;
+    device.pellets = stats.pelletsEaten;
+    device.jams = stats.jams;
+    device.sdBytes = stats.sdBytes;
+    device.sdSyncs = stats.sdSyncs;
+    device.batteryMah = stats.batteryUsedMah;
+    delete fed3;
+    delete board;
+    delete mouse;
+    device.hostS = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+static std::vector<std::string> split(const std::string &text)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos)
+            comma = text.size();
+        if (comma > start)
+            parts.push_back(text.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return parts;
+}
+
+static double median(std::vector<double> values)
+{
+    if (values.empty())
+        return NAN;
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: fed3_fleet --devices N [--task fr|pr|extinction|pavlovian|bandit|timed] [--set NAME=VALUE]...\n"
+            "                  [--mouse random,learning] [--days N] [--seed N] [--stagger-min N] [--battery-mah N]\n"
+            "                  [--threads N] [--sd DIR] [--out FILE.csv]\n");
+}
+
+int main(int argc, char **argv)
+{
+    int devices = 0;
+    std::string task = "fr", sdDir = "fleet_sd", outPath;
+    std::vector<std::string> mice(1, "learning");
+    std::vector<std::pair<std::string, double> > values;
+    double days = 7, staggerMin = 0;
+    uint64_t seed = 1;
+    FED3SimConfig base;
+    unsigned threads = std::thread::hardware_concurrency();
+    FED3 probe(String("Fleet")); // checks the --set names
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--devices")
+            devices = atoi(value.c_str());
+        else if (arg == "--task")
+            task = value;
+        else if (arg == "--set")
+        {
+            size_t eq = value.find('=');
+            if (eq == std::string::npos)
+            {
+                usage();
+                return 2;
+            }
+            std::string name = value.substr(0, eq);
+            if (!fed3SimSetVariable(probe, name.c_str(), 0))
+            {
+                fprintf(stderr, "fed3_fleet: unknown variable %s\n", name.c_str());
+                return 2;
+            }
+            values.push_back(std::make_pair(name, atof(value.c_str() + eq + 1)));
+        }
+        else if (arg == "--mouse")
+            mice = split(value);
+        else if (arg == "--days")
+            days = atof(value.c_str());
+        else if (arg == "--seed")
+            seed = strtoull(value.c_str(), NULL, 10);
+        else if (arg == "--stagger-min")
+            staggerMin = atof(value.c_str());
+        else if (arg == "--battery-mah")
+            base.batteryMah = atof(value.c_str());
+        else if (arg == "--threads")
+            threads = atoi(value.c_str());
+        else if (arg == "--sd")
+            sdDir = value;
+        else if (arg == "--out")
+            outPath = value;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    const FED3_Task *fleetTask = fed3SimTask(task.c_str());
+    if (devices <= 0 || fleetTask == NULL || mice.empty() || threads == 0)
+    {
+        usage();
+        return 2;
+    }
+    for (size_t m = 0; m < mice.size(); m++)
+    {
+        FED3SimMouse *check = fed3SimMakeMouse(mice[m].c_str(), FED3SimBehavior());
+        if (check == NULL)
+        {
+            usage();
+            return 2;
+        }
+        delete check;
+    }
+
+    ::mkdir(sdDir.c_str(), 0777);
+    std::vector<FleetDevice> fleet(devices);
+    for (int d = 0; d < devices; d++)
+    {
+        FleetDevice &device = fleet[d];
+        char dir[16];
+        snprintf(dir, sizeof(dir), "/dev%03d", d + 1);
+        device.number = d + 1;
+        device.mouse = mice[d % mice.size()];
+        device.config = base;
+        device.config.deviceNumber = d + 1;
+        device.config.seed = seed * 1000003ULL + d;
+        device.config.durationS = days * 86400.0;
+        device.config.startUnix = base.startUnix + (uint32_t)(d * staggerMin * 60.0);
+        device.config.sdDir = sdDir + std::string(dir);
+    }
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> done(0);
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads && w < fleet.size(); w++)
+    {
+        workers.push_back(std::thread([&]() {
+            size_t i;
+            while ((i = next++) < fleet.size())
+            {
+                runDevice(*fleetTask, values, fleet[i]);
+                fprintf(stderr, "\r%zu/%zu devices", ++done, fleet.size());
+            }
+        }));
+    }
+    for (size_t w = 0; w < workers.size(); w++)
+        workers[w].join();
+    fprintf(stderr, "\n");
+    double hostS = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    if (!outPath.empty())
+    {
+        FILE *out = fopen(outPath.c_str(), "w");
+        if (out == NULL)
+        {
+            perror(outPath.c_str());
+            return 1;
+        }
+        fprintf(out, "Device,Mouse,Seed,Days,Stopped,Pellets_Day,Pokes_Day,Jams,Log_KB_Day,SD_Syncs_Day,Battery_mAh_Day,"
+                     "Battery_Days,Host_s\n");
+        for (size_t i = 0; i < fleet.size(); i++)
+        {
+            const FleetDevice &d = fleet[i];
+            fprintf(out, "%d,%s,%llu,%.3f,%s,%.1f,%.1f,%lu,%.1f,%.0f,%.2f,%.1f,%.2f\n", d.number, d.mouse.c_str(),
+                    (unsigned long long)d.config.seed, d.days, d.reason, d.perDay(d.pellets), d.perDay(d.pokes), d.jams,
+                    d.perDay(d.sdBytes) / 1024.0, d.perDay(d.sdSyncs), d.perDay(d.batteryMah), d.batteryDays(), d.hostS);
+        }
+        fclose(out);
+    }
+
+    // Room totals
+    double deviceDays = 0, pelletsDay = 0, bytesDay = 0;
+    std::vector<double> logKB, syncs, drain, lasts;
+    int stopped = 0;
+    const FleetDevice *firstEmpty = NULL;
+    for (size_t i = 0; i < fleet.size(); i++)
+    {
+        const FleetDevice &d = fleet[i];
+        if (strcmp(d.reason, "time") != 0)
+            stopped++;
+        deviceDays += d.days;
+        pelletsDay += d.perDay(d.pellets);
+        bytesDay += d.perDay(d.sdBytes);
+        logKB.push_back(d.perDay(d.sdBytes) / 1024.0);
+        syncs.push_back(d.perDay(d.sdSyncs));
+        drain.push_back(d.perDay(d.batteryMah));
+        lasts.push_back(d.batteryDays());
+        if (firstEmpty == NULL || d.batteryDays() < firstEmpty->batteryDays())
+            firstEmpty = &d;
+    }
+
+    printf("fleet:            %d devices, %s task, %.1f days each, %u threads\n", devices, task.c_str(), days,
+           (unsigned)workers.size());
+    printf("host:             %.1f s, %.1f device-days per second\n", hostS, hostS > 0 ? deviceDays / hostS : 0.0);
+    if (stopped)
+        printf("stopped early:    %d devices (see --out for why)\n", stopped);
+    printf("pellets:          %.0f per day for the room, %.1f per device\n", pelletsDay, pelletsDay / devices);
+    printf("logs:             %.1f KB/day per device (max %.1f), %.2f MB/day and %.1f MB/month for the room\n",
+           median(logKB), *std::max_element(logKB.begin(), logKB.end()), bytesDay / 1048576.0, bytesDay * 30 / 1048576.0);
+    printf("SD syncs:         %.0f per day per device (max %.0f)\n", median(syncs), *std::max_element(syncs.begin(), syncs.end()));
+    printf("battery:          %.1f mAh/day per device (max %.1f) from %.0f mAh, lasts %.1f days (median)\n", median(drain),
+           *std::max_element(drain.begin(), drain.end()), base.batteryMah, median(lasts));
+    if (firstEmpty && isfinite(firstEmpty->batteryDays()))
+        printf("battery swaps:    first empty after %.1f days (device %d), swap the room every %d days to keep 20%% in reserve\n",
+               firstEmpty->batteryDays(), firstEmpty->number, (int)(firstEmpty->batteryDays() * 0.8));
+    return 0;
+}
@@ -0,0 +1,213 @@
+/*
+  NeoPixel frame and rail check
+
+  Counts the frames the library sends to the NeoPixel strip (each strip.show() of the simulator's NeoPixel
+  stand-in) and the time the motor driver and NeoPixel rail is powered, on a simulated FED3.
+
+  First it calls the pixel helpers of src/FED3_Pixel.cpp and the pixel effects of src/FED3_Animation.cpp one by
+  one and checks each against the frames it should send and whether it should leave the rail on. pixelsOn()
+  and pixelsOff() used to send a frame per pixel (8 and 10) and power the rail even to turn the pixels off; now
+  a change sends one frame and turning every pixel off only switches the rail off. colorWipe() sends a frame
+  per pixel as it always did and leaves the pixels dark.
+
+  Then it runs each of the library's tasks with a mouse for a simulated day (by default) and prints the frames
+  and the rail time per day, with the share of the battery the rail used. fed3_sim prints the same two numbers
+  after running an example program.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_pixelbench.cpp -o fed3_pixelbench
+
+  Usage:
+    fed3_pixelbench [--mouse random|learning] [--hours N] [--seed N] [--sd DIR]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <sys/stat.h>
+
+struct PixelCase
+{
+    const char *name;
+    unsigned long frames;
+    unsigned long expectedFrames;
+    unsigned long before; // frames the helper sent before frames were batched, 0 if new
+    bool railOn;
+    bool expectedRail;
+};
+
+struct TaskRun
+{
+    const char *name;
+    const char *reason = "not run";
+    double hours = 0;
+    unsigned long frames = 0;
+    double railS = 0;
+    double railMah = 0;
+    double batteryMah = 0;
+    unsigned long pellets = 0;
+};
+
+static const char *taskNames[] = {"fr", "pr", "extinction", "pavlovian", "bandit", "timed"};
+
+static void runTask(const char *name, const char *mouseName, const FED3SimConfig &config, TaskRun &run)
+{
+    FED3SimMouse *mouse = fed3SimMakeMouse(mouseName, FED3SimBehavior());
+    FED3SimBoard board(config);
+    board.mouse = mouse;
+    FED3 fed3(String("Pixels"));
+    run.name = name;
+    run.reason = board.run(
+        [&]() {
+            fed3.startTask(*fed3SimTask(name));
+            fed3.begin();
+        },
+        [&]() { fed3.run(); });
+    run.hours = board.hours();
+    run.frames = board.stats.pixelFrames;
+    run.railS = board.stats.railNs / 1e9;
+    run.railMah = config.railMa * board.stats.railNs / 3.6e12;
+    run.batteryMah = board.stats.batteryUsedMah;
+    run.pellets = board.stats.pelletsEaten;
+    delete mouse;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_pixelbench [--mouse random|learning] [--hours N] [--seed N] [--sd DIR]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string mouse = "learning", sdDir = "pixelbench_sd";
+    FED3SimConfig config;
+    config.durationS = 86400;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--mouse")
+            mouse = value;
+        else if (arg == "--hours")
+            config.durationS = atof(value.c_str()) * 3600;
+        else if (arg == "--seed")
+            config.seed = strtoull(value.c_str(), NULL, 10);
+        else if (arg == "--sd")
+            sdDir = value;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    FED3SimMouse *check = fed3SimMakeMouse(mouse.c_str(), FED3SimBehavior());
+    if (check == NULL || config.durationS <= 0)
+    {
+        usage();
+        return 2;
+    }
+    delete check;
+    ::mkdir(sdDir.c_str(), 0777);
+
+    // The helpers one by one, on a board without a mouse
+    FED3SimConfig helperConfig;
+    helperConfig.sdDir = sdDir + "/helpers";
+    FED3SimBoard board(helperConfig);
+    FED3 fed3(String("Pixels"));
+    bool rail = false;
+    board.onOutput = [&](uint8_t pin, int level) {
+        if (pin == MOTOR_ENABLE)
+            rail = level == HIGH;
+    };
+    std::vector<PixelCase> cases;
+    board.run(
+        [&]() {
+            fed3.begin();
+            fed3.pixelsOff();
+            uint32_t blue = fed3.strip.Color(0, 0, 20, 0);
+            auto check = [&](const char *name, unsigned long expected, unsigned long before, bool expectedRail,
+                             std::function<void()> call) {
+                unsigned long start = board.stats.pixelFrames;
+                call();
+                cases.push_back(PixelCase{name, board.stats.pixelFrames - start, expected, before, rail, expectedRail});
+            };
+            auto animate = [&]() {
+                while (fed3.animationRunning())
+                {
+                    fed3.serviceAnimations();
+                    delay(1);
+                }
+            };
+
+            check("pixelsOn", 1, 8, true, [&]() { fed3.pixelsOn(0, 0, 20, 0); });
+            check("pixelsOn, same", 0, 8, true, [&]() { fed3.pixelsOn(0, 0, 20, 0); });
+            check("leftPixel", 1, 1, true, [&]() { fed3.leftPixel(20, 0, 0, 0); });
+            check("pixelsOff", 0, 10, false, [&]() { fed3.pixelsOff(); });
+            check("pixelsOff, dark", 0, 10, false, [&]() { fed3.pixelsOff(); });
+            check("rightPokePixel", 1, 1, true, [&]() { fed3.rightPokePixel(0, 20, 0, 0); });
+            check("rightPokePixel, off", 0, 1, false, [&]() { fed3.rightPokePixel(0, 0, 0, 0); });
+            check("colorWipe", 8, 8, false, [&]() { fed3.colorWipe(blue, 10); });
+            check("startColorWipe", 8, 0, false, [&]() {
+                fed3.startColorWipe(blue, 10);
+                animate();
+            });
+            // 32 steps: the two dark ones turn the rail off and the second step at full level changes nothing
+            check("startPixelPulse", 29, 0, false, [&]() {
+                fed3.startPixelPulse(blue, 640, false);
+                for (int step = 0; step < 32; step++)
+                {
+                    fed3.serviceAnimations();
+                    delay(20);
+                }
+                fed3.cancelAnimations();
+            });
+            check("startPokeCue", 16, 0, false, [&]() {
+                fed3.startPokeCue(blue, 20, false);
+                for (int step = 0; step < 16; step++)
+                {
+                    fed3.serviceAnimations();
+                    delay(20);
+                }
+                fed3.cancelAnimations();
+            });
+            throw FED3SimStop{"done"};
+        },
+        []() {});
+
+    int failed = 0;
+    printf("%-20s %7s %9s %7s %5s %9s  %s\n", "helper", "frames", "expected", "before", "rail", "expected", "result");
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+        const PixelCase &c = cases[i];
+        bool ok = c.frames == c.expectedFrames && c.railOn == c.expectedRail;
+        failed += !ok;
+        char before[24] = "-";
+        if (c.before)
+            snprintf(before, sizeof(before), "%lu", c.before);
+        printf("%-20s %7lu %9lu %7s %5s %9s  %s\n", c.name, c.frames, c.expectedFrames, before, c.railOn ? "on" : "off",
+               c.expectedRail ? "on" : "off", ok ? "ok" : "FAIL");
+    }
+    printf("%zu helpers, %d failed\n\n", cases.size(), failed);
+
+    printf("%s mouse, seed %llu\n", mouse.c_str(), (unsigned long long)config.seed);
+    printf("%-12s %8s %12s %12s %12s %8s\n", "task", "hours", "frames/day", "rail_s/day", "rail_share", "pellets");
+    for (size_t t = 0; t < sizeof(taskNames) / sizeof(taskNames[0]); t++)
+    {
+        TaskRun run;
+        config.sdDir = sdDir + "/" + taskNames[t];
+        runTask(taskNames[t], mouse.c_str(), config, run);
+        double days = run.hours / 24;
+        printf("%-12s %8.2f %12.1f %12.1f %11.1f%% %8lu\n", run.name, run.hours, days > 0 ? run.frames / days : 0.0,
+               days > 0 ? run.railS / days : 0.0, run.batteryMah > 0 ? 100 * run.railMah / run.batteryMah : 0.0,
+               run.pellets);
+        if (strcmp(run.reason, "time") != 0)
+            printf("  stopped early: %s\n", run.reason);
+    }
+    return failed ? 1 : 0;
+}
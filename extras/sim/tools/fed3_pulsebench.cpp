@@ -0,0 +1,193 @@
+/*
+  Pulse train edge timing check
+
+  Runs pulse trains of startPulseTrain(), startPulseEdges() and pulseGenerator() (see src/FED3_BNC.cpp) on a
+  simulated FED3, whose TC3 model calls TC3_Handler() when the real counter would match, and records every level
+  change of the BNC output on the processor clock. Each edge is compared with the schedule the train asked for,
+  worked out here from its parameters rather than with the library's pulseEdgeTime(), counted from the call that
+  started the train.
+
+  Trains cover short and long pulses, periods that don't divide a millisecond, gaps longer than one TC3 wait
+  (21 ms, after which the timer is re-armed), bursts, pulses too short to re-arm the timer between edges, and a
+  train that runs while the main loop redraws the display. For each it prints the edges seen against the edges
+  expected, how late the edges were on the board (worst and mean) and the worst lateness the library measured
+  itself (pulseWorstLateUs). A train fails if an edge is missing, has the wrong level, or is more than
+  --tolerance microseconds late or at all early.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_pulsebench.cpp -o fed3_pulsebench
+
+  Usage:
+    fed3_pulsebench [--tolerance US]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+
+struct Edge
+{
+    uint64_t ns; // processor clock
+    int level;
+};
+
+struct PulseCase
+{
+    const char *name;
+    unsigned long widthUs;
+    unsigned long periodUs;
+    unsigned int pulses;
+    unsigned int bursts;
+    unsigned long burstGapUs;
+    bool drawDisplay; // redraw the screen while the train runs
+};
+
+static const PulseCase cases[] = {
+    {"1 kHz, 100 us", 100, 1000, 200, 1, 0, false},
+    {"3 Hz, 10 ms", 10000, 333333, 6, 1, 0, false},
+    {"20 Hz opto, 5 ms", 5000, 50000, 40, 1, 0, false},
+    {"40 Hz bursts", 10000, 25000, 10, 5, 500000, false},
+    {"50 us period", 20, 50, 100, 1, 0, false},
+    {"20 Hz, display", 5000, 50000, 40, 1, 0, true},
+};
+
+static const unsigned long edgeList[] = {0, 200, 1000, 1500, 31000, 31050, 90000, 190000};
+
+// Rising edges at even entries, falling at odd, from the first rising edge
+static std::vector<unsigned long> expectedEdges(const PulseCase &c)
+{
+    std::vector<unsigned long> edges;
+    unsigned long burstStart = 0;
+    for (unsigned int b = 0; b < c.bursts; b++)
+    {
+        for (unsigned int p = 0; p < c.pulses; p++)
+        {
+            edges.push_back(burstStart + p * c.periodUs);
+            edges.push_back(burstStart + p * c.periodUs + c.widthUs);
+        }
+        burstStart += c.pulses * c.periodUs + c.burstGapUs;
+    }
+    return edges;
+}
+
+struct Result
+{
+    std::string name;
+    size_t seen = 0;
+    size_t expected = 0;
+    long worstLateUs = 0;
+    long earliestUs = 0; // most negative lateness, 0 if none was early
+    double meanLateUs = 0;
+    unsigned long libraryWorstUs = 0;
+    bool levelsOk = true;
+};
+
+static Result compare(const std::string &name, uint64_t startNs, const std::vector<Edge> &seen,
+                      const std::vector<unsigned long> &expected, unsigned long libraryWorstUs)
+{
+    Result r;
+    r.name = name;
+    r.seen = seen.size();
+    r.expected = expected.size();
+    r.libraryWorstUs = libraryWorstUs;
+    double sum = 0;
+    for (size_t i = 0; i < seen.size() && i < expected.size(); i++)
+    {
+        if (seen[i].level != ((i & 1) ? LOW : HIGH))
+            r.levelsOk = false;
+        long late = (long)(((int64_t)seen[i].ns - (int64_t)startNs) / 1000) - (long)expected[i];
+        r.worstLateUs = std::max(r.worstLateUs, late);
+        r.earliestUs = std::min(r.earliestUs, late);
+        sum += late;
+    }
+    r.meanLateUs = seen.empty() ? 0 : sum / seen.size();
+    return r;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_pulsebench [--tolerance US]\n");
+}
+
+int main(int argc, char **argv)
+{
+    long tolerance = 30;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = atol(argv[++i]);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    FED3SimConfig config;
+    config.sdDir = "pulsebench_sd";
+    FED3SimBoard board(config);
+    FED3 fed3(String("Pulses"));
+    std::vector<Edge> edges;
+    board.onOutput = [&](uint8_t pin, int level) {
+        if (pin == BNC_OUT)
+            edges.push_back(Edge{board.awakeNs, level});
+    };
+    std::vector<Result> results;
+
+    board.run(
+        [&]() {
+            fed3.begin();
+            for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+            {
+                const PulseCase &pc = cases[c];
+                edges.clear();
+                fed3.resetPulseStats();
+                uint64_t startNs = board.awakeNs;
+                fed3.startPulseTrain(pc.widthUs, pc.periodUs, pc.pulses, pc.bursts, pc.burstGapUs);
+                while (fed3.pulseTrainRunning())
+                {
+                    if (pc.drawDisplay)
+                        fed3.UpdateDisplay();
+                    else
+                        delay(1);
+                }
+                results.push_back(compare(pc.name, startNs, edges, expectedEdges(pc), fed3.pulseWorstLateUs));
+            }
+
+            edges.clear();
+            fed3.resetPulseStats();
+            uint64_t startNs = board.awakeNs;
+            fed3.startPulseEdges(edgeList, sizeof(edgeList) / sizeof(edgeList[0]));
+            while (fed3.pulseTrainRunning())
+                delay(1);
+            results.push_back(compare("edge list", startNs, edges,
+                                      std::vector<unsigned long>(edgeList, edgeList + sizeof(edgeList) / sizeof(edgeList[0])),
+                                      fed3.pulseWorstLateUs));
+
+            // pulseGenerator() blocks until its train is done: 3 Hz, which 1000 / frequency used to truncate
+            edges.clear();
+            fed3.resetPulseStats();
+            startNs = board.awakeNs;
+            fed3.pulseGenerator(10, 3, 6);
+            PulseCase generator = {"pulseGenerator", 10000, 333333, 6, 1, 0, false};
+            results.push_back(compare(generator.name, startNs, edges, expectedEdges(generator), fed3.pulseWorstLateUs));
+            throw FED3SimStop{"done"};
+        },
+        []() {});
+
+    int failed = 0;
+    printf("%-18s %6s %8s %14s %12s %12s %16s  %s\n", "train", "edges", "expected", "worst_late_us", "mean_late_us",
+           "earliest_us", "library_worst_us", "result");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        bool ok = r.seen == r.expected && r.levelsOk && r.worstLateUs <= tolerance && r.earliestUs >= 0;
+        failed += !ok;
+        printf("%-18s %6zu %8zu %14ld %12.1f %12ld %16lu  %s\n", r.name.c_str(), r.seen, r.expected, r.worstLateUs,
+               r.meanLateUs, r.earliestUs, r.libraryWorstUs, ok ? "ok" : "FAIL");
+    }
+    printf("%zu trains, %d failed, tolerance %ld us\n", results.size(), failed, tolerance);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+/*
+  Golden image check of the FED3 screens
+
+  Runs FED3::captureScreens() (see src/FED3_Display.cpp) on a simulated FED3, which draws every screen and
+  the mode names of every menu, and compares each image with its golden image, pixel for pixel. Prints the
+  draw and refresh time of each screen from SCREENS.CSV, in the simulator's time (display transfers and waits,
+  not the drawing itself). Images that differ are written to the output folder under the golden image's name,
+  and the number of pixels that differ and the box around them are printed.
+
+  The screens are drawn at a fixed time and battery voltage, so they only change when the drawing code does.
+  Golden images depend on the font: extras/sim/golden/block holds the images drawn with the simulator's block
+  glyphs, extras/sim/golden/freesans those drawn with the real fonts (see extras/readme.md). Only the block
+  images are in the repository, so without the fonts installed the check covers where text is drawn and how wide
+  it is, not the shapes of the glyphs; the run says so. After a change to a screen that is meant, update the
+  images with --update and look at them before committing.
+
+  The simulated SD card and the images that differ go to --out, by default fed3_screens in the temp folder, so a
+  run leaves nothing in the repository.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_screens.cpp -o fed3_screens
+
+  Usage (from the repository root):
+    fed3_screens [--golden DIR] [--out DIR] [--update]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+struct Screen
+{
+    std::string name;
+    std::string image; // file on the simulated SD card
+    unsigned long drawUs;
+    unsigned long refreshUs;
+};
+
+static bool readFile(const std::string &path, std::string &data)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+        return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    data = buffer.str();
+    return true;
+}
+
+static bool writeFile(const std::string &path, const std::string &data)
+{
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << data;
+    return (bool)out;
+}
+
+// P4 image: width, height and the packed rows
+static bool parsePBM(const std::string &data, int &width, int &height, std::string &bits)
+{
+    int offset = 0;
+    if (sscanf(data.c_str(), "P4 %d %d%n", &width, &height, &offset) != 2 || offset >= (int)data.size())
+        return false;
+    bits = data.substr(offset + 1);
+    return bits.size() == (size_t)((width + 7) / 8 * height);
+}
+
+// Pixels that differ and the box around them
+static long comparePBM(const std::string &a, const std::string &b, int box[4])
+{
+    int wa, ha, wb, hb;
+    std::string bitsA, bitsB;
+    if (!parsePBM(a, wa, ha, bitsA) || !parsePBM(b, wb, hb, bitsB) || wa != wb || ha != hb)
+        return -1;
+    long differ = 0;
+    int rowBytes = (wa + 7) / 8;
+    box[0] = wa, box[1] = ha, box[2] = -1, box[3] = -1;
+    for (int y = 0; y < ha; y++)
+    {
+        for (int x = 0; x < wa; x++)
+        {
+            int i = y * rowBytes + x / 8, bit = 0x80 >> (x & 7);
+            if ((bitsA[i] & bit) != (bitsB[i] & bit))
+            {
+                differ++;
+                box[0] = std::min(box[0], x);
+                box[1] = std::min(box[1], y);
+                box[2] = std::max(box[2], x);
+                box[3] = std::max(box[3], y);
+            }
+        }
+    }
+    return differ;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_screens [--golden DIR] [--out DIR] [--update]\n");
+}
+
+int main(int argc, char **argv)
+{
+    bool realFont = FreeSans9pt7b.bitmap[0] != 0xFF || FreeSans9pt7b.bitmap[1] != 0xFF;
+    std::string golden = realFont ? "extras/sim/golden/freesans" : "extras/sim/golden/block";
+    const char *tmp = getenv("TMPDIR");
+    std::string outDir = std::string(tmp && *tmp ? tmp : "/tmp") + "/fed3_screens";
+    bool update = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--update")
+            update = true;
+        else if (arg == "--golden" && i + 1 < argc)
+            golden = argv[++i];
+        else if (arg == "--out" && i + 1 < argc)
+            outDir = argv[++i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    // Every screen at a fixed time, with a fresh battery
+    FED3SimConfig config;
+    config.sdDir = outDir + "/sd";
+    config.startUnix = 1740816000UL; // 3/1/2025 08:00:00
+    ::mkdir(outDir.c_str(), 0777);
+    FED3SimBoard board(config);
+    FED3 fed3(String("Screens"));
+    board.run(
+        [&]() {
+            fed3.begin();
+            fed3.captureScreens();
+            throw FED3SimStop{"done"};
+        },
+        []() {});
+
+    std::ifstream timing(board.sdPath("SCREENS.CSV").c_str());
+    std::string line;
+    std::vector<Screen> screens;
+    std::getline(timing, line); // header
+    while (std::getline(timing, line))
+    {
+        int index;
+        char name[32];
+        Screen screen;
+        if (sscanf(line.c_str(), "%d,%31[^,],%lu,%lu", &index, name, &screen.drawUs, &screen.refreshUs) != 4)
+            continue;
+        char image[16];
+        snprintf(image, sizeof(image), "SCR_%03d.PBM", index);
+        screen.name = name;
+        screen.image = board.sdPath(image);
+        screens.push_back(screen);
+    }
+    if (screens.empty())
+    {
+        fprintf(stderr, "captureScreens() wrote no screens\n");
+        return 1;
+    }
+
+    if (update)
+        ::mkdir(golden.c_str(), 0777);
+    int failed = 0, missing = 0;
+    printf("%-16s %10s %10s  %s\n", "screen", "draw_us", "refresh_us", golden.c_str());
+    for (size_t i = 0; i < screens.size(); i++)
+    {
+        const Screen &screen = screens[i];
+        std::string image, expected;
+        std::string goldenPath = golden + "/" + screen.name + ".pbm";
+        readFile(screen.image, image);
+        printf("%-16s %10lu %10lu  ", screen.name.c_str(), screen.drawUs, screen.refreshUs);
+
+        if (update)
+        {
+            printf(writeFile(goldenPath, image) ? "updated\n" : "could not write\n");
+            continue;
+        }
+        if (!readFile(goldenPath, expected))
+        {
+            printf("no golden image\n");
+            missing++;
+            continue;
+        }
+        int box[4];
+        long differ = comparePBM(image, expected, box);
+        if (differ == 0)
+        {
+            printf("match\n");
+            continue;
+        }
+        failed++;
+        writeFile(outDir + "/" + screen.name + ".pbm", image);
+        if (differ < 0)
+            printf("DIFFERS in size\n");
+        else
+            printf("DIFFERS in %ld pixels, x %d-%d, y %d-%d\n", differ, box[0], box[2], box[1], box[3]);
+    }
+
+    if (!update)
+    {
+        printf("%zu screens, %d differ, %d without a golden image", screens.size(), failed, missing);
+        if (failed)
+            printf(", new images in %s", outDir.c_str());
+        printf("\n");
+        if (!realFont)
+            printf("drawn with the block glyphs, the glyph shapes of the real fonts were not checked\n");
+    }
+    return failed || missing ? 1 : 0;
+}
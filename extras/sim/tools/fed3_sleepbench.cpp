@@ -0,0 +1,159 @@
+/*
+  Sleep check over a simulated day
+
+  Runs one of the library's tasks with a mouse for 24 hours (by default) on the simulator, once with the
+  deadline driven sleep of goToSleep() (see src/FED3_Deadlines.cpp) and once waking at least every 5 seconds,
+  as the library did before. For each run it prints the wakeups per hour, the fraction of the time asleep as
+  the library measures it (sleepResidency()) and as the simulated board spent it, and the battery drain.
+
+  It also checks deadlineClock(), the library's time base on the M0, where millis() stops in standby: after
+  every pass of the loop it is compared with the time since power on, and the largest difference and the one
+  at the end of the run are printed. A poke or a pellet that ends a sleep early is measured with the RTC,
+  which only counts whole seconds, so the clock may be a second or so off but must not drift: the run fails
+  when it is more than two seconds off.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_sleepbench.cpp -o fed3_sleepbench
+
+  Usage:
+    fed3_sleepbench [--task fr|pr|extinction|pavlovian|bandit|timed] [--mouse random|learning] [--hours N]
+                    [--seed N] [--sd DIR]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <sys/stat.h>
+
+struct SleepRun
+{
+    const char *name;
+    unsigned long maxSleepMs;
+    const char *reason = "not run";
+    double hours = 0;
+    unsigned long wakeups = 0;
+    unsigned long sleeps = 0; // sleeps the board saw, including sleepForever()
+    double residency = 0;     // sleepResidency()
+    double simResidency = 0;  // time the board spent asleep
+    double batteryMahDay = 0;
+    long worstDriftMs = 0;
+    long endDriftMs = 0;
+    unsigned long pellets = 0;
+};
+
+// deadlineClock() minus the time since power on
+static long clockDrift(FED3 &fed3, const FED3SimBoard &board)
+{
+    return (long)fed3.deadlineClock() - (long)(board.wallNs / 1000000ULL);
+}
+
+static void runSleep(const FED3_Task &task, const char *mouseName, const FED3SimConfig &config, SleepRun &run)
+{
+    FED3SimMouse *mouse = fed3SimMakeMouse(mouseName, FED3SimBehavior());
+    FED3SimBoard board(config);
+    board.mouse = mouse;
+    FED3 fed3(String("Sleep"));
+    run.reason = board.run(
+        [&]() {
+            fed3.startTask(task);
+            fed3.begin();
+            fed3.maxSleepMs = run.maxSleepMs;
+        },
+        [&]() {
+            fed3.run();
+            long drift = clockDrift(fed3, board);
+            if (labs(drift) > labs(run.worstDriftMs))
+                run.worstDriftMs = drift;
+            run.endDriftMs = drift;
+        });
+
+    run.hours = board.hours();
+    run.wakeups = fed3.sleepWakeups;
+    run.sleeps = board.stats.sleeps;
+    // sleepResidency() reads millis(), which would move the finished board on, so take its sum here
+    double clockMs = board.awakeNs / 1e6 + fed3.sleptMs;
+    run.residency = clockMs > 0 ? fed3.sleptMs / clockMs : 0.0;
+    run.simResidency = board.wallNs ? (double)board.stats.sleptNs / board.wallNs : 0.0;
+    run.batteryMahDay = run.hours > 0 ? board.stats.batteryUsedMah * 24 / run.hours : 0.0;
+    run.pellets = board.stats.pelletsEaten;
+    delete mouse;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_sleepbench [--task fr|pr|extinction|pavlovian|bandit|timed] [--mouse random|learning]\n"
+                    "                       [--hours N] [--seed N] [--sd DIR]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string task = "fr", mouse = "learning", sdDir = "sleepbench_sd";
+    FED3SimConfig config;
+    config.durationS = 86400;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--task")
+            task = value;
+        else if (arg == "--mouse")
+            mouse = value;
+        else if (arg == "--hours")
+            config.durationS = atof(value.c_str()) * 3600;
+        else if (arg == "--seed")
+            config.seed = strtoull(value.c_str(), NULL, 10);
+        else if (arg == "--sd")
+            sdDir = value;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    const FED3_Task *sleepTask = fed3SimTask(task.c_str());
+    FED3SimMouse *check = fed3SimMakeMouse(mouse.c_str(), FED3SimBehavior());
+    if (sleepTask == NULL || check == NULL || config.durationS <= 0)
+    {
+        usage();
+        return 2;
+    }
+    delete check;
+
+    ::mkdir(sdDir.c_str(), 0777);
+    SleepRun runs[2];
+    runs[0].name = "deadlines";
+    runs[0].maxSleepMs = FED3(String("Sleep")).maxSleepMs;
+    runs[1].name = "5 s wakeups";
+    runs[1].maxSleepMs = 5000;
+    for (int r = 0; r < 2; r++)
+    {
+        config.sdDir = sdDir + (r == 0 ? "/deadlines" : "/fixed");
+        runSleep(*sleepTask, mouse.c_str(), config, runs[r]);
+    }
+
+    printf("%s task, %s mouse, seed %llu\n", task.c_str(), mouse.c_str(), (unsigned long long)config.seed);
+    printf("%-12s %8s %9s %10s %13s %12s %12s %10s %8s\n", "sleep", "hours", "wakeups/h", "residency",
+           "sim_residency", "mAh/day", "worst_drift", "end_drift", "pellets");
+    bool drifted = false;
+    for (int r = 0; r < 2; r++)
+    {
+        const SleepRun &run = runs[r];
+        printf("%-12s %8.2f %9.1f %9.2f%% %12.2f%% %12.2f %9ld ms %7ld ms %8lu\n", run.name, run.hours,
+               run.hours > 0 ? run.wakeups / run.hours : 0.0, 100 * run.residency, 100 * run.simResidency,
+               run.batteryMahDay, run.worstDriftMs, run.endDriftMs, run.pellets);
+        if (strcmp(run.reason, "time") != 0)
+            printf("  stopped early: %s\n", run.reason);
+        drifted |= labs(run.worstDriftMs) > 2000;
+    }
+    if (runs[0].hours > 0 && runs[1].hours > 0 && runs[0].wakeups > 0)
+        printf("wakeups: %.1fx fewer with deadlines\n", (double)runs[1].wakeups / runs[0].wakeups);
+    if (drifted)
+        printf("deadlineClock() drifted more than two seconds from the time since power on\n");
+    return drifted ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+/*
+  Session statistics microbenchmark
+
+  Times the on-device statistics update (FED3::statsEvent(), see src/FED3_Stats.cpp) on the host and checks
+  that its cost doesn't grow with the session: the time per event is measured on streams of 1 thousand to
+  1 million events, each call is timed on its own for the slowest ones, and every allocation made while
+  events are counted is counted too (there should be none). The results are checked against a recount from
+  the whole event list at points along the stream: the rolling hour, the 24 hourly bins, the retrieval time
+  mean and standard deviation, and the meals.
+
+  Events are drawn like a long FR session: pokes and pellets seconds to minutes apart, pauses of hours, a few
+  timed out retrievals and jams, and an active side that changes now and then.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_statsbench.cpp -o fed3_statsbench
+
+  Usage:
+    fed3_statsbench [--events N] [--seed N]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <algorithm>
+#include <chrono>
+
+// Allocations made while counting is on
+static bool countingAllocations = false;
+static unsigned long allocations = 0;
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    if (countingAllocations)
+        allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    if (countingAllocations)
+        allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+    if (countingAllocations)
+        allocations++;
+    return __libc_realloc(p, size);
+}
+#endif
+
+struct StatsEvent
+{
+    byte type; // STATS_EVENT_*
+    bool activeLeft;
+    int retMs;
+    uint32_t time;
+};
+
+static std::vector<StatsEvent> makeEvents(size_t count, uint64_t seed)
+{
+    FED3SimRandom random(seed);
+    std::vector<StatsEvent> events(count);
+    uint32_t time = 1740787200; // 3/1/2025 00:00:00
+    bool activeLeft = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        StatsEvent &e = events[i];
+        time += random.chance(0.01) ? (uint32_t)random.exponential(3 * 3600.0) : (uint32_t)random.exponential(20.0);
+        if (random.chance(0.001))
+            activeLeft = !activeLeft;
+        double draw = random.uniform();
+        e.type = draw < 0.45 ? STATS_EVENT_LEFT : draw < 0.75 ? STATS_EVENT_RIGHT : draw < 0.95 ? STATS_EVENT_PELLET :
+                 draw < 0.96 ? STATS_EVENT_JAM : STATS_EVENT_OTHER;
+        e.retMs = random.chance(0.03) ? 60000 : std::min(59999, (int)random.lognormal(3000, 1.0));
+        e.activeLeft = activeLeft;
+        e.time = time;
+    }
+    return events;
+}
+
+static void count(FED3 &fed3, const StatsEvent &e)
+{
+    fed3.activePoke = e.activeLeft;
+    fed3.retInterval = e.retMs;
+    fed3.statsEvent(e.type, e.time);
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Check
+**************************************************************************************************************************************************/
+// Recount the rolling hour and the hourly bins at event `last` from the events before it
+static bool checkAt(FED3 &fed3, const std::vector<StatsEvent> &events, size_t last)
+{
+    uint32_t minute = events[last].time / 60, hour = events[last].time / 3600;
+    unsigned pellets = 0, pokes = 0, active = 0;
+    FED3_StatsHour hours[STATS_HOURS] = {};
+    for (size_t i = last + 1; i-- > 0;)
+    {
+        const StatsEvent &e = events[i];
+        if (hour - e.time / 3600 >= STATS_HOURS)
+            break;
+        bool poke = e.type == STATS_EVENT_LEFT || e.type == STATS_EVENT_RIGHT;
+        bool onActive = poke && (e.type == STATS_EVENT_LEFT) == e.activeLeft;
+        if (minute - e.time / 60 < STATS_MINUTES)
+        {
+            pellets += e.type == STATS_EVENT_PELLET;
+            pokes += poke;
+            active += onActive;
+        }
+        FED3_StatsHour &h = hours[hour - e.time / 3600];
+        h.pellets += e.type == STATS_EVENT_PELLET;
+        h.leftPokes += e.type == STATS_EVENT_LEFT;
+        h.rightPokes += e.type == STATS_EVENT_RIGHT;
+        h.activePokes += onActive;
+        h.jams += e.type == STATS_EVENT_JAM;
+        if (e.type == STATS_EVENT_PELLET && e.retMs < 60000)
+        {
+            h.retrievals++;
+            h.retrievalMs += e.retMs;
+        }
+        else if (e.type == STATS_EVENT_PELLET)
+            h.timedOut++;
+    }
+
+    bool ok = fed3.pelletsLastHour() == pellets && fed3.pokesLastHour() == pokes &&
+              fabs(fed3.pokeEfficiencyLastHour() - (pokes ? (float)active / pokes : 0)) < 1e-6;
+    for (byte h = 0; h < STATS_HOURS; h++)
+    {
+        FED3_StatsHour got = fed3.statsHour(h);
+        ok = ok && got.pellets == hours[h].pellets && got.leftPokes == hours[h].leftPokes &&
+             got.rightPokes == hours[h].rightPokes && got.activePokes == hours[h].activePokes &&
+             got.retrievals == hours[h].retrievals && got.retrievalMs == hours[h].retrievalMs &&
+             got.timedOut == hours[h].timedOut && got.jams == hours[h].jams;
+    }
+    if (!ok)
+        fprintf(stderr, "mismatch at event %zu: %u pellets and %u pokes in the last hour, counted %u and %u\n", last,
+                fed3.pelletsLastHour(), fed3.pokesLastHour(), pellets, pokes);
+    return ok;
+}
+
+// Retrieval time and meals over the whole stream
+static bool checkSession(FED3 &fed3, const std::vector<StatsEvent> &events)
+{
+    double sum = 0, sumSq = 0;
+    unsigned long n = 0, meals = 0, run = 0;
+    uint32_t lastPellet = 0;
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const StatsEvent &e = events[i];
+        if (e.type != STATS_EVENT_PELLET)
+            continue;
+        if (e.retMs < 60000)
+        {
+            n++;
+            sum += e.retMs / 1000.0;
+        }
+        run = (lastPellet != 0 && e.time - lastPellet <= fed3.mealGapSec) ? run + 1 : 1;
+        meals += run == fed3.mealMinPellets;
+        lastPellet = e.time;
+    }
+    double mean = sum / n;
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        if (events[i].type == STATS_EVENT_PELLET && events[i].retMs < 60000)
+            sumSq += (events[i].retMs / 1000.0 - mean) * (events[i].retMs / 1000.0 - mean);
+    }
+    double sd = sqrt(sumSq / (n - 1));
+    bool ok = fed3.retrievalCount() == n && fabs(fed3.retrievalMean() - mean) < 1e-3 * mean &&
+              fabs(fed3.retrievalSD() - sd) < 1e-3 * sd && fed3.mealCount == meals;
+    printf("session:       %lu retrievals, mean %.4f s (two pass %.4f), SD %.4f s (two pass %.4f), %lu meals (%lu)\n",
+           fed3.retrievalCount(), fed3.retrievalMean(), mean, fed3.retrievalSD(), sd, fed3.mealCount, meals);
+    return ok;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Timing
+**************************************************************************************************************************************************/
+static double nsPerEvent(FED3 &fed3, const std::vector<StatsEvent> &events, size_t n, int rounds)
+{
+    double best = INFINITY;
+    for (int r = 0; r < rounds; r++)
+    {
+        fed3.resetStats();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; i++)
+            count(fed3, events[i]);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / n);
+    }
+    return best;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_statsbench [--events N] [--seed N]\n");
+}
+
+int main(int argc, char **argv)
+{
+    size_t total = 1000000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--events")
+            total = strtoul(value.c_str(), NULL, 10);
+        else if (arg == "--seed")
+            seed = strtoull(value.c_str(), NULL, 10);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (total < 1000)
+    {
+        usage();
+        return 2;
+    }
+
+    std::vector<StatsEvent> events = makeEvents(total, seed);
+    FED3 fed3(String("Bench"));
+    printf("events:        %zu over %.1f days\n", total, (events.back().time - events.front().time) / 86400.0);
+
+    // Results against a recount, at about a thousand points
+    bool ok = true;
+    size_t checks = 0;
+    fed3.resetStats();
+    for (size_t i = 0; i < total; i++)
+    {
+        count(fed3, events[i]);
+        if (i % (total / 1000) == 0 || i == total - 1)
+        {
+            ok = checkAt(fed3, events, i) && ok;
+            checks++;
+        }
+    }
+    ok = checkSession(fed3, events) && ok;
+    printf("check:         rolling hour and %d hourly bins at %zu points: %s\n", STATS_HOURS, checks,
+           ok ? "match" : "MISMATCH");
+
+    // Cost per event against the length of the session
+    for (size_t n = 1000; n <= total; n *= 10)
+        printf("%-14s %.1f ns per event\n", (std::to_string(n) + " events:").c_str(), nsPerEvent(fed3, events, n, 5));
+
+    // The event names logdata() passes through statsEventType()
+    const char *names[] = {"Left", "LeftShort", "LeftWithPellet", "Right", "RightinTimeout", "Pellet", "PelletStuck",
+                           "SeqMatch"};
+    const size_t nameCount = sizeof(names) / sizeof(names[0]);
+    std::vector<String> eventNames(names, names + nameCount);
+
+    // Slowest calls, each timed on its own, and allocations, with the event name classified as in logdata()
+    std::vector<float> callNs(total);
+    fed3.resetStats();
+    allocations = 0;
+    countingAllocations = true;
+    for (size_t i = 0; i < total; i++)
+    {
+        const StatsEvent &e = events[i];
+        const String &name = eventNames[i % nameCount];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fed3.activePoke = e.activeLeft;
+        fed3.retInterval = e.retMs;
+        fed3.statsEvent(fed3.statsEventType(name), e.time);
+        callNs[i] = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    countingAllocations = false;
+    std::sort(callNs.begin(), callNs.end());
+    printf("per call:      median %.0f ns, 99.9%% %.0f ns, max %.0f ns (with statsEventType and the clock reads)\n",
+           callNs[total / 2], callNs[total - total / 1000], callNs.back());
+    printf("allocations:   %lu while counting %zu events\n", allocations, total);
+
+    return ok && allocations == 0 ? 0 : 1;
+}
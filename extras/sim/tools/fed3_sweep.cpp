@@ -0,0 +1,315 @@
+/*
+  Parameter sweep over simulated FED3 sessions
+
+  Runs one of the library's tasks (see FED3_Task.cpp) on the simulator for every combination of a
+  parameter grid and a list of seeds, on a pool of worker threads, and prints one summary row per
+  combination with the mean and spread over the seeds: pellets per day, poke efficiency (share of
+  pokes on the active side), pokes per pellet, retrieval time and time to a pellet criterion.
+
+  Every run has its own board and FED3, so runs share nothing and the summary only depends on the
+  grid and the seeds, not on the number of workers.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -pthread -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_sweep.cpp -o fed3_sweep
+
+  Usage:
+    fed3_sweep --task fr|pr|extinction|pavlovian|bandit|timed [--grid NAME=V1,V2,... | NAME=FROM:TO:STEP]...
+               [--mouse random,learning] [--seeds 1:10] [--days N] [--criterion PELLETS] [--jobs N]
+               [--sd DIR] [--out FILE.csv]
+
+  Grid names are FED3 variables (FR, timeout, minPokeTime, activePoke, prob_left, prob_right,
+  pelletsToSwitch, taskDelaySec, choiceDelayMs, timedStart, timedEnd) and the simulator's jam
+  probability (jam). Logs of every run stay in DIR/<row>_<seed>.
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <atomic>
+#include <thread>
+#include <sys/stat.h>
+
+struct SweepAxis
+{
+    std::string name;
+    std::vector<std::string> values;
+};
+
+struct SweepRun
+{
+    size_t row;
+    FED3SimConfig config;
+    std::string mouse;
+    std::vector<std::pair<std::string, double> > values;
+    bool ok = false;
+    double days = 0;
+    unsigned long active = 0;
+    unsigned long inactive = 0;
+    unsigned long pellets = 0;
+    double retrievalS = 0;
+    double criterionH = -1;
+};
+
+/**************************************************************************************************************************************************
+                                                                                               One run
+**************************************************************************************************************************************************/
+static void runOne(const FED3_Task &task, SweepRun &run)
+{
+    FED3SimMouse *mouse = fed3SimMakeMouse(run.mouse.c_str(), FED3SimBehavior());
+    if (mouse == NULL)
+        return;
+
+    FED3SimBoard board(run.config);
+    board.mouse = mouse;
+    FED3 fed3(String("Sweep"));
+    for (size_t i = 0; i < run.values.size(); i++)
+        fed3SimSetVariable(fed3, run.values[i].first.c_str(), run.values[i].second);
+    board.run(
+        [&]() {
+            fed3.startTask(task);
+            fed3.begin();
+        },
+        [&]() { fed3.run(); });
+
+    const FED3SimStats &stats = board.stats;
+    bool leftActive = fed3.activePoke == 1;
+    run.days = board.wallNs / 8.64e13;
+    run.active = leftActive ? stats.leftPokes : stats.rightPokes;
+    run.inactive = leftActive ? stats.rightPokes : stats.leftPokes;
+    run.pellets = stats.pelletsEaten;
+    run.retrievalS = stats.pelletsEaten ? stats.retrievalNs / 1e9 / stats.pelletsEaten : 0.0;
+    run.criterionH = stats.criterionNs ? stats.criterionNs / 3.6e12 : -1.0;
+    run.ok = true;
+    delete mouse;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Sweep
+**************************************************************************************************************************************************/
+// "1,2,5" or "1:10:2"
+static std::vector<std::string> parseValues(const std::string &text)
+{
+    std::vector<std::string> values;
+    double from, to, step = 1;
+    if (text.find(':') != std::string::npos && sscanf(text.c_str(), "%lf:%lf:%lf", &from, &to, &step) >= 2 && step > 0)
+    {
+        char buffer[32];
+        for (double v = from; v <= to + step * 1e-9; v += step)
+        {
+            snprintf(buffer, sizeof(buffer), "%g", v);
+            values.push_back(buffer);
+        }
+        return values;
+    }
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos)
+            comma = text.size();
+        if (comma > start)
+            values.push_back(text.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return values;
+}
+
+struct Summary
+{
+    double n = 0, sum = 0, sumSq = 0;
+    void add(double x)
+    {
+        n++;
+        sum += x;
+        sumSq += x * x;
+    }
+    double mean() const { return n ? sum / n : NAN; }
+    double sd() const { return n > 1 ? sqrt(fmax(0.0, (sumSq - sum * sum / n) / (n - 1))) : 0.0; }
+};
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: fed3_sweep --task fr|pr|extinction|pavlovian|bandit|timed [--grid NAME=V1,V2,...|NAME=FROM:TO:STEP]...\n"
+            "                  [--mouse random,learning] [--seeds 1:10] [--days N] [--criterion PELLETS] [--jobs N]\n"
+            "                  [--sd DIR] [--out FILE.csv]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string task, days = "1", criterion = "0", sdDir = "sweep_sd", outPath;
+    std::vector<SweepAxis> axes;
+    std::vector<std::string> mice(1, "learning");
+    std::vector<std::string> seeds(1, "1");
+    unsigned jobs = std::thread::hardware_concurrency();
+    FED3 probe(String("Sweep")); // checks the grid names
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--task")
+            task = value;
+        else if (arg == "--grid")
+        {
+            size_t eq = value.find('=');
+            if (eq == std::string::npos)
+            {
+                usage();
+                return 2;
+            }
+            SweepAxis axis;
+            axis.name = value.substr(0, eq);
+            axis.values = parseValues(value.substr(eq + 1));
+            if (axis.name != "jam" && !fed3SimSetVariable(probe, axis.name.c_str(), 0))
+            {
+                fprintf(stderr, "fed3_sweep: unknown variable %s\n", axis.name.c_str());
+                return 2;
+            }
+            axes.push_back(axis);
+        }
+        else if (arg == "--mouse")
+            mice = parseValues(value);
+        else if (arg == "--seeds")
+            seeds = parseValues(value);
+        else if (arg == "--days")
+            days = value;
+        else if (arg == "--criterion")
+            criterion = value;
+        else if (arg == "--jobs")
+            jobs = atoi(value.c_str());
+        else if (arg == "--sd")
+            sdDir = value;
+        else if (arg == "--out")
+            outPath = value;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    const FED3_Task *runTask = fed3SimTask(task.c_str());
+    if (runTask == NULL || jobs == 0)
+    {
+        usage();
+        return 2;
+    }
+    SweepAxis mouseAxis;
+    mouseAxis.name = "mouse";
+    mouseAxis.values = mice;
+    axes.push_back(mouseAxis);
+
+    // Every grid point, then every seed of it
+    size_t rows = 1;
+    for (size_t a = 0; a < axes.size(); a++)
+        rows *= axes[a].values.size();
+    ::mkdir(sdDir.c_str(), 0777);
+    std::vector<SweepRun> runs;
+    for (size_t row = 0; row < rows; row++)
+    {
+        for (size_t s = 0; s < seeds.size(); s++)
+        {
+            SweepRun run;
+            run.row = row;
+            size_t index = row;
+            for (size_t a = axes.size(); a-- > 0;)
+            {
+                const std::string &name = axes[a].name;
+                const std::string &value = axes[a].values[index % axes[a].values.size()];
+                index /= axes[a].values.size();
+                if (name == "mouse")
+                    run.mouse = value;
+                else if (name == "jam")
+                    run.config.jamProbability = atof(value.c_str());
+                else
+                    run.values.push_back(std::make_pair(name, atof(value.c_str())));
+            }
+            run.config.seed = strtoull(seeds[s].c_str(), NULL, 10);
+            run.config.durationS = atof(days.c_str()) * 86400.0;
+            run.config.criterionPellets = atol(criterion.c_str());
+            run.config.sdDir = sdDir + "/" + std::to_string(row) + "_" + seeds[s];
+            runs.push_back(run);
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> done(0);
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < jobs && w < runs.size(); w++)
+    {
+        workers.push_back(std::thread([&]() {
+            size_t i;
+            while ((i = next++) < runs.size())
+            {
+                runOne(*runTask, runs[i]);
+                fprintf(stderr, "\r%zu/%zu runs", ++done, runs.size());
+            }
+        }));
+    }
+    for (size_t w = 0; w < workers.size(); w++)
+        workers[w].join();
+    fprintf(stderr, "\n");
+
+    FILE *out = outPath.empty() ? stdout : fopen(outPath.c_str(), "w");
+    if (out == NULL)
+    {
+        perror(outPath.c_str());
+        return 1;
+    }
+    for (size_t a = 0; a < axes.size(); a++)
+        fprintf(out, "%s,", axes[a].name.c_str());
+    fprintf(out, "Runs,Failed,Pellets_Day,Pellets_Day_SD,Efficiency,Efficiency_SD,Pokes_Per_Pellet,Retrieval_s,"
+                 "Criterion_h,Criterion_Reached,Session_Days\n");
+    for (size_t row = 0; row < rows; row++)
+    {
+        Summary pelletsDay, efficiency, pokesPerPellet, retrieval, criterionH, sessionDays;
+        int failed = 0, reached = 0;
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            const SweepRun &run = runs[i];
+            if (run.row != row)
+                continue;
+            if (!run.ok)
+            {
+                failed++;
+                continue;
+            }
+            unsigned long pokes = run.active + run.inactive;
+            pelletsDay.add(run.days > 0 ? run.pellets / run.days : 0);
+            if (pokes)
+                efficiency.add((double)run.active / pokes);
+            if (run.pellets)
+            {
+                pokesPerPellet.add((double)pokes / run.pellets);
+                retrieval.add(run.retrievalS);
+            }
+            if (run.criterionH >= 0)
+            {
+                criterionH.add(run.criterionH);
+                reached++;
+            }
+            sessionDays.add(run.days);
+        }
+        size_t index = row;
+        std::vector<std::string> cells(axes.size());
+        for (size_t a = axes.size(); a-- > 0;)
+        {
+            cells[a] = axes[a].values[index % axes[a].values.size()];
+            index /= axes[a].values.size();
+        }
+        for (size_t a = 0; a < axes.size(); a++)
+            fprintf(out, "%s,", cells[a].c_str());
+        fprintf(out, "%d,%d,%.2f,%.2f,%.3f,%.3f,%.2f,%.2f,%.2f,%d,%.2f\n", (int)sessionDays.n + failed, failed,
+                pelletsDay.mean(), pelletsDay.sd(), efficiency.mean(), efficiency.sd(), pokesPerPellet.mean(),
+                retrieval.mean(), criterionH.mean(), reached, sessionDays.mean());
+    }
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
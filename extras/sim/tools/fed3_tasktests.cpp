@@ -0,0 +1,175 @@
+/*
+  Scripted tests of the task engine's built-in tables
+
+  Runs each of the library's task tables (see src/FED3_Task.cpp) on a simulated FED3 against a scripted input
+  stream, feeding the events to taskEvent() directly, and checks the pellets, the poke counts, the state the
+  task ends in and, where the table changes it, the ratio. The script is a string of events:
+
+    L  left poke        R  right poke        T  state timer
+    h  set the hour from the next number (timed feeding reads currentHour)
+
+  The mouse never pokes by itself and takes each pellet a second after it lands, so Feed() returns, and the
+  pellet well is checked before each event as its interrupt would. Each test
+  runs on its own board and SD directory, so one test can't leave state behind for the next.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_tasktests.cpp -o fed3_tasktests
+
+  Usage:
+    fed3_tasktests [--sd DIR] [--verbose]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <sys/stat.h>
+
+// Pokes only when the script says so, takes pellets after a second
+class ScriptedMouse : public FED3SimMouse
+{
+public:
+    ScriptedMouse() : FED3SimMouse(FED3SimBehavior()) {}
+    const char *name() const { return "scripted"; }
+    FED3SimPoke nextPoke(FED3SimBoard &board) { return FED3SimPoke{1e9, false, 0.1}; }
+    double retrievalDelay(FED3SimBoard &board) { return 1.0; }
+};
+
+struct TaskTest
+{
+    const char *name;
+    const char *task; // fed3SimTask() name
+    std::function<void(FED3 &)> setup;
+    const char *script;
+    int pellets;
+    int left;
+    int right;
+    int state;
+    int ratio; // FR at the end, -1 to not check it
+};
+
+// Pokes in a timeout count toward LeftCount/RightCount unless countAllPokes is off, which the bandit turns off
+static const TaskTest tests[] = {
+    {"FR1, poke in timeout", "fr", [](FED3 &f) { f.FR = 1; }, "L R T L", 2, 2, 1, 1, -1},
+    {"FR3, inactive poke", "fr", [](FED3 &f) { f.FR = 3; }, "L L R L T L", 1, 4, 1, 0, -1},
+    {"FR3, right active", "fr", [](FED3 &f) { f.FR = 3; f.activePoke = 0; }, "L L L R R R", 1, 3, 3, 1, -1},
+    {"FR3, pokes in timeout", "fr", [](FED3 &f) { f.FR = 3; }, "L L L L L L T L L", 1, 8, 0, 0, -1},
+    {"PR, Richardson & Roberts", "pr", [](FED3 &f) {}, "L L L L L L L R", 3, 7, 1, 0, 6},
+    {"extinction", "extinction", [](FED3 &f) {}, "L R L T", 0, 2, 1, 0, -1},
+    {"Pavlovian, cue then pellet", "pavlovian", [](FED3 &f) {}, "T L T T R T", 2, 1, 1, 0, -1},
+    {"Pavlovian, waits for the cue", "pavlovian", [](FED3 &f) {}, "L R L", 0, 2, 1, 0, -1},
+    {"bandit, sure and never", "bandit", [](FED3 &f) { f.prob_left = 100; f.prob_right = 0; }, "L T R T L T L", 1, 2, 1, 1, -1},
+    {"bandit, timeout pokes", "bandit", [](FED3 &f) { f.prob_left = 0; f.prob_right = 0; }, "R T L R", 0, 0, 1, 2, -1},
+    {"bandit, left then right in delay", "bandit", [](FED3 &f) { f.prob_left = 100; f.prob_right = 0; }, "L R T", 1, 1, 0, 0, -1},
+    {"bandit, right then left in delay", "bandit", [](FED3 &f) { f.prob_left = 100; f.prob_right = 0; }, "R L T", 0, 0, 1, 2, -1},
+    {"timed, inside the window", "timed", [](FED3 &f) { f.timedStart = 7; f.timedEnd = 9; }, "h8 L R", 1, 1, 1, 0, -1},
+    {"timed, outside the window", "timed", [](FED3 &f) { f.timedStart = 7; f.timedEnd = 9; }, "h9 L L", 0, 2, 0, 0, -1},
+    {"timed, over midnight", "timed", [](FED3 &f) { f.timedStart = 22; f.timedEnd = 6; }, "h23 L h3 L h12 L", 2, 3, 0, 0, -1},
+};
+
+struct TestResult
+{
+    int pellets = 0;
+    int left = 0;
+    int right = 0;
+    int state = 0;
+    int ratio = 0;
+    const char *error = NULL;
+};
+
+static TestResult runTest(const TaskTest &test, const std::string &sdDir)
+{
+    FED3SimConfig config;
+    config.sdDir = sdDir;
+    config.durationS = 3600;
+    ::mkdir(sdDir.c_str(), 0777);
+    ScriptedMouse mouse;
+    FED3SimBoard board(config);
+    board.mouse = &mouse;
+    FED3 fed3(String("Tests"));
+    TestResult result;
+
+    const char *reason = board.run(
+        [&]() {
+            test.setup(fed3);
+            fed3.startTask(*fed3SimTask(test.task));
+            fed3.begin();
+            test.setup(fed3); // again, startTask() and begin() set some of them, e.g. the bandit's probabilities
+            for (const char *s = test.script; *s; s++)
+            {
+                fed3.pelletTrigger(); // what the well interrupt does once the pellet is taken
+                if (*s == 'L')
+                    fed3.taskEvent(TASK_EVENT_LEFT);
+                else if (*s == 'R')
+                    fed3.taskEvent(TASK_EVENT_RIGHT);
+                else if (*s == 'T')
+                    fed3.taskEvent(TASK_EVENT_TIMER);
+                else if (*s == 'h')
+                {
+                    char *end;
+                    fed3.currentHour = strtoul(s + 1, &end, 10);
+                    s = end - 1;
+                }
+            }
+            result.pellets = fed3.PelletCount;
+            result.left = fed3.LeftCount;
+            result.right = fed3.RightCount;
+            result.state = fed3.taskState;
+            result.ratio = fed3.FR;
+            throw FED3SimStop{"done"};
+        },
+        []() {});
+    if (strcmp(reason, "done") != 0)
+        result.error = reason;
+    return result;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_tasktests [--sd DIR] [--verbose]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string sdDir = "tasktests_sd";
+    bool verbose = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--sd" && i + 1 < argc)
+            sdDir = argv[++i];
+        else if (arg == "--verbose")
+            verbose = true;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    ::mkdir(sdDir.c_str(), 0777);
+
+    int failed = 0;
+    size_t count = sizeof(tests) / sizeof(tests[0]);
+    for (size_t i = 0; i < count; i++)
+    {
+        const TaskTest &test = tests[i];
+        char dir[16];
+        snprintf(dir, sizeof(dir), "/%02zu", i);
+        TestResult r = runTest(test, sdDir + std::string(dir));
+        bool ok = r.error == NULL && r.pellets == test.pellets && r.left == test.left && r.right == test.right &&
+                  r.state == test.state && (test.ratio < 0 || r.ratio == test.ratio);
+        failed += !ok;
+        if (ok && !verbose)
+            continue;
+        printf("%-32s %-12s %-20s %s\n", test.name, test.task, test.script, ok ? "ok" : "FAIL");
+        if (r.error)
+            printf("  stopped: %s\n", r.error);
+        printf("  pellets %d (%d), left %d (%d), right %d (%d), state %d (%d)", r.pellets, test.pellets, r.left,
+               test.left, r.right, test.right, r.state, test.state);
+        if (test.ratio >= 0)
+            printf(", FR %d (%d)", r.ratio, test.ratio);
+        printf("\n");
+    }
+    printf("%zu tests, %d failed\n", count, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,219 @@
+/*
+  Trial stimulus onset jitter check
+
+  Runs trials of startTrial() (see src/FED3_Trial.cpp) on a simulated FED3 and compares when each stimulus ran
+  with when it was scheduled, the trigger plus the stimulus' offset. Each trial has a TTL on the BNC output at a
+  random offset, a tone and the end of the TTL; the BNC edges are recorded on the processor clock, and the onsets
+  the library recorded (stimulusOnsetUs()) are compared as well, for every stimulus.
+
+  The trials run with the main loop idle, while it redraws the display, and while the white noise of Timeout()
+  loops, which a trial's tone pauses rather than stops: after each of those trials the noise has to be playing
+  again. It prints how late the onsets were (mean, median, 99th percentile and worst) on the board and as the
+  library measured them. A run fails if a stimulus is missing, any onset is early, the worst is more than
+  --tolerance microseconds late, or the noise didn't come back.
+
+  Build (from the repository root):
+    g++ -std=gnu++11 -O2 -D__arm__ -Iextras/sim/hal -Iextras/sim -Isrc -include Arduino.h \
+        src/FED3*.cpp extras/sim/fed3_sim.cpp extras/sim/fed3_sim_hal.cpp extras/sim/fed3_sim_mouse.cpp \
+        extras/sim/fed3_sim_tasks.cpp extras/sim/tools/fed3_trialbench.cpp -o fed3_trialbench
+
+  Usage:
+    fed3_trialbench [--trials N] [--seed N] [--tolerance US]
+*/
+
+#include "fed3_sim.h"
+#include <FED3.h>
+#include <algorithm>
+#include <random>
+
+enum Load
+{
+    LOAD_IDLE,
+    LOAD_DISPLAY,
+    LOAD_NOISE,
+};
+
+struct TrialCase
+{
+    const char *name;
+    Load load;
+};
+
+static const TrialCase cases[] = {
+    {"idle", LOAD_IDLE},
+    {"display redraw", LOAD_DISPLAY},
+    {"timeout noise", LOAD_NOISE},
+};
+
+struct Result
+{
+    std::string name;
+    unsigned long trials = 0;
+    unsigned long missing = 0; // stimuli or BNC edges that never came
+    unsigned long noiseLost = 0; // trials after which the looping noise wasn't playing
+    std::vector<long> boardLateUs; // BNC edges
+    std::vector<long> libraryLateUs; // every stimulus, from stimulusOnsetUs()
+};
+
+static long percentile(std::vector<long> v, double p)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+static double mean(const std::vector<long> &v)
+{
+    double sum = 0;
+    for (size_t i = 0; i < v.size(); i++)
+        sum += v[i];
+    return v.empty() ? 0 : sum / v.size();
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_trialbench [--trials N] [--seed N] [--tolerance US]\n");
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long trials = 200;
+    unsigned long seed = 1;
+    long tolerance = 30;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--trials")
+            trials = strtoul(value.c_str(), NULL, 10);
+        else if (arg == "--seed")
+            seed = strtoul(value.c_str(), NULL, 10);
+        else if (arg == "--tolerance")
+            tolerance = atol(value.c_str());
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (trials == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    FED3SimConfig config;
+    config.sdDir = "trialbench_sd";
+    FED3SimBoard board(config);
+    FED3 fed3(String("Trials"));
+    std::vector<uint64_t> bncEdges; // processor clock, ns
+    unsigned long buzzerEdges = 0;
+    board.onOutput = [&](uint8_t pin, int level) {
+        if (pin == BNC_OUT)
+            bncEdges.push_back(board.awakeNs);
+        else if (pin == BUZZER)
+            buzzerEdges++;
+    };
+    std::mt19937 random(seed);
+    std::vector<Result> results;
+
+    board.run(
+        [&]() {
+            fed3.begin();
+            for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+            {
+                const TrialCase &tc = cases[c];
+                Result r;
+                r.name = tc.name;
+                if (tc.load == LOAD_NOISE)
+                    fed3.playNoise(AUDIO_UNTIL_STOPPED);
+                for (unsigned long t = 0; t < trials; t++)
+                {
+                    // TTL at a random offset, a tone 20 ms into it and the end of the TTL after the tone
+                    unsigned long onUs = std::uniform_int_distribution<unsigned long>(0, 250000)(random);
+                    FED3_Stimulus stimuli[] = {
+                        {onUs, STIMULUS_BNC, 1, 0},
+                        {onUs + 20000, STIMULUS_TONE, 4000, 50},
+                        {onUs + 100000, STIMULUS_BNC, 0, 0},
+                    };
+                    const byte count = sizeof(stimuli) / sizeof(stimuli[0]);
+                    bncEdges.clear();
+                    unsigned long triggerUs = micros();
+                    fed3.startTrial(stimuli, count, triggerUs);
+                    while (fed3.trialRunning())
+                    {
+                        if (tc.load == LOAD_DISPLAY)
+                            fed3.UpdateDisplay();
+                        else
+                            delay(1);
+                    }
+
+                    for (byte i = 0; i < count; i++)
+                    {
+                        unsigned long onset = fed3.stimulusOnsetUs(i);
+                        if (onset == 0)
+                            r.missing++;
+                        else
+                            r.libraryLateUs.push_back((long)(onset - (triggerUs + stimuli[i].offsetUs)));
+                    }
+                    const byte bnc[] = {0, 2};
+                    for (byte e = 0; e < 2; e++)
+                    {
+                        if (e >= bncEdges.size())
+                        {
+                            r.missing++;
+                            continue;
+                        }
+                        unsigned long edgeUs = (unsigned long)(bncEdges[e] / 1000);
+                        r.boardLateUs.push_back((long)(edgeUs - (triggerUs + stimuli[bnc[e]].offsetUs)));
+                    }
+
+                    if (tc.load == LOAD_NOISE)
+                    {
+                        delay(60); // the tone is over, the noise should be back
+                        unsigned long before = buzzerEdges;
+                        delay(5);
+                        if (!fed3.isPlaying() || buzzerEdges == before)
+                        {
+                            r.noiseLost++;
+                            fed3.playNoise(AUDIO_UNTIL_STOPPED);
+                        }
+                    }
+                    else
+                    {
+                        while (fed3.isPlaying())
+                            delay(1);
+                    }
+                    r.trials++;
+                }
+                fed3.stop();
+                results.push_back(r);
+            }
+            throw FED3SimStop{"done"};
+        },
+        []() {});
+
+    int failed = 0;
+    printf("%-16s %6s %7s %9s %9s %9s %9s %9s %10s %8s  %s\n", "load", "trials", "missing", "mean_us", "p50_us", "p99_us",
+           "worst_us", "early_us", "lib_worst", "no_noise", "result");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        long worst = percentile(r.boardLateUs, 1.0);
+        long earliest = std::min(percentile(r.boardLateUs, 0.0), percentile(r.libraryLateUs, 0.0));
+        long libraryWorst = percentile(r.libraryLateUs, 1.0);
+        bool ok = r.missing == 0 && r.noiseLost == 0 && earliest >= 0 && worst <= tolerance && libraryWorst <= tolerance;
+        failed += !ok;
+        printf("%-16s %6lu %7lu %9.1f %9ld %9ld %9ld %9ld %10ld %8lu  %s\n", r.name.c_str(), r.trials, r.missing,
+               mean(r.boardLateUs), percentile(r.boardLateUs, 0.5), percentile(r.boardLateUs, 0.99), worst,
+               std::min(earliest, 0L), libraryWorst, r.noiseLost, ok ? "ok" : "FAIL");
+    }
+    printf("%zu loads, %d failed, tolerance %ld us\n", results.size(), failed, tolerance);
+    return failed ? 1 : 0;
+}
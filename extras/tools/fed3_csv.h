@@ -0,0 +1,914 @@
+/*
+  FED3 log reader for host tools
+
+  Reads the FED###_MMDDYY_nn.CSV files the library writes (see FED3::writeHeader() and FED3::logdata()).
+  The header line decides the columns: the FR and Bandit layouts, the optional Temp/Humidity columns, the
+  optional PR_Step and Sync_Seq columns (and Sync_Time_us of older logs) and the session's Seed, which older
+  logs don't have. Rows are parsed in place from a memory mapped file, nothing is allocated per row: text
+  fields point into the file.
+
+  Quirks of the format handled here:
+    - times are M/D/YYYY h:mm:ss without leading zeros on the month, day and hour
+    - numbers are printed by Arduino's Print: "nan" (from sqrt(-1) on rows that have no value), "inf", "ovf"
+    - Retrieval_Time is "Timed_out" when the pellet sat in the well for a minute or more
+    - lines end in CR LF, the last line may be cut short by a power loss
+
+  FED3CsvSession collects the session metrics for a run of rows. Sessions of consecutive parts of a file
+  can be merged in order, so a large file can be split at line boundaries and parsed on several threads.
+
+  Header only, C++11, POSIX (mmap).
+*/
+
+#ifndef FED3_CSV_H
+#define FED3_CSV_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**************************************************************************************************************************************************
+                                                                                               Memory mapped file
+**************************************************************************************************************************************************/
+class FED3CsvFile
+{
+public:
+    FED3CsvFile() {}
+    ~FED3CsvFile() { close(); }
+    FED3CsvFile(const FED3CsvFile &) = delete;
+    FED3CsvFile(FED3CsvFile &&other) : bytes(other.bytes), length(other.length)
+    {
+        other.bytes = NULL;
+        other.length = 0;
+    }
+    FED3CsvFile &operator=(const FED3CsvFile &) = delete;
+
+    bool open(const char *path)
+    {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        length = st.st_size;
+        if (length > 0)
+        {
+            void *p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            madvise(p, length, MADV_SEQUENTIAL);
+            bytes = (const char *)p;
+        }
+        ::close(fd);
+        return true;
+    }
+
+    void close()
+    {
+        if (bytes)
+            munmap((void *)bytes, length);
+        bytes = NULL;
+        length = 0;
+    }
+
+    const char *begin() const { return bytes; }
+    const char *end() const { return bytes + length; }
+    size_t size() const { return length; }
+
+private:
+    const char *bytes = NULL;
+    size_t length = 0;
+};
+
+/**************************************************************************************************************************************************
+                                                                                               Schema
+**************************************************************************************************************************************************/
+enum FED3CsvColumn : uint8_t
+{
+    FED3_CSV_TIME,
+    FED3_CSV_TEMP,
+    FED3_CSV_HUMIDITY,
+    FED3_CSV_VERSION,
+    FED3_CSV_SESSION_TYPE,
+    FED3_CSV_DEVICE,
+    FED3_CSV_BATTERY,
+    FED3_CSV_MOTOR_TURNS,
+    FED3_CSV_FR,
+    FED3_CSV_PELLETS_TO_SWITCH,
+    FED3_CSV_PROB_LEFT,
+    FED3_CSV_PROB_RIGHT,
+    FED3_CSV_EVENT,
+    FED3_CSV_ACTIVE_POKE, // Active_Poke, or High_prob_poke in the Bandit layout
+    FED3_CSV_LEFT_COUNT,
+    FED3_CSV_RIGHT_COUNT,
+    FED3_CSV_PELLET_COUNT,
+    FED3_CSV_BLOCK_PELLET_COUNT,
+    FED3_CSV_RETRIEVAL,
+    FED3_CSV_INTER_PELLET,
+    FED3_CSV_POKE_TIME,
+    FED3_CSV_PR_STEP,
+    FED3_CSV_SYNC_SEQ,
+    FED3_CSV_SYNC_US,
+    FED3_CSV_SEED,
+    FED3_CSV_UNKNOWN,
+};
+
+#define FED3_CSV_FIELD(column) (1UL << (column))
+#define FED3_CSV_ALL_FIELDS 0xFFFFFFFFUL
+#define FED3_CSV_MAX_COLUMNS 32
+
+enum FED3CsvEvent : uint8_t
+{
+    FED3_EVENT_OTHER,
+    FED3_EVENT_PELLET,
+    FED3_EVENT_PELLET_STUCK,
+    FED3_EVENT_LEFT,        // Left, LeftShort, LeftWithPellet, LeftinTimeOut, LeftDuringDispense
+    FED3_EVENT_RIGHT,       // and the same for Right
+};
+
+enum FED3CsvSide : uint8_t
+{
+    FED3_SIDE_NONE,
+    FED3_SIDE_LEFT,
+    FED3_SIDE_RIGHT,
+};
+
+// A text field, pointing into the file
+struct FED3CsvText
+{
+    const char *p = "";
+    uint32_t n = 0;
+
+    bool is(const char *s) const { return strlen(s) == n && memcmp(p, s, n) == 0; }
+    std::string str() const { return std::string(p, n); }
+};
+
+struct FED3CsvRecord
+{
+    int64_t time = 0; // seconds since 1970 in the device's local time
+    float temp = NAN;
+    float humidity = NAN;
+    FED3CsvText version;
+    FED3CsvText sessionType;
+    int device = -1;
+    float battery = NAN;
+    float motorTurns = NAN;
+    int fr = -1;
+    int pelletsToSwitch = -1;
+    int probLeft = -1;
+    int probRight = -1;
+    FED3CsvText eventName;
+    FED3CsvEvent event = FED3_EVENT_OTHER;
+    FED3CsvSide active = FED3_SIDE_NONE;
+    long leftCount = 0;
+    long rightCount = 0;
+    long pelletCount = 0;
+    long blockPelletCount = 0;
+    float retrievalS = NAN;
+    bool timedOut = false;
+    float interPelletS = NAN;
+    float pokeS = NAN;
+    int prStep = -1;
+    long syncSeq = -1;
+    double syncUs = NAN;
+};
+
+// Days from 1970-01-01 to a date of the proleptic Gregorian calendar
+inline int64_t fed3CsvDays(int y, int m, int d)
+{
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+// Header name of a column
+inline const char *fed3CsvColumnName(FED3CsvColumn column)
+{
+    static const char *const names[] = {
+        "MM:DD:YYYY hh:mm:ss", "Temp", "Humidity", "Library_Version", "Session_type", "Device_Number",
+        "Battery_Voltage", "Motor_Turns", "FR", "PelletsToSwitch", "Prob_left", "Prob_right", "Event",
+        "Active_Poke", "Left_Poke_Count", "Right_Poke_Count", "Pellet_Count", "Block_Pellet_Count",
+        "Retrieval_Time", "InterPelletInterval", "Poke_Time", "PR_Step", "Sync_Seq", "Sync_Time_us", "Seed"};
+    return column < FED3_CSV_UNKNOWN ? names[column] : "";
+}
+
+// Column layout of one log file, from its header line
+class FED3CsvSchema
+{
+public:
+    uint8_t columns = 0;
+    FED3CsvColumn column[FED3_CSV_MAX_COLUMNS];
+    unsigned long present = 0; // FED3_CSV_FIELD() of the columns in the file
+
+    // Reads the header at the start of the file, returns where the rows start or NULL if it isn't a FED3 log
+    const char *readHeader(const char *p, const char *end)
+    {
+        columns = 0;
+        present = 0;
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        const char *rows = eol < end ? eol + 1 : end;
+        while (p < eol && columns < FED3_CSV_MAX_COLUMNS)
+        {
+            const char *comma = (const char *)memchr(p, ',', eol - p);
+            const char *stop = comma ? comma : eol;
+            const char *last = stop;
+            while (last > p && (last[-1] == '\r' || last[-1] == ' '))
+                last--;
+            FED3CsvText name;
+            name.p = p;
+            name.n = last - p;
+            FED3CsvColumn c = FED3_CSV_UNKNOWN;
+            for (int i = 0; i < FED3_CSV_UNKNOWN; i++)
+                if (name.is(fed3CsvColumnName((FED3CsvColumn)i)))
+                    c = (FED3CsvColumn)i;
+            if (name.is("High_prob_poke"))
+                c = FED3_CSV_ACTIVE_POKE;
+            column[columns++] = c;
+            if (c != FED3_CSV_UNKNOWN)
+                present |= FED3_CSV_FIELD(c);
+            p = stop + 1;
+        }
+        bool fed3 = columns > 0 && column[0] == FED3_CSV_TIME && (present & FED3_CSV_FIELD(FED3_CSV_EVENT));
+        return fed3 ? rows : NULL;
+    }
+
+    // Parses the row in [p, eol), reading only the columns in fields. Returns false on a row that doesn't
+    // fit the layout: too few columns or a time that doesn't parse.
+    bool parse(const char *p, const char *eol, FED3CsvRecord &r, unsigned long fields = FED3_CSV_ALL_FIELDS) const
+    {
+        while (eol > p && eol[-1] == '\r')
+            eol--;
+        uint8_t c = 0;
+        for (; c < columns && p <= eol; c++)
+        {
+            const char *comma = (const char *)memchr(p, ',', eol - p);
+            const char *stop = comma ? comma : eol;
+            FED3CsvColumn col = column[c];
+            if (col != FED3_CSV_UNKNOWN && (fields & FED3_CSV_FIELD(col)))
+            {
+                if (!parseField(col, p, stop, r))
+                    return false;
+            }
+            p = stop + 1;
+            if (comma == NULL)
+            {
+                c++;
+                break;
+            }
+        }
+        return c == columns;
+    }
+
+    // Splits the row in [p, eol) into its text fields, by column. Columns the file doesn't have are left empty.
+    bool split(const char *p, const char *eol, FED3CsvText (&fields)[FED3_CSV_UNKNOWN]) const
+    {
+        while (eol > p && eol[-1] == '\r')
+            eol--;
+        for (int i = 0; i < FED3_CSV_UNKNOWN; i++)
+            fields[i] = FED3CsvText();
+        for (uint8_t c = 0; c < columns; c++)
+        {
+            if (p > eol)
+                return false;
+            const char *comma = (const char *)memchr(p, ',', eol - p);
+            const char *stop = comma ? comma : eol;
+            if (column[c] != FED3_CSV_UNKNOWN)
+            {
+                fields[column[c]].p = p;
+                fields[column[c]].n = stop - p;
+            }
+            p = stop + 1;
+        }
+        return true;
+    }
+
+private:
+    // Arduino Print float: [-]digits[.digits], or nan/inf/ovf
+    static float number(const char *p, const char *end)
+    {
+        if (p == end)
+            return NAN;
+        bool negative = *p == '-';
+        if (negative)
+            p++;
+        if (p == end || (unsigned)(*p - '0') > 9)
+            return (p < end && *p == 'i') ? (negative ? -INFINITY : INFINITY) : NAN;
+        uint64_t whole = 0;
+        while (p < end && (unsigned)(*p - '0') <= 9)
+            whole = whole * 10 + (*p++ - '0');
+        double value = (double)whole;
+        if (p < end && *p == '.')
+        {
+            static const double scale[] = {1, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9};
+            uint64_t fraction = 0;
+            int digits = 0;
+            for (p++; p < end && (unsigned)(*p - '0') <= 9; p++)
+            {
+                if (digits < 9)
+                {
+                    fraction = fraction * 10 + (*p - '0');
+                    digits++;
+                }
+            }
+            value += fraction * scale[digits];
+        }
+        return (float)(negative ? -value : value);
+    }
+
+    static long integer(const char *p, const char *end, long none = -1)
+    {
+        bool negative = p < end && *p == '-';
+        if (negative)
+            p++;
+        if (p == end || (unsigned)(*p - '0') > 9)
+            return none;
+        long value = 0;
+        while (p < end && (unsigned)(*p - '0') <= 9)
+            value = value * 10 + (*p++ - '0');
+        return negative ? -value : value;
+    }
+
+    // Reads digits up to a separator, advances p past it
+    static bool field(const char *&p, const char *end, char separator, int &value)
+    {
+        int v = 0, digits = 0;
+        while (p < end && (unsigned)(*p - '0') <= 9)
+        {
+            v = v * 10 + (*p++ - '0');
+            digits++;
+        }
+        if (digits == 0)
+            return false;
+        value = v;
+        if (separator)
+        {
+            if (p == end || *p != separator)
+                return false;
+            p++;
+        }
+        return true;
+    }
+
+    static bool parseTime(const char *p, const char *end, int64_t &time)
+    {
+        int month, day, year, hour, minute, second;
+        if (!field(p, end, '/', month) || !field(p, end, '/', day) || !field(p, end, ' ', year) ||
+            !field(p, end, ':', hour) || !field(p, end, ':', minute) || !field(p, end, 0, second))
+            return false;
+        if (month < 1 || month > 12 || day < 1 || day > 31)
+            return false;
+        time = fed3CsvDays(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+        return true;
+    }
+
+    static FED3CsvEvent classify(const char *p, size_t n)
+    {
+        if (n >= 4 && memcmp(p, "Left", 4) == 0)
+            return FED3_EVENT_LEFT;
+        if (n >= 5 && memcmp(p, "Right", 5) == 0)
+            return FED3_EVENT_RIGHT;
+        if (n == 6 && memcmp(p, "Pellet", 6) == 0)
+            return FED3_EVENT_PELLET;
+        if (n == 11 && memcmp(p, "PelletStuck", 11) == 0)
+            return FED3_EVENT_PELLET_STUCK;
+        return FED3_EVENT_OTHER;
+    }
+
+    static bool parseField(FED3CsvColumn col, const char *p, const char *end, FED3CsvRecord &r)
+    {
+        switch (col)
+        {
+        case FED3_CSV_TIME:
+            return parseTime(p, end, r.time);
+        case FED3_CSV_TEMP:
+            r.temp = number(p, end);
+            break;
+        case FED3_CSV_HUMIDITY:
+            r.humidity = number(p, end);
+            break;
+        case FED3_CSV_VERSION:
+            r.version.p = p;
+            r.version.n = end - p;
+            break;
+        case FED3_CSV_SESSION_TYPE:
+            r.sessionType.p = p;
+            r.sessionType.n = end - p;
+            break;
+        case FED3_CSV_DEVICE:
+            r.device = integer(p, end);
+            break;
+        case FED3_CSV_BATTERY:
+            r.battery = number(p, end);
+            break;
+        case FED3_CSV_MOTOR_TURNS:
+            r.motorTurns = number(p, end);
+            break;
+        case FED3_CSV_FR:
+            r.fr = integer(p, end);
+            break;
+        case FED3_CSV_PELLETS_TO_SWITCH:
+            r.pelletsToSwitch = integer(p, end);
+            break;
+        case FED3_CSV_PROB_LEFT:
+            r.probLeft = integer(p, end);
+            break;
+        case FED3_CSV_PROB_RIGHT:
+            r.probRight = integer(p, end);
+            break;
+        case FED3_CSV_EVENT:
+            r.eventName.p = p;
+            r.eventName.n = end - p;
+            r.event = classify(p, end - p);
+            break;
+        case FED3_CSV_ACTIVE_POKE:
+            r.active = end > p && *p == 'L' ? FED3_SIDE_LEFT : end > p && *p == 'R' ? FED3_SIDE_RIGHT : FED3_SIDE_NONE;
+            break;
+        case FED3_CSV_LEFT_COUNT:
+            r.leftCount = integer(p, end, 0);
+            break;
+        case FED3_CSV_RIGHT_COUNT:
+            r.rightCount = integer(p, end, 0);
+            break;
+        case FED3_CSV_PELLET_COUNT:
+            r.pelletCount = integer(p, end, 0);
+            break;
+        case FED3_CSV_BLOCK_PELLET_COUNT:
+            r.blockPelletCount = integer(p, end, 0);
+            break;
+        case FED3_CSV_RETRIEVAL:
+            r.timedOut = end > p && *p == 'T';
+            r.retrievalS = r.timedOut ? NAN : number(p, end);
+            break;
+        case FED3_CSV_INTER_PELLET:
+            r.interPelletS = number(p, end);
+            break;
+        case FED3_CSV_POKE_TIME:
+            r.pokeS = number(p, end);
+            break;
+        case FED3_CSV_PR_STEP:
+            r.prStep = integer(p, end);
+            break;
+        case FED3_CSV_SYNC_SEQ:
+            r.syncSeq = integer(p, end);
+            break;
+        case FED3_CSV_SYNC_US:
+            r.syncUs = number(p, end);
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+};
+
+/**************************************************************************************************************************************************
+                                                                                               Rows and chunks
+**************************************************************************************************************************************************/
+// Walks the rows of [p, end). Blank lines are skipped, rows that don't parse are counted in bad.
+class FED3CsvRows
+{
+public:
+    FED3CsvRows(const FED3CsvSchema &schema, const char *p, const char *end,
+                unsigned long fields = FED3_CSV_ALL_FIELDS)
+        : schema(schema), p(p), end(end), fields(fields) {}
+
+    bool next(FED3CsvRecord &r)
+    {
+        while (p < end)
+        {
+            const char *eol = (const char *)memchr(p, '\n', end - p);
+            if (eol == NULL)
+                eol = end;
+            const char *line = p;
+            p = eol < end ? eol + 1 : end;
+            if (eol == line || (eol == line + 1 && *line == '\r'))
+                continue;
+            rowStart = line;
+            if (schema.parse(line, eol, r, fields))
+                return true;
+            bad++;
+        }
+        return false;
+    }
+
+    const char *position() const { return p; }
+    const char *row() const { return rowStart; } // start of the row next() returned
+    unsigned long bad = 0;
+
+private:
+    const FED3CsvSchema &schema;
+    const char *p;
+    const char *end;
+    unsigned long fields;
+    const char *rowStart = NULL;
+};
+
+// Splits [begin, end) into pieces of about chunkBytes that end at line boundaries
+inline std::vector<const char *> fed3CsvSplit(const char *begin, const char *end, size_t chunkBytes)
+{
+    std::vector<const char *> cuts(1, begin);
+    const char *p = begin;
+    while ((size_t)(end - p) > chunkBytes)
+    {
+        const char *eol = (const char *)memchr(p + chunkBytes, '\n', end - p - chunkBytes);
+        if (eol == NULL)
+            break;
+        p = eol + 1;
+        cuts.push_back(p);
+    }
+    cuts.push_back(end);
+    return cuts;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Time index
+**************************************************************************************************************************************************/
+#define FED3_CSV_INDEX_EVERY 256 // rows per index block
+
+// Sparse time index of a log file: the offset of every Nth row and the earliest and latest time in each block
+// of N rows. Kept next to the log in a sidecar file (the log's path + ".idx"). Logs only grow, so an index of
+// a shorter version of the file is brought up to date by indexing again from its last block.
+// Blocks keep their min and max time, so a range query is exact even where the RTC was set back.
+class FED3CsvIndex
+{
+public:
+    struct Block
+    {
+        int64_t minTime;
+        int64_t maxTime;
+        uint64_t offset; // of the block's first row from the start of the file
+        uint32_t rows;
+        uint32_t reserved;
+    };
+
+    uint32_t every = FED3_CSV_INDEX_EVERY;
+    uint64_t indexedBytes = 0; // size of the log when it was indexed
+    std::vector<Block> blocks;
+
+    // Indexes the rows of a mapped log up to its end, from scratch or from the last block of an older index.
+    // Returns the number of bytes that had to be read.
+    size_t update(const FED3CsvFile &file, const FED3CsvSchema &schema, const char *rows)
+    {
+        const char *from = rows;
+        if (!blocks.empty() && indexedBytes <= file.size() && blocks.back().offset < file.size() &&
+            startsBlock(file, schema, blocks.back()))
+        {
+            from = file.begin() + blocks.back().offset;
+            blocks.pop_back();
+        }
+        else
+            blocks.clear();
+
+        FED3CsvRows reader(schema, from, file.end(), FED3_CSV_FIELD(FED3_CSV_TIME));
+        FED3CsvRecord r;
+        Block *block = NULL;
+        while (reader.next(r))
+        {
+            if (block == NULL || block->rows == every)
+            {
+                Block b = {r.time, r.time, (uint64_t)(reader.row() - file.begin()), 0, 0};
+                blocks.push_back(b);
+                block = &blocks.back();
+            }
+            if (r.time < block->minTime)
+                block->minTime = r.time;
+            if (r.time > block->maxTime)
+                block->maxTime = r.time;
+            block->rows++;
+        }
+        indexedBytes = file.size();
+        return file.end() - from;
+    }
+
+    // Byte range of the file that holds every row with from <= time < to
+    void range(const FED3CsvFile &file, const char *rows, int64_t from, int64_t to, const char *&begin,
+               const char *&end) const
+    {
+        begin = end = rows;
+        size_t first = 0;
+        int64_t latest = INT64_MIN;
+        while (first < blocks.size() && (latest = std::max(latest, blocks[first].maxTime)) < from)
+            first++;
+        if (first == blocks.size())
+            return;
+        size_t last = blocks.size();
+        while (last > first && blocks[last - 1].minTime >= to)
+            last--;
+        if (last == first)
+            return;
+        begin = file.begin() + blocks[first].offset;
+        end = last < blocks.size() ? file.begin() + blocks[last].offset : file.end();
+    }
+
+private:
+    // The row at a block's offset is still the one indexed, the file was appended to and not rewritten
+    static bool startsBlock(const FED3CsvFile &file, const FED3CsvSchema &schema, const Block &block)
+    {
+        const char *p = file.begin() + block.offset;
+        if (block.offset > 0 && p[-1] != '\n')
+            return false;
+        const char *eol = (const char *)memchr(p, '\n', file.end() - p);
+        FED3CsvRecord r;
+        return schema.parse(p, eol ? eol : file.end(), r, FED3_CSV_FIELD(FED3_CSV_TIME)) && r.time >= block.minTime &&
+               r.time <= block.maxTime;
+    }
+
+public:
+    // Sidecar file: "FED3IDX1", every, log size, block count, then the blocks
+    bool load(const std::string &path)
+    {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (f == NULL)
+            return false;
+        char magic[8];
+        uint32_t fileEvery;
+        uint64_t bytes, count;
+        bool ok = fread(magic, 8, 1, f) == 1 && memcmp(magic, "FED3IDX1", 8) == 0 && fread(&fileEvery, 4, 1, f) == 1 &&
+                  fread(&bytes, 8, 1, f) == 1 && fread(&count, 8, 1, f) == 1 && count < (1ULL << 32);
+        if (ok)
+        {
+            blocks.resize(count);
+            ok = count == 0 || fread(blocks.data(), sizeof(Block), count, f) == count;
+        }
+        fclose(f);
+        if (!ok)
+        {
+            blocks.clear();
+            return false;
+        }
+        every = fileEvery;
+        indexedBytes = bytes;
+        return true;
+    }
+
+    bool save(const std::string &path) const
+    {
+        std::string temp = path + ".tmp";
+        FILE *f = fopen(temp.c_str(), "wb");
+        if (f == NULL)
+            return false;
+        uint64_t count = blocks.size();
+        bool ok = fwrite("FED3IDX1", 8, 1, f) == 1 && fwrite(&every, 4, 1, f) == 1 &&
+                  fwrite(&indexedBytes, 8, 1, f) == 1 && fwrite(&count, 8, 1, f) == 1 &&
+                  (count == 0 || fwrite(blocks.data(), sizeof(Block), count, f) == count);
+        ok = fclose(f) == 0 && ok;
+        // Replaced in one step, a reader never sees half an index
+        return ok && rename(temp.c_str(), path.c_str()) == 0;
+    }
+};
+
+/**************************************************************************************************************************************************
+                                                                                               Session metrics
+**************************************************************************************************************************************************/
+#define FED3_CSV_RETRIEVAL_BIN_S 0.1
+#define FED3_CSV_RETRIEVAL_BINS 600 // retrievals are logged below 60 s, longer ones are Timed_out
+
+// Meals: pellets no more than gapS apart, at least minPellets of them. Kept as the open runs at both ends
+// plus the meals closed in between, so consecutive parts of a log can be merged without the pellet times.
+struct FED3CsvMeals
+{
+    int64_t first = -1; // first and last pellet
+    int64_t last = -1;
+    long leadPellets = 0; // run that started at or before the first pellet
+    long tailPellets = 0; // run still open after the last pellet
+    bool single = true;   // all pellets are in one run, lead and tail are the same run
+    long meals = 0;
+    long mealPellets = 0;
+
+    void pellet(int64_t t, int64_t gapS, long minPellets)
+    {
+        FED3CsvMeals one;
+        one.first = one.last = t;
+        one.leadPellets = one.tailPellets = 1;
+        merge(one, gapS, minPellets);
+    }
+
+    void merge(const FED3CsvMeals &b, int64_t gapS, long minPellets)
+    {
+        if (b.first < 0)
+            return;
+        if (first < 0)
+        {
+            *this = b;
+            return;
+        }
+        if (b.first - last <= gapS)
+        {
+            long joined = tailPellets + b.leadPellets;
+            if (single && b.single)
+                leadPellets = tailPellets = joined;
+            else if (single)
+            {
+                leadPellets = joined;
+                tailPellets = b.tailPellets;
+            }
+            else
+            {
+                if (b.single)
+                    tailPellets = joined;
+                else
+                {
+                    close(joined, minPellets);
+                    tailPellets = b.tailPellets;
+                }
+            }
+            single = single && b.single;
+        }
+        else
+        {
+            if (!single)
+                close(tailPellets, minPellets);
+            if (!b.single)
+                close(b.leadPellets, minPellets);
+            tailPellets = b.tailPellets;
+            single = false;
+        }
+        meals += b.meals;
+        mealPellets += b.mealPellets;
+        last = b.last;
+    }
+
+    // Meals once the log has ended: the open runs are closed too
+    long totalMeals(long minPellets, long *pellets = NULL) const
+    {
+        FED3CsvMeals done = *this;
+        if (first >= 0)
+        {
+            done.close(leadPellets, minPellets);
+            if (!single)
+                done.close(tailPellets, minPellets);
+        }
+        if (pellets)
+            *pellets = done.mealPellets;
+        return done.meals;
+    }
+
+private:
+    void close(long n, long minPellets)
+    {
+        if (n >= minPellets)
+        {
+            meals++;
+            mealPellets += n;
+        }
+    }
+};
+
+struct FED3CsvSession
+{
+    int64_t gapS = 60;     // meal definition
+    long minMealPellets = 1;
+
+    unsigned long rows = 0;
+    unsigned long badRows = 0;
+    int64_t start = -1;
+    int64_t end = -1;
+    int device = -1;
+    char sessionType[24] = "";
+    unsigned long pellets = 0;
+    unsigned long jams = 0;
+    unsigned long leftPokes = 0;
+    unsigned long rightPokes = 0;
+    unsigned long activePokes = 0;
+    unsigned long timedOut = 0;
+    unsigned long retrievals = 0;
+    double retrievalSum = 0;
+    uint32_t retrievalBins[FED3_CSV_RETRIEVAL_BINS] = {};
+    FED3CsvMeals meals;
+
+    // The fields add() reads
+    static const unsigned long fields = FED3_CSV_FIELD(FED3_CSV_TIME) | FED3_CSV_FIELD(FED3_CSV_EVENT) |
+                                        FED3_CSV_FIELD(FED3_CSV_ACTIVE_POKE) | FED3_CSV_FIELD(FED3_CSV_RETRIEVAL) |
+                                        FED3_CSV_FIELD(FED3_CSV_DEVICE) | FED3_CSV_FIELD(FED3_CSV_SESSION_TYPE);
+
+    void add(const FED3CsvRecord &r)
+    {
+        rows++;
+        if (start < 0)
+        {
+            start = r.time;
+            device = r.device;
+            size_t n = r.sessionType.n < sizeof(sessionType) - 1 ? r.sessionType.n : sizeof(sessionType) - 1;
+            memcpy(sessionType, r.sessionType.p, n);
+            sessionType[n] = 0;
+        }
+        end = r.time;
+        switch (r.event)
+        {
+        case FED3_EVENT_PELLET:
+            pellets++;
+            meals.pellet(r.time, gapS, minMealPellets);
+            if (r.timedOut)
+                timedOut++;
+            else if (r.retrievalS >= 0)
+            {
+                retrievals++;
+                retrievalSum += r.retrievalS;
+                int bin = (int)(r.retrievalS / FED3_CSV_RETRIEVAL_BIN_S);
+                retrievalBins[bin < FED3_CSV_RETRIEVAL_BINS ? bin : FED3_CSV_RETRIEVAL_BINS - 1]++;
+            }
+            break;
+        case FED3_EVENT_PELLET_STUCK:
+            jams++;
+            break;
+        case FED3_EVENT_LEFT:
+            leftPokes++;
+            activePokes += r.active == FED3_SIDE_LEFT;
+            break;
+        case FED3_EVENT_RIGHT:
+            rightPokes++;
+            activePokes += r.active == FED3_SIDE_RIGHT;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Appends the session of the rows that follow this one's
+    void merge(const FED3CsvSession &b)
+    {
+        if (b.start >= 0 && start < 0)
+        {
+            start = b.start;
+            device = b.device;
+            memcpy(sessionType, b.sessionType, sizeof(sessionType));
+        }
+        if (b.end >= 0)
+            end = b.end;
+        rows += b.rows;
+        badRows += b.badRows;
+        pellets += b.pellets;
+        jams += b.jams;
+        leftPokes += b.leftPokes;
+        rightPokes += b.rightPokes;
+        activePokes += b.activePokes;
+        timedOut += b.timedOut;
+        retrievals += b.retrievals;
+        retrievalSum += b.retrievalSum;
+        for (int i = 0; i < FED3_CSV_RETRIEVAL_BINS; i++)
+            retrievalBins[i] += b.retrievalBins[i];
+        meals.merge(b.meals, gapS, minMealPellets);
+    }
+
+    double hours() const { return start >= 0 ? (end - start) / 3600.0 : 0.0; }
+    double pelletsPerHour() const { return hours() > 0 ? pellets / hours() : NAN; }
+    double efficiency() const { return leftPokes + rightPokes ? (double)activePokes / (leftPokes + rightPokes) : NAN; }
+    double retrievalMean() const { return retrievals ? retrievalSum / retrievals : NAN; }
+
+    // Retrieval time below which a share q of the retrievals fall, to the bin width
+    double retrievalQuantile(double q) const
+    {
+        if (retrievals == 0)
+            return NAN;
+        double target = q * retrievals;
+        unsigned long seen = 0;
+        for (int i = 0; i < FED3_CSV_RETRIEVAL_BINS; i++)
+        {
+            if (retrievalBins[i] && seen + retrievalBins[i] >= target)
+                return (i + (target - seen) / retrievalBins[i]) * FED3_CSV_RETRIEVAL_BIN_S;
+            seen += retrievalBins[i];
+        }
+        return FED3_CSV_RETRIEVAL_BINS * FED3_CSV_RETRIEVAL_BIN_S;
+    }
+};
+
+// Prints a log time as YYYY-MM-DD hh:mm:ss
+inline void fed3CsvFormatTime(int64_t time, char *out, size_t size)
+{
+    int64_t days = time >= 0 ? time / 86400 : (time - 86399) / 86400;
+    int64_t secs = time - days * 86400;
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int y = (int)(yoe + era * 400);
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    snprintf(out, size, "%04d-%02u-%02u %02d:%02d:%02d", y + (m <= 2), m, d, (int)(secs / 3600), (int)(secs / 60 % 60),
+             (int)(secs % 60));
+}
+
+#endif
@@ -0,0 +1,405 @@
+/*
+  FED3 log statistics
+
+  Summarizes FED3 log files (FED###_MMDDYY_nn.CSV) into one row per file or per device: pellets per
+  hour, pokes on each side and poke efficiency (share of pokes on the active side), meals, retrieval
+  time mean, median and 90th percentile, timed out retrievals and jams. Files are memory mapped and
+  split into chunks that worker threads parse in parallel (see fed3_csv.h).
+
+  Build:  g++ -std=c++11 -O2 -pthread -o fed3_logstats fed3_logstats.cpp
+  Usage:  fed3_logstats FILE.CSV|DIR... [--by file|device] [--threads N] [--chunk-mb N]
+                        [--meal-gap S] [--meal-min N] [--out FILE.csv]
+          fed3_logstats --make-corpus DIR [--files N] [--rows N] [--seed N]
+
+  Directories are searched for FED*.CSV. --by device merges the files of each device in time order,
+  e.g. the daily files of createDailyFile. A meal is pellets no more than --meal-gap seconds apart
+  (60), at least --meal-min pellets (1). Rows that don't parse are counted in Bad_Rows.
+
+  --make-corpus writes synthetic logs in the layouts the library writes (FR and Bandit, with and
+  without Temp/Humidity, with PR_Step), for checking the parser's speed: time a run over the corpus.
+*/
+
+#include "fed3_csv.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <dirent.h>
+
+struct Unit
+{
+    size_t file;
+    const char *begin;
+    const char *end;
+    FED3CsvSession session;
+};
+
+struct LogFile
+{
+    std::string path;
+    FED3CsvFile map;
+    FED3CsvSchema schema;
+    bool ok = false;
+    FED3CsvSession session;
+};
+
+static void findLogs(const std::string &path, std::vector<std::string> &paths)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+    {
+        paths.push_back(path);
+        return;
+    }
+    std::vector<std::string> found;
+    while (struct dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 3, "FED") == 0 &&
+            strcasecmp(name.c_str() + name.size() - 4, ".CSV") == 0)
+            found.push_back(path + "/" + name);
+    }
+    closedir(dir);
+    std::sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Synthetic corpus
+**************************************************************************************************************************************************/
+static uint64_t corpusState;
+
+static uint32_t corpusRandom()
+{
+    corpusState ^= corpusState << 13;
+    corpusState ^= corpusState >> 7;
+    corpusState ^= corpusState << 17;
+    return (uint32_t)(corpusState >> 16);
+}
+
+static double corpusUniform() { return corpusRandom() / 4294967296.0; }
+
+static void printTime(FILE *f, int64_t t)
+{
+    char text[48];
+    fed3CsvFormatTime(t, text, sizeof(text));
+    int y, mo, d, h, mi, s;
+    sscanf(text, "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &s);
+    fprintf(f, "%d/%d/%d %d:%02d:%02d,", mo, d, y, h, mi, s);
+}
+
+static int makeCorpus(const std::string &dir, int files, long rows, uint64_t seed)
+{
+    mkdir(dir.c_str(), 0777);
+    corpusState = seed * 0x9E3779B97F4A7C15ULL + 1;
+    size_t bytes = 0;
+    int64_t deviceTime[32] = {};
+    for (int i = 0; i < files; i++)
+    {
+        int layout = i % 4; // FR, FR with Temp/Humidity, Bandit, FR with PR_Step
+        int device = i % 32;
+        if (deviceTime[device] == 0)
+            deviceTime[device] = fed3CsvDays(2025, 1, 6) * 86400;
+        int64_t &t = deviceTime[device]; // a device's files follow each other
+        char date[48];
+        fed3CsvFormatTime(t, date, sizeof(date));
+        std::string name = dir + "/FED";
+        char part[32];
+        snprintf(part, sizeof(part), "%03d_%.2s%.2s%.2s_%02d.CSV", device, date + 5, date + 8, date + 2, i / 32 % 100);
+        name += part;
+        FILE *f = fopen(name.c_str(), "w");
+        if (f == NULL)
+        {
+            perror(name.c_str());
+            return 1;
+        }
+        const char *session = layout == 2 ? "Bandit" : layout == 3 ? "ProgRatio" : "FR3";
+        if (layout == 2)
+            fprintf(f, "MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,"
+                       "PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,"
+                       "Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time\r\n");
+        else
+            fprintf(f, "MM:DD:YYYY hh:mm:ss,%sLibrary_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,FR,"
+                       "Event,Active_Poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,"
+                       "Retrieval_Time,InterPelletInterval,Poke_Time%s\r\n",
+                    layout == 1 ? "Temp,Humidity," : "", layout == 3 ? ",PR_Step" : "");
+
+        long left = 0, right = 0, pellets = 0, block = 0, sinceActive = 0;
+        int probLeft = 80, probRight = 20;
+        double battery = 4.2;
+        int64_t lastPellet = 0;
+        for (long r = 0; r < rows; r++)
+        {
+            t += corpusUniform() < 0.7 ? 1 + corpusRandom() % 5 : 60 + corpusRandom() % 900;
+            battery -= 0.00002;
+            bool pellet = sinceActive >= 3;
+            bool stuck = !pellet && corpusUniform() < 0.002;
+            bool leftPoke = corpusUniform() < 0.7;
+            const char *event;
+            if (pellet)
+            {
+                event = "Pellet";
+                pellets++;
+                block++;
+                sinceActive = 0;
+            }
+            else if (stuck)
+                event = "PelletStuck";
+            else
+            {
+                static const char *const leftKinds[] = {"Left", "Left", "Left", "Left", "Left", "LeftShort",
+                                                        "LeftWithPellet", "LeftinTimeOut"};
+                static const char *const rightKinds[] = {"Right", "Right", "Right", "Right", "Right", "RightShort",
+                                                         "RightWithPellet", "RightinTimeout"};
+                int kind = corpusRandom() % 8;
+                event = leftPoke ? leftKinds[kind] : rightKinds[kind];
+                if (leftPoke)
+                    left++;
+                else
+                    right++;
+                if (leftPoke && kind < 5)
+                    sinceActive++;
+            }
+
+            printTime(f, t);
+            if (layout == 1)
+                fprintf(f, "%.2f,%.2f,", 21.0 + corpusUniform() * 3, 40.0 + corpusUniform() * 20);
+            fprintf(f, "1.20.0,%s,%d,%.2f,", session, device, battery);
+            if (pellet)
+                fprintf(f, "%d,", 1 + (corpusUniform() < 0.05));
+            else
+                fprintf(f, "nan,");
+            if (layout == 2)
+                fprintf(f, "10,%d,%d,", probLeft, probRight);
+            else
+                fprintf(f, "3,");
+            fprintf(f, "%s,%s,%ld,%ld,%ld,%ld,", event, layout == 2 ? (probLeft > probRight ? "Left" : "Right") : "Left",
+                    left, right, pellets, block);
+            if (!pellet)
+                fprintf(f, "nan,nan,");
+            else
+            {
+                if (corpusUniform() < 0.02)
+                    fprintf(f, "Timed_out,");
+                else
+                    fprintf(f, "%.2f,", exp(log(3.0) + 0.8 * (corpusUniform() + corpusUniform() + corpusUniform() - 1.5)));
+                if (pellets < 2)
+                    fprintf(f, "nan,");
+                else
+                    fprintf(f, "%ld,", (long)(t - lastPellet));
+                lastPellet = t;
+            }
+            if (pellet || stuck)
+                fprintf(f, "nan");
+            else
+                fprintf(f, "%.2f", 0.05 + corpusUniform() * 0.6);
+            if (layout == 3)
+                fprintf(f, ",%ld", pellets);
+            fprintf(f, "\r\n");
+            if (layout == 2 && pellet && block >= 10)
+            {
+                std::swap(probLeft, probRight);
+                block = 0;
+            }
+        }
+        bytes += ftell(f);
+        fclose(f);
+    }
+    fprintf(stderr, "%d files, %.1f MB in %s\n", files, bytes / 1048576.0, dir.c_str());
+    return 0;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Summary
+**************************************************************************************************************************************************/
+static void printRow(FILE *out, const std::string &name, const FED3CsvSession &s)
+{
+    char start[48] = "";
+    if (s.start >= 0)
+        fed3CsvFormatTime(s.start, start, sizeof(start));
+    long mealPellets;
+    long meals = s.meals.totalMeals(s.minMealPellets, &mealPellets);
+    fprintf(out, "%s,%d,%s,%s,%.2f,%lu,%lu,%lu,%.2f,%lu,%lu,%.3f,%ld,%.2f,%.2f,%.2f,%.2f,%lu,%lu\n", name.c_str(),
+            s.device, s.sessionType, start, s.hours(), s.rows, s.badRows, s.pellets, s.pelletsPerHour(), s.leftPokes,
+            s.rightPokes, s.efficiency(), meals, meals ? (double)mealPellets / meals : NAN, s.retrievalMean(),
+            s.retrievalQuantile(0.5), s.retrievalQuantile(0.9), s.timedOut, s.jams);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_logstats FILE.CSV|DIR... [--by file|device] [--threads N] [--chunk-mb N]\n"
+                    "                     [--meal-gap S] [--meal-min N] [--out FILE.csv]\n"
+                    "       fed3_logstats --make-corpus DIR [--files N] [--rows N] [--seed N]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> inputs;
+    std::string by = "file", outPath, corpus;
+    unsigned threads = std::thread::hardware_concurrency();
+    double chunkMB = 4;
+    long mealGap = 60, mealMin = 1, corpusRows = 100000;
+    int corpusFiles = 64;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0)
+        {
+            inputs.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        const char *value = argv[++i];
+        if (arg == "--by")
+            by = value;
+        else if (arg == "--threads")
+            threads = atoi(value);
+        else if (arg == "--chunk-mb")
+            chunkMB = atof(value);
+        else if (arg == "--meal-gap")
+            mealGap = atol(value);
+        else if (arg == "--meal-min")
+            mealMin = atol(value);
+        else if (arg == "--out")
+            outPath = value;
+        else if (arg == "--make-corpus")
+            corpus = value;
+        else if (arg == "--files")
+            corpusFiles = atoi(value);
+        else if (arg == "--rows")
+            corpusRows = atol(value);
+        else if (arg == "--seed")
+            seed = strtoull(value, NULL, 10);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (!corpus.empty())
+        return makeCorpus(corpus, corpusFiles, corpusRows, seed);
+    if (inputs.empty() || threads == 0 || chunkMB <= 0 || (by != "file" && by != "device"))
+    {
+        usage();
+        return 2;
+    }
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < inputs.size(); i++)
+        findLogs(inputs[i], paths);
+
+    // Map every file, read its header and cut it into chunks
+    FED3CsvSession blank;
+    blank.gapS = mealGap;
+    blank.minMealPellets = mealMin;
+    std::vector<LogFile> logs(paths.size());
+    std::vector<Unit> units;
+    size_t bytes = 0;
+    for (size_t f = 0; f < paths.size(); f++)
+    {
+        LogFile &log = logs[f];
+        log.path = paths[f];
+        log.session = blank;
+        if (!log.map.open(log.path.c_str()))
+        {
+            fprintf(stderr, "%s: can't open\n", log.path.c_str());
+            continue;
+        }
+        const char *rows = log.schema.readHeader(log.map.begin(), log.map.end());
+        if (rows == NULL)
+        {
+            fprintf(stderr, "%s: not a FED3 log\n", log.path.c_str());
+            continue;
+        }
+        log.ok = true;
+        bytes += log.map.size();
+        std::vector<const char *> cuts = fed3CsvSplit(rows, log.map.end(), (size_t)(chunkMB * 1048576));
+        for (size_t c = 0; c + 1 < cuts.size(); c++)
+        {
+            Unit unit;
+            unit.file = f;
+            unit.begin = cuts[c];
+            unit.end = cuts[c + 1];
+            unit.session = blank;
+            units.push_back(unit);
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads && w < units.size(); w++)
+    {
+        workers.push_back(std::thread([&]() {
+            size_t i;
+            while ((i = next++) < units.size())
+            {
+                Unit &unit = units[i];
+                FED3CsvRows reader(logs[unit.file].schema, unit.begin, unit.end, FED3CsvSession::fields);
+                FED3CsvRecord record;
+                while (reader.next(record))
+                    unit.session.add(record);
+                unit.session.badRows = reader.bad;
+            }
+        }));
+    }
+    for (size_t w = 0; w < workers.size(); w++)
+        workers[w].join();
+
+    // Chunks are in file order
+    unsigned long rows = 0;
+    for (size_t i = 0; i < units.size(); i++)
+    {
+        logs[units[i].file].session.merge(units[i].session);
+        rows += units[i].session.rows + units[i].session.badRows;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    FILE *out = outPath.empty() ? stdout : fopen(outPath.c_str(), "w");
+    if (out == NULL)
+    {
+        perror(outPath.c_str());
+        return 1;
+    }
+    fprintf(out, "%s,Device,Session_type,Start,Hours,Rows,Bad_Rows,Pellets,Pellets_Hour,Left_Pokes,Right_Pokes,Efficiency,"
+                 "Meals,Meal_Size,Retrieval_Mean_s,Retrieval_Median_s,Retrieval_P90_s,Timed_Out,Jams\n",
+            by == "file" ? "File" : "Files");
+    if (by == "file")
+    {
+        for (size_t f = 0; f < logs.size(); f++)
+            if (logs[f].ok)
+                printRow(out, logs[f].path, logs[f].session);
+    }
+    else
+    {
+        // Each device's files by the time of their first row
+        std::map<int, std::vector<const LogFile *> > devices;
+        for (size_t f = 0; f < logs.size(); f++)
+            if (logs[f].ok && logs[f].session.rows)
+                devices[logs[f].session.device].push_back(&logs[f]);
+        for (std::map<int, std::vector<const LogFile *> >::iterator it = devices.begin(); it != devices.end(); ++it)
+        {
+            std::vector<const LogFile *> &files = it->second;
+            std::stable_sort(files.begin(), files.end(),
+                             [](const LogFile *a, const LogFile *b) { return a->session.start < b->session.start; });
+            FED3CsvSession device = blank;
+            for (size_t i = 0; i < files.size(); i++)
+                device.merge(files[i]->session);
+            printRow(out, std::to_string(files.size()), device);
+        }
+    }
+    if (out != stdout)
+        fclose(out);
+
+    fprintf(stderr, "%zu files, %.1f MB, %lu rows in %.2f s (%.0f MB/s, %u threads)\n", paths.size(), bytes / 1048576.0,
+            rows, seconds, seconds > 0 ? bytes / 1048576.0 / seconds : 0.0, (unsigned)workers.size());
+    return 0;
+}
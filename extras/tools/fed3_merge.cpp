@@ -0,0 +1,336 @@
+/*
+  FED3 log merge
+
+  Merges the log files of many devices (and the daily files of createDailyFile) into one stream in time
+  order, and answers time range queries without reading the files from the start. Each log gets a sparse
+  time index in a sidecar file next to it (FED###_MMDDYY_nn.CSV.idx, see FED3CsvIndex in fed3_csv.h),
+  built on first use and brought up to date when the log has grown.
+
+  Build:  g++ -std=c++11 -O2 -o fed3_merge fed3_merge.cpp
+  Usage:  fed3_merge FILE.CSV|DIR... [--from TIME] [--to TIME] [--out FILE.csv] [--no-index] [--every N]
+          fed3_merge --bench DIR [--queries N] [--days N]
+
+  TIME is YYYY-MM-DD or YYYY-MM-DDThh:mm[:ss], in the devices' clock. --from is inclusive, --to exclusive.
+  The output has every column either log layout has, empty where a file doesn't have it, with the
+  values as written by the device. Rows with the same time keep the order of the files on the command
+  line. The merge keeps one row per file in memory, however many rows the files have.
+
+  --bench times random range queries over the logs in DIR, reading through the index and by scanning,
+  e.g. on a corpus from fed3_logstats --make-corpus.
+*/
+
+#include "fed3_csv.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <queue>
+#include <dirent.h>
+
+struct Log
+{
+    std::string path;
+    FED3CsvFile map;
+    FED3CsvSchema schema;
+    const char *rows = NULL;
+    FED3CsvIndex index;
+};
+
+static void findLogs(const std::string &path, std::vector<std::string> &paths)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+    {
+        paths.push_back(path);
+        return;
+    }
+    std::vector<std::string> found;
+    while (struct dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 3, "FED") == 0 &&
+            strcasecmp(name.c_str() + name.size() - 4, ".CSV") == 0)
+            found.push_back(path + "/" + name);
+    }
+    closedir(dir);
+    std::sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+}
+
+static bool parseTime(const char *text, int64_t &time)
+{
+    int y, mo, d, h = 0, mi = 0, s = 0;
+    if (sscanf(text, "%d-%d-%dT%d:%d:%d", &y, &mo, &d, &h, &mi, &s) < 3)
+        return false;
+    time = fed3CsvDays(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+    return true;
+}
+
+// Maps the logs and loads or brings their indexes up to date. Returns the bytes read to index.
+static size_t openLogs(const std::vector<std::string> &paths, std::vector<Log> &logs, uint32_t every, bool useIndex)
+{
+    size_t indexed = 0;
+    logs.clear();
+    logs.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        logs.push_back(Log());
+        Log &log = logs.back();
+        log.path = paths[i];
+        if (!log.map.open(log.path.c_str()) || (log.rows = log.schema.readHeader(log.map.begin(), log.map.end())) == NULL)
+        {
+            fprintf(stderr, "%s: not a FED3 log\n", log.path.c_str());
+            logs.pop_back();
+            continue;
+        }
+        if (!useIndex)
+            continue;
+        std::string sidecar = log.path + ".idx";
+        bool loaded = log.index.load(sidecar) && log.index.every == every;
+        if (!loaded)
+        {
+            log.index = FED3CsvIndex();
+            log.index.every = every;
+        }
+        if (!loaded || log.index.indexedBytes != log.map.size())
+        {
+            indexed += log.index.update(log.map, log.schema, log.rows);
+            if (!log.index.save(sidecar))
+                fprintf(stderr, "%s: can't write the index\n", sidecar.c_str());
+        }
+    }
+    return indexed;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Merge
+**************************************************************************************************************************************************/
+struct Cursor
+{
+    const Log *log;
+    size_t order;
+    FED3CsvRows rows;
+    FED3CsvRecord record;
+    const char *line;
+    const char *lineEnd; // at the line feed
+
+    Cursor(const Log *log, size_t order, const char *begin, const char *end)
+        : log(log), order(order), rows(log->schema, begin, end, FED3_CSV_FIELD(FED3_CSV_TIME)) {}
+
+    bool next(int64_t from, int64_t to)
+    {
+        while (rows.next(record))
+        {
+            if (record.time < from || record.time >= to)
+                continue;
+            line = rows.row();
+            lineEnd = rows.position();
+            if (lineEnd[-1] == '\n')
+                lineEnd--;
+            return true;
+        }
+        return false;
+    }
+};
+
+struct Later
+{
+    bool operator()(const Cursor *a, const Cursor *b) const
+    {
+        return a->record.time != b->record.time ? a->record.time > b->record.time : a->order > b->order;
+    }
+};
+
+struct MergeStats
+{
+    unsigned long rows = 0;
+    size_t scanned = 0; // bytes of rows read
+};
+
+static void writeHeader(FILE *out)
+{
+    for (int c = 0; c < FED3_CSV_UNKNOWN; c++)
+        fprintf(out, "%s%s", c ? "," : "", fed3CsvColumnName((FED3CsvColumn)c));
+    fputs("\r\n", out);
+}
+
+static MergeStats merge(const std::vector<Log> &logs, int64_t from, int64_t to, bool useIndex, FILE *out)
+{
+    MergeStats stats;
+    std::vector<Cursor> cursors;
+    cursors.reserve(logs.size());
+    std::priority_queue<Cursor *, std::vector<Cursor *>, Later> heap;
+    for (size_t i = 0; i < logs.size(); i++)
+    {
+        const Log &log = logs[i];
+        const char *begin = log.rows, *end = log.map.end();
+        if (useIndex)
+            log.index.range(log.map, log.rows, from, to, begin, end);
+        stats.scanned += end - begin;
+        cursors.push_back(Cursor(&log, i, begin, end));
+    }
+    for (size_t i = 0; i < cursors.size(); i++)
+        if (cursors[i].next(from, to))
+            heap.push(&cursors[i]);
+
+    FED3CsvText fields[FED3_CSV_UNKNOWN];
+    while (!heap.empty())
+    {
+        Cursor *c = heap.top();
+        heap.pop();
+        if (out && c->log->schema.split(c->line, c->lineEnd, fields))
+        {
+            for (int f = 0; f < FED3_CSV_UNKNOWN; f++)
+            {
+                if (f)
+                    putc(',', out);
+                fwrite(fields[f].p, 1, fields[f].n, out);
+            }
+            fputs("\r\n", out);
+        }
+        stats.rows++;
+        if (c->next(from, to))
+            heap.push(c);
+    }
+    return stats;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Benchmark
+**************************************************************************************************************************************************/
+static int bench(const std::vector<std::string> &paths, int queries, double days, uint32_t every)
+{
+    std::vector<Log> logs;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    size_t indexed = openLogs(paths, logs, every, true);
+    double indexS = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (logs.empty())
+        return 1;
+
+    size_t bytes = 0, blocks = 0;
+    int64_t first = INT64_MAX, last = INT64_MIN;
+    for (size_t i = 0; i < logs.size(); i++)
+    {
+        bytes += logs[i].map.size();
+        blocks += logs[i].index.blocks.size();
+        if (!logs[i].index.blocks.empty())
+        {
+            first = std::min(first, logs[i].index.blocks.front().minTime);
+            last = std::max(last, logs[i].index.blocks.back().maxTime);
+        }
+    }
+    printf("logs:          %zu files, %.1f MB, %.1f days, %zu index blocks (%.1f KB of sidecars)\n", logs.size(),
+           bytes / 1048576.0, (last - first) / 86400.0, blocks, blocks * sizeof(FED3CsvIndex::Block) / 1024.0);
+    printf("indexing:      %.1f MB read in %.2f s\n", indexed / 1048576.0, indexS);
+
+    FILE *sink = fopen("/dev/null", "w");
+    uint64_t state = 88172645463325252ULL;
+    double seconds[2] = {0, 0};
+    size_t scanned[2] = {0, 0};
+    unsigned long rows[2] = {0, 0};
+    int64_t span = (int64_t)(days * 86400);
+    for (int q = 0; q < queries; q++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int64_t from = first + (int64_t)(state % (uint64_t)std::max<int64_t>(1, last - first - span));
+        for (int way = 0; way < 2; way++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            MergeStats stats = merge(logs, from, from + span, way == 0, sink);
+            seconds[way] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            scanned[way] += stats.scanned;
+            rows[way] += stats.rows;
+        }
+    }
+    fclose(sink);
+    if (rows[0] != rows[1])
+        fprintf(stderr, "index and scan disagree: %lu and %lu rows\n", rows[0], rows[1]);
+    for (int way = 0; way < 2; way++)
+        printf("%-14s %d queries of %.1f days, %.0f rows, %.1f MB read and %.1f ms each\n",
+               way == 0 ? "with index:" : "scanning:", queries, days, (double)rows[way] / queries,
+               scanned[way] / 1048576.0 / queries, seconds[way] * 1000 / queries);
+    return rows[0] == rows[1] ? 0 : 1;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fed3_merge FILE.CSV|DIR... [--from TIME] [--to TIME] [--out FILE.csv] [--no-index] [--every N]\n"
+                    "       fed3_merge --bench DIR [--queries N] [--days N]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> inputs;
+    std::string outPath;
+    int64_t from = INT64_MIN, to = INT64_MAX;
+    bool useIndex = true, benchmark = false;
+    uint32_t every = FED3_CSV_INDEX_EVERY;
+    int queries = 100;
+    double days = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0)
+            inputs.push_back(arg);
+        else if (arg == "--no-index")
+            useIndex = false;
+        else if (arg == "--bench")
+            benchmark = true;
+        else if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        else if (arg == "--from" && parseTime(argv[i + 1], from))
+            i++;
+        else if (arg == "--to" && parseTime(argv[i + 1], to))
+            i++;
+        else if (arg == "--out")
+            outPath = argv[++i];
+        else if (arg == "--every")
+            every = atoi(argv[++i]);
+        else if (arg == "--queries")
+            queries = atoi(argv[++i]);
+        else if (arg == "--days")
+            days = atof(argv[++i]);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (inputs.empty() || every == 0 || queries <= 0)
+    {
+        usage();
+        return 2;
+    }
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < inputs.size(); i++)
+        findLogs(inputs[i], paths);
+    if (benchmark)
+        return bench(paths, queries, days, every);
+
+    std::vector<Log> logs;
+    openLogs(paths, logs, every, useIndex);
+    FILE *out = outPath.empty() ? stdout : fopen(outPath.c_str(), "w");
+    if (out == NULL)
+    {
+        perror(outPath.c_str());
+        return 1;
+    }
+    static char buffer[1 << 20];
+    setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    writeHeader(out);
+    MergeStats stats = merge(logs, from, to, useIndex, out);
+    if (out != stdout)
+        fclose(out);
+    else
+        fflush(out);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%zu files, %lu rows, %.1f MB read in %.2f s\n", logs.size(), stats.rows, stats.scanned / 1048576.0,
+            seconds);
+    return 0;
+}
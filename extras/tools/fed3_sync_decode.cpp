@@ -0,0 +1,199 @@
+/*
+  FED3 sync marker decoder
+
+  Reconstructs the FED3 event stream from a sampled recording of the BNC line, for aligning FED3 logs
+  with electrophysiology or video. Markers are sent by the library when fed3.syncMarkers = true: a 2 ms
+  header pulse, then 13 bit pulses at 1 ms spacing starting 3 ms after the header. A 200 us pulse is a 0
+  and a 600 us pulse is a 1. The bits are a 4 bit event type, an 8 bit rolling sequence number and an
+  even parity bit, most significant bit first. The sequence number matches the Sync_Seq column of the log.
+
+  Build:  g++ -std=c++11 -O2 -o fed3_sync_decode fed3_sync_decode.cpp
+  Usage:  fed3_sync_decode trace.csv --rate 30000 [--column 0] [--threshold 1.5]
+
+  The trace is a text file with one sample per line. With --column, the value is taken from that
+  comma-separated column, and lines that don't parse as a number (headers) are skipped. The threshold
+  defaults to halfway between the lowest and highest sample. The sample rate should be at least 10 kHz.
+
+  Output is CSV on stdout: Time_s,Sample,Sync_Seq,Type,Event
+  Markers that fail to decode and gaps in the sequence are reported on stderr.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Protocol, must match FED3.h
+static const double HEADER_US = 2000;
+static const double BIT_START_US = 3000;
+static const double BIT_PERIOD_US = 1000;
+static const double ZERO_US = 200;
+static const double ONE_US = 600;
+static const int BITS = 13;
+
+// Event types in the order used by FED3_BNC.cpp
+static const char *const eventNames[16] = {
+    "None", "Pellet", "Left", "LeftShort", "LeftWithPellet", "LeftinTimeOut", "LeftDuringDispense",
+    "Right", "RightShort", "RightWithPellet", "RightinTimeout", "RightDuringDispense", "PelletStuck",
+    "BNCRise", "BNCFall", "Other"};
+
+struct Pulse
+{
+    double riseUs;
+    double widthUs;
+    long sample;
+};
+
+static bool readTrace(const char *path, int column, std::vector<double> &samples)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+    char line[4096];
+    while (fgets(line, sizeof(line), f))
+    {
+        const char *field = line;
+        for (int c = 0; c < column && field; c++)
+        {
+            field = strchr(field, ',');
+            if (field)
+                field++;
+        }
+        if (!field)
+            continue;
+        char *end;
+        double value = strtod(field, &end);
+        if (end == field)
+            continue; // header or blank line
+        samples.push_back(value);
+    }
+    fclose(f);
+    return true;
+}
+
+// High runs of the thresholded trace, edges placed halfway between the samples either side
+static std::vector<Pulse> findPulses(const std::vector<double> &samples, double threshold, double rate)
+{
+    std::vector<Pulse> pulses;
+    double usPerSample = 1e6 / rate;
+    bool high = false;
+    long riseSample = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        bool level = samples[i] >= threshold;
+        if (level && !high)
+        {
+            riseSample = i;
+        }
+        else if (!level && high)
+        {
+            Pulse p;
+            p.riseUs = (riseSample - 0.5) * usPerSample;
+            p.widthUs = (i - riseSample) * usPerSample;
+            p.sample = riseSample;
+            pulses.push_back(p);
+        }
+        high = level;
+    }
+    return pulses;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    double rate = 0;
+    int column = 0;
+    double threshold = NAN;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--rate") && i + 1 < argc)
+            rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--column") && i + 1 < argc)
+            column = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else
+            path = argv[i];
+    }
+    if (!path || rate <= 0)
+    {
+        fprintf(stderr, "usage: %s trace.csv --rate Hz [--column N] [--threshold V]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<double> samples;
+    if (!readTrace(path, column, samples) || samples.empty())
+    {
+        fprintf(stderr, "could not read samples from %s\n", path);
+        return 1;
+    }
+    if (rate < 10000)
+        fprintf(stderr, "warning: %.0f Hz is too slow to reliably tell 200 us from 600 us pulses\n", rate);
+
+    if (std::isnan(threshold))
+    {
+        double lo = samples[0], hi = samples[0];
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            if (samples[i] < lo)
+                lo = samples[i];
+            if (samples[i] > hi)
+                hi = samples[i];
+        }
+        threshold = (lo + hi) / 2;
+    }
+
+    std::vector<Pulse> pulses = findPulses(samples, threshold, rate);
+    double tolerance = 1e6 / rate + 150; // allowed error on edge positions
+
+    printf("Time_s,Sample,Sync_Seq,Type,Event\n");
+    int lastSeq = -1;
+    long decoded = 0, failed = 0;
+
+    for (size_t i = 0; i < pulses.size(); i++)
+    {
+        if (fabs(pulses[i].widthUs - HEADER_US) > HEADER_US / 4)
+            continue;
+
+        // Collect one pulse per bit slot
+        unsigned code = 0;
+        bool ok = i + BITS < pulses.size();
+        for (int b = 0; ok && b < BITS; b++)
+        {
+            const Pulse &p = pulses[i + 1 + b];
+            double expected = pulses[i].riseUs + BIT_START_US + b * BIT_PERIOD_US;
+            if (fabs(p.riseUs - expected) > tolerance)
+            {
+                ok = false;
+                break;
+            }
+            code = (code << 1) | (p.widthUs > (ZERO_US + ONE_US) / 2 ? 1 : 0);
+        }
+
+        unsigned parity = 0;
+        for (unsigned bits = code; bits; bits >>= 1)
+            parity ^= bits & 1;
+        if (!ok || parity != 0)
+        {
+            failed++;
+            fprintf(stderr, "bad marker at %.6f s\n", pulses[i].riseUs / 1e6);
+            continue;
+        }
+
+        int type = (code >> 9) & 0x0F;
+        int seq = (code >> 1) & 0xFF;
+        if (lastSeq >= 0 && seq != ((lastSeq + 1) & 0xFF))
+            fprintf(stderr, "sequence gap at %.6f s: %d -> %d\n", pulses[i].riseUs / 1e6, lastSeq, seq);
+        lastSeq = seq;
+
+        printf("%.6f,%ld,%d,%d,%s\n", pulses[i].riseUs / 1e6, pulses[i].sample, seq, type, eventNames[type]);
+        decoded++;
+        i += BITS;
+    }
+
+    fprintf(stderr, "%ld markers decoded, %ld failed\n", decoded, failed);
+    return 0;
+}
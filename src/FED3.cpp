@@ -29,28 +29,38 @@
 #include "Arduino.h"
 #include "FED3.h"
 
-FED3 *FED3::staticFED = nullptr;
-
 #if defined(ESP32)
 #define IRAM_ISR_ATTR IRAM_ATTR
 #elif defined(__arm__)
 #define IRAM_ISR_ATTR // Empty for non-ESP32 platforms
 #endif
 
+FED3 *FED3::staticFED = nullptr;
+
+void __attribute__((weak)) fed3BindBoard(FED3 *fed3)
+{
+  FED3::staticFED = fed3;
+}
+
+FED3 *__attribute__((weak)) fed3BoardFED()
+{
+  return FED3::staticFED;
+}
+
 //  Interrupt handlers
 static void IRAM_ISR_ATTR outsidePelletTriggerHandler()
 {
-  FED3::staticFED->pelletTrigger();
+  fed3BoardFED()->pelletTrigger();
 }
 
 static void IRAM_ISR_ATTR outsideLeftTriggerHandler()
 {
-  FED3::staticFED->leftTrigger();
+  fed3BoardFED()->leftTrigger();
 }
 
 static void IRAM_ISR_ATTR outsideRightTriggerHandler()
 {
-  FED3::staticFED->rightTrigger();
+  fed3BoardFED()->rightTrigger();
 }
 
 void FED3::begin()
@@ -119,6 +129,7 @@ void FED3::begin()
   display.setRotation(3);
   display.setTextColor(BLACK);
   display.setTextSize(1);
+  display.buildGlyphAtlas(&FreeSans9pt7b);
   Serial.println("Display initialized.");
 
   // Check if AHT20 temp humidity sensor is present
@@ -135,16 +146,26 @@ void FED3::begin()
 
   // Initialize SD card and create the datafile
   Serial.println("Initializing SD card...");
+  fed3BindBoard(this);
   SdFile::dateTimeCallback(dateTime);
   CreateFile();
   Serial.println("SD card initialized and file created.");
 
   // Initialize interrupts
   Serial.println("Attaching interrupts...");
-  staticFED = this;
   attachWakeupInterrupts();
   Serial.println("Interrupts attached.");
 
+  // Rebuild the open hour of the summaries from the last session's log
+  if (logSummary)
+  {
+    recoverSummary();
+  }
+
+  // Pick the session's random seed before the header, which logs it
+  if (!randomSeeded)
+    seedRandom(randomSeedValue);
+
   // Create data file for current session
   Serial.println("Creating data file for current session...");
   CreateDataFile();
@@ -184,7 +205,11 @@ void FED3::begin()
   }
   display.clearDisplay();
   display.refresh();
-  Serial.println("Setup complete.");
+
+  startupMs = millis();
+  Serial.print("Setup complete in ");
+  Serial.print(startupMs);
+  Serial.println(" ms.");
 }
 
 /**************************************************************************************************************************************************
@@ -193,6 +218,9 @@ void FED3::begin()
 void FED3::run()
 {
   // This should be called at least once per loop.  It updates the time, updates display, and controls sleep
+  serviceAnimations();
+  servicePulseTrain();
+  logBNCEdges();
   if (digitalRead(PELLET_WELL) == HIGH)
   { // check for pellet
     PelletAvailable = false;
@@ -203,7 +231,16 @@ void FED3::run()
   currentSecond = now.second(); // useful for timed feeding sessions
   unixtime = now.unixtime();
   ReadBatteryLevel();
-  UpdateDisplay();
+  servicePowerReport();
+  if (sessionStats || logSummary)
+    advanceStats(unixtime);
+  if (logSummary)
+    serviceSummary(unixtime);
+  serviceTask();
+  serviceSequence();
+  if (mainScreenKey() != shownScreenKey)
+    requestDisplayUpdate();
+  serviceDisplay(EnableSleep); // render now if about to sleep, otherwise at most displayFrameRate times per second
   goToSleep();
 }
 
@@ -239,6 +276,7 @@ void FED3::leftTrigger()
     if (digitalRead(LEFT_POKE) == LOW)
     {
       Left = true;
+      notePokeEdge(true);
     }
   }
 }
@@ -251,22 +289,54 @@ void FED3::rightTrigger()
     if (digitalRead(RIGHT_POKE) == LOW)
     {
       Right = true;
+      notePokeEdge(false);
     }
   }
 }
 
-// Sleep function
+// Sleep function, sleeps until the next deadline or until a poke or pellet interrupt
 void FED3::goToSleep()
 {
-  if (EnableSleep == true)
+  if (EnableSleep == true && !outputsBusy())
   {
-    ReleaseMotor();
-    delay(2);            // let things settle
-    lowPowerSleep(5000); // Wake up every 5 sec to check the pellet well
+    scheduleLibraryDeadlines();
+    unsigned long sleepMs = msToNextDeadline();
+    if (sleepMs > maxSleepMs)
+      sleepMs = maxSleepMs;
+
+    if (sleepMs > 0)
+    {
+      ReleaseMotor();
+      delay(2); // let things settle
+      sleepWakeups++;
+#if defined(ESP32)
+      unsigned long sleepStart = millis();
+      lowPowerSleep(sleepMs);
+      sleptMs += millis() - sleepStart; // millis() keeps counting through light sleep
+#elif defined(__arm__)
+      // millis() stops in standby. Count the whole sleep unless the RTC rules it out, when a poke or
+      // pellet interrupt ended it more than a second early
+      unsigned long sleepStart = deadlineClock();
+      alignRtcClock();
+      lowPowerSleep(sleepMs);
+      long measured = (long)(rtcClockMs() - sleepStart);
+      if (measured + 1000L < (long)sleepMs)
+        sleptMs += (measured > 0) ? measured : 0;
+      else
+        sleptMs += sleepMs;
+#endif
+    }
   }
   pelletTrigger(); // check pellet well to make sure it's not stuck thinking there's a pellet when there's not
 }
 
+// Timers and interrupts stop while asleep, so stay awake to finish animations, pulse trains and audio,
+// and while capturing BNC edges with microsecond stamps
+bool FED3::outputsBusy()
+{
+  return animationRunning() || pulseTrainRunning() || bncCaptureRunning() || isPlaying() || trialRunning();
+}
+
 // Pull all motor pins low to de-energize stepper and save power, also disable motor driver with the EN pin
 void FED3::ReleaseMotor()
 {
@@ -274,9 +344,10 @@ void FED3::ReleaseMotor()
   digitalWrite(A3, LOW);
   digitalWrite(A4, LOW);
   digitalWrite(A5, LOW);
+  motorTurning = false;
   if (EnableSleep == true)
   {
-    digitalWrite(MOTOR_ENABLE, LOW); // disable motor driver and neopixels
+    motorEnable(false); // disable motor driver and neopixels
   }
 }
 
@@ -287,9 +358,9 @@ void FED3::ReleaseMotor()
 // Import Sketch variable from the Arduino script
 FED3::FED3(String sketch)
 {
-  staticFED = this;
   this->sketch = sketch;
   this->sessiontype = sketch;
+  fed3BindBoard(this);
 }
 
 // Menu functions moved to FED3_Menus.cpp
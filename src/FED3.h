@@ -51,7 +51,8 @@ This device includes hardware and code from:
 #include "RTClib.h"
 #include <SdFat.h>
 #include <Adafruit_GFX.h>
-#include <Adafruit_SharpMem.h>
+#include "FED3_SharpMem.h"
+#include "FED3_Schedule.h"
 #include <Fonts/FreeSans9pt7b.h>
 #include <Fonts/Org_01.h>
 #include <Adafruit_NeoPixel.h>
@@ -96,11 +97,268 @@ This device includes hardware and code from:
 
 #define BLACK 0
 #define WHITE 1
+
+// Menus offered at startup
+#define MENU_CLASSIC 0
+#define MENU_FED3 1
+#define MENU_PSYGENE 2
+
+// Poke or retrieval interval shown next to the session name
+#define DISPLAY_NO_INTERVAL 0
+#define DISPLAY_RETRIEVAL_INTERVAL 1
+#define DISPLAY_LEFT_INTERVAL 2
+#define DISPLAY_RIGHT_INTERVAL 3
 #define STEPS 2038
 #define SD_CLOCK_SPEED 1 // SD card clock speed in MHz
+#define FED3_STAMP_CHARS 26 // "M/D/YYYY hh:mm:ss" of formatStamp() at its widest, with the terminator
 
 extern bool Left;
 
+// Deadlines that end sleep early, slots below DEADLINE_SKETCH are used by the library
+#define MAX_DEADLINES 8
+#define DEADLINE_DISPLAY 0       // next clock minute on the display
+#define DEADLINE_TIMED_FEEDING 1 // next edge of the timed feeding window
+#define DEADLINE_PELLET_CHECK 2  // pellet well polling where it has no wake interrupt
+#define DEADLINE_TASK 3          // state timer of the task engine
+#define DEADLINE_SEQUENCE 4      // time window of the poke sequence matcher
+#define DEADLINE_SKETCH 5        // first slot free for sketches
+
+// Random number streams, each has its own state so draws in one don't shift the others
+#define RANDOM_TASK 0     // reward and block decisions, and sketches
+#define RANDOM_HARDWARE 1 // jitter in jam clearing
+#define RANDOM_AUDIO 2    // white noise
+#define RANDOM_STREAMS 3
+
+// Edges captured on the BNC port by startBNCCapture()
+#define BNC_CAPTURE_SIZE 64 // power of two
+struct FED3_BNCEdge
+{
+    unsigned long us; // micros() when the edge was seen
+    bool rising;
+};
+
+// Sync markers sent on the BNC port for each logged event: a header pulse, then one pulse per bit
+// (4 bit event type, 8 bit rolling sequence number, even parity), most significant bit first
+#define SYNC_HEADER_US 2000     // header pulse width
+#define SYNC_BIT_START_US 3000  // first bit slot, from the header rising edge
+#define SYNC_BIT_PERIOD_US 1000 // spacing of bit slots
+#define SYNC_ZERO_US 200        // pulse width of a 0 bit
+#define SYNC_ONE_US 600         // pulse width of a 1 bit
+#define SYNC_BITS 13
+#define SYNC_MARKER_US 17000    // header to header of markers queued back to back
+#define SYNC_QUEUE_SIZE 8       // power of two, holds one marker less while another goes out
+
+// Notes for the audio engine, a sequence is an array of notes played in order
+#define AUDIO_REST 0        // silence for the note duration
+#define AUDIO_NOISE 1       // white noise for the note duration
+#define AUDIO_UNTIL_STOPPED 0 // duration for playTone()/playNoise() that plays until stop()
+struct FED3_Note
+{
+    uint16_t freq;       // Hz, or AUDIO_REST / AUDIO_NOISE
+    uint16_t durationMs;
+};
+
+// Log index: every LOG_INDEX_EVERY rows, and at least once an hour, logdata() appends the time and file offset of
+// the row to an IDX companion of the log file, so a time can be found without reading the whole log
+#define LOG_INDEX_EVERY 64
+#define LOG_INDEX_SECONDS 3600
+#define LOG_INDEX_CHECK 0xFED31DE5UL
+struct FED3_LogIndexEntry
+{
+    uint32_t unixTime; // RTC time of the row
+    uint32_t offset;   // where the row starts in the log file
+    uint32_t check;    // unixTime ^ offset ^ LOG_INDEX_CHECK, an entry cut short by a power loss doesn't match
+};
+
+// Session statistics, kept by logdata() in constant time: rolling counts over the last hour in one minute
+// bins, and one bin per clock hour for the last day
+#define STATS_MINUTES 60
+#define STATS_HOURS 24
+#define STATS_EVENT_OTHER 0
+#define STATS_EVENT_LEFT 1   // Left, LeftShort, LeftWithPellet, LeftinTimeOut, LeftDuringDispense
+#define STATS_EVENT_RIGHT 2  // and the same for Right
+#define STATS_EVENT_PELLET 3 // retInterval holds its retrieval time
+#define STATS_EVENT_JAM 4    // PelletStuck
+struct FED3_StatsHour
+{
+    uint16_t pellets;
+    uint16_t leftPokes;
+    uint16_t rightPokes;
+    uint16_t activePokes;  // pokes on the side that was active when they were made
+    uint16_t meals;        // meals that reached mealMinPellets in this hour
+    uint16_t retrievals;   // pellets taken within a minute
+    uint16_t timedOut;     // pellets left in the well for a minute or more
+    uint16_t jams;
+    uint32_t retrievalMs;  // total retrieval time of the retrievals
+};
+
+// Hourly and daily summaries: at the end of each clock hour a row with the hour's FED3_StatsHour counts and the
+// mean battery voltage and temperature is appended to HOURS###.CSV, and after midnight the day's totals to
+// DAYS###.CSV. SUMMARY.DAT keeps what is needed to rebuild the current hour from the log after a reset.
+struct FED3_SummaryBin
+{
+    FED3_StatsHour events;
+    float batteryV;         // total of the battery readings
+    float temperatureC;     // total of the temperature readings
+    uint16_t batteryReadings;
+    uint16_t temperatureReadings;
+};
+
+// Current drawn by each subsystem, used by the energy accounting in FED3_Power.cpp
+struct FED3_PowerModel
+{
+    float sleepmA;    // whole device asleep
+    float awakemA;    // CPU awake, added on top of sleepmA
+    float railmA;     // motor driver and NeoPixel rail enabled
+    float buzzermA;   // buzzer sounding
+    float refreshmAs; // charge per display refresh
+    float sdSyncmAs;  // charge per SD card sync
+    float batterymAh; // battery capacity for the runtime projection
+};
+
+// Task engine, a task is a table of transitions checked in order, the first match is taken
+// Input events
+#define TASK_EVENT_LEFT 1
+#define TASK_EVENT_RIGHT 2
+#define TASK_EVENT_ACTIVE 3   // poke on the active side (activePoke)
+#define TASK_EVENT_INACTIVE 4
+#define TASK_EVENT_POKE 5     // either poke
+#define TASK_EVENT_TIMER 6    // state timer expired
+// Guards
+#define TASK_GUARD_NONE 0
+#define TASK_GUARD_RATIO 1    // this poke completes the ratio in FR
+#define TASK_GUARD_WINDOW 2   // inside the timedStart - timedEnd feeding window
+#define TASK_GUARD_CHANCE 3   // random draw against prob_left / prob_right for the side of the TASK_CHOICE poke
+#define TASK_GUARD_CUSTOM 4   // taskGuard callback
+// Actions, run in this order
+#define TASK_LOG_POKE 0x0001         // logLeftPoke() / logRightPoke()
+#define TASK_LOG_TIMEOUT_POKE 0x0002 // log as LeftinTimeOut / RightinTimeout
+#define TASK_COUNT 0x0004            // count the poke toward the ratio
+#define TASK_RESET_COUNT 0x0008
+#define TASK_CLICK 0x0010
+#define TASK_NOISE_OFF 0x0020
+#define TASK_STIMULUS 0x0040         // ConditionedStimulus()
+#define TASK_FEED 0x0080
+#define TASK_ERROR_TONE 0x0100
+#define TASK_NOISE_ON 0x0200
+#define TASK_PR_STEP 0x0400          // raise FR to the next ratio of prSchedule
+#define TASK_BLOCK_STEP 0x0800       // count the pellet toward the bandit block
+#define TASK_CHOICE 0x1000           // count the poke in the bandit block statistics
+// State timers, armed on entering a state
+#define TASK_TIMER_NONE 0
+#define TASK_TIMER_TIMEOUT 1 // timeout seconds
+#define TASK_TIMER_DELAY 2   // taskDelaySec seconds
+#define TASK_TIMER_CHOICE 3  // choiceDelayMs, between a choice and its outcome
+#define TASK_STAY 0xFF       // next state that keeps the current state and its timer running
+
+struct FED3_Transition
+{
+    byte state;
+    byte event;    // TASK_EVENT_*
+    byte guard;    // TASK_GUARD_*
+    uint16_t actions; // TASK_* action flags
+    byte next;     // next state, or TASK_STAY
+};
+
+struct FED3_Task
+{
+    const char *name; // session type, NULL keeps the sketch's
+    const FED3_Transition *transitions;
+    byte transitionCount;
+    const byte *stateTimers; // TASK_TIMER_* for each state
+    byte stateCount;
+};
+
+// Built-in tasks
+extern const FED3_Task FED3_FixedRatio;
+extern const FED3_Task FED3_ProgressiveRatio;
+extern const FED3_Task FED3_Extinction;
+extern const FED3_Task FED3_Pavlovian;
+extern const FED3_Task FED3_Bandit;
+extern const FED3_Task FED3_TimedFeeding;
+
+// Trial stimuli run from the hardware timer at offsets from a trigger
+#define MAX_TRIAL_STIMULI 16
+#define STIMULUS_TONE 1      // value: frequency in Hz (or AUDIO_NOISE), durationMs
+#define STIMULUS_TONE_OFF 2
+#define STIMULUS_PIXELS 3    // value: color of all pixels, 0 turns them off, shown by run()
+#define STIMULUS_BNC 4       // value: 1 sets the BNC output high, 0 low
+
+struct FED3_Stimulus
+{
+    unsigned long offsetUs; // from the trigger, the list is sorted by offset
+    byte type;              // STIMULUS_*
+    uint32_t value;
+    uint16_t durationMs;
+};
+
+// Poke sequences matched by startSequence()
+#define MAX_SEQUENCE_LENGTH 16
+
+// Window used once the matcher has counted afterMatches matches
+struct FED3_SequenceWindow
+{
+    uint16_t afterMatches;
+    unsigned long windowMs;
+};
+
+// Bandit block plans, drawn for the whole session when the task starts
+#define MAX_BANDIT_BLOCKS 64 // after this many blocks the plan is drawn again, following on from the last block
+#define MAX_BANDIT_SETS 8
+
+struct FED3_BanditSet
+{
+    byte left;  // reward probability of each side, 0-100
+    byte right;
+};
+
+struct FED3_BanditConfig
+{
+    const FED3_BanditSet *sets;
+    byte setCount;
+    uint16_t minPellets; // block length in pellets, drawn uniformly between the two
+    uint16_t maxPellets;
+    bool allowRepeat;    // a set can follow itself
+    byte maxSameSide;    // most blocks in a row with the same better side, 0 for no limit, 1 reverses every block
+};
+
+struct FED3_BanditBlock
+{
+    byte set;
+    uint16_t pellets;
+};
+
+// Statistics of the current block, written to a BLK companion of the log file when it ends
+struct FED3_BanditStats
+{
+    uint16_t block;
+    unsigned long startMs;
+    uint16_t leftChoices;
+    uint16_t rightChoices;
+    uint16_t highChoices; // choices of the side with the higher reward probability
+    uint16_t rewards;
+};
+
+// Animations advanced from the main loop by serviceAnimations()
+#define ANIMATION_NONE 0
+#define ANIMATION_ANY 0        // matches any type in animationRunning()
+#define ANIMATION_MOUSE 1      // startup mouse on the display
+#define ANIMATION_COLOR_WIPE 2 // NeoPixel color wipe
+#define ANIMATION_PULSE 3      // all pixels fading in and out
+#define ANIMATION_CUE 4        // light moving toward the active poke
+#define MAX_ANIMATIONS 4
+
+struct FED3_Animation
+{
+    byte type;            // ANIMATION_*, ANIMATION_NONE when the slot is free
+    byte step;            // next keyframe
+    uint16_t intervalMs;  // time between keyframes
+    unsigned long nextMs; // when the next keyframe is due
+    uint32_t color;
+    uint16_t sequence;    // animations on the same output run one after another in start order
+    bool cancelOnInput;   // stop as soon as a poke is detected
+};
+
 enum ErrorCode
 {
     ERROR_SD_INIT_FAIL = 1, // Explicitly assigned to 1
@@ -109,11 +367,20 @@ enum ErrorCode
     ERROR_READ_FAIL         // Automatically assigned to 4
 };
 
+class FED3;
+
+// The FED3 running on this board, for the handlers that get no argument: pin and timer interrupts and the
+// SD card's dateTime() callback. The constructor and begin() bind it. A board runs one FED3, so this is
+// FED3::staticFED; hosts that run several FED3 objects in one process (extras/sim) define both functions to
+// keep it per board.
+void fed3BindBoard(FED3 *fed3);
+FED3 *fed3BoardFED();
+
 class FED3
 {
     // Members
 public:
-    static FED3 *staticFED;
+    static FED3 *staticFED; // deprecated, use fed3BoardFED()
     explicit FED3(String sketch = "undef");
     String sketch;
     String &sessiontype = sketch;
@@ -141,11 +408,27 @@ public:
     bool suppressSDerrors = false; // set to true to suppress SD card errors at startup
     String getMetaValue(const char *rootKey, const char *subKey);
 
+    // Reading the log back from a time, through its index, e.g. the last day over Serial
+    bool logIndex = true;                  // keep the IDX companion of the log file
+    uint16_t logIndexEvery = LOG_INDEX_EVERY;
+    bool openLogAt(uint32_t unixTime, const char *name = NULL); // the current log by default
+    int readLogRow(char *row, int size);   // next row without the line end, -1 at the end of the log
+    void closeLog();
+    unsigned long streamLog(uint32_t unixTime, Print &out, const char *name = NULL); // rows sent
+
     // Battery
     float measuredvbat = 1.0;
     float batteryPercent = 0.0; // Battery percentage for ESP32 devices
     int ReadBatteryLevel();
 
+    // Pixel frame, colors are staged and sent with one show() per frame. The motor driver and
+    // NeoPixel rail is only powered while a pixel is lit.
+    void setPixel(byte n, uint32_t color);
+    void fillPixels(uint32_t color, byte first = 0, byte count = 8);
+    void clearPixels();
+    void showPixels();
+    unsigned long pixelFramesShown = 0;
+
     // Neopixel
     void pixelsOn(int R, int G, int B, int W);
     void pixelsOff();
@@ -173,6 +456,32 @@ public:
     void DisplayText(const String &text, int x = 10, int y = 40, bool clear_area = true, bool bold = false, int clear_width = 200, int clear_height = 22);
     void DisplayJammed();
 
+    // Display scheduler
+    void requestDisplayUpdate();                 // main screen changed, redraw on the next frame
+    void requestIntervalDisplay(byte interval);  // show a DISPLAY_*_INTERVAL on the next frame
+    void requestDisplayRefresh();                // buffer was drawn into directly, push it on the next frame
+    void serviceDisplay(bool force = false);     // render pending changes, at most displayFrameRate times per second unless forced
+    byte displayFrameRate = 4;                   // maximum frames per second rendered by serviceDisplay()
+    byte displayInterval = DISPLAY_NO_INTERVAL;
+    unsigned long displayFramesRendered = 0;
+    unsigned long displayUpdatesCoalesced = 0;   // requests for a different screen merged into an already pending frame
+    unsigned long displayWorstRenderUs = 0;
+
+    // Animations
+    bool startAnimation(byte type, uint16_t intervalMs, uint32_t color = 0, bool cancelOnInput = false);
+    bool startColorWipe(uint32_t c, uint8_t wait, bool cancelOnInput = false); // non-blocking colorWipe()
+    bool startPixelPulse(uint32_t c, uint16_t periodMs, bool cancelOnInput = true);
+    bool startPokeCue(uint32_t c, uint16_t stepMs, bool cancelOnInput = true);   // runs until cancelled
+    void serviceAnimations(unsigned long budgetUs = 2000);                   // advance due keyframes for up to budgetUs
+    bool animationRunning(byte type = ANIMATION_ANY);
+    void cancelAnimations();
+    void noteMenuPoll();
+    unsigned long startupMs = 0;           // time from power up to the end of begin()
+    unsigned long menuWorstInputGapMs = 0; // longest time the startup menus went without checking the pokes
+
+    // Screen capture
+    void captureScreens(); // save every screen as a PBM image with its draw and refresh time
+
     // Menu system functions
     void ClassicMenu();    // Classic FED3 menu
     void StartScreen();    // Default startup screen
@@ -181,15 +490,72 @@ public:
     void SetClock();       // Clock setting interface
     void SelectMode();     // Mode selection handling
     void writeFEDmode();   // Save mode settings
+    byte currentMenu();    // Menu selected by ClassicFED3 / psygene flags
+    byte menuModeCount(byte menu);
+    const char *modeName(byte menu, byte mode);
 
     // BNC input/output
     void ReadBNC(bool blinkGreen);
     bool BNCinput = false;
 
+    // BNC input capture, every edge is queued with a microsecond timestamp
+    void startBNCCapture(bool logEdges = false); // logEdges writes BNCRise/BNCFall events from run(), edge micros() in Poke_Time
+    void stopBNCCapture();
+    bool bncCaptureRunning();
+    byte bncEdgesAvailable();
+    bool readBNCEdge(FED3_BNCEdge &edge); // oldest queued edge, false if the queue is empty
+    void bncEdge();                       // called from the BNC interrupt
+    volatile unsigned long bncOverflows = 0; // edges dropped because the queue was full
+    volatile unsigned long bncPulses = 0;
+    volatile unsigned long bncMinWidthUs = 0;
+    volatile unsigned long bncMaxWidthUs = 0;
+    float bncMeanWidthUs();
+    float bncFrequencyHz(); // from the mean time between rising edges
+    void resetBNCStats();
+
     // Motor
     void ReleaseMotor();
+    void motorEnable(bool enable); // switch the motor driver and NeoPixel rail
     int numMotorTurns = 0;
 
+    // Energy accounting
+#if defined(ESP32)
+    FED3_PowerModel powerModel = {1.5, 40.0, 30.0, 20.0, 0.05, 2.0, 4400.0};
+#else
+    FED3_PowerModel powerModel = {2.0, 12.0, 30.0, 20.0, 0.05, 2.0, 4400.0};
+#endif
+    bool logPower = true;          // append an hourly energy report to a PWR companion of the log file
+    void noteSdSync();
+    void noteBuzzer(int durationMs);
+    float energyUsedmAh();         // since startup
+    float projectedRuntimeHours(); // at the average draw since the last report
+    void writePowerReport();
+
+    // Session statistics, for closed-loop decisions in sketches, as of the last run() or logged event
+    bool sessionStats = true;                       // count logged events, see FED3_Stats.cpp
+    uint16_t mealGapSec = 60;                       // pellets no more than this apart are one meal
+    uint16_t mealMinPellets = 1;                    // pellets a meal needs to count
+    void statsEvent(byte event, uint32_t unixTime); // count a STATS_EVENT_*, logdata() calls this for every row
+    byte statsEventType(const String &event);
+    static byte statsEventType(const char *event);
+    unsigned int pelletsLastHour();                 // rolling, the last 60 minutes
+    unsigned int pokesLastHour();
+    float pokeEfficiencyLastHour();                 // share of the last hour's pokes on the active side, 0 without pokes
+    unsigned long retrievalCount();                 // retrievals within a minute since the statistics were reset
+    float retrievalMean();                          // seconds
+    float retrievalSD();                            // seconds, sample standard deviation
+    FED3_StatsHour statsHour(byte hoursAgo);        // 0 is the current clock hour, empty from STATS_HOURS on
+    FED3_StatsHour statsLastDay();                  // the last STATS_HOURS hours added up
+    static void addStatsHour(FED3_StatsHour &total, const FED3_StatsHour &hour);
+    unsigned long mealCount = 0;
+    uint16_t mealPellets = 0;                       // pellets in the last run of pellets no more than mealGapSec apart
+    bool inMeal();                                  // the last pellet was part of a meal that can still grow
+    void resetStats();
+    bool displayStats = false;                      // main screen shows pellets per hour over the last day instead of the counters
+
+    // Hourly and daily summaries
+    bool logSummary = true; // append hourly and daily totals to HOURS###.CSV and DAYS###.CSV, see FED3_Summary.cpp
+
     // Set FED
     void SetDeviceNumber();
 
@@ -200,9 +566,92 @@ public:
     void BNC(int DELAY_MS, int loops);
     void pulseGenerator(int pulse_width, int frequency, int repetitions);
 
+    // Pulse trains on the BNC output, timed by the hardware timer so the sketch keeps running
+    bool startPulseTrain(unsigned long widthUs, unsigned long periodUs, unsigned int pulses,
+                         unsigned int bursts = 1, unsigned long burstGapUs = 0, void (*onComplete)() = NULL);
+    void stopPulseTrain();
+    bool pulseTrainRunning();
+    void servicePulseTrain(); // runs the completion callback from the main loop
+    volatile unsigned long pulseEdgesWritten = 0;
+    volatile unsigned long pulseWorstLateUs = 0; // largest delay of an edge after its scheduled time
+    volatile unsigned long pulseLateSumUs = 0;
+    float pulseMeanLateUs();
+    void resetPulseStats();
+
+    bool startPulseEdges(const unsigned long *edgesUs, byte count, void (*onComplete)() = NULL); // edge times from the first rising edge
+
+    // Trial stimuli, e.g. a cue at the poke edge and a stop signal 250 ms later, onsets are recorded
+    bool startTrial(const FED3_Stimulus *stimuli, byte count, unsigned long triggerUs = 0); // triggerUs is a micros() time, 0 for now
+    void stopTrial();
+    bool trialRunning();                       // stimuli still to run
+    unsigned long stimulusOnsetUs(byte index); // micros() when the stimulus ran, 0 if it hasn't
+    long reactionTimeUs(byte index);           // from the onset of the stimulus to the first poke after the trigger, -1 if none
+    volatile unsigned long pokeEdgeUs = 0;     // micros() at the last poke interrupt, a trigger for startTrial()
+    volatile bool trialResponded = false;
+    volatile bool trialResponseLeft = false;
+    volatile unsigned long trialResponseUs = 0;
+    volatile unsigned long stimuliRun = 0;
+    volatile unsigned long stimulusWorstLateUs = 0; // largest delay of an onset after its scheduled time
+    volatile unsigned long stimulusLateSumUs = 0;
+    float stimulusMeanLateUs();
+
+    // Sync markers
+    bool syncMarkers = false;  // send a coded marker for every logged event and log its sequence number
+    bool emitSyncMarker(byte type);
+    byte syncEventType(const String &event);
+    byte syncSequence = 0;     // sequence number of the next marker
+    long syncLastSequence = -1; // last marker sent or queued, -1 if it could not be
+
+    // Hardware timer shared by the timed outputs
+    void serviceHardwareTimer(); // called from the timer interrupt
+
     void Tone(int freq, int duration);
     void stopTone();
 
+    // Audio engine, notes and noise are generated from a timer interrupt so these all return immediately
+    bool play(const FED3_Note *notes, byte count, bool loop = false); // notes must stay valid while playing
+    bool playTone(uint16_t freq, uint16_t durationMs);
+    bool playNoise(uint16_t durationMs);
+    void stop();
+    bool isPlaying();
+    void serviceAudio(); // called from the audio timer interrupt
+    bool audioTimer = true; // false leaves TC4 to the Servo library, see FED3_Timer.cpp
+
+    // Task engine, run() feeds it poke and timer events
+    void startTask(const FED3_Task &task);
+    void stopTask();
+    void taskEvent(byte event); // handle an event now, TASK_EVENT_LEFT / RIGHT / TIMER
+    const FED3_Task *task = NULL;
+    byte taskState = 0;
+    int taskPokes = 0;     // pokes toward the current ratio
+    int taskDelaySec = 5;  // TASK_TIMER_DELAY, e.g. cue to pellet in the Pavlovian task
+    bool taskLastLeft = false; // side of the last poke event
+    bool taskChoiceLeft = false; // side of the last TASK_CHOICE poke, which TASK_GUARD_CHANCE rewards
+    bool (*taskGuard)(byte state, byte event) = NULL;
+    void logTimeoutPoke(bool left);
+
+    // Random numbers (xoshiro128**), the session's seed is logged so it can be replayed
+    unsigned long randomSeedValue = 0; // set before begin() to replay a session, 0 picks a new seed
+    void seedRandom(unsigned long seed);
+    uint32_t random32(byte stream = RANDOM_TASK);
+    uint32_t randomBelow(uint32_t n, byte stream = RANDOM_TASK);    // 0 to n - 1, unbiased
+    long randomRange(long low, long high, byte stream = RANDOM_TASK); // low to high - 1, like random(low, high)
+    bool randomChance(float p, byte stream = RANDOM_TASK);          // true with probability p
+
+    // Poke sequence matcher, logged pokes step a DFA built from the pattern
+    bool startSequence(const char *pattern, unsigned long windowMs = 0, void (*onMatch)() = NULL); // e.g. "LR", window from the first poke of the match, 0 for none
+    void setSequenceWindows(const FED3_SequenceWindow *windows, byte count);                       // shorten the window as matches add up, sorted by afterMatches
+    void stopSequence();
+    void sequenceEvent(bool left); // called by logLeftPoke() and logRightPoke()
+    byte sequenceState = 0;        // pokes of the pattern matched so far
+    unsigned long sequenceMatches = 0;
+    unsigned long sequenceResets = 0;
+    unsigned long sequenceWindowMs = 0;
+    bool logSequenceEvents = true; // log SeqMatch and SeqReset events
+
+    // Progressive ratio schedule, when set before begin() its step is logged in a PR_Step column
+    FED3_PRSchedule *prSchedule = NULL;
+
     // Pelet and poke functions
     void logLeftPoke();
     void logRightPoke();
@@ -269,8 +718,17 @@ public:
 
     // Bandit task functions
     void updateBanditBlock();                                       // Handle block transitions and probability updates
-    bool handleBanditPoke(bool isLeftPoke);                         // Handle poke behavior for Bandit task
+    bool handleBanditPoke(bool isLeftPoke);                         // Handle poke behavior for Bandit task, blocks during the delay and timeout
     void initBanditTask(int pellets_per_block, bool allow_repeats); // Initialize Bandit settings
+    void planBandit(const FED3_BanditConfig &config);               // draw the block sequence, call before begin() to log its seed
+    void countBanditChoice(bool left);
+    FED3_BanditBlock banditPlan[MAX_BANDIT_BLOCKS] = {};
+    FED3_BanditSet banditSets[MAX_BANDIT_SETS] = {};
+    byte banditBlock = 0;                                           // current entry of banditPlan
+    bool banditPlanned = false;
+    FED3_BanditStats banditStats = {};
+    unsigned long choiceDelayMs = 1000;                             // TASK_TIMER_CHOICE
+    bool logBanditBlocks = true;                                    // write block statistics to a BLK companion of the log file
 
     // timing variables
     int retInterval = 0;
@@ -288,6 +746,18 @@ public:
     bool EnableSleep = true;
     void disableSleep();
     void enableSleep();
+
+    // Deadlines, sleep lasts until the next one or until a poke or pellet interrupt
+    void setDeadline(byte id, unsigned long delayMs);
+    void clearDeadline(byte id);
+    bool deadlinePassed(byte id);          // true once when the deadline is reached, then clears it
+    unsigned long msToNextDeadline();
+    unsigned long deadlineClock();         // millis() plus time spent asleep
+    unsigned long maxSleepMs = 60000;      // longest sleep even with no deadline set
+    unsigned long sleepWakeups = 0;
+    unsigned long sleptMs = 0;             // total time asleep
+    float sleepResidency();                // fraction of time since startup spent asleep
+
     bool ClassicFED3 = false;
     bool FED3Menu = false;
     bool psygene = false; // Psygene menu mode flag
@@ -304,7 +774,7 @@ public:
     // Neopixel strip
     Adafruit_NeoPixel strip = Adafruit_NeoPixel(10, NEOPIXEL, NEO_GRBW + NEO_KHZ800);
     // Display
-    Adafruit_SharpMem display = Adafruit_SharpMem(SHARP_SCK, SHARP_MOSI, SHARP_SS, 144, 168);
+    FED3_SharpMem display = FED3_SharpMem(SHARP_SCK, SHARP_MOSI, SHARP_SS, 144, 168);
     // Stepper
     Stepper stepper = Stepper(STEPS, A2, A3, A4, A5);
     // Temp/Humidity Sensor
@@ -321,6 +791,7 @@ public:
     // RTC
     void adjustRTC(uint32_t timestamp);
     static void dateTime(uint16_t *date, uint16_t *time); // Add this declaration
+    static void formatStamp(char *stamp, const DateTime &time); // first column of the CSV files, stamp holds FED3_STAMP_CHARS
 
     // Add new RTC-related functions
     bool initializeRTC();
@@ -333,6 +804,233 @@ public:
 
 private:
     RTC_PCF8523 rtc;
+
+    // Display scheduler state
+    byte displayPending = 0;
+    unsigned long lastDisplayFrame = 0;
+    uint32_t pendingScreenKey = 0; // mainScreenKey() of the pending frame
+    uint32_t shownScreenKey = 0;   // and of the last one rendered
+    int shownInterval = -1;        // interval value last rendered
+    uint32_t mainScreenKey();
+    int intervalValue(byte interval);
+    void drawMainScreen();
+    void drawStatsPanel();
+    void drawIntervalText();
+    void drawStartScreen();
+    void drawMenuScreen(byte menu);
+    const char *drawCaptureScreen(byte screen);
+    void drawMouseFrame(int i);
+
+    // Animation state
+    FED3_Animation animations[MAX_ANIMATIONS] = {};
+    uint16_t animationSequence = 0;
+    unsigned long lastMenuPoll = 0;
+    bool stepAnimation(FED3_Animation &animation);
+    void endAnimation(FED3_Animation &animation);
+    bool pixelsDirty = false;
+    bool firstOnOutput(byte slot);
+
+    // Deadline state
+    unsigned long deadlineAt[MAX_DEADLINES] = {};
+    byte deadlinesActive = 0; // bit n set when slot n is armed
+    void scheduleLibraryDeadlines();
+    uint32_t rtcSecondUnix = 0; // an RTC second, which began on deadlineClock() between the two below
+    unsigned long rtcSecondLo = 0;
+    unsigned long rtcSecondHi = 0;
+    unsigned long rtcClockMs();
+    void alignRtcClock();
+
+    // Sequence matcher state
+    byte sequenceNext[MAX_SEQUENCE_LENGTH][2] = {}; // next state for a right (0) or left (1) poke
+    byte sequenceLength = 0;
+    unsigned long sequencePokeMs[MAX_SEQUENCE_LENGTH] = {}; // times of the last pokes, ring indexed by sequenceHead
+    byte sequenceHead = 0;
+    void (*sequenceCallback)() = NULL;
+    const FED3_SequenceWindow *sequenceWindows = NULL;
+    byte sequenceWindowCount = 0;
+    byte sequenceWindowIndex = 0;
+    void serviceSequence();
+    void resetSequence();
+    void logSequenceEvent(const char *event);
+
+    // Bandit plan state
+    void planBandit(const FED3_BanditConfig &config, bool followOn);
+    void drawBanditBlocks(bool followOn);
+    void startBanditBlock(byte index);
+    void writeBanditBlock();
+    FED3_BanditConfig banditConfig = {};
+
+    // Random stream state
+    uint32_t randomState[RANDOM_STREAMS][4] = {};
+    bool randomSeeded = false;
+    unsigned long pickRandomSeed();
+
+    // BNC capture state
+    volatile FED3_BNCEdge bncQueue[BNC_CAPTURE_SIZE];
+    volatile byte bncHead = 0;
+    volatile byte bncTail = 0;
+    volatile bool bncCapturing = false;
+    bool bncLogEdges = false;
+    unsigned long bncLogUs = 0; // micros() of the edge logdata() is writing, logged as its Poke_Time
+    volatile unsigned long bncLastRiseUs = 0;
+    volatile unsigned long bncWidthSumUs = 0;
+    volatile unsigned long bncPeriods = 0;
+    volatile unsigned long bncPeriodSumUs = 0;
+    void logBNCEdges();
+
+    // Trial state
+    const FED3_Stimulus *trialStimuli = NULL;
+    byte trialCount = 0;
+    volatile byte trialNext = 0;
+    volatile bool trialArmed = false; // a trial was started, pokes are timed against it until stopTrial()
+    unsigned long trialTriggerUs = 0;
+    volatile unsigned long trialOnsetUs[MAX_TRIAL_STIMULI] = {};
+    volatile bool trialPixelsPending = false; // a frame the timer staged for serviceTrialPixels()
+    volatile uint32_t trialPixelColor = 0;
+    volatile byte trialPixelStimulus = 0;
+    unsigned long stepTrial();
+    void runStimulus(const FED3_Stimulus &stimulus);
+    void noteStimulusOnset(byte index, unsigned long onset);
+    void serviceTrialPixels();
+    void notePokeEdge(bool left);
+
+    // Hardware timer and pulse train state
+    bool hardwareTimerReady = false;
+    void startHardwareTimer();
+    void armHardwareTimer(unsigned long delayUs);
+    void stopHardwareTimer();
+    unsigned long stepPulseTrain();
+    unsigned long pulseEdgeTime(unsigned long edge);
+    volatile bool pulseRunning = false;
+    volatile bool pulseDone = false;
+    volatile unsigned long pulseEdge = 0;
+    unsigned long pulseEdgeCount = 0;
+    unsigned long pulseStartUs = 0;
+    unsigned long pulseWidthUs = 0;
+    unsigned long pulsePeriodUs = 0;
+    unsigned long pulseBurstSpanUs = 0;
+    unsigned int pulsesPerBurst = 0;
+    const unsigned long *pulseEdgeList = NULL;
+    unsigned long syncEdges[2 + 2 * SYNC_BITS];
+    volatile uint16_t syncQueue[SYNC_QUEUE_SIZE];
+    volatile byte syncQueueHead = 0;
+    volatile byte syncQueueTail = 0;
+    void setSyncEdges(uint16_t code);
+    bool nextSyncMarker();
+    void (*pulseCallback)() = NULL;
+
+    // Audio engine state
+    bool audioTimerReady = false;
+    void startAudioTimer();
+    void setAudioTimerPeriod(unsigned long periodUs);
+    void stopAudioTimer();
+    void prepareAudio();
+    void playWithTone(const FED3_Note *notes, byte count);
+    void startNote(byte index);
+    void startInterruptNote(uint16_t freq, uint16_t durationMs); // from the trial timer, see FED3_Trial.cpp
+    void stopInterruptNote();
+    void resumeAudioLoop();
+    const FED3_Note *audioNotes = NULL;
+    byte audioCount = 0;
+    volatile byte audioIndex = 0;
+    bool audioLoop = false;
+    volatile bool audioPlaying = false;
+    volatile unsigned long audioTicksLeft = 0;
+    bool audioLevel = false;
+    uint32_t noiseState = 0; // xorshift32, one bit of noise per step
+    unsigned long audioStartMs = 0;
+    FED3_Note audioSingle = {};
+    FED3_Note audioTrialNote = {};
+    volatile bool audioResume = false; // a looping sequence is paused for a trial note
+    const FED3_Note *audioResumeNotes = NULL;
+    byte audioResumeCount = 0;
+    byte audioResumeIndex = 0;
+    unsigned long audioResumeTicks = 0;
+
+    // Task engine state
+    void serviceTask();
+    void enterTaskState(byte state);
+    bool taskGuardPasses(byte guard, byte event);
+    FED3_PRSchedule defaultPRSchedule = FED3_PRSchedule(FED3_PRTable<FED3_PRExponential, 30>::steps);
+    void runTaskActions(uint16_t actions, bool left);
+
+    bool outputsBusy(); // animations, pulse trains, BNC capture or audio that need the device awake
+
+    // Energy accounting state
+    struct PowerTotals
+    {
+        unsigned long clockMs;
+        unsigned long sleptMs;
+        unsigned long railMs;
+        unsigned long buzzerMs;
+        unsigned long refreshes;
+        unsigned long sdSyncs;
+    };
+    bool railOn = false;
+    bool motorTurning = false; // RotateDisk() is stepping, the rail stays on until ReleaseMotor()
+    unsigned long railOnSince = 0;
+    unsigned long railMs = 0;
+    unsigned long buzzerMs = 0;
+    unsigned long buzzerEnd = 0;
+    unsigned long sdSyncs = 0;
+    PowerTotals lastPowerReport = {};
+    int powerReportHour = -1;
+    PowerTotals powerTotals();
+    float chargemAh(const PowerTotals &from, const PowerTotals &to);
+    void servicePowerReport();
+
+    // Session statistics state
+    uint8_t statsMinutePellets[STATS_MINUTES] = {}; // ring indexed by minute, saturates at 255
+    uint8_t statsMinutePokes[STATS_MINUTES] = {};
+    uint8_t statsMinuteActive[STATS_MINUTES] = {};
+    uint16_t rollingPellets = 0; // sums of the minute bins
+    uint16_t rollingPokes = 0;
+    uint16_t rollingActive = 0;
+    FED3_StatsHour statsHours[STATS_HOURS] = {}; // ring indexed by hour
+    uint32_t statsMinute = 0;    // minutes since 1970 of the newest minute bin, 0 before the first event
+    uint32_t statsHourIndex = 0; // hours since 1970 of the newest hour bin
+    unsigned long statsRetrievals = 0;
+    float statsRetrievalMean = 0; // Welford's running mean and sum of squared differences, seconds
+    float statsRetrievalM2 = 0;
+    uint32_t lastMealPellet = 0;
+    void advanceStats(uint32_t unixTime);
+    void countStatsEvent(byte event, uint32_t unixTime, bool activeLeft, int retrievalMs);
+
+    // Summary state, the open hour is kept in RAM and rebuilt from the log after a reset
+    struct SummaryState
+    {
+        uint32_t sequence;      // SUMMARY.DAT holds two copies, the newer one that checks out is used
+        uint32_t hour;          // hours since 1970 of the open hour, its rows are not in HOURS###.CSV yet
+        uint32_t day;           // days since 1970 of the open day
+        uint16_t dayHours;      // hours written to HOURS###.CSV for the open day
+        FED3_SummaryBin dayBin; // their totals
+        char logs[2][21];       // previous and current log file, the open hour's rows are in these
+        uint32_t check;
+    };
+    uint32_t summaryHour = 0; // open hour, 0 before the first
+    uint32_t summaryDay = 0;
+    uint16_t summaryDayHours = 0;
+    FED3_SummaryBin summaryBin = {};    // battery and temperature readings of the open hour, its counts are in statsHours
+    FED3_SummaryBin summaryDayBin = {};
+    uint32_t summarySequence = 0;
+    char summaryLogs[2][21] = {};
+    void serviceSummary(uint32_t unixTime);
+    void addSummaryReading(uint32_t unixTime, float batteryV, float temperatureC);
+    void closeSummaryHour(uint32_t hour);
+    void writeSummaryRow(const char *prefix, uint32_t start, uint16_t hours, const FED3_SummaryBin &bin);
+    void saveSummaryState();
+    bool loadSummaryState(SummaryState &state);
+    void recoverSummary();
+    void replaySummaryLog(const char *name, uint32_t from, uint32_t to);
+    // Log index
+    SdFile logReader;
+    bool logIndexStarted = false; // an entry was written to this log's index since startup
+    uint16_t logIndexRows = 0;    // rows since the last entry
+    uint32_t logIndexUnix = 0;    // time of the last entry
+    void indexFilename(char *name, const char *log);
+    void indexLogRow(uint32_t unixTime, uint32_t offset);
+    bool readIndexEntry(SdFile &index, uint32_t i, FED3_LogIndexEntry &entry);
+    static bool rowTime(const char *row, uint32_t &unixTime);
 #if defined(ESP32)
     Adafruit_MAX17048 maxlipo;
 #endif
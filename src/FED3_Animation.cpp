@@ -0,0 +1,186 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Animations
+**************************************************************************************************************************************************/
+// Animations are keyframed tasks stepped from serviceAnimations(), which run() calls once per loop.
+// Blocking loops that should keep animations moving (like the startup menus) call it too.
+
+// Display and NeoPixel animations can run at the same time, animations on the same output queue up
+static byte animationOutput(byte type)
+{
+    return (type == ANIMATION_MOUSE) ? 0 : 1;
+}
+
+bool FED3::startAnimation(byte type, uint16_t intervalMs, uint32_t color, bool cancelOnInput)
+{
+    for (byte n = 0; n < MAX_ANIMATIONS; n++)
+    {
+        FED3_Animation &a = animations[n];
+        if (a.type == ANIMATION_NONE)
+        {
+            a.type = type;
+            a.step = 0;
+            a.intervalMs = intervalMs;
+            a.nextMs = millis();
+            a.color = color;
+            a.sequence = animationSequence++;
+            a.cancelOnInput = cancelOnInput;
+            return true;
+        }
+    }
+    return false; // all slots busy
+}
+
+bool FED3::startColorWipe(uint32_t c, uint8_t wait, bool cancelOnInput)
+{
+    return startAnimation(ANIMATION_COLOR_WIPE, wait, c, cancelOnInput);
+}
+
+// Fade all pixels in and out, one full cycle every periodMs
+bool FED3::startPixelPulse(uint32_t c, uint16_t periodMs, bool cancelOnInput)
+{
+    return startAnimation(ANIMATION_PULSE, periodMs / 32, c, cancelOnInput);
+}
+
+// Light-tracking cue: a light runs along the strip toward the active poke, then lights the poke
+bool FED3::startPokeCue(uint32_t c, uint16_t stepMs, bool cancelOnInput)
+{
+    return startAnimation(ANIMATION_CUE, stepMs, c, cancelOnInput);
+}
+
+bool FED3::animationRunning(byte type)
+{
+    for (byte n = 0; n < MAX_ANIMATIONS; n++)
+    {
+        if (animations[n].type != ANIMATION_NONE && (type == ANIMATION_ANY || animations[n].type == type))
+            return true;
+    }
+    return false;
+}
+
+void FED3::cancelAnimations()
+{
+    for (byte n = 0; n < MAX_ANIMATIONS; n++)
+    {
+        if (animations[n].type != ANIMATION_NONE)
+            endAnimation(animations[n]);
+    }
+    showPixels();
+}
+
+// Free the slot, pixel animations leave the pixels dark
+void FED3::endAnimation(FED3_Animation &a)
+{
+    if (animationOutput(a.type) == 1)
+        clearPixels();
+    a.type = ANIMATION_NONE;
+}
+
+// True if no earlier animation is still using the same output
+bool FED3::firstOnOutput(byte slot)
+{
+    const FED3_Animation &a = animations[slot];
+    for (byte n = 0; n < MAX_ANIMATIONS; n++)
+    {
+        const FED3_Animation &b = animations[n];
+        if (n != slot && b.type != ANIMATION_NONE && animationOutput(b.type) == animationOutput(a.type) &&
+            (int16_t)(b.sequence - a.sequence) < 0)
+            return false;
+    }
+    return true;
+}
+
+void FED3::serviceAnimations(unsigned long budgetUs)
+{
+    unsigned long serviceStart = micros();
+    bool input = (digitalRead(LEFT_POKE) == LOW || digitalRead(RIGHT_POKE) == LOW || Left || Right);
+
+    for (byte n = 0; n < MAX_ANIMATIONS; n++)
+    {
+        FED3_Animation &a = animations[n];
+        if (a.type == ANIMATION_NONE)
+            continue;
+
+        if (input && a.cancelOnInput)
+        {
+            endAnimation(a);
+            continue;
+        }
+
+        if (!firstOnOutput(n) || (long)(millis() - a.nextMs) < 0)
+            continue;
+
+        if (!stepAnimation(a))
+            endAnimation(a); // finished
+
+        if (micros() - serviceStart > budgetUs)
+            break;
+    }
+
+    // Pixel animations only stage colors, send them as one frame with a trial's frame
+    serviceTrialPixels();
+    if (pixelsDirty)
+        showPixels();
+}
+
+// Draw one keyframe and schedule the next, returns false when the animation is done
+bool FED3::stepAnimation(FED3_Animation &a)
+{
+    if (a.type == ANIMATION_MOUSE)
+    {
+        // 17 frames with the mouse moving 15 pixels to the right each frame
+        if (a.step > 0)
+        {
+            int previous = -50 + 15 * (a.step - 1);
+            display.fillRect(previous - 25, 73, 95, 33, WHITE);
+        }
+        requestDisplayRefresh(); // pushed by serviceDisplay() within the frame budget
+        if (a.step == 17)
+            return false;
+        drawMouseFrame(-50 + 15 * a.step);
+    }
+    else if (a.type == ANIMATION_COLOR_WIPE)
+    {
+        // light the pixels left to right, then turn them off again
+        if (a.step == 8)
+            return false;
+        setPixel(a.step, a.color);
+    }
+    else if (a.type == ANIMATION_PULSE)
+    {
+        // triangle wave over 32 steps, scaling each color channel
+        byte level = (a.step & 31) < 16 ? (a.step & 31) : 31 - (a.step & 31);
+        uint32_t c = 0;
+        for (byte shift = 0; shift < 32; shift += 8)
+            c |= (uint32_t)((((a.color >> shift) & 0xFF) * level + 7) / 15) << shift;
+        fillPixels(c);
+    }
+    else if (a.type == ANIMATION_CUE)
+    {
+        // 8 steps moving toward the active poke, then 8 steps with the poke pixel lit
+        byte phase = a.step & 15;
+        clearPixels();
+        if (phase < 8)
+            setPixel(activePoke ? 7 - phase : phase, a.color);
+        else
+            setPixel(activePoke ? 9 : 8, a.color);
+    }
+    else
+    {
+        return false;
+    }
+
+    a.step++;
+    a.nextMs = millis() + a.intervalMs;
+    return true;
+}
+
+// Track the longest gap between poke checks in the startup menus
+void FED3::noteMenuPoll()
+{
+    unsigned long now = millis();
+    if (lastMenuPoll != 0 && now - lastMenuPoll > menuWorstInputGapMs)
+        menuWorstInputGapMs = now - lastMenuPoll;
+    lastMenuPoll = now;
+}
@@ -4,107 +4,322 @@ void FED3::Timeout(int seconds, bool reset, bool whitenoise)
 {
     unsigned long timeoutStart = millis();
 
+    // White noise for the whole timeout, played by the audio engine
+    if (whitenoise)
+    {
+        playNoise(AUDIO_UNTIL_STOPPED);
+    }
+
     while ((millis() - timeoutStart) < (seconds * 1000UL))
     {
-        // Generate white noise if enabled
-        if (whitenoise)
-        {
-            int freq = random(50, 250);
-            tone(BUZZER, freq, 10);
-            delay(10);
-        }
+        serviceDisplay();
 
-        // Handle left poke during timeout
+        // Handle pokes during timeout
         if (digitalRead(LEFT_POKE) == LOW)
         {
             if (reset)
             {
                 timeoutStart = millis();
             }
-            leftPokeTime = millis();
-            if (countAllPokes)
-            {
-                LeftCount++;
-            }
-
-            leftInterval = 0.0;
-            while (digitalRead(LEFT_POKE) == LOW)
-            {
-                if (whitenoise)
-                {
-                    int freq = random(50, 250);
-                    tone(BUZZER, freq, 10);
-                }
-            }
-
-            leftInterval = (millis() - leftPokeTime);
-            Event = "LeftinTimeOut";
-            logdata();
+            logTimeoutPoke(true);
         }
 
-        // Handle right poke during timeout
         if (digitalRead(RIGHT_POKE) == LOW)
         {
             if (reset)
             {
                 timeoutStart = millis();
             }
-            if (countAllPokes)
-            {
-                RightCount++;
-            }
-            rightPokeTime = millis();
-
-            rightInterval = 0.0;
-            while (digitalRead(RIGHT_POKE) == LOW)
-            { // Fixed: was checking LEFT_POKE
-                if (whitenoise)
-                {
-                    int freq = random(50, 250);
-                    tone(BUZZER, freq, 10);
-                }
-            }
-            rightInterval = (millis() - rightPokeTime);
-            UpdateDisplay();
-            Event = "RightinTimeout";
-            logdata();
+            logTimeoutPoke(false);
         }
     }
 
+    if (whitenoise)
+    {
+        stop();
+    }
+
     // Clear timeout display and reset states
     display.fillRect(5, 20, 100, 25, WHITE);
-    UpdateDisplay();
+    requestDisplayUpdate();
     Left = false;
     Right = false;
 }
 
 void FED3::ConditionedStimulus(int duration)
 {
-    tone(BUZZER, 4000, duration);
+    Tone(4000, duration);
     pixelsOn(0, 0, 10, 0); // blue light for all
 }
 
 void FED3::Click()
 {
-    tone(BUZZER, 800, 8);
+    Tone(800, 8);
 }
 
 void FED3::Tone(int freq, int duration)
 {
-    tone(BUZZER, freq, duration);
+    playTone(freq, duration);
 }
 
 void FED3::stopTone()
 {
-    noTone(BUZZER);
+    stop();
 }
 
 void FED3::Noise(int duration)
 {
     // White noise to signal errors
-    for (int i = 0; i < duration / 50; i++)
+    playNoise(duration);
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Audio engine
+**************************************************************************************************************************************************/
+// Note sequences and noise are played from the audio timer interrupt. A tone toggles BUZZER every half period,
+// noise writes one bit of an xorshift32 generator every AUDIO_NOISE_TICK_US. The generator only repeats after
+// 2^32 - 1 bits, days at 10 kHz, so the noise has no audible period.
+#define AUDIO_NOISE_TICK_US 100 // 10 kHz bit rate
+#define AUDIO_REST_TICK_US 1000
+
+/**
+ * Plays a sequence of notes in the background.
+ *
+ * @param notes Notes to play, freq is in Hz or AUDIO_REST / AUDIO_NOISE. Must stay valid until the sequence ends.
+ * @param count Number of notes
+ * @param loop  Start over after the last note until stop() is called
+ */
+bool FED3::play(const FED3_Note *notes, byte count, bool loop)
+{
+    if (notes == NULL || count == 0)
+        return false;
+
+    stop();
+    if (!audioTimer)
+    {
+        if (loop)
+            return false;
+        playWithTone(notes, count);
+        return true;
+    }
+    prepareAudio();
+    audioStartMs = millis();
+
+    // Sounding time for the energy accounting, looping sequences are counted when stopped
+    if (!loop)
     {
-        tone(BUZZER, random(50, 250), 50);
-        delay(duration / 50);
+        unsigned long sounding = 0;
+        for (byte i = 0; i < count; i++)
+        {
+            if (notes[i].freq != AUDIO_REST)
+                sounding += notes[i].durationMs;
+        }
+        noteBuzzer(sounding);
     }
-}
\ No newline at end of file
+
+    noInterrupts(); // a trial note started from the timer in between would change these
+    audioNotes = notes;
+    audioCount = count;
+    audioLoop = loop;
+    audioPlaying = true;
+    startNote(0);
+    interrupts();
+    return true;
+}
+
+// Timer, pin and noise generator, set up outside the interrupts that start notes
+void FED3::prepareAudio()
+{
+    while (noiseState == 0)
+    {
+        noiseState = random32(RANDOM_AUDIO); // seeded from its own stream, so noise doesn't use up task draws
+    }
+    startAudioTimer();
+    pinMode(BUZZER, OUTPUT);
+}
+
+// Without the audio timer: notes one after another with tone() and noise as random low tones, as before the audio
+// engine. Returns when the sequence is done.
+void FED3::playWithTone(const FED3_Note *notes, byte count)
+{
+    pinMode(BUZZER, OUTPUT);
+    for (byte i = 0; i < count; i++)
+    {
+        uint16_t freq = notes[i].freq;
+        uint16_t duration = notes[i].durationMs;
+        if (freq == AUDIO_NOISE)
+        {
+            for (uint16_t t = 0; t < duration; t += 10)
+            {
+                tone(BUZZER, 50 + randomBelow(200, RANDOM_AUDIO), 10);
+                delay(10);
+            }
+        }
+        else if (freq != AUDIO_REST)
+        {
+            tone(BUZZER, freq, duration);
+            delay(duration);
+        }
+        else
+        {
+            delay(duration);
+        }
+        if (freq != AUDIO_REST)
+            noteBuzzer(duration);
+    }
+    noTone(BUZZER);
+    noteBuzzer(0);
+}
+
+bool FED3::playTone(uint16_t freq, uint16_t durationMs)
+{
+    audioSingle.freq = freq;
+    audioSingle.durationMs = durationMs;
+    return play(&audioSingle, 1, durationMs == AUDIO_UNTIL_STOPPED);
+}
+
+bool FED3::playNoise(uint16_t durationMs)
+{
+    return playTone(AUDIO_NOISE, durationMs);
+}
+
+void FED3::stop()
+{
+    if (!audioPlaying)
+        return;
+    noInterrupts();
+    audioPlaying = false;
+    bool looped = audioLoop || audioResume;
+    audioResume = false;
+    stopAudioTimer();
+    interrupts();
+    digitalWrite(BUZZER, LOW);
+
+    if (looped)
+        noteBuzzer(millis() - audioStartMs);
+    else
+        noteBuzzer(0); // cuts off the rest of the sequence
+}
+
+bool FED3::isPlaying()
+{
+    return audioPlaying;
+}
+
+// Load a note and set the timer to its tick rate
+void FED3::startNote(byte index)
+{
+    audioIndex = index;
+    uint16_t freq = audioNotes[index].freq;
+    unsigned long period;
+    if (freq == AUDIO_REST)
+        period = AUDIO_REST_TICK_US;
+    else if (freq == AUDIO_NOISE)
+        period = AUDIO_NOISE_TICK_US;
+    else
+        period = 500000UL / freq; // half a cycle per tick
+
+    // A note played until stopped has no duration, keep it going
+    unsigned long durationUs = audioNotes[index].durationMs * 1000UL;
+    audioTicksLeft = (durationUs == 0) ? 0xFFFFFFFF : (durationUs + period / 2) / period;
+    if (audioTicksLeft == 0)
+        audioTicksLeft = 1;
+
+    audioLevel = false;
+    digitalWrite(BUZZER, LOW);
+    setAudioTimerPeriod(period);
+}
+
+// Start a trial's note from the trial timer interrupt. startTrial() has set up the timer and the pin and counted
+// the note's energy, so nothing here reads millis(). A sound looping until stop(), e.g. the white noise of Timeout(),
+// is paused for the note and picks up where it was when the note ends. Anything else playing is cut off.
+void FED3::startInterruptNote(uint16_t freq, uint16_t durationMs)
+{
+    if (audioPlaying && audioLoop && !audioResume)
+    {
+        audioResumeNotes = audioNotes;
+        audioResumeCount = audioCount;
+        audioResumeIndex = audioIndex;
+        audioResumeTicks = audioTicksLeft;
+        audioResume = true;
+    }
+    audioTrialNote.freq = freq;
+    audioTrialNote.durationMs = durationMs;
+    audioNotes = &audioTrialNote;
+    audioCount = 1;
+    audioLoop = false;
+    audioPlaying = true;
+    startNote(0);
+}
+
+// Ends a trial's note early, a paused loop goes on
+void FED3::stopInterruptNote()
+{
+    if (audioResume)
+    {
+        resumeAudioLoop();
+    }
+    else if (audioPlaying && audioNotes == &audioTrialNote)
+    {
+        audioPlaying = false;
+        stopAudioTimer();
+        digitalWrite(BUZZER, LOW);
+    }
+}
+
+void FED3::resumeAudioLoop()
+{
+    audioResume = false;
+    audioNotes = audioResumeNotes;
+    audioCount = audioResumeCount;
+    audioLoop = true;
+    startNote(audioResumeIndex);
+    audioTicksLeft = audioResumeTicks;
+}
+
+// Audio timer interrupt
+void FED3::serviceAudio()
+{
+    if (!audioPlaying)
+        return;
+
+    if (audioTicksLeft == 0)
+    {
+        byte next = audioIndex + 1;
+        if (next >= audioCount)
+        {
+            if (audioResume)
+            {
+                resumeAudioLoop();
+                return;
+            }
+            if (!audioLoop)
+            {
+                audioPlaying = false;
+                stopAudioTimer();
+                digitalWrite(BUZZER, LOW);
+                return;
+            }
+            next = 0;
+        }
+        startNote(next);
+    }
+    if (audioTicksLeft != 0xFFFFFFFF)
+        audioTicksLeft--;
+
+    uint16_t freq = audioNotes[audioIndex].freq;
+    if (freq == AUDIO_REST)
+        return;
+    if (freq == AUDIO_NOISE)
+    {
+        noiseState ^= noiseState << 13;
+        noiseState ^= noiseState >> 17;
+        noiseState ^= noiseState << 5;
+        audioLevel = noiseState & 1;
+    }
+    else
+    {
+        audioLevel = !audioLevel;
+    }
+    digitalWrite(BUZZER, audioLevel ? HIGH : LOW);
+}
@@ -1,5 +1,16 @@
 #include "FED3.h"
 
+#if defined(ESP32)
+#define IRAM_ISR_ATTR IRAM_ATTR
+#elif defined(__arm__)
+#define IRAM_ISR_ATTR
+#endif
+
+static void IRAM_ISR_ATTR outsideBNCHandler()
+{
+    fed3BoardFED()->bncEdge();
+}
+
 // Simple function for sending square wave pulses to the BNC port
 void FED3::BNC(int DELAY_MS, int loops)
 {
@@ -17,18 +28,169 @@ void FED3::BNC(int DELAY_MS, int loops)
 // More advanced function for controlling pulse width and frequency for the BNC port
 void FED3::pulseGenerator(int pulse_width, int frequency, int repetitions)
 { // freq in Hz, width in ms, loops in number of times
-    for (byte j = 0; j < repetitions; j++)
+    if (frequency <= 0 || pulse_width < 0 || repetitions <= 0)
+        return;
+
+    // Work in microseconds so periods like 1000 / 3 ms aren't truncated
+    unsigned long widthUs = pulse_width * 1000UL;
+    unsigned long periodUs = 1000000UL / frequency;
+    if (periodUs < widthUs)
+        periodUs = widthUs; // if parameters are set wrong, pulse back to back so FED3 doesn't crash O_o
+
+    if (!startPulseTrain(widthUs, periodUs, repetitions))
+        return;
+    while (pulseTrainRunning())
     {
-        digitalWrite(BNC_OUT, HIGH);
-        digitalWrite(GREEN_LED, HIGH);
-        delay(pulse_width); // pulse high for width
-        digitalWrite(BNC_OUT, LOW);
-        digitalWrite(GREEN_LED, LOW);
-        long temp_delay = (1000 / frequency) - pulse_width;
-        if (temp_delay < 0)
-            temp_delay = 0; // if temp delay <0 because parameters are set wrong, set it to 0 so FED3 doesn't crash O_o
-        delay(temp_delay);  // pin low
+        delay(1);
     }
+    servicePulseTrain();
+}
+
+/**
+ * Starts a train of pulses on the BNC output and returns immediately. Edges are written from the
+ * hardware timer interrupt, scheduled from the start of the train so errors don't accumulate.
+ *
+ * @param widthUs    High time of each pulse
+ * @param periodUs   Time from one rising edge to the next within a burst
+ * @param pulses     Pulses per burst
+ * @param bursts     Number of bursts
+ * @param burstGapUs Extra low time between the last period of a burst and the next burst
+ * @param onComplete Called from run() once the last edge has been written
+ */
+bool FED3::startPulseTrain(unsigned long widthUs, unsigned long periodUs, unsigned int pulses,
+                           unsigned int bursts, unsigned long burstGapUs, void (*onComplete)())
+{
+    if (widthUs == 0 || periodUs < widthUs || pulses == 0 || bursts == 0)
+        return false;
+
+    stopPulseTrain();
+    stopBNCCapture(); // the BNC port can only be an input or an output
+    pinMode(BNC_OUT, OUTPUT);
+
+    pulseEdgeList = NULL;
+    pulseWidthUs = widthUs;
+    pulsePeriodUs = periodUs;
+    pulsesPerBurst = pulses;
+    pulseBurstSpanUs = pulses * periodUs + burstGapUs;
+    pulseEdgeCount = 2UL * pulses * bursts;
+    pulseCallback = onComplete;
+    pulseEdge = 0;
+    pulseDone = false;
+    pulseRunning = true;
+
+    startHardwareTimer();
+    pulseStartUs = micros();
+    serviceHardwareTimer(); // writes the first rising edge now and arms the timer for the next one
+    return true;
+}
+
+// Starts a pulse train from a list of edge times, even entries rise and odd entries fall.
+// The list must stay valid until the train is finished.
+bool FED3::startPulseEdges(const unsigned long *edgesUs, byte count, void (*onComplete)())
+{
+    if (edgesUs == NULL || count < 2 || (count & 1))
+        return false;
+
+    stopPulseTrain();
+    stopBNCCapture();
+    pinMode(BNC_OUT, OUTPUT);
+
+    pulseEdgeList = edgesUs;
+    pulseEdgeCount = count;
+    pulseCallback = onComplete;
+    pulseEdge = 0;
+    pulseDone = false;
+    pulseRunning = true;
+
+    startHardwareTimer();
+    pulseStartUs = micros();
+    serviceHardwareTimer();
+    return true;
+}
+
+void FED3::stopPulseTrain()
+{
+    if (!pulseRunning)
+        return;
+    noInterrupts();
+    pulseRunning = false;
+    syncQueueTail = syncQueueHead; // queued sync markers are dropped with the train
+    if (!trialRunning())
+        stopHardwareTimer();
+    interrupts();
+    digitalWrite(BNC_OUT, LOW);
+    digitalWrite(GREEN_LED, LOW);
+}
+
+bool FED3::pulseTrainRunning()
+{
+    return pulseRunning;
+}
+
+void FED3::servicePulseTrain()
+{
+    if (!pulseDone)
+        return;
+    pulseDone = false;
+    if (pulseCallback)
+        pulseCallback();
+}
+
+// Time of an edge from the start of the train, even edges rise and odd edges fall
+unsigned long FED3::pulseEdgeTime(unsigned long edge)
+{
+    if (pulseEdgeList)
+        return pulseEdgeList[edge];
+    unsigned long pulse = edge >> 1;
+    unsigned long time = (pulse / pulsesPerBurst) * pulseBurstSpanUs + (pulse % pulsesPerBurst) * pulsePeriodUs;
+    return (edge & 1) ? time + pulseWidthUs : time;
+}
+
+// Write every edge that is due, returns microseconds until the next one or 0 when the train is finished
+unsigned long FED3::stepPulseTrain()
+{
+    while (pulseRunning)
+    {
+        unsigned long due = pulseEdgeTime(pulseEdge);
+        long wait = (long)(due - (micros() - pulseStartUs));
+        if (wait > 20)
+            return wait;
+        while (wait > 0) // too close to re-arm the timer, wait it out
+            wait = (long)(due - (micros() - pulseStartUs));
+
+        bool high = !(pulseEdge & 1);
+        digitalWrite(BNC_OUT, high ? HIGH : LOW);
+        digitalWrite(GREEN_LED, high ? HIGH : LOW);
+
+        unsigned long late = -wait;
+        pulseEdgesWritten++;
+        pulseLateSumUs += late;
+        if (late > pulseWorstLateUs)
+            pulseWorstLateUs = late;
+
+        if (++pulseEdge >= pulseEdgeCount)
+        {
+            if (pulseEdgeList == syncEdges && nextSyncMarker())
+                continue;
+            pulseRunning = false;
+            pulseDone = true;
+        }
+    }
+    return 0;
+}
+
+float FED3::pulseMeanLateUs()
+{
+    return pulseEdgesWritten ? (float)pulseLateSumUs / pulseEdgesWritten : 0.0;
+}
+
+void FED3::resetPulseStats()
+{
+    noInterrupts();
+    pulseEdgesWritten = 0;
+    pulseWorstLateUs = 0;
+    pulseLateSumUs = 0;
+    interrupts();
 }
 
 void FED3::ReadBNC(bool blinkGreen)
@@ -49,4 +211,222 @@ void FED3::ReadBNC(bool blinkGreen)
             BNCinput = true;
         }
     }
-}
\ No newline at end of file
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Sync markers
+**************************************************************************************************************************************************/
+// With syncMarkers set, logdata() sends a marker for each event so recordings of the BNC line can be aligned
+// with the log. extras/tools/fed3_sync_decode.cpp decodes markers from a sampled TTL trace.
+// Event types, the index is the 4 bit code sent in the marker and 15 is any other event.
+static const char *const syncEventNames[] = {
+    "None", "Pellet", "Left", "LeftShort", "LeftWithPellet", "LeftinTimeOut", "LeftDuringDispense",
+    "Right", "RightShort", "RightWithPellet", "RightinTimeout", "RightDuringDispense", "PelletStuck",
+    "BNCRise", "BNCFall"};
+
+byte FED3::syncEventType(const String &event)
+{
+    for (byte i = 0; i < sizeof(syncEventNames) / sizeof(syncEventNames[0]); i++)
+    {
+        if (event == syncEventNames[i])
+            return i;
+    }
+    return 15;
+}
+
+// Send a marker with the next sequence number. While one is going out, the marker waits in a queue and the
+// timer interrupt sends it SYNC_MARKER_US after the previous one, so logdata() never waits for the port.
+// Returns false if a sketch's pulse train is using the port or the queue is full.
+bool FED3::emitSyncMarker(byte type)
+{
+    uint16_t code = ((type & 0x0F) << 9) | ((uint16_t)syncSequence << 1);
+    byte parity = 0;
+    for (uint16_t bits = code; bits; bits >>= 1)
+        parity ^= bits & 1;
+    code |= parity;
+
+    if (pulseTrainRunning())
+    {
+        bool queued = false;
+        noInterrupts();
+        byte next = (syncQueueHead + 1) & (SYNC_QUEUE_SIZE - 1);
+        bool sending = pulseRunning && pulseEdgeList == syncEdges;
+        if (sending && next != syncQueueTail)
+        {
+            syncQueue[syncQueueHead] = code;
+            syncQueueHead = next;
+            queued = true;
+        }
+        interrupts();
+        if (queued)
+        {
+            syncLastSequence = syncSequence++;
+            return true;
+        }
+        if (pulseTrainRunning())
+        {
+            syncLastSequence = -1;
+            return false;
+        }
+    }
+
+    setSyncEdges(code);
+    if (!startPulseEdges(syncEdges, 2 + 2 * SYNC_BITS))
+    {
+        syncLastSequence = -1;
+        return false;
+    }
+    syncLastSequence = syncSequence++;
+    return true;
+}
+
+// Edge times of a marker: the header pulse, then a short or long pulse per bit
+void FED3::setSyncEdges(uint16_t code)
+{
+    syncEdges[0] = 0;
+    syncEdges[1] = SYNC_HEADER_US;
+    for (byte i = 0; i < SYNC_BITS; i++)
+    {
+        unsigned long rise = SYNC_BIT_START_US + i * (unsigned long)SYNC_BIT_PERIOD_US;
+        bool one = code & (1 << (SYNC_BITS - 1 - i));
+        syncEdges[2 + 2 * i] = rise;
+        syncEdges[3 + 2 * i] = rise + (one ? SYNC_ONE_US : SYNC_ZERO_US);
+    }
+}
+
+// Called from the timer interrupt when a marker is done: starts the next queued one, SYNC_MARKER_US after it
+bool FED3::nextSyncMarker()
+{
+    if (syncQueueTail == syncQueueHead)
+        return false;
+    setSyncEdges(syncQueue[syncQueueTail]);
+    syncQueueTail = (syncQueueTail + 1) & (SYNC_QUEUE_SIZE - 1);
+    pulseEdge = 0;
+    pulseStartUs += SYNC_MARKER_US;
+    return true;
+}
+
+/**************************************************************************************************************************************************
+                                                                                               BNC input capture
+**************************************************************************************************************************************************/
+// Queue every edge on the BNC port with its micros() timestamp. The sketch reads edges with readBNCEdge(),
+// or with logEdges set run() logs each one as a BNCRise/BNCFall event, with the edge's micros() in the
+// Poke_Time column since the date and time column only has whole seconds. Logging takes an SD write per edge,
+// so it is meant for slow signals, faster trains should be read from the queue and summarised.
+void FED3::startBNCCapture(bool logEdges)
+{
+    stopPulseTrain();
+    pinMode(BNC_OUT, INPUT_PULLDOWN);
+    noInterrupts();
+    bncHead = 0;
+    bncTail = 0;
+    interrupts();
+    bncLogEdges = logEdges;
+    resetBNCStats();
+    bncCapturing = true;
+    attachInterrupt(digitalPinToInterrupt(BNC_OUT), outsideBNCHandler, CHANGE);
+}
+
+void FED3::stopBNCCapture()
+{
+    if (!bncCapturing)
+        return;
+    detachInterrupt(digitalPinToInterrupt(BNC_OUT));
+    bncCapturing = false;
+}
+
+bool FED3::bncCaptureRunning()
+{
+    return bncCapturing;
+}
+
+void FED3::bncEdge()
+{
+    unsigned long now = micros();
+    bool rising = digitalRead(BNC_OUT) == HIGH;
+
+    byte next = (bncHead + 1) & (BNC_CAPTURE_SIZE - 1);
+    if (next == bncTail)
+    {
+        bncOverflows++;
+    }
+    else
+    {
+        bncQueue[bncHead].us = now;
+        bncQueue[bncHead].rising = rising;
+        bncHead = next;
+    }
+
+    if (rising)
+    {
+        if (bncLastRiseUs != 0)
+        {
+            bncPeriods++;
+            bncPeriodSumUs += now - bncLastRiseUs;
+        }
+        bncLastRiseUs = now;
+    }
+    else if (bncLastRiseUs != 0)
+    {
+        unsigned long width = now - bncLastRiseUs;
+        bncPulses++;
+        bncWidthSumUs += width;
+        if (bncMinWidthUs == 0 || width < bncMinWidthUs)
+            bncMinWidthUs = width;
+        if (width > bncMaxWidthUs)
+            bncMaxWidthUs = width;
+    }
+}
+
+byte FED3::bncEdgesAvailable()
+{
+    return (bncHead - bncTail) & (BNC_CAPTURE_SIZE - 1);
+}
+
+bool FED3::readBNCEdge(FED3_BNCEdge &edge)
+{
+    if (bncTail == bncHead)
+        return false;
+    edge.us = bncQueue[bncTail].us;
+    edge.rising = bncQueue[bncTail].rising;
+    bncTail = (bncTail + 1) & (BNC_CAPTURE_SIZE - 1);
+    return true;
+}
+
+// Log queued edges, called from run()
+void FED3::logBNCEdges()
+{
+    if (!bncCapturing || !bncLogEdges)
+        return;
+    FED3_BNCEdge edge;
+    while (readBNCEdge(edge))
+    {
+        Event = edge.rising ? "BNCRise" : "BNCFall";
+        bncLogUs = edge.us;
+        logdata();
+    }
+}
+
+float FED3::bncMeanWidthUs()
+{
+    return bncPulses ? (float)bncWidthSumUs / bncPulses : 0.0;
+}
+
+float FED3::bncFrequencyHz()
+{
+    return bncPeriodSumUs ? 1000000.0 * bncPeriods / bncPeriodSumUs : 0.0;
+}
+
+void FED3::resetBNCStats()
+{
+    noInterrupts();
+    bncOverflows = 0;
+    bncPulses = 0;
+    bncMinWidthUs = 0;
+    bncMaxWidthUs = 0;
+    bncLastRiseUs = 0;
+    bncWidthSumUs = 0;
+    bncPeriods = 0;
+    bncPeriodSumUs = 0;
+    interrupts();
+}
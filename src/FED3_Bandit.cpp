@@ -1,39 +1,215 @@
 #include "FED3.h"
 
+// Block sequences are drawn when the task starts, and again after MAX_BANDIT_BLOCKS blocks, from the
+// RANDOM_TASK stream, so the seed logged by begin() reproduces them. A block uses one set of reward probabilities and lasts a drawn number of pellets:
+//
+//   const FED3_BanditSet sets[] = {{90, 10}, {70, 30}, {30, 70}, {10, 90}};
+//   FED3_BanditConfig config = {sets, 4, 20, 40, false, 2}; // 20-40 pellets, no repeats, better side switches after 2 blocks at most
+//   fed3.planBandit(config);
+//   fed3.startTask(FED3_Bandit);
+//   fed3.begin();
+
+static const FED3_BanditSet standardSets[] = {{80, 20}, {20, 80}};
+
 // Initialize Bandit task settings
 void FED3::initBanditTask(int pellets_per_block, bool allow_repeats)
 {
     countAllPokes = false;               // Only count pokes during active trials
     pelletsToSwitch = pellets_per_block; // Number of pellets before probability switch
     allowBlockRepeat = allow_repeats;    // Whether same probabilities can repeat
-    prob_left = 80;                      // Initial probability of left poke
-    prob_right = 20;                     // Initial probability of right poke
-    BlockPelletCount = 0;                // Reset block counter
+
+    FED3_BanditConfig config = {standardSets, 2, (uint16_t)pellets_per_block, (uint16_t)pellets_per_block, allow_repeats, 0};
+    planBandit(config);
+}
+
+static int betterSide(const FED3_BanditSet &set)
+{
+    return (set.left > set.right) - (set.left < set.right);
+}
+
+void FED3::planBandit(const FED3_BanditConfig &config)
+{
+    planBandit(config, false);
+}
+
+// With followOn the plan follows the block running now, see drawBanditBlocks()
+void FED3::planBandit(const FED3_BanditConfig &config, bool followOn)
+{
+    byte setCount = min((int)config.setCount, MAX_BANDIT_SETS);
+    if (config.sets == NULL || setCount == 0)
+        return;
+    memcpy(banditSets, config.sets, setCount * sizeof(FED3_BanditSet));
+    banditConfig = config;
+    banditConfig.sets = banditSets; // the sketch's array may not outlive the call
+    banditConfig.setCount = setCount;
+
+    drawBanditBlocks(followOn);
+    banditPlanned = true;
+    startBanditBlock(0);
+}
+
+// Draw the sets and lengths of every block, checking the constraints against the blocks already drawn. With
+// followOn the new first block is checked against the block running now: the last block of the previous plan,
+// or the probabilities the sketch set before a plan was drawn.
+void FED3::drawBanditBlocks(bool followOn)
+{
+    const FED3_BanditConfig &config = banditConfig;
+    byte setCount = config.setCount;
+    uint16_t minPellets = max((int)config.minPellets, 1);
+    uint16_t maxPellets = max(config.maxPellets, minPellets);
+    byte previous = 0xFF;
+    int previousSide = 0; // sign of left - right in the last block
+    byte sideRun = 0;
+    if (followOn && banditPlanned)
+    {
+        previous = banditPlan[MAX_BANDIT_BLOCKS - 1].set;
+        previousSide = betterSide(banditSets[previous]);
+        for (int b = MAX_BANDIT_BLOCKS - 1; b >= 0 && betterSide(banditSets[banditPlan[b].set]) == previousSide; b--)
+            sideRun++;
+    }
+    else if (followOn)
+    {
+        FED3_BanditSet running = {(byte)prob_left, (byte)prob_right};
+        for (byte i = 0; i < setCount; i++)
+        {
+            if (banditSets[i].left == running.left && banditSets[i].right == running.right)
+                previous = i;
+        }
+        previousSide = betterSide(running);
+        sideRun = 1;
+    }
+
+    for (byte b = 0; b < MAX_BANDIT_BLOCKS; b++)
+    {
+        byte candidates[MAX_BANDIT_SETS];
+        byte candidateCount = 0;
+        for (byte i = 0; i < setCount; i++)
+        {
+            int side = betterSide(banditSets[i]);
+            if (!config.allowRepeat && i == previous)
+                continue;
+            if (config.maxSameSide > 0 && sideRun >= config.maxSameSide && side != 0 && side == previousSide)
+                continue;
+            candidates[candidateCount++] = i;
+        }
+        if (candidateCount == 0) // constraints can't be met with these sets, drop them for this block
+        {
+            for (byte i = 0; i < setCount; i++)
+                candidates[candidateCount++] = i;
+        }
+
+        byte set = candidates[randomBelow(candidateCount)];
+        int side = betterSide(banditSets[set]);
+        sideRun = (side == previousSide) ? sideRun + 1 : 1;
+        previousSide = side;
+        previous = set;
+
+        banditPlan[b].set = set;
+        banditPlan[b].pellets = minPellets + randomBelow(maxPellets - minPellets + 1);
+    }
+}
+
+void FED3::startBanditBlock(byte index)
+{
+    banditBlock = index;
+    prob_left = banditSets[banditPlan[index].set].left;
+    prob_right = banditSets[banditPlan[index].set].right;
+    pelletsToSwitch = banditPlan[index].pellets;
+    BlockPelletCount = 0;
+
+    uint16_t block = banditStats.block;
+    memset(&banditStats, 0, sizeof(banditStats));
+    banditStats.block = block;
+    banditStats.startMs = deadlineClock();
 }
 
 // Handle block transitions and probability updates
 void FED3::updateBanditBlock()
 {
-    static const int probs[2] = {80, 20}; // Standard probability options
-
     if (BlockPelletCount >= pelletsToSwitch)
     {
-        BlockPelletCount = 0;               // Reset block counter
-        int new_prob = probs[random(0, 2)]; // Select new probability
+        if (logBanditBlocks)
+            writeBanditBlock();
+        banditStats.block++;
 
-        // If repeats not allowed, ensure new prob is different
-        if (!allowBlockRepeat)
+        if (banditPlanned)
         {
-            while (new_prob == prob_left)
+            if (banditBlock + 1 == MAX_BANDIT_BLOCKS)
+            {
+                drawBanditBlocks(true);
+                startBanditBlock(0);
+            }
+            else
             {
-                new_prob = probs[random(0, 2)];
+                startBanditBlock(banditBlock + 1);
             }
         }
+        else // no plan yet, draw one from pelletsToSwitch and allowBlockRepeat that follows the sketch's block
+        {
+            FED3_BanditConfig config = {standardSets, 2, (uint16_t)pelletsToSwitch, (uint16_t)pelletsToSwitch, allowBlockRepeat, 0};
+            planBandit(config, true);
+        }
+    }
+}
 
-        // Update probabilities (always sum to 100)
-        prob_left = new_prob;
-        prob_right = 100 - prob_left;
+void FED3::countBanditChoice(bool left)
+{
+    if (left)
+        banditStats.leftChoices++;
+    else
+        banditStats.rightChoices++;
+    if ((left && prob_left > prob_right) || (!left && prob_right > prob_left))
+        banditStats.highChoices++;
+}
+
+// One row per block in BLK###_MMDDYY_NN.CSV next to the log file
+void FED3::writeBanditBlock()
+{
+    char blockFile[21];
+    strcpy(blockFile, filename);
+    memcpy(blockFile, "BLK", 3);
+
+    SdFile blockfile;
+    if (!blockfile.open(blockFile, O_WRITE | O_CREAT | O_APPEND))
+        return;
+    if (blockfile.fileSize() == 0)
+    {
+        blockfile.println("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Block,Prob_left,Prob_right,Pellets,Left_Choices,Right_Choices,High_Choice_Fraction,Block_Time_s");
     }
+
+    char stamp[FED3_STAMP_CHARS];
+    formatStamp(stamp, rtc.now());
+    unsigned int choices = banditStats.leftChoices + banditStats.rightChoices;
+
+    blockfile.print(stamp);
+    blockfile.print(",");
+    blockfile.print(VER);
+    blockfile.print(",");
+    blockfile.print(sessiontype);
+    blockfile.print(",");
+    blockfile.print(FED);
+    blockfile.print(",");
+    blockfile.print(banditStats.block);
+    blockfile.print(",");
+    blockfile.print(prob_left);
+    blockfile.print(",");
+    blockfile.print(prob_right);
+    blockfile.print(",");
+    blockfile.print(banditStats.rewards);
+    blockfile.print(",");
+    blockfile.print(banditStats.leftChoices);
+    blockfile.print(",");
+    blockfile.print(banditStats.rightChoices);
+    blockfile.print(",");
+    if (choices > 0)
+        blockfile.print((float)banditStats.highChoices / choices, 3);
+    else
+        blockfile.print(sqrt(-1));
+    blockfile.print(",");
+    blockfile.println((deadlineClock() - banditStats.startMs) / 1000.0, 1);
+    blockfile.sync();
+    blockfile.close();
+    noteSdSync();
 }
 
 // Handle Bandit-specific poke behavior
@@ -53,15 +229,17 @@ bool FED3::handleBanditPoke(bool isLeftPoke)
         logRightPoke();
         Event = "Right";
     }
+    countBanditChoice(isLeftPoke);
 
     delay(1000); // Standard delay after poke
 
     // Check if reward should be delivered based on probability
-    if (random(100) < poke_prob)
+    if ((int)randomBelow(100) < poke_prob)
     {
         ConditionedStimulus(); // Visual/audio feedback
         Feed();                // Deliver pellet
         BlockPelletCount++;    // Increment block counter
+        banditStats.rewards++;
         success = true;
     }
     else
@@ -71,4 +249,4 @@ bool FED3::handleBanditPoke(bool isLeftPoke)
     }
 
     return success;
-}
\ No newline at end of file
+}
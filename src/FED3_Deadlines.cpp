@@ -0,0 +1,136 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Deadlines
+**************************************************************************************************************************************************/
+// goToSleep() sleeps until the earliest armed deadline instead of waking on a fixed interval.
+// The library arms slots for its own periodic work and sketches can use the slots from DEADLINE_SKETCH up, e.g.:
+//
+//   fed3.setDeadline(DEADLINE_SKETCH, 1000);   // wake up in 1 s
+//   ...
+//   if (fed3.deadlinePassed(DEADLINE_SKETCH)) { ... }
+
+// Time base for deadlines. millis() stops while the M0 is in standby, so the time spent asleep is added back.
+unsigned long FED3::deadlineClock()
+{
+#if defined(ESP32)
+    return millis();
+#else
+    return millis() + sleptMs;
+#endif
+}
+
+void FED3::setDeadline(byte id, unsigned long delayMs)
+{
+    if (id >= MAX_DEADLINES)
+        return;
+    deadlineAt[id] = deadlineClock() + delayMs;
+    deadlinesActive |= (1 << id);
+}
+
+void FED3::clearDeadline(byte id)
+{
+    if (id >= MAX_DEADLINES)
+        return;
+    deadlinesActive &= ~(1 << id);
+}
+
+bool FED3::deadlinePassed(byte id)
+{
+    if (id >= MAX_DEADLINES || !(deadlinesActive & (1 << id)))
+        return false;
+    if ((long)(deadlineClock() - deadlineAt[id]) < 0)
+        return false;
+    clearDeadline(id);
+    return true;
+}
+
+// Milliseconds until the earliest armed deadline, 0 if one has already passed, maxSleepMs if none is armed
+unsigned long FED3::msToNextDeadline()
+{
+    unsigned long now = deadlineClock();
+    unsigned long next = maxSleepMs;
+    for (byte id = 0; id < MAX_DEADLINES; id++)
+    {
+        if (!(deadlinesActive & (1 << id)))
+            continue;
+        long remaining = (long)(deadlineAt[id] - now);
+        if (remaining <= 0)
+            return 0;
+        if ((unsigned long)remaining < next)
+            next = remaining;
+    }
+    return next;
+}
+
+// Deadlines for the library's own periodic work, re-armed every time the device goes to sleep
+void FED3::scheduleLibraryDeadlines()
+{
+    // The display shows hours and minutes, so redraw the clock (and battery) on the next minute
+    setDeadline(DEADLINE_DISPLAY, (60 - currentSecond) * 1000UL);
+
+    // Wake on the next start or end of a timed feeding window
+    if (DisplayTimed == true)
+    {
+        long nowSeconds = currentHour * 3600L + currentMinute * 60L + currentSecond;
+        long toStart = ((timedStart * 3600L - nowSeconds) + 86400L) % 86400L;
+        long toEnd = ((timedEnd * 3600L - nowSeconds) + 86400L) % 86400L;
+        long toEdge = (toStart > 0 && (toStart < toEnd || toEnd == 0)) ? toStart : toEnd;
+        if (toEdge == 0)
+            toEdge = 86400L;
+        setDeadline(DEADLINE_TIMED_FEEDING, toEdge * 1000UL);
+    }
+    else
+    {
+        clearDeadline(DEADLINE_TIMED_FEEDING);
+    }
+
+#if defined(ESP32)
+    // The pellet well does not wake the ESP32, so keep checking it while a pellet is waiting
+    if (PelletAvailable)
+        setDeadline(DEADLINE_PELLET_CHECK, 5000);
+    else
+        clearDeadline(DEADLINE_PELLET_CHECK);
+#endif
+}
+
+float FED3::sleepResidency()
+{
+    unsigned long total = deadlineClock();
+    if (total == 0)
+        return 0.0;
+    return (float)sleptMs / total; // deadlineClock() already includes the time asleep
+}
+
+// The time on the deadlineClock() scale by the RTC, for measuring a sleep on the M0. The RTC only counts whole seconds,
+// so count them from one reading whose second was placed on deadlineClock() while awake (see alignRtcClock()), rather
+// than from a reading at the start of each sleep. The result is within a second of the time whatever the clock has
+// gathered, so errors do not add up over thousands of wakeups.
+unsigned long FED3::rtcClockMs()
+{
+    return rtcSecondLo + (rtcSecondHi - rtcSecondLo) / 2 + (rtc.now().unixtime() - rtcSecondUnix) * 1000UL + 500UL;
+}
+
+// Places an RTC second on deadlineClock(): it began between rtcSecondLo and rtcSecondHi. Readings narrow that down
+// until the first sleep, after which deadlineClock() is itself partly measured with the RTC. Starts over when the RTC
+// was set and no longer fits by more than a few seconds.
+void FED3::alignRtcClock()
+{
+    uint32_t now = rtc.now().unixtime();
+    unsigned long clock = deadlineClock();
+    unsigned long hi = clock - (now - rtcSecondUnix) * 1000UL; // second "now" began up to 999 ms before the reading
+    unsigned long lo = hi - 999UL;
+    if (rtcSecondUnix == 0 || now < rtcSecondUnix || (long)(hi - rtcSecondLo) < -3000L || (long)(lo - rtcSecondHi) > 3000L)
+    {
+        rtcSecondUnix = now;
+        rtcSecondLo = clock - 999UL;
+        rtcSecondHi = clock;
+    }
+    else if (sleptMs == 0)
+    {
+        if ((long)(lo - rtcSecondLo) > 0)
+            rtcSecondLo = lo;
+        if ((long)(hi - rtcSecondHi) < 0)
+            rtcSecondHi = hi;
+    }
+}
@@ -4,15 +4,19 @@
                                                                                                Display functions
 **************************************************************************************************************************************************/
 void FED3::UpdateDisplay()
+{
+    drawMainScreen();
+    display.refresh();
+}
+
+void FED3::drawMainScreen()
 {
     // Box around data area of screen
     display.drawRect(5, 45, 158, 70, BLACK);
 
     display.setCursor(5, 15);
-    display.print("FED:");
-    display.println(FED);
-    display.setCursor(6, 15); // this doubling is a way to do bold type
-    display.print("FED:");
+    display.printFast("FED:", true); // bold
+    display.printFast(FED);
     display.fillRect(6, 20, 200, 22, WHITE);  // erase text under battery row without clearing the entire screen
     display.fillRect(35, 46, 120, 68, WHITE); // erase the pellet data on screen without clearing the entire screen
     display.setCursor(5, 36);                 // display which sketch is running
@@ -27,32 +31,177 @@ void FED3::UpdateDisplay()
     display.print(sessiontype.charAt(6));
     display.print(sessiontype.charAt(7));
 
-    if (DisplayPokes == 1)
+    if (displayStats)
     {
-        display.setCursor(35, 65);
-        display.print("Left: ");
-        display.setCursor(95, 65);
-        display.print(LeftCount);
-        display.setCursor(35, 85);
-        display.print("Right:  ");
-        display.setCursor(95, 85);
-        display.print(RightCount);
+        drawStatsPanel();
     }
+    else
+    {
+        if (DisplayPokes == 1)
+        {
+            display.setCursor(35, 65);
+            display.printFast("Left: ");
+            display.setCursor(95, 65);
+            display.printFast(LeftCount);
+            display.setCursor(35, 85);
+            display.printFast("Right:  ");
+            display.setCursor(95, 85);
+            display.printFast(RightCount);
+        }
 
-    display.setCursor(35, 105);
-    display.print("Pellets:");
-    display.setCursor(95, 105);
-    display.print(PelletCount);
+        display.setCursor(35, 105);
+        display.printFast("Pellets:");
+        display.setCursor(95, 105);
+        display.printFast(PelletCount);
 
-    if (DisplayTimed == true)
-    { // If it's a timed Feeding Session
-        DisplayTimedFeeding();
+        if (DisplayTimed == true)
+        { // If it's a timed Feeding Session
+            DisplayTimedFeeding();
+        }
     }
 
     DisplayBattery();
     DisplayDateTime();
     DisplayIndicators();
+}
+
+// Session statistics in the data area: pellets in each of the last 24 clock hours, the current hour on the
+// right, and the rolling hour, retrieval time and meals below
+void FED3::drawStatsPanel()
+{
+    uint16_t most = 1;
+    for (byte h = 0; h < STATS_HOURS; h++)
+    {
+        uint16_t pellets = statsHour(h).pellets;
+        if (pellets > most)
+            most = pellets;
+    }
+    for (byte h = 0; h < STATS_HOURS; h++)
+    {
+        int height = (long)statsHour(h).pellets * 34 / most;
+        if (height > 0)
+            display.fillRect(35 + (STATS_HOURS - 1 - h) * 5, 84 - height, 4, height, BLACK);
+    }
+    display.drawFastHLine(35, 85, 119, BLACK);
+
+    display.setFont(&Org_01);
+    display.setTextSize(1);
+    display.setCursor(35, 94);
+    display.print("1H: ");
+    display.print(pelletsLastHour());
+    display.print(" PEL ");
+    display.print(pokesLastHour());
+    display.print(" POKES");
+    display.setCursor(35, 103);
+    display.print("RET ");
+    display.print(retrievalMean(), 1);
+    display.print(" SD ");
+    display.print(retrievalSD(), 1);
+    display.print(" S");
+    display.setCursor(35, 112);
+    display.print("MEALS ");
+    display.print(mealCount);
+    display.print(" MAX ");
+    display.print(most);
+    display.print("/H");
+    display.setFont(&FreeSans9pt7b);
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Display scheduler
+**************************************************************************************************************************************************/
+// The poke and feed paths only record what changed on screen. serviceDisplay() coalesces these requests
+// and renders them together, so a slow LCD transfer never sits between an event and its log entry.
+#define DISPLAY_PENDING_SCREEN 0x01
+#define DISPLAY_PENDING_INTERVAL 0x02
+#define DISPLAY_PENDING_REFRESH 0x04
+
+// What the main screen shows. run() only asks for a frame when it changes, and a request only counts as
+// coalesced when it replaces a pending one with a different screen.
+uint32_t FED3::mainScreenKey()
+{
+    uint32_t values[] = {(uint32_t)LeftCount, (uint32_t)RightCount, (uint32_t)PelletCount, (uint32_t)FED,
+                         (uint32_t)(unixtime / 60), (uint32_t)(measuredvbat * 100), (uint32_t)numMotorTurns, (uint32_t)activePoke,
+                         (uint32_t)(DisplayPokes | DisplayTimed << 1 | displayStats << 2), (uint32_t)timedStart,
+                         (uint32_t)timedEnd, rollingPellets, rollingPokes, (uint32_t)mealCount, (uint32_t)statsRetrievals};
+    uint32_t key = 2166136261UL; // FNV-1a over the values and the session name
+    for (byte i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        key = (key ^ values[i]) * 16777619UL;
+    for (unsigned int i = 0; i < sessiontype.length() && i < 8; i++)
+        key = (key ^ (uint8_t)sessiontype.charAt(i)) * 16777619UL;
+    return key;
+}
+
+void FED3::requestDisplayUpdate()
+{
+    uint32_t key = mainScreenKey();
+    if ((displayPending & DISPLAY_PENDING_SCREEN) && key != pendingScreenKey)
+        displayUpdatesCoalesced++;
+    pendingScreenKey = key;
+    displayPending |= DISPLAY_PENDING_SCREEN;
+}
+
+int FED3::intervalValue(byte interval)
+{
+    if (interval == DISPLAY_RETRIEVAL_INTERVAL)
+        return retInterval;
+    if (interval == DISPLAY_LEFT_INTERVAL)
+        return leftInterval;
+    if (interval == DISPLAY_RIGHT_INTERVAL)
+        return rightInterval;
+    return -1;
+}
+
+// The pending frame draws the interval's value at render time, so asking again for the same interval
+// changes nothing
+void FED3::requestIntervalDisplay(byte interval)
+{
+    if (displayPending & DISPLAY_PENDING_INTERVAL)
+    {
+        if (interval == displayInterval)
+            return;
+        displayUpdatesCoalesced++;
+    }
+    else if (interval == displayInterval && intervalValue(interval) == shownInterval)
+    {
+        return; // already on screen
+    }
+    displayInterval = interval;
+    displayPending |= DISPLAY_PENDING_INTERVAL;
+}
+
+void FED3::requestDisplayRefresh()
+{
+    if (displayPending && !(displayPending & DISPLAY_PENDING_REFRESH))
+        displayUpdatesCoalesced++;
+    displayPending |= DISPLAY_PENDING_REFRESH;
+}
+
+void FED3::serviceDisplay(bool force)
+{
+    if (displayPending == 0)
+        return;
+    if (!force && displayFrameRate > 0 && millis() - lastDisplayFrame < 1000UL / displayFrameRate)
+        return;
+
+    unsigned long renderStart = micros();
+    byte pending = displayPending;
+    displayPending = 0;
+
+    if (pending & DISPLAY_PENDING_SCREEN)
+    {
+        shownScreenKey = mainScreenKey();
+        drawMainScreen();
+    }
+    if (pending & DISPLAY_PENDING_INTERVAL)
+        drawIntervalText();
     display.refresh();
+
+    unsigned long renderTime = micros() - renderStart;
+    if (renderTime > displayWorstRenderUs)
+        displayWorstRenderUs = renderTime;
+    displayFramesRendered++;
+    lastDisplayFrame = millis();
 }
 
 void FED3::SetClock()
@@ -96,14 +245,14 @@ void FED3::SetClock()
 
     if (digitalRead(LEFT_POKE) == LOW)
     {
-        tone(BUZZER, 800, 1);
+        Tone(800, 1);
         rtc.adjust(DateTime(unixtime - 60));
         EndTime = millis();
     }
 
     if (digitalRead(RIGHT_POKE) == LOW)
     {
-        tone(BUZZER, 800, 1);
+        Tone(800, 1);
         rtc.adjust(DateTime(unixtime + 60));
         EndTime = millis();
     }
@@ -117,19 +266,10 @@ void FED3::DisplayDateTime()
     // Print to display
     display.setCursor(0, 135);
     display.fillRect(0, 123, 200, 60, WHITE);
-    display.print(now.month());
-    display.print("/");
-    display.print(now.day());
-    display.print("/");
-    display.print(now.year());
-    display.print("      ");
-    if (now.hour() < 10)
-        display.print('0'); // Trick to add leading zero for formatting
-    display.print(now.hour());
-    display.print(":");
-    if (now.minute() < 10)
-        display.print('0'); // Trick to add leading zero for formatting
-    display.print(now.minute());
+    char dateTime[28];
+    snprintf(dateTime, sizeof(dateTime), "%d/%d/%d      %02d:%02d",
+             now.month(), now.day(), now.year(), now.hour(), now.minute());
+    display.printFast(dateTime);
 }
 
 void FED3::DisplayIndicators()
@@ -235,75 +375,83 @@ void FED3::DisplayJamClear()
 // Display pellet retrieval interval
 void FED3::DisplayRetrievalInt()
 {
-    display.fillRect(85, 22, 70, 15, WHITE);
-    display.setCursor(90, 36);
-    if (retInterval < 59000)
-    {
-        display.print(retInterval);
-        display.print("ms");
-    }
+    displayInterval = DISPLAY_RETRIEVAL_INTERVAL;
+    drawIntervalText();
     display.refresh();
 }
 
 // Display left poke duration
 void FED3::DisplayLeftInt()
 {
-    display.fillRect(85, 22, 70, 15, WHITE);
-    display.setCursor(90, 36);
-    if (leftInterval < 10000)
-    {
-        display.print(leftInterval);
-        display.print("ms");
-    }
+    displayInterval = DISPLAY_LEFT_INTERVAL;
+    drawIntervalText();
     display.refresh();
 }
 
 // Display right poke duration
 void FED3::DisplayRightInt()
 {
+    displayInterval = DISPLAY_RIGHT_INTERVAL;
+    drawIntervalText();
+    display.refresh();
+}
+
+// Draw the interval selected by displayInterval next to the session name
+void FED3::drawIntervalText()
+{
+    int interval = intervalValue(displayInterval);
+    int limit = displayInterval == DISPLAY_RETRIEVAL_INTERVAL ? 59000 : 10000;
+    if (interval < 0)
+        return;
+    shownInterval = interval;
+
     display.fillRect(85, 22, 70, 15, WHITE);
     display.setCursor(90, 36);
-    if (rightInterval < 10000)
+    if (interval < limit)
     {
-        display.print(rightInterval);
-        display.print("ms");
+        display.printFast(interval);
+        display.printFast("ms");
     }
-    display.refresh();
 }
 
 void FED3::StartScreen()
 {
     if (ClassicFED3 == false)
     {
-        display.setTextSize(3);
-        display.setTextColor(BLACK);
-        display.clearDisplay();
-        display.setCursor(15, 55);
-        display.print("FED3");
-
-        // print filename on screen
-        display.setTextSize(1);
-        display.setCursor(2, 138);
-        display.print(filename);
-
-        // Display FED verison number at startup
-        display.setCursor(2, 120);
-        display.print("v: ");
-        display.print(VER);
-        display.print("_");
-        display.print(sessiontype.charAt(0));
-        display.print(sessiontype.charAt(1));
-        display.print(sessiontype.charAt(2));
-        display.print(sessiontype.charAt(3));
-        display.print(sessiontype.charAt(4));
-        display.print(sessiontype.charAt(5));
-        display.print(sessiontype.charAt(6));
-        display.print(sessiontype.charAt(7));
+        drawStartScreen();
         display.refresh();
         DisplayMouse();
     }
 }
 
+void FED3::drawStartScreen()
+{
+    display.setTextSize(3);
+    display.setTextColor(BLACK);
+    display.clearDisplay();
+    display.setCursor(15, 55);
+    display.print("FED3");
+
+    // print filename on screen
+    display.setTextSize(1);
+    display.setCursor(2, 138);
+    display.print(filename);
+
+    // Display FED verison number at startup
+    display.setCursor(2, 120);
+    display.print("v: ");
+    display.print(VER);
+    display.print("_");
+    display.print(sessiontype.charAt(0));
+    display.print(sessiontype.charAt(1));
+    display.print(sessiontype.charAt(2));
+    display.print(sessiontype.charAt(3));
+    display.print(sessiontype.charAt(4));
+    display.print(sessiontype.charAt(5));
+    display.print(sessiontype.charAt(6));
+    display.print(sessiontype.charAt(7));
+}
+
 void FED3::DisplayTimedFeeding()
 {
     display.setCursor(35, 65);
@@ -343,36 +491,13 @@ void FED3::DisplayNoProgram()
 
 void FED3::DisplayMouse()
 {
-    // Draw animated mouse...
-    for (int i = -50; i < 200; i += 15)
+    // Run the mouse animation while watching the pokes for menu input
+    startAnimation(ANIMATION_MOUSE, 80);
+    while (animationRunning(ANIMATION_MOUSE))
     {
-        display.fillRoundRect(i + 25, 82, 15, 10, 6, BLACK); // head
-        display.fillRoundRect(i + 22, 80, 8, 5, 3, BLACK);   // ear
-        display.fillRoundRect(i + 30, 84, 1, 1, 1, WHITE);   // eye
-        // movement of the mouse
-        if ((i / 10) % 2 == 0)
-        {
-            display.fillRoundRect(i, 84, 32, 17, 10, BLACK); // body
-            display.drawFastHLine(i - 8, 85, 18, BLACK);     // tail
-            display.drawFastHLine(i - 8, 86, 18, BLACK);
-            display.drawFastHLine(i - 14, 84, 8, BLACK);
-            display.drawFastHLine(i - 14, 85, 8, BLACK);
-            display.fillRoundRect(i + 22, 99, 8, 4, 3, BLACK); // front foot
-            display.fillRoundRect(i, 97, 8, 6, 3, BLACK);      // back foot
-        }
-        else
-        {
-            display.fillRoundRect(i + 2, 82, 30, 17, 10, BLACK); // body
-            display.drawFastHLine(i - 6, 91, 18, BLACK);         // tail
-            display.drawFastHLine(i - 6, 90, 18, BLACK);
-            display.drawFastHLine(i - 12, 92, 8, BLACK);
-            display.drawFastHLine(i - 12, 91, 8, BLACK);
-            display.fillRoundRect(i + 15, 99, 8, 4, 3, BLACK); // foot
-            display.fillRoundRect(i + 8, 97, 8, 6, 3, BLACK);  // back foot
-        }
-        display.refresh();
-        delay(80);
-        display.fillRect(i - 25, 73, 95, 33, WHITE);
+        noteMenuPoll();
+        serviceAnimations();
+        serviceDisplay();
         previousFEDmode = FEDmode;
         previousFED = FED;
 
@@ -386,11 +511,12 @@ void FED3::DisplayMouse()
         // If both pokes are pushed edit device number
         if ((digitalRead(LEFT_POKE) == LOW) && (digitalRead(RIGHT_POKE) == LOW))
         {
-            tone(BUZZER, 1000, 200);
+            cancelAnimations();
+            Tone(1000, 200);
             delay(400);
-            tone(BUZZER, 1000, 500);
+            Tone(1000, 500);
             delay(200);
-            tone(BUZZER, 3000, 600);
+            Tone(3000, 600);
             colorWipe(strip.Color(2, 2, 2), 40); // Color wipe
             colorWipe(strip.Color(0, 0, 0), 20); // OFF
             EndTime = millis();
@@ -398,6 +524,36 @@ void FED3::DisplayMouse()
             SetDeviceNumber();
         }
     }
+    serviceDisplay(true); // the last frame, with the mouse gone
+}
+
+// One frame of the startup mouse animation, i is the x position of the body
+void FED3::drawMouseFrame(int i)
+{
+    display.fillRoundRect(i + 25, 82, 15, 10, 6, BLACK); // head
+    display.fillRoundRect(i + 22, 80, 8, 5, 3, BLACK);   // ear
+    display.fillRoundRect(i + 30, 84, 1, 1, 1, WHITE);   // eye
+    // movement of the mouse
+    if ((i / 10) % 2 == 0)
+    {
+        display.fillRoundRect(i, 84, 32, 17, 10, BLACK); // body
+        display.drawFastHLine(i - 8, 85, 18, BLACK);     // tail
+        display.drawFastHLine(i - 8, 86, 18, BLACK);
+        display.drawFastHLine(i - 14, 84, 8, BLACK);
+        display.drawFastHLine(i - 14, 85, 8, BLACK);
+        display.fillRoundRect(i + 22, 99, 8, 4, 3, BLACK); // front foot
+        display.fillRoundRect(i, 97, 8, 6, 3, BLACK);      // back foot
+    }
+    else
+    {
+        display.fillRoundRect(i + 2, 82, 30, 17, 10, BLACK); // body
+        display.drawFastHLine(i - 6, 91, 18, BLACK);         // tail
+        display.drawFastHLine(i - 6, 90, 18, BLACK);
+        display.drawFastHLine(i - 12, 92, 8, BLACK);
+        display.drawFastHLine(i - 12, 91, 8, BLACK);
+        display.fillRoundRect(i + 15, 99, 8, 4, 3, BLACK); // foot
+        display.fillRoundRect(i + 8, 97, 8, 6, 3, BLACK);  // back foot
+    }
 }
 
 // Display text when FED is clearing a jam
@@ -468,19 +624,139 @@ void FED3::DisplayText(const String &text, int x, int y, bool clear_area, bool b
             remaining = "";
         }
 
-        // Draw the line
+        // Draw the line, bold glyphs are one pixel wider
         display.setCursor(x, currentY);
-        display.print(line);
+        display.printFast(line.c_str(), bold);
+
+        currentY += lineHeight;
+    }
+
+    display.refresh();
+}
 
-        // If bold, draw again with slight offset
-        if (bold)
+/**************************************************************************************************************************************************
+                                                                                               Screen capture
+**************************************************************************************************************************************************/
+// Screens drawn by captureScreens(), in order
+#define CAPTURE_MAIN 0
+#define CAPTURE_MAIN_TIMED 1
+#define CAPTURE_START 2
+#define CAPTURE_SD_ERROR 3
+#define CAPTURE_JAM_CLEAR 4
+#define CAPTURE_JAMMED 5
+#define CAPTURE_MAIN_STATS 6
+#define CAPTURE_MENUS 7 // followed by one screen per mode of each menu
+
+// Draw one capture screen into the display buffer and return its name, or NULL past the last screen.
+// Screens that refresh the display themselves include that refresh in their draw time.
+const char *FED3::drawCaptureScreen(byte screen)
+{
+    switch (screen)
+    {
+    case CAPTURE_MAIN:
+        display.clearDisplay();
+        drawMainScreen();
+        return "main";
+    case CAPTURE_MAIN_TIMED:
+        display.clearDisplay();
+        DisplayTimed = true;
+        drawMainScreen();
+        return "main_timed";
+    case CAPTURE_START:
+        drawStartScreen();
+        return "start";
+    case CAPTURE_SD_ERROR:
+        DisplaySDError();
+        return "sd_error";
+    case CAPTURE_JAM_CLEAR:
+        DisplayJamClear();
+        return "jam_clear";
+    case CAPTURE_JAMMED:
+        DisplayJammed();
+        return "jammed";
+    case CAPTURE_MAIN_STATS:
+        display.clearDisplay();
+        displayStats = true;
+        drawMainScreen();
+        return "main_stats";
+    }
+
+    byte index = screen - CAPTURE_MENUS;
+    const byte menus[] = {MENU_CLASSIC, MENU_FED3, MENU_PSYGENE};
+    const char *const menuNames[] = {"classic", "fed3menu", "psygene"};
+    for (byte m = 0; m < sizeof(menus); m++)
+    {
+        if (index < menuModeCount(menus[m]))
         {
-            display.setCursor(x + 1, currentY);
-            display.print(line);
+            FEDmode = index;
+            drawMenuScreen(menus[m]);
+            static char name[20];
+            snprintf(name, sizeof(name), "%s_%d", menuNames[m], index);
+            return name;
         }
+        index -= menuModeCount(menus[m]);
+    }
+    return NULL;
+}
 
-        currentY += lineHeight;
+/**
+ * Draws every screen and menu mode name, saving each one to the SD card as SCR_###.PBM
+ * and its draw and refresh time in microseconds to SCREENS.CSV (also printed to Serial).
+ * Useful as a baseline for display changes: the images can be compared between library versions.
+ */
+void FED3::captureScreens()
+{
+    byte savedMode = FEDmode;
+    bool savedTimed = DisplayTimed;
+    bool savedStats = displayStats;
+
+    if (!fed3SD.begin(cardSelect, SD_SCK_MHZ(SD_CLOCK_SPEED)))
+    {
+        error(ERROR_SD_INIT_FAIL);
+        return;
     }
 
-    display.refresh();
-}
\ No newline at end of file
+    SdFile timing;
+    if (!timing.open("SCREENS.CSV", O_WRITE | O_CREAT | O_TRUNC))
+    {
+        error(ERROR_WRITE_FAIL);
+        return;
+    }
+    timing.println("Screen,Name,Draw_us,Refresh_us");
+    Serial.println("Screen,Name,Draw_us,Refresh_us");
+
+    for (byte screen = 0;; screen++)
+    {
+        unsigned long drawStart = micros();
+        const char *name = drawCaptureScreen(screen);
+        if (name == NULL)
+            break;
+        unsigned long drawTime = micros() - drawStart;
+
+        unsigned long refreshStart = micros();
+        display.refresh();
+        unsigned long refreshTime = micros() - refreshStart;
+
+        char image[13];
+        snprintf(image, sizeof(image), "SCR_%03d.PBM", screen);
+        SdFile pbm;
+        if (pbm.open(image, O_WRITE | O_CREAT | O_TRUNC))
+        {
+            display.writePBM(pbm);
+            pbm.close();
+        }
+
+        char row[48];
+        snprintf(row, sizeof(row), "%d,%s,%lu,%lu", screen, name, drawTime, refreshTime);
+        timing.println(row);
+        Serial.println(row);
+
+        FEDmode = savedMode;
+        DisplayTimed = savedTimed;
+        displayStats = savedStats;
+    }
+    timing.close();
+
+    display.clearDisplay();
+    UpdateDisplay();
+}
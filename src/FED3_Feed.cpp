@@ -28,13 +28,16 @@ void FED3::Feed(int pulse, bool pixelsoff)
             pelletTime = millis();
 
             display.fillCircle(25, 99, 5, BLACK);
-            display.refresh();
+            requestDisplayRefresh();
             retInterval = (millis() - pelletTime);
             // while pellet is present and under 60s has elapsed
             while (digitalRead(PELLET_WELL) == LOW and retInterval < 60000)
             { // After pellet is detected, hang here for up to 1 minute to detect when it is removed
+                int shown = retInterval;
                 retInterval = (millis() - pelletTime);
-                DisplayRetrievalInt();
+                if (retInterval != shown)
+                    requestIntervalDisplay(DISPLAY_RETRIEVAL_INTERVAL);
+                serviceDisplay();
 
                 // Log pokes while pellet is present
                 if (digitalRead(LEFT_POKE) == LOW)
@@ -47,7 +50,7 @@ void FED3::Feed(int pulse, bool pixelsoff)
                     {
                     } // Hang here until poke is clear
                     leftInterval = (millis() - leftPokeTime);
-                    UpdateDisplay();
+                    requestDisplayUpdate();
                     Event = "LeftWithPellet";
 
                     logdata();
@@ -62,7 +65,7 @@ void FED3::Feed(int pulse, bool pixelsoff)
                     {
                     } // Hang here until poke is clear
                     rightInterval = (millis() - rightPokeTime);
-                    UpdateDisplay();
+                    requestDisplayUpdate();
                     Event = "RightWithPellet";
                     logdata();
                 }
@@ -83,7 +86,7 @@ void FED3::Feed(int pulse, bool pixelsoff)
                     {
                     } // Hang here until poke is clear
                     leftInterval = (millis() - leftPokeTime);
-                    UpdateDisplay();
+                    requestDisplayUpdate();
                     Event = "LeftWithPellet";
 
                     logdata();
@@ -99,7 +102,7 @@ void FED3::Feed(int pulse, bool pixelsoff)
                     {
                     } // Hang here until poke is clear
                     rightInterval = (millis() - rightPokeTime);
-                    UpdateDisplay();
+                    requestDisplayUpdate();
                     Event = "RightWithPellet";
 
                     logdata();
@@ -127,7 +130,7 @@ void FED3::Feed(int pulse, bool pixelsoff)
             logdata();
             numMotorTurns = 0; // reset numMotorTurns
             PelletAvailable = true;
-            UpdateDisplay();
+            requestDisplayUpdate();
 
             break;
         }
@@ -218,7 +221,7 @@ bool FED3::ClearJam()
         return true;
     }
 
-    for (int i = 0; i < 21 + random(0, 20); i++)
+    for (int i = 0; i < 21 + (int)randomBelow(20, RANDOM_HARDWARE); i++)
     {
         if (RotateDisk(-i * 4))
         {
@@ -233,7 +236,7 @@ bool FED3::ClearJam()
         return true;
     }
 
-    for (int i = 0; i < 21 + random(0, 20); i++)
+    for (int i = 0; i < 21 + (int)randomBelow(20, RANDOM_HARDWARE); i++)
     {
         if (RotateDisk(i * 4))
         {
@@ -247,7 +250,8 @@ bool FED3::ClearJam()
 
 bool FED3::RotateDisk(int steps)
 {
-    digitalWrite(MOTOR_ENABLE, HIGH); // Enable motor driver
+    motorEnable(true); // Enable motor driver
+    motorTurning = true;
     for (int i = 0; i < (steps > 0 ? steps : -steps); i++)
     {
 
@@ -264,7 +268,7 @@ bool FED3::RotateDisk(int steps)
                     break; // maxPokeTime timeout
             }
             leftInterval = (millis() - leftPokeTime);
-            UpdateDisplay();
+            requestDisplayUpdate();
             Event = "LeftDuringDispense";
 
             logdata();
@@ -283,7 +287,7 @@ bool FED3::RotateDisk(int steps)
                     break; // maxPokeTime timeout
             }
             rightInterval = (millis() - rightPokeTime);
-            UpdateDisplay();
+            requestDisplayUpdate();
             Event = "RightDuringDispense";
 
             logdata();
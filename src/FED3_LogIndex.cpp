@@ -0,0 +1,174 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Log index
+**************************************************************************************************************************************************/
+// The IDX companion of FED000_010625_00.CSV is IDX000_010625_00.IDX, a list of fixed size entries. logdata()
+// appends one for the first row after startup or a new file, then every logIndexEvery rows or an hour, whichever
+// comes first. Between entries a logged row costs a counter increment.
+//
+// An entry is only written once its row has been synced, so every entry points at a row that is on the card.
+// A power loss can cost the entries of rows that weren't synced or leave the last entry cut short, which its
+// check word shows, the reader then starts from an earlier entry. Times are taken to only go forward, after the
+// RTC is set back openLogAt() can start after some of the rows of the earlier times.
+//
+//   fed3.streamLog(fed3.now().unixtime() - 86400, Serial); // the last day of the current log
+
+void FED3::indexFilename(char *name, const char *log)
+{
+    strcpy(name, log);
+    memcpy(name, "IDX", 3);
+    char *dot = strrchr(name, '.');
+    if (dot)
+        strcpy(dot, ".IDX");
+}
+
+// Called by logdata() for every row once it has been synced
+void FED3::indexLogRow(uint32_t unixTime, uint32_t offset)
+{
+    bool due = !logIndexStarted || logIndexRows >= logIndexEvery || unixTime - logIndexUnix >= LOG_INDEX_SECONDS;
+    logIndexRows++;
+    if (!due)
+        return;
+
+    char indexFile[21];
+    indexFilename(indexFile, filename);
+    SdFile index;
+    if (!index.open(indexFile, O_WRITE | O_CREAT | O_APPEND))
+        return;
+    // A torn entry at the end would shift the ones after it
+    if (index.fileSize() % sizeof(FED3_LogIndexEntry))
+        index.truncate(index.fileSize() - index.fileSize() % sizeof(FED3_LogIndexEntry));
+    index.seekEnd();
+
+    FED3_LogIndexEntry entry = {unixTime, offset, (uint32_t)(unixTime ^ offset ^ LOG_INDEX_CHECK)};
+    index.write((const uint8_t *)&entry, sizeof(entry));
+    index.sync();
+    noteSdSync();
+    index.close();
+    logIndexStarted = true;
+    logIndexRows = 1;
+    logIndexUnix = unixTime;
+}
+
+bool FED3::readIndexEntry(SdFile &index, uint32_t i, FED3_LogIndexEntry &entry)
+{
+    return index.seekSet(i * sizeof(FED3_LogIndexEntry)) &&
+           index.read(&entry, sizeof(entry)) == (int)sizeof(entry) &&
+           entry.check == (entry.unixTime ^ entry.offset ^ LOG_INDEX_CHECK);
+}
+
+// Time at the start of a row, "M/D/YYYY h:mm:ss", false for the header
+bool FED3::rowTime(const char *row, uint32_t &unixTime)
+{
+    int field[6];
+    const char separators[] = "// ::";
+    for (byte i = 0; i < 6; i++)
+    {
+        if (*row < '0' || *row > '9')
+            return false;
+        char *end;
+        field[i] = strtol(row, &end, 10);
+        if (i < 5 && *end != separators[i])
+            return false;
+        row = end + 1;
+    }
+    unixTime = DateTime(field[2], field[0], field[1], field[3], field[4], field[5]).unixtime();
+    return true;
+}
+
+// Opens a log at its first row from unixTime on. Starts from the last index entry before that time, or from the
+// top of the file when there is no index.
+bool FED3::openLogAt(uint32_t unixTime, const char *name)
+{
+    if (name == NULL)
+        name = filename;
+    closeLog();
+    if (!logReader.open(name, O_READ))
+        return false;
+
+    uint32_t start = 0;
+    char indexFile[21];
+    indexFilename(indexFile, name);
+    SdFile index;
+    if (index.open(indexFile, O_READ))
+    {
+        // Last entry at or before unixTime, an entry that doesn't check out counts as later
+        uint32_t lo = 0, hi = index.fileSize() / sizeof(FED3_LogIndexEntry);
+        FED3_LogIndexEntry entry;
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (readIndexEntry(index, mid, entry) && entry.unixTime <= unixTime)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo > 0 && readIndexEntry(index, lo - 1, entry) && entry.offset < logReader.fileSize())
+            start = entry.offset;
+        index.close();
+    }
+
+    // The entry must point at the start of a row
+    if (start > 0)
+    {
+        logReader.seekSet(start - 1);
+        if (logReader.read() != '\n')
+            start = 0;
+    }
+    logReader.seekSet(start);
+
+    char row[24];
+    for (;;)
+    {
+        uint32_t position = logReader.curPosition();
+        if (readLogRow(row, sizeof(row)) < 0)
+            return true; // nothing from that time on, the reader is at the end
+        uint32_t t;
+        if (rowTime(row, t) && t >= unixTime)
+        {
+            logReader.seekSet(position);
+            return true;
+        }
+    }
+}
+
+int FED3::readLogRow(char *row, int size)
+{
+    if (!logReader.isOpen() || size <= 0)
+        return -1;
+    int n = 0;
+    int c;
+    bool any = false;
+    while ((c = logReader.read()) >= 0)
+    {
+        any = true;
+        if (c == '\n')
+            break;
+        if (c != '\r' && n < size - 1)
+            row[n++] = c;
+    }
+    row[n] = 0;
+    return any ? n : -1;
+}
+
+void FED3::closeLog()
+{
+    if (logReader.isOpen())
+        logReader.close();
+}
+
+unsigned long FED3::streamLog(uint32_t unixTime, Print &out, const char *name)
+{
+    if (!openLogAt(unixTime, name))
+        return 0;
+    unsigned long rows = 0;
+    char row[256];
+    while (readLogRow(row, sizeof(row)) >= 0)
+    {
+        out.println(row);
+        rows++;
+    }
+    closeLog();
+    return rows;
+}
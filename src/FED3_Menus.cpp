@@ -35,8 +35,8 @@ void FED3::ClassicMenu()
     { // Extinction
         FR = 1;
         ReleaseMotor();
-        digitalWrite(MOTOR_ENABLE, LOW); // disable motor driver and neopixels
-        delay(2);                        // let things settle
+        motorEnable(false); // disable motor driver and neopixels
+        delay(2);           // let things settle
     }
     if (FEDmode == 6)
         FR = 1; // Light tracking
@@ -49,41 +49,7 @@ void FED3::ClassicMenu()
     if (FEDmode == 10)
         FR = 1; // self-stim (reversed)
 
-    display.clearDisplay();
-    display.setCursor(1, 135);
-    display.print(filename);
-
-    display.fillRect(0, 30, 160, 80, WHITE);
-    display.setCursor(10, 40);
-    display.print("Select Program:");
-
-    display.setCursor(10, 60);
-    // Text to display selected FR ratio
-    if (FEDmode == 0)
-        display.print("Free feeding");
-    if (FEDmode == 1)
-        display.print("FR1");
-    if (FEDmode == 2)
-        display.print("FR3");
-    if (FEDmode == 3)
-        display.print("FR5");
-    if (FEDmode == 4)
-        display.print("Progressive Ratio");
-    if (FEDmode == 5)
-        display.print("Extinction");
-    if (FEDmode == 6)
-        display.print("Light tracking");
-    if (FEDmode == 7)
-        display.print("FR1 (Reversed)");
-    if (FEDmode == 8)
-        display.print("Prog Ratio (Rev)");
-    if (FEDmode == 9)
-        display.print("Self-Stim");
-    if (FEDmode == 10)
-        display.print("Self-Stim (Rev)");
-    if (FEDmode == 11)
-        display.print("Timed feeding");
-
+    drawMenuScreen(MENU_CLASSIC);
     DisplayMouse();
     display.clearDisplay();
     display.refresh();
@@ -92,153 +58,100 @@ void FED3::ClassicMenu()
 // Mode selection handling
 void FED3::SelectMode()
 {
-    // Mode select on startup screen
-    // If both pokes are activated
-    if ((digitalRead(LEFT_POKE) == LOW) && (digitalRead(RIGHT_POKE) == LOW))
+    // Mode select on startup screen. Each poke steps the mode, and the mode is selected once
+    // no poke has been seen for 1.5 seconds. The light wipe after a poke paces repeats while a
+    // poke is held, without blocking the screen or the poke inputs.
+    do
     {
-        tone(BUZZER, 3000, 500);
-        colorWipe(strip.Color(2, 2, 2), 40); // Color wipe
-        colorWipe(strip.Color(0, 0, 0), 20); // OFF
-        EndTime = millis();
-        SetFED = true;
-        setTimed = true;
-        SetDeviceNumber();
-    }
+        noteMenuPoll();
+        serviceAnimations();
+        if (animationRunning(ANIMATION_COLOR_WIPE))
+            continue;
 
-    // If Left Poke is activated
-    else if (digitalRead(LEFT_POKE) == LOW)
-    {
-        EndTime = millis();
-        FEDmode -= 1;
-        tone(BUZZER, 2500, 200);
-        colorWipe(strip.Color(2, 0, 2), 40); // Color wipe
-        colorWipe(strip.Color(0, 0, 0), 20); // OFF
+        // If both pokes are activated
+        if ((digitalRead(LEFT_POKE) == LOW) && (digitalRead(RIGHT_POKE) == LOW))
+        {
+            Tone(3000, 500);
+            colorWipe(strip.Color(2, 2, 2), 40); // Color wipe
+            colorWipe(strip.Color(0, 0, 0), 20); // OFF
+            EndTime = millis();
+            SetFED = true;
+            setTimed = true;
+            SetDeviceNumber();
+        }
 
-        if (psygene)
+        // If Left Poke is activated
+        else if (digitalRead(LEFT_POKE) == LOW)
         {
-            if (FEDmode == -1)
-                FEDmode = 3;
+            EndTime = millis();
+            FEDmode -= 1;
+            Tone(2500, 200);
+            startColorWipe(strip.Color(2, 0, 2), 40); // Color wipe
+            startColorWipe(strip.Color(0, 0, 0), 20); // OFF
+
+            if (psygene)
+            {
+                if (FEDmode == -1)
+                    FEDmode = 3;
+            }
+            else
+            {
+                if (FEDmode == -1)
+                    FEDmode = 11;
+            }
+        }
+
+        // If Right Poke is activated
+        else if (digitalRead(RIGHT_POKE) == LOW)
+        {
+            EndTime = millis();
+            FEDmode += 1;
+            Tone(2500, 200);
+            startColorWipe(strip.Color(2, 2, 0), 40); // Color wipe
+            startColorWipe(strip.Color(0, 0, 0), 20); // OFF
+
+            if (psygene)
+            {
+                if (FEDmode == 4)
+                    FEDmode = 0;
+            }
+            else
+            {
+                if (FEDmode == 12)
+                    FEDmode = 0;
+            }
         }
         else
         {
-            if (FEDmode == -1)
-                FEDmode = 11;
+            continue;
         }
-    }
-
-    // If Right Poke is activated
-    else if (digitalRead(RIGHT_POKE) == LOW)
-    {
-        EndTime = millis();
-        FEDmode += 1;
-        tone(BUZZER, 2500, 200);
-        colorWipe(strip.Color(2, 2, 0), 40); // Color wipe
-        colorWipe(strip.Color(0, 0, 0), 20); // OFF
 
+        // Double check that modes never go over bounds
         if (psygene)
         {
-            if (FEDmode == 4)
+            if (FEDmode < 0)
                 FEDmode = 0;
+            if (FEDmode > 3)
+                FEDmode = 3;
         }
         else
         {
-            if (FEDmode == 12)
+            if (FEDmode < 0)
                 FEDmode = 0;
+            if (FEDmode > 11)
+                FEDmode = 11;
         }
-    }
-
-    // Double check that modes never go over bounds
-    if (psygene)
-    {
-        if (FEDmode < 0)
-            FEDmode = 0;
-        if (FEDmode > 3)
-            FEDmode = 3;
-    }
-    else
-    {
-        if (FEDmode < 0)
-            FEDmode = 0;
-        if (FEDmode > 11)
-            FEDmode = 11;
-    }
 
-    display.fillRect(10, 48, 200, 50, WHITE); // erase the selected program text
-    display.setCursor(10, 60);                // Display selected program
-
-    // Display mode names based on menu type
-    if (ClassicFED3 == true)
-    {
-        if (FEDmode == 0)
-            display.print("Free feeding");
-        if (FEDmode == 1)
-            display.print("FR1");
-        if (FEDmode == 2)
-            display.print("FR3");
-        if (FEDmode == 3)
-            display.print("FR5");
-        if (FEDmode == 4)
-            display.print("Progressive Ratio");
-        if (FEDmode == 5)
-            display.print("Extinction");
-        if (FEDmode == 6)
-            display.print("Light tracking");
-        if (FEDmode == 7)
-            display.print("FR1 (Reversed)");
-        if (FEDmode == 8)
-            display.print("Prog Ratio (Rev)");
-        if (FEDmode == 9)
-            display.print("Self-Stim");
-        if (FEDmode == 10)
-            display.print("Self-Stim (Rev)");
-        if (FEDmode == 11)
-            display.print("Timed feeding");
-        display.refresh();
-    }
-    else if (psygene)
-    {
-        if (FEDmode == 0)
-            display.print("Bandit_100_0");
-        if (FEDmode == 1)
-            display.print("FR1");
-        if (FEDmode == 2)
-            display.print("Bandit_80_20");
-        if (FEDmode == 3)
-            display.print("PR1");
+        display.fillRect(10, 48, 200, 50, WHITE); // erase the selected program text
+        display.setCursor(10, 60);                // Display selected program
+        display.print(modeName(currentMenu(), FEDmode));
         display.refresh();
-    }
-    else
-    {
-        if (FEDmode == 0)
-            display.print("Mode 1");
-        if (FEDmode == 1)
-            display.print("Mode 2");
-        if (FEDmode == 2)
-            display.print("Mode 3");
-        if (FEDmode == 3)
-            display.print("Mode 4");
-        if (FEDmode == 4)
-            display.print("Mode 5");
-        if (FEDmode == 5)
-            display.print("Mode 6");
-        if (FEDmode == 6)
-            display.print("Mode 7");
-        if (FEDmode == 7)
-            display.print("Mode 8");
-        if (FEDmode == 8)
-            display.print("Mode 9");
-        if (FEDmode == 9)
-            display.print("Mode 10");
-        if (FEDmode == 10)
-            display.print("Mode 11");
-        if (FEDmode == 11)
-            display.print("Mode 12");
-        display.refresh();
-    }
+    } while (millis() - EndTime < 1500);
 
-    while (millis() - EndTime < 1500)
+    // let the last wipe finish before resetting
+    while (animationRunning())
     {
-        SelectMode();
+        serviceAnimations();
     }
     display.setCursor(10, 100);
     display.println("...Selected!");
@@ -249,30 +162,70 @@ void FED3::SelectMode()
     softReset(); // processor software reset
 }
 
-// Psygene menu implementation
-void FED3::psygeneMenu()
+// Mode names shown by the menus, indexed by FEDmode
+static const char *const classicModeNames[] = {
+    "Free feeding", "FR1", "FR3", "FR5", "Progressive Ratio", "Extinction",
+    "Light tracking", "FR1 (Reversed)", "Prog Ratio (Rev)", "Self-Stim", "Self-Stim (Rev)", "Timed feeding"};
+static const char *const psygeneModeNames[] = {"Bandit_100_0", "FR1", "Bandit_80_20", "PR1"};
+static const char *const fed3MenuModeNames[] = {
+    "Mode 1", "Mode 2", "Mode 3", "Mode 4", "Mode 5", "Mode 6",
+    "Mode 7", "Mode 8", "Mode 9", "Mode 10", "Mode 11", "Mode 12"};
+
+// Which menu the current flags select (MENU_CLASSIC, MENU_PSYGENE or MENU_FED3)
+byte FED3::currentMenu()
+{
+    if (ClassicFED3 == true)
+        return MENU_CLASSIC;
+    if (psygene)
+        return MENU_PSYGENE;
+    return MENU_FED3;
+}
+
+// Number of modes offered by a menu
+byte FED3::menuModeCount(byte menu)
+{
+    if (menu == MENU_PSYGENE)
+        return sizeof(psygeneModeNames) / sizeof(psygeneModeNames[0]);
+    if (menu == MENU_CLASSIC)
+        return sizeof(classicModeNames) / sizeof(classicModeNames[0]);
+    return sizeof(fed3MenuModeNames) / sizeof(fed3MenuModeNames[0]);
+}
+
+// Text displayed for a mode, empty if the mode is out of range for the menu
+const char *FED3::modeName(byte menu, byte mode)
+{
+    if (mode >= menuModeCount(menu))
+        return "";
+    if (menu == MENU_CLASSIC)
+        return classicModeNames[mode];
+    if (menu == MENU_PSYGENE)
+        return psygeneModeNames[mode];
+    return fed3MenuModeNames[mode];
+}
+
+// Draw the mode selection screen shown under the startup mouse animation
+void FED3::drawMenuScreen(byte menu)
 {
     display.clearDisplay();
     display.setCursor(1, 135);
     display.print(filename);
-    display.setCursor(10, 20);
-    display.println("Psygene Menu");
-    display.setCursor(11, 20);
-    display.println("Psygene Menu");
+    if (menu != MENU_CLASSIC)
+    {
+        display.setCursor(10, 20);
+        display.printFast(menu == MENU_PSYGENE ? "Psygene Menu" : "FED3 Menu", true); // bold
+    }
     display.fillRect(0, 30, 160, 80, WHITE);
     display.setCursor(10, 40);
-    display.print("Select Mode:");
+    display.print(menu == MENU_CLASSIC ? "Select Program:" : "Select Mode:");
 
     display.setCursor(10, 60);
-    if (FEDmode == 0)
-        display.print("Bandit_100_0");
-    if (FEDmode == 1)
-        display.print("FR1");
-    if (FEDmode == 2)
-        display.print("Bandit_80_20");
-    if (FEDmode == 3)
-        display.print("PR1");
+    display.print(modeName(menu, FEDmode));
+}
 
+// Psygene menu implementation
+void FED3::psygeneMenu()
+{
+    drawMenuScreen(MENU_PSYGENE);
     DisplayMouse();
     display.clearDisplay();
     display.refresh();
@@ -418,43 +371,7 @@ void FED3::SetDeviceNumber()
 
 void FED3::FED3MenuScreen()
 {
-    display.clearDisplay();
-    display.setCursor(1, 135);
-    display.print(filename);
-    display.setCursor(10, 20);
-    display.println("FED3 Menu");
-    display.setCursor(11, 20);
-    display.println("FED3 Menu");
-    display.fillRect(0, 30, 160, 80, WHITE);
-    display.setCursor(10, 40);
-    display.print("Select Mode:");
-
-    display.setCursor(10, 60);
-    // Text to display selected FR ratio
-    if (FEDmode == 0)
-        display.print("Mode 1");
-    if (FEDmode == 1)
-        display.print("Mode 2");
-    if (FEDmode == 2)
-        display.print("Mode 3");
-    if (FEDmode == 3)
-        display.print("Mode 4");
-    if (FEDmode == 4)
-        display.print("Mode 5");
-    if (FEDmode == 5)
-        display.print("Mode 6");
-    if (FEDmode == 6)
-        display.print("Mode 7");
-    if (FEDmode == 7)
-        display.print("Mode 8");
-    if (FEDmode == 8)
-        display.print("Mode 9");
-    if (FEDmode == 9)
-        display.print("Mode 10");
-    if (FEDmode == 10)
-        display.print("Mode 11");
-    if (FEDmode == 11)
-        display.print("Mode 12");
+    drawMenuScreen(MENU_FED3);
     DisplayMouse();
     display.clearDisplay();
     display.refresh();
@@ -468,6 +385,7 @@ void FED3::writeFEDmode()
         ratiofile.seekSet(0); // Move to the beginning of the file
         ratiofile.println(FEDmode);
         ratiofile.sync();  // Commit changes to the SD card
+        noteSdSync();
         ratiofile.close(); // Close the file
     }
     else
@@ -481,6 +399,7 @@ void FED3::writeFEDmode()
         startfile.seekSet(0);
         startfile.println(timedStart);
         startfile.sync();
+        noteSdSync();
         startfile.close();
     }
     else
@@ -494,6 +413,7 @@ void FED3::writeFEDmode()
         stopfile.seekSet(0);
         stopfile.println(timedEnd);
         stopfile.sync();
+        noteSdSync();
         stopfile.close();
     }
     else
@@ -1,83 +1,113 @@
 #include "FED3.h"
 
-// Turn all pixels on to a specific color
-void FED3::pixelsOn(int R, int G, int B, int W)
+/**************************************************************************************************************************************************
+                                                                                               Pixel frame
+**************************************************************************************************************************************************/
+// Stage a color in the strip buffer, sent by the next showPixels()
+void FED3::setPixel(byte n, uint32_t color)
 {
-    digitalWrite(MOTOR_ENABLE, HIGH); // ENABLE motor driver
-    delay(2);                         // let things settle
-    for (uint16_t i = 0; i < 8; i++)
+    if (n >= strip.numPixels() || strip.getPixelColor(n) == color)
+        return;
+    strip.setPixelColor(n, color);
+    pixelsDirty = true;
+}
+
+void FED3::fillPixels(uint32_t color, byte first, byte count)
+{
+    for (byte i = first; i < first + count; i++)
+        setPixel(i, color);
+}
+
+void FED3::clearPixels()
+{
+    fillPixels(0, 0, strip.numPixels());
+}
+
+// Send the staged frame. Powers the rail up when a pixel is lit and down when all are dark,
+// unpowered pixels come back dark so there is nothing to send.
+void FED3::showPixels()
+{
+    bool lit = false;
+    for (uint16_t i = 0; i < strip.numPixels() && !lit; i++)
+        lit = strip.getPixelColor(i) != 0;
+
+    if (!lit && !motorTurning) // while the disk turns the rail stays on, send the dark frame
+    {
+        if (railOn)
+            motorEnable(false); // disable motor driver and neopixels
+        pixelsDirty = false;
+        return;
+    }
+
+    if (!railOn)
+    {
+        motorEnable(true); // ENABLE motor driver
+        delay(2);          // let things settle
+        pixelsDirty = true; // pixels lost their colors while unpowered
+    }
+    if (pixelsDirty)
     {
-        strip.setPixelColor(i, R, G, B, W);
         strip.show();
+        pixelFramesShown++;
+        pixelsDirty = false;
     }
 }
 
+// Turn all pixels on to a specific color
+void FED3::pixelsOn(int R, int G, int B, int W)
+{
+    fillPixels(strip.Color(R, G, B, W));
+    showPixels();
+}
+
 // Turn all pixels off
 void FED3::pixelsOff()
 {
-    digitalWrite(MOTOR_ENABLE, HIGH); // ENABLE motor driver
-    delay(2);                         // let things settle
-    for (uint16_t i = 0; i < strip.numPixels(); i++)
-    {
-        strip.setPixelColor(i, 0, 0, 0, 0);
-        strip.show();
-    }
-    digitalWrite(MOTOR_ENABLE, LOW); // disable motor driver and neopixels
+    clearPixels();
+    showPixels();
 }
 
-// colorWipe does a color wipe from left to right
+// colorWipe does a color wipe from left to right, then turns the pixels off. The strip buffer is cleared
+// as well, so the next frame doesn't light the wiped pixels again when the rail comes back on.
 void FED3::colorWipe(uint32_t c, uint8_t wait)
 {
-    digitalWrite(MOTOR_ENABLE, HIGH); // ENABLE motor driver
-    delay(2);                         // let things settle
     for (uint16_t i = 0; i < 8; i++)
     {
-        strip.setPixelColor(i, c);
-        strip.show();
+        setPixel(i, c);
+        showPixels();
         delay(wait);
     }
-    digitalWrite(MOTOR_ENABLE, LOW); ////disable motor driver and neopixels
-    delay(2);                        // let things settle
+    clearPixels();
+    showPixels(); // disable motor driver and neopixels
+    delay(2);     // let things settle
 }
 
 // Visual tracking stimulus - left-most pixel on strip
 void FED3::leftPixel(int R, int G, int B, int W)
 {
-    digitalWrite(MOTOR_ENABLE, HIGH);
-    delay(2); // let things settle
-    strip.setPixelColor(0, R, G, B, W);
-    strip.show();
-    //   delay(2); //let things settle
+    setPixel(0, strip.Color(R, G, B, W));
+    showPixels();
 }
 
 // Visual tracking stimulus - left-most pixel on strip
 void FED3::rightPixel(int R, int G, int B, int W)
 {
-    digitalWrite(MOTOR_ENABLE, HIGH);
-    delay(2); // let things settle
-    strip.setPixelColor(7, R, G, B, W);
-    strip.show();
-    //   delay(2); //let things settle
+    setPixel(7, strip.Color(R, G, B, W));
+    showPixels();
 }
 
 // Visual tracking stimulus - left poke pixel
 void FED3::leftPokePixel(int R, int G, int B, int W)
 {
-    digitalWrite(MOTOR_ENABLE, HIGH);
-    delay(2); // let things settle
-    strip.setPixelColor(9, R, G, B, W);
-    strip.show();
-    //   delay(2); //let things settle
+    setPixel(9, strip.Color(R, G, B, W));
+    showPixels();
 }
 
 // Visual tracking stimulus - right poke pixel
 void FED3::rightPokePixel(int R, int G, int B, int W)
 {
-    digitalWrite(MOTOR_ENABLE, HIGH);
-    delay(2); // let things settle
-    strip.setPixelColor(8, R, G, B, W);
-    strip.show();
-    // delay(2); //let things settle
+    setPixel(8, strip.Color(R, G, B, W));
+    showPixels();
 }
 
 // Short helper function for blinking LEDs and BNC out port
@@ -18,8 +18,8 @@ void FED3::logLeftPoke()
                 break; // maxPokeTime timeout
         }
         leftInterval = (millis() - leftPokeTime);
-        UpdateDisplay();
-        DisplayLeftInt();
+        requestDisplayUpdate();
+        requestIntervalDisplay(DISPLAY_LEFT_INTERVAL);
         if (leftInterval < minPokeTime)
         {
             Event = "LeftShort";
@@ -31,6 +31,7 @@ void FED3::logLeftPoke()
 
         logdata();
         Left = false;
+        sequenceEvent(true);
     }
 }
 
@@ -49,8 +50,8 @@ void FED3::logRightPoke()
                 break; // maxPokeTime timeout
         }
         rightInterval = (millis() - rightPokeTime);
-        UpdateDisplay();
-        DisplayRightInt();
+        requestDisplayUpdate();
+        requestIntervalDisplay(DISPLAY_RIGHT_INTERVAL);
         if (rightInterval < minPokeTime)
         {
             Event = "RightShort";
@@ -62,14 +63,54 @@ void FED3::logRightPoke()
 
         logdata();
         Right = false;
+        sequenceEvent(false);
     }
 }
 
+// log a poke made during a timeout, counted only if countAllPokes is set
+void FED3::logTimeoutPoke(bool left)
+{
+    unsigned long pokeStart = millis();
+    if (left)
+    {
+        leftPokeTime = pokeStart;
+        if (countAllPokes)
+            LeftCount++;
+        leftInterval = 0.0;
+    }
+    else
+    {
+        rightPokeTime = pokeStart;
+        if (countAllPokes)
+            RightCount++;
+        rightInterval = 0.0;
+    }
+
+    while (digitalRead(left ? LEFT_POKE : RIGHT_POKE) == LOW)
+    {
+        if (millis() - pokeStart > maxPokeTime)
+            break; // maxPokeTime timeout
+    }
+
+    if (left)
+    {
+        leftInterval = (millis() - leftPokeTime);
+        Event = "LeftinTimeOut";
+    }
+    else
+    {
+        rightInterval = (millis() - rightPokeTime);
+        Event = "RightinTimeout";
+    }
+    requestDisplayUpdate();
+    logdata();
+}
+
 void FED3::randomizeActivePoke(int max)
 {
     // Store last active side and randomize
     byte lastActive = activePoke;
-    activePoke = random(0, 2);
+    activePoke = randomBelow(2);
 
     // Increment consecutive active pokes, or reset consecutive to zero
     if (activePoke == lastActive)
@@ -0,0 +1,155 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Energy accounting
+**************************************************************************************************************************************************/
+// Time spent in each power state is integrated against powerModel. Once an hour a row is appended to
+// PWR###_MMDDYY_NN.CSV next to the log file with the charge used by each subsystem and the projected runtime.
+
+void FED3::motorEnable(bool enable)
+{
+    digitalWrite(MOTOR_ENABLE, enable ? HIGH : LOW);
+    unsigned long now = deadlineClock();
+    if (enable && !railOn)
+    {
+        railOnSince = now;
+    }
+    else if (!enable && railOn)
+    {
+        railMs += now - railOnSince;
+    }
+    railOn = enable;
+}
+
+void FED3::noteSdSync()
+{
+    sdSyncs++;
+}
+
+// Called for every tone, a new tone cuts off the rest of the previous one
+void FED3::noteBuzzer(int durationMs)
+{
+    unsigned long now = millis();
+    if ((long)(buzzerEnd - now) > 0)
+    {
+        buzzerMs -= buzzerEnd - now;
+    }
+    buzzerMs += durationMs;
+    buzzerEnd = now + durationMs;
+}
+
+FED3::PowerTotals FED3::powerTotals()
+{
+    PowerTotals t;
+    t.clockMs = deadlineClock();
+    t.sleptMs = sleptMs;
+    t.railMs = railMs + (railOn ? t.clockMs - railOnSince : 0);
+    t.buzzerMs = buzzerMs;
+    t.refreshes = display.refreshCount;
+    t.sdSyncs = sdSyncs;
+    return t;
+}
+
+// Charge drawn between two snapshots
+float FED3::chargemAh(const PowerTotals &from, const PowerTotals &to)
+{
+    float awakeMs = (to.clockMs - from.clockMs) - (to.sleptMs - from.sleptMs);
+    float mAms = (to.clockMs - from.clockMs) * powerModel.sleepmA +
+                 awakeMs * powerModel.awakemA +
+                 (to.railMs - from.railMs) * powerModel.railmA +
+                 (to.buzzerMs - from.buzzerMs) * powerModel.buzzermA;
+    float mAs = (to.refreshes - from.refreshes) * powerModel.refreshmAs +
+                (to.sdSyncs - from.sdSyncs) * powerModel.sdSyncmAs;
+    return mAms / 3600000.0 + mAs / 3600.0;
+}
+
+float FED3::energyUsedmAh()
+{
+    PowerTotals start = {};
+    return chargemAh(start, powerTotals());
+}
+
+float FED3::projectedRuntimeHours()
+{
+    PowerTotals now = powerTotals();
+    float hours = (now.clockMs - lastPowerReport.clockMs) / 3600000.0;
+    float charge = chargemAh(lastPowerReport, now);
+    if (hours <= 0 || charge <= 0)
+        return 0;
+    float remaining = powerModel.batterymAh - energyUsedmAh();
+    return (remaining > 0 ? remaining : 0) / (charge / hours);
+}
+
+// Write a report on the first call of each new hour
+void FED3::servicePowerReport()
+{
+    if (!logPower || (int)currentHour == powerReportHour)
+        return;
+    if (powerReportHour >= 0)
+        writePowerReport();
+    else
+        lastPowerReport = powerTotals(); // first hour starts now
+    powerReportHour = currentHour;
+}
+
+void FED3::writePowerReport()
+{
+    PowerTotals now = powerTotals();
+    float awakeMs = (now.clockMs - lastPowerReport.clockMs) - (now.sleptMs - lastPowerReport.sleptMs);
+    float runtime = projectedRuntimeHours();
+
+    char powerFile[21];
+    strcpy(powerFile, filename);
+    memcpy(powerFile, "PWR", 3);
+
+    SdFile powerfile;
+    if (powerfile.open(powerFile, O_WRITE | O_CREAT | O_APPEND))
+    {
+        if (powerfile.fileSize() == 0)
+        {
+            powerfile.println("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Battery_Voltage,Hours,Sleep_mAh,CPU_mAh,Rail_mAh,Buzzer_mAh,Display_mAh,SD_mAh,Total_mAh,Used_mAh,Runtime_h");
+        }
+        char stamp[FED3_STAMP_CHARS];
+        formatStamp(stamp, rtc.now());
+        powerfile.print(stamp);
+        powerfile.print(",");
+        powerfile.print(VER);
+        powerfile.print(",");
+        powerfile.print(sessiontype);
+        powerfile.print(",");
+        powerfile.print(FED);
+        powerfile.print(",");
+        powerfile.print(measuredvbat);
+        powerfile.print(",");
+        powerfile.print((now.clockMs - lastPowerReport.clockMs) / 3600000.0, 3);
+        powerfile.print(",");
+        powerfile.print((now.clockMs - lastPowerReport.clockMs) * powerModel.sleepmA / 3600000.0, 3);
+        powerfile.print(",");
+        powerfile.print(awakeMs * powerModel.awakemA / 3600000.0, 3);
+        powerfile.print(",");
+        powerfile.print((now.railMs - lastPowerReport.railMs) * powerModel.railmA / 3600000.0, 3);
+        powerfile.print(",");
+        powerfile.print((now.buzzerMs - lastPowerReport.buzzerMs) * powerModel.buzzermA / 3600000.0, 3);
+        powerfile.print(",");
+        powerfile.print((now.refreshes - lastPowerReport.refreshes) * powerModel.refreshmAs / 3600.0, 3);
+        powerfile.print(",");
+        powerfile.print((now.sdSyncs - lastPowerReport.sdSyncs) * powerModel.sdSyncmAs / 3600.0, 3);
+        powerfile.print(",");
+        powerfile.print(chargemAh(lastPowerReport, now), 3);
+        powerfile.print(",");
+        powerfile.print(energyUsedmAh(), 1);
+        powerfile.print(",");
+        powerfile.println(runtime, 1);
+        powerfile.sync();
+        powerfile.close();
+        noteSdSync();
+    }
+
+    Serial.print("Power: ");
+    Serial.print(chargemAh(lastPowerReport, now), 2);
+    Serial.print(" mAh this hour, ");
+    Serial.print(runtime, 1);
+    Serial.println(" h projected runtime");
+
+    lastPowerReport = now;
+}
@@ -82,9 +82,10 @@ void FED3::adjustRTC(uint32_t timestamp)
 //  dateTime function
 void FED3::dateTime(uint16_t *date, uint16_t *time)
 {
-    if (!staticFED)
+    FED3 *fed3 = fed3BoardFED();
+    if (!fed3)
         return; // Safety check
-    DateTime now = staticFED->rtc.now();
+    DateTime now = fed3->rtc.now();
     // return date using FAT_DATE macro to format fields
     *date = FAT_DATE(now.year(), now.month(), now.day());
     // return time using FAT_TIME macro to format fields
@@ -106,6 +107,12 @@ void FED3::serialPrintRTC()
                   current.hour(), current.minute(), current.second());
 }
 
+// Date and time as in the first column of the CSV files, e.g. "3/1/2025 08:00:00"
+void FED3::formatStamp(char *stamp, const DateTime &time)
+{
+    snprintf(stamp, FED3_STAMP_CHARS, "%d/%d/%d %02d:%02d:%02d", time.month(), time.day(), time.year(), time.hour(), time.minute(), time.second());
+}
+
 // Get compilation date/time
 String FED3::getCompileDateTime()
 {
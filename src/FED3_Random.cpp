@@ -0,0 +1,115 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Random numbers
+**************************************************************************************************************************************************/
+// xoshiro128** generators, one per RANDOM_* stream, all seeded from one 32 bit session seed. The log file has the
+// seed in its Seed column, and setting randomSeedValue to it before begin() replays
+// the same draws:
+//
+//   fed3.randomSeedValue = 0x1A2B3C4D;
+//   fed3.begin();
+//   ...
+//   if (fed3.randomChance(0.8)) { ... }      // 80% of the time
+//   int side = fed3.randomBelow(2);          // 0 or 1
+
+// SplitMix32, spreads the seed and stream number over the generator state
+static uint32_t splitMix32(uint32_t &x)
+{
+    uint32_t z = (x += 0x9E3779B9);
+    z = (z ^ (z >> 16)) * 0x85EBCA6B;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35;
+    return z ^ (z >> 16);
+}
+
+static inline uint32_t rotl(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+// Entropy for a new seed: ADC noise on the battery pin and the time since boot
+unsigned long FED3::pickRandomSeed()
+{
+#if defined(ESP32)
+    return esp_random();
+#else
+    uint32_t seed = micros();
+    for (int i = 0; i < 32; i++)
+    {
+        seed = rotl(seed, 5) ^ analogRead(VBATPIN);
+        seed ^= micros();
+    }
+    return splitMix32(seed);
+#endif
+}
+
+void FED3::seedRandom(unsigned long seed)
+{
+    if (seed == 0)
+        seed = pickRandomSeed();
+    if (seed == 0)
+        seed = 1; // 0 means "pick one" when logged seeds are replayed
+    randomSeedValue = seed;
+
+    for (byte stream = 0; stream < RANDOM_STREAMS; stream++)
+    {
+        uint32_t x = seed ^ (stream * 0x632BE5ABUL);
+        for (byte i = 0; i < 4; i++)
+            randomState[stream][i] = splitMix32(x);
+    }
+    randomSeeded = true;
+}
+
+uint32_t FED3::random32(byte stream)
+{
+    if (!randomSeeded)
+        seedRandom(randomSeedValue);
+    if (stream >= RANDOM_STREAMS)
+        stream = RANDOM_TASK;
+
+    uint32_t *s = randomState[stream];
+    uint32_t result = rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    return result;
+}
+
+// Lemire's multiply and reject, no modulo bias and usually no division
+uint32_t FED3::randomBelow(uint32_t n, byte stream)
+{
+    if (n == 0)
+        return 0;
+    uint64_t m = (uint64_t)random32(stream) * n;
+    uint32_t low = (uint32_t)m;
+    if (low < n)
+    {
+        uint32_t threshold = (0 - n) % n;
+        while (low < threshold)
+        {
+            m = (uint64_t)random32(stream) * n;
+            low = (uint32_t)m;
+        }
+    }
+    return m >> 32;
+}
+
+long FED3::randomRange(long low, long high, byte stream)
+{
+    if (high <= low)
+        return low;
+    return low + (long)randomBelow((uint32_t)(high - low), stream);
+}
+
+bool FED3::randomChance(float p, byte stream)
+{
+    if (p <= 0)
+        return false;
+    if (p >= 1)
+        return true;
+    return random32(stream) < (uint32_t)(p * 4294967296.0);
+}
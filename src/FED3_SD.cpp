@@ -6,7 +6,7 @@
 // Create new files on uSD for FED3 settings
 void FED3::CreateFile()
 {
-    digitalWrite(MOTOR_ENABLE, LOW); // Disable motor driver and neopixel
+    motorEnable(false); // Disable motor driver and neopixel
 
     // Initialize SD card with SdFat
     if (!fed3SD.begin(cardSelect, SD_SCK_MHZ(SD_CLOCK_SPEED)))
@@ -60,8 +60,20 @@ void FED3::CreateFile()
 // Create a new datafile
 void FED3::CreateDataFile()
 {
-    digitalWrite(MOTOR_ENABLE, LOW); // Disable motor driver and neopixel
-    getFilename(filename);           // Generate the filename
+    motorEnable(false);    // Disable motor driver and neopixel
+    getFilename(filename); // Generate the filename
+
+    // A new log starts a new index, one left over from a log of the same name would point into the old rows
+    char indexFile[21];
+    indexFilename(indexFile, filename);
+    fed3SD.remove(indexFile);
+    logIndexStarted = false;
+
+    // The open hour of the summaries goes on in the new log
+    if (logSummary && strcmp(summaryLogs[1], filename) != 0)
+    {
+        saveSummaryState();
+    }
 
     // Open logfile for writing
     if (!logfile.open(filename, O_WRITE | O_CREAT | O_TRUNC))
@@ -74,18 +86,18 @@ void FED3::CreateDataFile()
 // Write the header to the datafile
 void FED3::writeHeader()
 {
-    digitalWrite(MOTOR_ENABLE, LOW); // Disable motor driver and neopixel
+    motorEnable(false); // Disable motor driver and neopixel
     // Write data header to file of microSD card
 
     if (sessiontype == "Bandit")
     {
         if (tempSensor == false)
         {
-            logfile.println("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
+            logfile.print("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
         }
         else if (tempSensor == true)
         {
-            logfile.println("MM:DD:YYYY hh:mm:ss,Temp,Humidity,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
+            logfile.print("MM:DD:YYYY hh:mm:ss,Temp,Humidity,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
         }
     }
 
@@ -95,33 +107,42 @@ void FED3::writeHeader()
         {
             if (tempSensor == false)
             {
-                logfile.println("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
+                logfile.print("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
             }
             else
             {
-                logfile.println("MM:DD:YYYY hh:mm:ss,Temp,Humidity,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
+                logfile.print("MM:DD:YYYY hh:mm:ss,Temp,Humidity,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,PelletsToSwitch,Prob_left,Prob_right,Event,High_prob_poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
             }
         }
         else
         {
             if (tempSensor == false)
             {
-                logfile.println("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,FR,Event,Active_Poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
+                logfile.print("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,FR,Event,Active_Poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
             }
             if (tempSensor == true)
             {
-                logfile.println("MM:DD:YYYY hh:mm:ss,Temp,Humidity,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,FR,Event,Active_Poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
+                logfile.print("MM:DD:YYYY hh:mm:ss,Temp,Humidity,Library_Version,Session_type,Device_Number,Battery_Voltage,Motor_Turns,FR,Event,Active_Poke,Left_Poke_Count,Right_Poke_Count,Pellet_Count,Block_Pellet_Count,Retrieval_Time,InterPelletInterval,Poke_Time");
             }
         }
     }
-
+    if (prSchedule != NULL)
+    {
+        logfile.print(",PR_Step");
+    }
+    if (syncMarkers)
+    {
+        logfile.print(",Sync_Seq");
+    }
+    logfile.print(",Seed");
+    logfile.println();
     logfile.close();
 }
 
 // write a configfile (this contains the FED device number)
 void FED3::writeConfigFile()
 {
-    digitalWrite(MOTOR_ENABLE, LOW); // Disable motor driver and neopixel
+    motorEnable(false); // Disable motor driver and neopixel
 
     // Open configfile directly for writing
     if (!configfile.open("DeviceNumber.csv", O_WRITE | O_CREAT | O_TRUNC))
@@ -133,14 +154,29 @@ void FED3::writeConfigFile()
     configfile.rewind();     // Go to the beginning of the file
     configfile.println(FED); // Write the FED value
     configfile.sync();       // Use sync() to ensure data is written
+    noteSdSync();
     configfile.close();      // Close the file
 }
 
 void FED3::logdata()
 {
+    // Mark the event on the BNC port before the slow SD write
+    if (syncMarkers)
+    {
+        emitSyncMarker(syncEventType(Event));
+    }
+
     if (EnableSleep == true)
     {
-        digitalWrite(MOTOR_ENABLE, LOW); // Disable motor driver and neopixel
+        motorEnable(false); // Disable motor driver and neopixel
+    }
+
+    DateTime now = rtc.now();
+
+    // Count the event before the SD card, so the statistics don't depend on the card
+    if (sessionStats || logSummary)
+    {
+        statsEvent(statsEventType(Event), now.unixtime());
     }
 
     // Initialize SD card if not already initialized
@@ -150,8 +186,6 @@ void FED3::logdata()
         return;
     }
 
-    DateTime now = rtc.now();
-
     // Fix filename (the .CSV extension can become corrupted) and open file
     filename[16] = '.';
     filename[17] = 'C';
@@ -183,6 +217,8 @@ void FED3::logdata()
         return;
     }
 
+    uint32_t rowOffset = logfile.fileSize(); // for the log index
+
     // Log data to the file
     logfile.print(now.month());
     logfile.print("/");
@@ -202,10 +238,12 @@ void FED3::logdata()
     logfile.print(",");
 
     // Log temp and humidity if tempSensor is true
+    float temperature = NAN;
     if (tempSensor)
     {
         sensors_event_t humidity, temp;
         aht.getEvent(&humidity, &temp); // Populate temp and humidity objects with fresh data
+        temperature = temp.temperature;
         logfile.print(temp.temperature);
         logfile.print(",");
         logfile.print(humidity.relative_humidity);
@@ -331,28 +369,68 @@ void FED3::logdata()
     }
     logfile.print(",");
 
-    // Log poke duration
+    // Log poke duration, or the micros() of a BNC edge
     if (Event == "Pellet")
     {
-        logfile.println(sqrt(-1));
+        logfile.print(sqrt(-1));
+    }
+    else if (Event == "BNCRise" || Event == "BNCFall")
+    {
+        logfile.print(bncLogUs);
     }
     else if (Event.startsWith("Left"))
     {
-        logfile.println(leftInterval / 1000.0);
+        logfile.print(leftInterval / 1000.0);
     }
     else if (Event.startsWith("Right"))
     {
-        logfile.println(rightInterval / 1000.0);
+        logfile.print(rightInterval / 1000.0);
     }
     else
     {
-        logfile.println(sqrt(-1));
+        logfile.print(sqrt(-1));
     }
 
+    // Log the progressive ratio step
+    if (prSchedule != NULL)
+    {
+        logfile.print(",");
+        logfile.print(prSchedule->step());
+    }
+
+    // Log the sync marker sent for this event
+    if (syncMarkers)
+    {
+        logfile.print(",");
+        if (syncLastSequence >= 0)
+        {
+            logfile.print(syncLastSequence);
+        }
+        else
+        {
+            logfile.print(sqrt(-1));
+        }
+    }
+
+    // The session's random seed, set randomSeedValue to it to replay the session's draws
+    char seed[12];
+    snprintf(seed, sizeof(seed), ",0x%08lX", randomSeedValue);
+    logfile.print(seed);
+    logfile.println();
+
     // Commit data to SD card and close file
     Blink(GREEN_LED, 25, 2);
     logfile.sync();  // Use sync() instead of flush() to write data
+    noteSdSync();
     logfile.close(); // Close the file
+    if (logIndex)
+    {
+        indexLogRow(now.unixtime(), rowOffset);
+    }
+    if (logSummary)
+    {
+        addSummaryReading(now.unixtime(), measuredvbat, temperature);
+    }
 
     // new option to create a new file for each day
     if (createDailyFile == true)
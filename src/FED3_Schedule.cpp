@@ -0,0 +1,34 @@
+#include "FED3_Schedule.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Progressive ratio schedule
+**************************************************************************************************************************************************/
+FED3_PRSchedule::FED3_PRSchedule(const uint16_t *steps, uint8_t count) : steps(steps), count(count)
+{
+    reset();
+}
+
+bool FED3_PRSchedule::poke()
+{
+    if (left > 1)
+    {
+        left--;
+        return false;
+    }
+    next();
+    return true;
+}
+
+uint16_t FED3_PRSchedule::next()
+{
+    if (index + 1 < count)
+        index++;
+    left = steps[index];
+    return left;
+}
+
+void FED3_PRSchedule::reset()
+{
+    index = 0;
+    left = steps[0];
+}
@@ -0,0 +1,134 @@
+/*
+Progressive ratio schedules for FED3
+
+The ratios are generated at compile time into flash tables, so nothing is computed while the
+device runs. FED3_PRSchedule walks a table and counts pokes down to the next reward.
+
+  // Richardson & Roberts (1996): 1, 2, 4, 6, 9, 12, 15, 20, 25, 32, ...
+  FED3_PRSchedule pr(FED3_PRTable<FED3_PRExponential, 30>::steps);
+
+  // FR1, FR3, FR5, ...
+  FED3_PRSchedule pr(FED3_PRTable<FED3_PRArithmetic<1, 2>, 100>::steps);
+
+  // 1, 2, 4, 8, ... (start 1, ratio 2/1)
+  FED3_PRSchedule pr(FED3_PRTable<FED3_PRGeometric<1, 2, 1>, 15>::steps);
+
+A rule is any struct with a constexpr at(n) giving the ratio for the nth reward (from 0), sketches
+can write their own. After the last entry the schedule stays on the last ratio.
+*/
+
+#ifndef FED3_SCHEDULE_H
+#define FED3_SCHEDULE_H
+
+#include <Arduino.h>
+
+// Compile time math for the rules, exp() and pow() are not constexpr
+constexpr double fed3ExpSeries(double x, int k, double term)
+{
+    return k > 48 ? term : term + fed3ExpSeries(x, k + 1, term * x / k);
+}
+
+constexpr double fed3Exp(double x)
+{
+    return fed3ExpSeries(x, 1, 1.0);
+}
+
+constexpr double fed3Pow(double base, int n)
+{
+    return n == 0 ? 1.0 : base * fed3Pow(base, n - 1);
+}
+
+constexpr uint16_t fed3RoundRatio(double ratio)
+{
+    return ratio < 1 ? 1 : ratio >= 65535 ? 65535 : (uint16_t)(ratio + 0.5);
+}
+
+// Richardson & Roberts (1996), round(5 * e^(0.2 * pellet) - 5) for pellet 1, 2, 3, ...
+struct FED3_PRExponential
+{
+    static constexpr uint16_t at(int n) { return fed3RoundRatio(5 * fed3Exp(0.2 * (n + 1)) - 5); }
+};
+
+// Start, Start + Step, Start + 2 * Step, ...
+template <int Start, int Step>
+struct FED3_PRArithmetic
+{
+    static constexpr uint16_t at(int n) { return fed3RoundRatio((double)Start + (double)Step * n); }
+};
+
+// Start, Start * r, Start * r^2, ... with r = Numerator / Denominator
+template <int Start, int Numerator, int Denominator>
+struct FED3_PRGeometric
+{
+    static constexpr uint16_t at(int n) { return fed3RoundRatio(Start * fed3Pow((double)Numerator / Denominator, n)); }
+};
+
+// The published sequence, checked when the library compiles
+static_assert(FED3_PRExponential::at(0) == 1 && FED3_PRExponential::at(1) == 2 && FED3_PRExponential::at(2) == 4 &&
+                  FED3_PRExponential::at(3) == 6 && FED3_PRExponential::at(4) == 9 && FED3_PRExponential::at(5) == 12 &&
+                  FED3_PRExponential::at(6) == 15 && FED3_PRExponential::at(7) == 20 && FED3_PRExponential::at(8) == 25 &&
+                  FED3_PRExponential::at(9) == 32 && FED3_PRExponential::at(10) == 40 && FED3_PRExponential::at(11) == 50 &&
+                  FED3_PRExponential::at(12) == 62 && FED3_PRExponential::at(13) == 77 && FED3_PRExponential::at(14) == 95 &&
+                  FED3_PRExponential::at(15) == 118 && FED3_PRExponential::at(16) == 145 && FED3_PRExponential::at(17) == 178 &&
+                  FED3_PRExponential::at(18) == 219 && FED3_PRExponential::at(19) == 268 && FED3_PRExponential::at(20) == 328 &&
+                  FED3_PRExponential::at(21) == 402 && FED3_PRExponential::at(22) == 492 && FED3_PRExponential::at(23) == 603,
+              "FED3_PRExponential does not match Richardson & Roberts (1996)");
+
+// Index packs to expand a rule into an array initializer
+template <int... I>
+struct FED3_Indices
+{
+};
+
+template <int N, int... I>
+struct FED3_MakeIndices : FED3_MakeIndices<N - 1, N - 1, I...>
+{
+};
+
+template <int... I>
+struct FED3_MakeIndices<0, I...>
+{
+    typedef FED3_Indices<I...> type;
+};
+
+template <class Rule, class Indices>
+struct FED3_PRTableSteps;
+
+template <class Rule, int... I>
+struct FED3_PRTableSteps<Rule, FED3_Indices<I...>>
+{
+    static constexpr uint16_t steps[sizeof...(I)] = {Rule::at(I)...};
+};
+
+template <class Rule, int... I>
+constexpr uint16_t FED3_PRTableSteps<Rule, FED3_Indices<I...>>::steps[sizeof...(I)];
+
+// The first Count ratios of Rule, as FED3_PRTable<Rule, Count>::steps
+template <class Rule, int Count>
+struct FED3_PRTable : FED3_PRTableSteps<Rule, typename FED3_MakeIndices<Count>::type>
+{
+    static_assert(Count > 0 && Count <= 255, "FED3_PRTable holds 1 to 255 ratios");
+};
+
+class FED3_PRSchedule
+{
+public:
+    FED3_PRSchedule(const uint16_t *steps, uint8_t count);
+    template <size_t N>
+    FED3_PRSchedule(const uint16_t (&steps)[N]) : FED3_PRSchedule(steps, N) {}
+
+    bool poke();               // count a poke, true when it completes the ratio and the schedule moves on
+    uint16_t next();           // move to the next ratio without pokes, returns it
+    void reset();              // back to the first ratio
+    uint16_t required() const { return steps[index]; } // pokes for the current ratio
+    uint16_t remaining() const { return left; }         // pokes still needed for the next reward
+    uint8_t step() const { return index; }              // current ratio, from 0
+
+private:
+    const uint16_t *steps;
+    uint8_t count;
+    uint8_t index;
+    uint16_t left;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Poke sequences
+**************************************************************************************************************************************************/
+// The pattern is compiled into a DFA (Knuth-Morris-Pratt), so each logged poke is one table lookup. A poke that
+// breaks the pattern falls back to the longest partial match it still continues: with "LR", L L R matches on
+// the second L. The window runs from the first poke of the partial match, when it expires the matcher resets
+// and logs SeqReset. A match logs SeqMatch, then calls the callback and starts over.
+//
+//   fed3.startSequence("LR", 4000, reward); // left then right within 4 s
+//
+//   const FED3_SequenceWindow windows[] = {{0, 60000}, {60, 30000}, {120, 10000}}; // shorter as matches add up
+//   fed3.setSequenceWindows(windows, 3);
+
+bool FED3::startSequence(const char *pattern, unsigned long windowMs, void (*onMatch)())
+{
+    byte length = strlen(pattern);
+    if (length == 0 || length > MAX_SEQUENCE_LENGTH)
+        return false;
+    for (byte j = 0; j < length; j++)
+    {
+        if (pattern[j] != 'L' && pattern[j] != 'R')
+            return false;
+    }
+
+    // Row j is the state after j matched pokes, a mismatch takes the transition of the restart state
+    byte restart = 0;
+    for (byte j = 0; j < length; j++)
+    {
+        byte symbol = (pattern[j] == 'L');
+        sequenceNext[j][0] = (j == 0) ? 0 : sequenceNext[restart][0];
+        sequenceNext[j][1] = (j == 0) ? 0 : sequenceNext[restart][1];
+        sequenceNext[j][symbol] = j + 1;
+        if (j > 0)
+            restart = sequenceNext[restart][symbol];
+    }
+
+    sequenceLength = length;
+    sequenceState = 0;
+    sequenceMatches = 0;
+    sequenceResets = 0;
+    sequenceWindowMs = windowMs;
+    sequenceWindows = NULL;
+    sequenceCallback = onMatch;
+    clearDeadline(DEADLINE_SEQUENCE);
+    return true;
+}
+
+void FED3::setSequenceWindows(const FED3_SequenceWindow *windows, byte count)
+{
+    sequenceWindows = windows;
+    sequenceWindowCount = count;
+    sequenceWindowIndex = 0;
+    if (windows == NULL || count == 0)
+        return;
+    while (sequenceWindowIndex + 1 < count && sequenceMatches >= windows[sequenceWindowIndex + 1].afterMatches)
+        sequenceWindowIndex++;
+    sequenceWindowMs = windows[sequenceWindowIndex].windowMs;
+}
+
+void FED3::stopSequence()
+{
+    sequenceLength = 0;
+    sequenceState = 0;
+    clearDeadline(DEADLINE_SEQUENCE);
+}
+
+void FED3::sequenceEvent(bool left)
+{
+    if (sequenceLength == 0)
+        return;
+
+    unsigned long now = deadlineClock();
+    if (sequenceState > 0 && sequenceWindowMs > 0)
+    {
+        unsigned long start = sequencePokeMs[(sequenceHead + MAX_SEQUENCE_LENGTH - (sequenceState - 1)) % MAX_SEQUENCE_LENGTH];
+        if (now - start >= sequenceWindowMs)
+            resetSequence(); // the deadline hasn't been serviced yet
+    }
+
+    sequenceHead = (sequenceHead + 1) % MAX_SEQUENCE_LENGTH;
+    sequencePokeMs[sequenceHead] = now;
+    sequenceState = sequenceNext[sequenceState][left];
+
+    if (sequenceState == sequenceLength)
+    {
+        sequenceState = 0;
+        sequenceMatches++;
+        clearDeadline(DEADLINE_SEQUENCE);
+        if (sequenceWindows != NULL)
+        {
+            while (sequenceWindowIndex + 1 < sequenceWindowCount && sequenceMatches >= sequenceWindows[sequenceWindowIndex + 1].afterMatches)
+                sequenceWindowIndex++;
+            sequenceWindowMs = sequenceWindows[sequenceWindowIndex].windowMs;
+        }
+        logSequenceEvent("SeqMatch");
+        if (sequenceCallback != NULL)
+            sequenceCallback();
+    }
+    else if (sequenceState > 0 && sequenceWindowMs > 0)
+    {
+        unsigned long start = sequencePokeMs[(sequenceHead + MAX_SEQUENCE_LENGTH - (sequenceState - 1)) % MAX_SEQUENCE_LENGTH];
+        setDeadline(DEADLINE_SEQUENCE, sequenceWindowMs - (now - start));
+    }
+    else
+    {
+        clearDeadline(DEADLINE_SEQUENCE);
+    }
+}
+
+// Called from run(), resets a partial match when its window runs out
+void FED3::serviceSequence()
+{
+    if (deadlinePassed(DEADLINE_SEQUENCE) && sequenceState > 0)
+        resetSequence();
+}
+
+void FED3::resetSequence()
+{
+    sequenceState = 0;
+    sequenceResets++;
+    clearDeadline(DEADLINE_SEQUENCE);
+    logSequenceEvent("SeqReset");
+}
+
+void FED3::logSequenceEvent(const char *event)
+{
+    if (!logSequenceEvents)
+        return;
+    Event = event;
+    logdata();
+}
@@ -0,0 +1,403 @@
+#include "FED3_SharpMem.h"
+
+#define SHARPMEM_BIT_WRITECMD (0x01) // 0x80 in LSB format
+#define SHARPMEM_BIT_VCOM (0x02)     // 0x40 in LSB format
+#define SHARPMEM_BIT_CLEAR (0x04)    // 0x20 in LSB format
+
+/**************************************************************************************************************************************************
+                                                                                               Display driver
+**************************************************************************************************************************************************/
+FED3_SharpMem::FED3_SharpMem(uint8_t clk, uint8_t mosi, uint8_t cs, uint16_t width, uint16_t height, uint32_t freq)
+    : Adafruit_GFX(width, height)
+{
+    _cs = cs;
+    spidev = new Adafruit_SPIDevice(cs, clk, -1, mosi, freq, SPI_BITORDER_LSBFIRST);
+}
+
+boolean FED3_SharpMem::begin()
+{
+    if (!spidev->begin())
+    {
+        return false;
+    }
+    // this display is weird in that _cs is active HIGH not LOW like every other SPI device
+    digitalWrite(_cs, LOW);
+    vcom = SHARPMEM_BIT_VCOM; // set the vcom bit to a defined state
+
+    buffer = (uint8_t *)malloc((WIDTH * HEIGHT) / 8);
+    if (!buffer)
+    {
+        return false;
+    }
+    setRotation(0);
+    return true;
+}
+
+void FED3_SharpMem::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+    if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height))
+        return;
+
+    switch (rotation)
+    {
+    case 1:
+        _swap_int16_t(x, y);
+        x = WIDTH - 1 - x;
+        break;
+    case 2:
+        x = WIDTH - 1 - x;
+        y = HEIGHT - 1 - y;
+        break;
+    case 3:
+        _swap_int16_t(x, y);
+        y = HEIGHT - 1 - y;
+        break;
+    }
+
+    if (color)
+        buffer[(y * WIDTH + x) / 8] |= (1 << (x & 7));
+    else
+        buffer[(y * WIDTH + x) / 8] &= ~(1 << (x & 7));
+}
+
+uint8_t FED3_SharpMem::getPixel(uint16_t x, uint16_t y)
+{
+    if ((x >= _width) || (y >= _height))
+        return 0;
+
+    switch (rotation)
+    {
+    case 1:
+        _swap_int16_t(x, y);
+        x = WIDTH - 1 - x;
+        break;
+    case 2:
+        x = WIDTH - 1 - x;
+        y = HEIGHT - 1 - y;
+        break;
+    case 3:
+        _swap_int16_t(x, y);
+        y = HEIGHT - 1 - y;
+        break;
+    }
+
+    return (buffer[(y * WIDTH + x) / 8] & (1 << (x & 7))) ? 1 : 0;
+}
+
+void FED3_SharpMem::clearDisplay()
+{
+    clearDisplayBuffer();
+
+    // Send the clear screen command rather than doing a HW refresh (quicker)
+    spidev->beginTransaction();
+    digitalWrite(_cs, HIGH);
+    uint8_t clear_data[2] = {(uint8_t)(vcom | SHARPMEM_BIT_CLEAR), 0x00};
+    spidev->transfer(clear_data, 2);
+    vcom = vcom ? 0x00 : SHARPMEM_BIT_VCOM;
+    digitalWrite(_cs, LOW);
+    spidev->endTransaction();
+    refreshCount++;
+}
+
+void FED3_SharpMem::clearDisplayBuffer()
+{
+    memset(buffer, 0xff, (WIDTH * HEIGHT) / 8);
+}
+
+void FED3_SharpMem::refresh()
+{
+    uint8_t bytesPerLine = WIDTH / 8;
+    uint8_t line[WIDTH / 8 + 2];
+
+    spidev->beginTransaction();
+    digitalWrite(_cs, HIGH);
+    spidev->transfer(vcom | SHARPMEM_BIT_WRITECMD); // write command
+    vcom = vcom ? 0x00 : SHARPMEM_BIT_VCOM;
+
+    for (uint16_t row = 0; row < HEIGHT; row++)
+    {
+        line[0] = row + 1; // line address is 1-based
+        memcpy(line + 1, buffer + row * bytesPerLine, bytesPerLine);
+        line[bytesPerLine + 1] = 0x00; // end of line
+        spidev->transfer(line, bytesPerLine + 2);
+    }
+    spidev->transfer(0x00); // trailing 8 bits for the last line
+
+    digitalWrite(_cs, LOW);
+    spidev->endTransaction();
+    refreshCount++;
+}
+
+// Write the screen as it is currently oriented as a binary PBM (P4) image
+void FED3_SharpMem::writePBM(Print &out)
+{
+    out.print("P4\n");
+    out.print(_width);
+    out.print(" ");
+    out.print(_height);
+    out.print("\n");
+
+    uint8_t rowBytes[(168 + 7) / 8];
+    uint8_t rowLength = (_width + 7) / 8;
+    if (rowLength > sizeof(rowBytes))
+        return;
+
+    for (int16_t y = 0; y < _height; y++)
+    {
+        memset(rowBytes, 0, rowLength);
+        for (int16_t x = 0; x < _width; x++)
+        {
+            if (getPixel(x, y) == 0) // PBM uses 1 for black
+                rowBytes[x / 8] |= 0x80 >> (x & 7);
+        }
+        out.write(rowBytes, rowLength);
+    }
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Glyph atlas
+**************************************************************************************************************************************************/
+// Decode the font bitmaps for FED3_ATLAS_CHARS once, storing each glyph column as a bit mask
+// so a whole column of a character can be written with a few byte operations.
+// Must be called after setFont() with the same font that printFast() will be used with.
+bool FED3_SharpMem::buildGlyphAtlas(const GFXfont *font)
+{
+    atlasFont = font;
+    memset(knownFonts, 0, sizeof(knownFonts));
+    uint16_t column = 0;
+    uint16_t first = pgm_read_word(&font->first);
+    uint16_t last = pgm_read_word(&font->last);
+    const uint8_t *bitmap = (const uint8_t *)pgm_read_ptr(&font->bitmap);
+    const GFXglyph *glyphs = (const GFXglyph *)pgm_read_ptr(&font->glyph);
+
+    for (uint8_t i = 0; i < sizeof(FED3_ATLAS_CHARS) - 1; i++)
+    {
+        AtlasGlyph &g = atlasGlyphs[i];
+        uint8_t c = FED3_ATLAS_CHARS[i];
+        g.column = 0xFFFF; // not in atlas, printFast() falls back to Adafruit_GFX
+
+        if (c < first || c > last)
+            continue;
+
+        const GFXglyph *glyph = &glyphs[c - first];
+        uint16_t bo = pgm_read_word(&glyph->bitmapOffset);
+        g.width = pgm_read_byte(&glyph->width);
+        g.height = pgm_read_byte(&glyph->height);
+        g.xAdvance = pgm_read_byte(&glyph->xAdvance);
+        g.xOffset = pgm_read_byte(&glyph->xOffset);
+        g.yOffset = pgm_read_byte(&glyph->yOffset);
+
+        if (g.height > 24 || column + g.width > FED3_ATLAS_MAX_COLUMNS)
+            continue;
+
+        // Glyph bitmaps are packed row by row, MSB first, with no padding between rows
+        uint8_t bits = 0, bit = 0;
+        for (uint8_t yy = 0; yy < g.height; yy++)
+        {
+            for (uint8_t xx = 0; xx < g.width; xx++)
+            {
+                if (yy == 0)
+                    atlasColumns[column + xx] = 0;
+                if (!(bit++ & 7))
+                    bits = pgm_read_byte(&bitmap[bo++]);
+                if (bits & 0x80)
+                    atlasColumns[column + xx] |= (1UL << yy);
+                bits <<= 1;
+            }
+        }
+        g.column = column;
+        column += g.width;
+    }
+    return true;
+}
+
+const FED3_SharpMem::AtlasGlyph *FED3_SharpMem::findGlyph(char c)
+{
+    const char *p = (c == 0) ? NULL : strchr(FED3_ATLAS_CHARS, c);
+    if (p == NULL)
+        return NULL;
+    const AtlasGlyph *g = &atlasGlyphs[p - FED3_ATLAS_CHARS];
+    return (g->column == 0xFFFF) ? NULL : g;
+}
+
+// The atlas is laid out for the FED3 screen orientation (rotation 3), where a glyph column
+// lands on a single row of the frame buffer
+bool FED3_SharpMem::canBlit()
+{
+    if (buffer == NULL || atlasFont == NULL || gfxFont == NULL || textsize_x != 1 || textsize_y != 1 || rotation != 3)
+        return false;
+    if (gfxFont == atlasFont)
+        return true;
+    for (uint8_t i = 0; i < FED3_ATLAS_FONTS; i++)
+    {
+        if (knownFonts[i] == gfxFont)
+            return knownSame[i];
+    }
+
+    // Compared once per font address, the oldest is replaced when the table is full
+    bool same = sameFont(gfxFont);
+    knownFonts[knownNext] = gfxFont;
+    knownSame[knownNext] = same;
+    knownNext = (knownNext + 1) % FED3_ATLAS_FONTS;
+    return same;
+}
+
+// The font headers define their GFXfont as a const object, so each file that includes one has its own
+// copy at its own address. A font counts as the atlas font when its glyphs and bitmaps are the same.
+bool FED3_SharpMem::sameFont(const GFXfont *font)
+{
+    uint16_t first = pgm_read_word(&font->first);
+    uint16_t last = pgm_read_word(&font->last);
+    if (first != pgm_read_word(&atlasFont->first) || last != pgm_read_word(&atlasFont->last) ||
+        pgm_read_byte(&font->yAdvance) != pgm_read_byte(&atlasFont->yAdvance))
+        return false;
+
+    const uint8_t *glyphs = (const uint8_t *)pgm_read_ptr(&font->glyph);
+    const uint8_t *atlasGlyphTable = (const uint8_t *)pgm_read_ptr(&atlasFont->glyph);
+    uint32_t bitmapSize = 0;
+    for (uint16_t c = 0; c <= last - first; c++)
+    {
+        const GFXglyph *glyph = (const GFXglyph *)(glyphs + c * sizeof(GFXglyph));
+        for (uint8_t i = 0; i < sizeof(GFXglyph); i++)
+        {
+            if (pgm_read_byte(glyphs + c * sizeof(GFXglyph) + i) != pgm_read_byte(atlasGlyphTable + c * sizeof(GFXglyph) + i))
+                return false;
+        }
+        uint32_t end = pgm_read_word(&glyph->bitmapOffset) +
+                       ((uint16_t)pgm_read_byte(&glyph->width) * pgm_read_byte(&glyph->height) + 7) / 8;
+        if (end > bitmapSize)
+            bitmapSize = end;
+    }
+
+    const uint8_t *bitmap = (const uint8_t *)pgm_read_ptr(&font->bitmap);
+    const uint8_t *atlasBitmap = (const uint8_t *)pgm_read_ptr(&atlasFont->bitmap);
+    for (uint32_t i = 0; i < bitmapSize; i++)
+    {
+        if (pgm_read_byte(bitmap + i) != pgm_read_byte(atlasBitmap + i))
+            return false;
+    }
+    return true;
+}
+
+// Write one glyph column (mask bit n = pixel y + n) in the current text color
+void FED3_SharpMem::blitColumn(int16_t x, int16_t y, uint32_t mask, uint8_t height)
+{
+    if (mask == 0 || x < 0 || x >= _width)
+        return;
+
+    // Clip rows against the top and bottom of the screen
+    if (y < 0)
+    {
+        if (-y >= height)
+            return;
+        mask >>= -y;
+        y = 0;
+    }
+    if (y >= _height)
+        return;
+    if (_height - y < 32)
+        mask &= (1UL << (_height - y)) - 1;
+
+    // Rotation 3: screen x maps to buffer row HEIGHT - 1 - x, screen y maps to buffer column y
+    uint8_t *p = buffer + ((HEIGHT - 1 - x) * WIDTH + y) / 8;
+    mask <<= (y & 7);
+    while (mask)
+    {
+        uint8_t m = mask & 0xFF;
+        if (m)
+        {
+            if (textcolor)
+                *p |= m;
+            else
+                *p &= ~m;
+        }
+        mask >>= 8;
+        p++;
+    }
+}
+
+/**
+ * Prints text at the cursor, producing the same pixels as display.print(text).
+ * Characters in FED3_ATLAS_CHARS are copied from the glyph atlas, anything else is drawn by Adafruit_GFX.
+ *
+ * @param text The text to print
+ * @param bold Draw each glyph one pixel wider, matching the "print twice with a one pixel offset" bold
+ *             used across the FED3 screens. The cursor advances as for regular text.
+ */
+void FED3_SharpMem::printFast(const char *text, bool bold)
+{
+    int16_t x0 = cursor_x, y0 = cursor_y;
+
+    if (bold)
+    {
+        // Merge each glyph with its one pixel shifted copy. If either copy would wrap or
+        // contains characters outside the atlas, draw the two copies with Adafruit_GFX.
+        bool fast = canBlit();
+        int16_t x = x0;
+        for (const char *c = text; *c && fast; c++)
+        {
+            const AtlasGlyph *g = findGlyph(*c);
+            if (g == NULL || (wrap && g->width > 0 && x + 1 + g->xOffset + g->width > _width))
+                fast = false;
+            else
+                x += g->xAdvance;
+        }
+        if (!fast)
+        {
+            setCursor(x0 + 1, y0);
+            print(text);
+            setCursor(x0, y0);
+            print(text);
+            return;
+        }
+
+        for (const char *c = text; *c; c++)
+        {
+            const AtlasGlyph *g = findGlyph(*c);
+            if (g->width > 0 && g->height > 0)
+            {
+                const uint32_t *cols = &atlasColumns[g->column];
+                for (uint8_t xx = 0; xx <= g->width; xx++)
+                {
+                    uint32_t mask = (xx < g->width ? cols[xx] : 0) | (xx > 0 ? cols[xx - 1] : 0);
+                    blitColumn(cursor_x + g->xOffset + xx, cursor_y + g->yOffset, mask, g->height);
+                }
+            }
+            cursor_x += g->xAdvance;
+        }
+        return;
+    }
+
+    bool fast = canBlit();
+    for (const char *c = text; *c; c++)
+    {
+        const AtlasGlyph *g = fast ? findGlyph(*c) : NULL;
+        if (g == NULL)
+        {
+            write((uint8_t)*c);
+            continue;
+        }
+        if (g->width > 0 && g->height > 0)
+        {
+            // same wrapping rule as Adafruit_GFX::write()
+            if (wrap && (cursor_x + g->xOffset + g->width) > _width)
+            {
+                cursor_x = 0;
+                cursor_y += (uint8_t)pgm_read_byte(&atlasFont->yAdvance);
+            }
+            const uint32_t *cols = &atlasColumns[g->column];
+            for (uint8_t xx = 0; xx < g->width; xx++)
+            {
+                blitColumn(cursor_x + g->xOffset + xx, cursor_y + g->yOffset, cols[xx], g->height);
+            }
+        }
+        cursor_x += g->xAdvance;
+    }
+}
+
+void FED3_SharpMem::printFast(long value, bool bold)
+{
+    char text[12];
+    ltoa(value, text, 10);
+    printFast(text, bold);
+}
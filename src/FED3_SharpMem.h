@@ -0,0 +1,74 @@
+/*
+Sharp Memory LCD driver for FED3
+
+Drop-in replacement for Adafruit_SharpMem that keeps the frame buffer accessible
+to the library, so text can be blitted from a pre-rendered glyph atlas instead of
+being drawn one drawPixel() call at a time through Adafruit_GFX.
+
+The SPI protocol follows the Adafruit_SharpMem driver (BSD license, Adafruit Industries).
+*/
+
+#ifndef FED3_SHARPMEM_H
+#define FED3_SHARPMEM_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SPIDevice.h>
+
+// Characters pre-rendered into the glyph atlas: digits, clock and interval
+// punctuation, and the letters used by the fixed labels on the main screen
+#define FED3_ATLAS_CHARS "0123456789:/. -msFEDLeftRighPl"
+#define FED3_ATLAS_MAX_COLUMNS 400 // total glyph columns the atlas can hold
+#define FED3_ATLAS_FONTS 4          // fonts remembered by canBlit(), each file that includes a font header has a copy
+
+class FED3_SharpMem : public Adafruit_GFX
+{
+public:
+    FED3_SharpMem(uint8_t clk, uint8_t mosi, uint8_t cs, uint16_t width = 96, uint16_t height = 96, uint32_t freq = 2000000);
+
+    boolean begin();
+    void drawPixel(int16_t x, int16_t y, uint16_t color);
+    uint8_t getPixel(uint16_t x, uint16_t y);
+    void clearDisplay();
+    void clearDisplayBuffer();
+    void refresh();
+
+    // Glyph atlas
+    bool buildGlyphAtlas(const GFXfont *font);
+    void printFast(const char *text, bool bold = false);
+    void printFast(long value, bool bold = false);
+
+    uint8_t *getBuffer() { return buffer; }
+    unsigned long refreshCount = 0; // refresh() and clearDisplay() transfers, for energy accounting
+    void writePBM(Print &out);
+
+private:
+    struct AtlasGlyph
+    {
+        uint16_t column; // first column mask in atlasColumns
+        uint8_t width;
+        uint8_t height;
+        uint8_t xAdvance;
+        int8_t xOffset;
+        int8_t yOffset;
+    };
+
+    Adafruit_SPIDevice *spidev = NULL;
+    uint8_t *buffer = NULL;
+    uint8_t _cs;
+    uint8_t vcom;
+
+    const GFXfont *atlasFont = NULL;
+    const GFXfont *knownFonts[FED3_ATLAS_FONTS] = {}; // fonts compared with the atlas font, see sameFont()
+    bool knownSame[FED3_ATLAS_FONTS] = {};
+    uint8_t knownNext = 0;
+    AtlasGlyph atlasGlyphs[sizeof(FED3_ATLAS_CHARS) - 1];
+    uint32_t atlasColumns[FED3_ATLAS_MAX_COLUMNS]; // one mask per glyph column, bit n = glyph row n
+
+    const AtlasGlyph *findGlyph(char c);
+    bool canBlit();
+    bool sameFont(const GFXfont *font);
+    void blitColumn(int16_t x, int16_t y, uint32_t mask, uint8_t height);
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Session statistics
+**************************************************************************************************************************************************/
+// logdata() passes every row to statsEvent(), which updates these in constant time and without allocating: one
+// minute bins for the rolling last hour, one bin per clock hour for the last day, Welford's running mean and
+// variance of the retrieval time, and meals (pellets no more than mealGapSec apart, as in fed3_logstats).
+// run() moves the bins along with the clock between events. Pokes and pellets are counted as they are logged,
+// so pokes during a timeout or with a pellet in the well count too, like in the log readers in extras/tools.
+//
+//   if (fed3.pelletsLastHour() > 30)         // e.g. a higher ratio while the mouse eats fast
+//       fed3.FR = 5;
+//   FED3_StatsHour hour = fed3.statsHour(1); // the previous clock hour
+//   fed3.displayStats = true;                // pellets per hour for the last day on the screen
+
+byte FED3::statsEventType(const String &event)
+{
+    return statsEventType(event.c_str());
+}
+
+byte FED3::statsEventType(const char *event)
+{
+    if (strncmp(event, "Left", 4) == 0)
+        return STATS_EVENT_LEFT;
+    if (strncmp(event, "Right", 5) == 0)
+        return STATS_EVENT_RIGHT;
+    if (strcmp(event, "Pellet") == 0)
+        return STATS_EVENT_PELLET;
+    if (strcmp(event, "PelletStuck") == 0)
+        return STATS_EVENT_JAM;
+    return STATS_EVENT_OTHER;
+}
+
+// Minute bins are bytes, a bin that is full stops counting so the rolling sum stays the sum of the bins
+static void countMinute(uint8_t &bin, uint16_t &sum)
+{
+    if (bin < 255)
+    {
+        bin++;
+        sum++;
+    }
+}
+
+void FED3::statsEvent(byte event, uint32_t unixTime)
+{
+    countStatsEvent(event, unixTime, activePoke == 1, retInterval);
+}
+
+// An event with the active side and retrieval time it was logged with
+void FED3::countStatsEvent(byte event, uint32_t unixTime, bool activeLeft, int retrievalMs)
+{
+    advanceStats(unixTime);
+    byte minute = statsMinute % STATS_MINUTES;
+    FED3_StatsHour &hour = statsHours[statsHourIndex % STATS_HOURS];
+
+    if (event == STATS_EVENT_LEFT || event == STATS_EVENT_RIGHT)
+    {
+        bool left = (event == STATS_EVENT_LEFT);
+        if (left)
+            hour.leftPokes++;
+        else
+            hour.rightPokes++;
+        countMinute(statsMinutePokes[minute], rollingPokes);
+        if (left == activeLeft)
+        {
+            hour.activePokes++;
+            countMinute(statsMinuteActive[minute], rollingActive);
+        }
+    }
+    else if (event == STATS_EVENT_PELLET)
+    {
+        hour.pellets++;
+        countMinute(statsMinutePellets[minute], rollingPellets);
+
+        if (retrievalMs < 60000)
+        {
+            float seconds = retrievalMs / 1000.0;
+            statsRetrievals++;
+            float delta = seconds - statsRetrievalMean;
+            statsRetrievalMean += delta / statsRetrievals;
+            statsRetrievalM2 += delta * (seconds - statsRetrievalMean);
+            hour.retrievals++;
+            hour.retrievalMs += retrievalMs;
+        }
+        else
+        {
+            hour.timedOut++;
+        }
+
+        // A pellet more than mealGapSec after the last one starts a new run, a run counts as a meal once it
+        // has mealMinPellets pellets
+        if (lastMealPellet != 0 && unixTime - lastMealPellet <= mealGapSec)
+            mealPellets++;
+        else
+            mealPellets = 1;
+        lastMealPellet = unixTime;
+        if (mealPellets == mealMinPellets)
+        {
+            mealCount++;
+            hour.meals++;
+        }
+    }
+    else if (event == STATS_EVENT_JAM)
+    {
+        hour.jams++;
+    }
+}
+
+// Clear the bins the clock has moved past, at most every bin once. Setting the clock back clears them all.
+void FED3::advanceStats(uint32_t unixTime)
+{
+    uint32_t minute = unixTime / 60;
+    if (minute != statsMinute)
+    {
+        uint32_t steps = (minute > statsMinute && minute - statsMinute < STATS_MINUTES) ? minute - statsMinute : STATS_MINUTES;
+        for (uint32_t i = 1; i <= steps; i++)
+        {
+            byte bin = (statsMinute + i) % STATS_MINUTES;
+            rollingPellets -= statsMinutePellets[bin];
+            rollingPokes -= statsMinutePokes[bin];
+            rollingActive -= statsMinuteActive[bin];
+            statsMinutePellets[bin] = 0;
+            statsMinutePokes[bin] = 0;
+            statsMinuteActive[bin] = 0;
+        }
+        statsMinute = minute;
+    }
+
+    uint32_t hour = unixTime / 3600;
+    if (hour != statsHourIndex)
+    {
+        uint32_t steps = (hour > statsHourIndex && hour - statsHourIndex < STATS_HOURS) ? hour - statsHourIndex : STATS_HOURS;
+        for (uint32_t i = 1; i <= steps; i++)
+        {
+            memset(&statsHours[(statsHourIndex + i) % STATS_HOURS], 0, sizeof(FED3_StatsHour));
+        }
+        statsHourIndex = hour;
+    }
+}
+
+unsigned int FED3::pelletsLastHour()
+{
+    return rollingPellets;
+}
+
+unsigned int FED3::pokesLastHour()
+{
+    return rollingPokes;
+}
+
+float FED3::pokeEfficiencyLastHour()
+{
+    return rollingPokes ? (float)rollingActive / rollingPokes : 0;
+}
+
+unsigned long FED3::retrievalCount()
+{
+    return statsRetrievals;
+}
+
+float FED3::retrievalMean()
+{
+    return statsRetrievalMean;
+}
+
+float FED3::retrievalSD()
+{
+    return statsRetrievals > 1 ? sqrt(statsRetrievalM2 / (statsRetrievals - 1)) : 0;
+}
+
+FED3_StatsHour FED3::statsHour(byte hoursAgo)
+{
+    FED3_StatsHour empty = {};
+    if (hoursAgo >= STATS_HOURS || statsHourIndex == 0)
+        return empty;
+    return statsHours[(statsHourIndex - hoursAgo) % STATS_HOURS];
+}
+
+FED3_StatsHour FED3::statsLastDay()
+{
+    FED3_StatsHour day = {};
+    for (byte i = 0; i < STATS_HOURS; i++)
+    {
+        addStatsHour(day, statsHours[i]);
+    }
+    return day;
+}
+
+void FED3::addStatsHour(FED3_StatsHour &total, const FED3_StatsHour &hour)
+{
+    total.pellets += hour.pellets;
+    total.leftPokes += hour.leftPokes;
+    total.rightPokes += hour.rightPokes;
+    total.activePokes += hour.activePokes;
+    total.meals += hour.meals;
+    total.retrievals += hour.retrievals;
+    total.timedOut += hour.timedOut;
+    total.jams += hour.jams;
+    total.retrievalMs += hour.retrievalMs;
+}
+
+bool FED3::inMeal()
+{
+    return mealPellets >= mealMinPellets && lastMealPellet != 0 && unixtime - lastMealPellet <= mealGapSec;
+}
+
+void FED3::resetStats()
+{
+    memset(statsMinutePellets, 0, sizeof(statsMinutePellets));
+    memset(statsMinutePokes, 0, sizeof(statsMinutePokes));
+    memset(statsMinuteActive, 0, sizeof(statsMinuteActive));
+    memset(statsHours, 0, sizeof(statsHours));
+    rollingPellets = 0;
+    rollingPokes = 0;
+    rollingActive = 0;
+    statsMinute = 0;
+    statsHourIndex = 0;
+    statsRetrievals = 0;
+    statsRetrievalMean = 0;
+    statsRetrievalM2 = 0;
+    mealCount = 0;
+    mealPellets = 0;
+    lastMealPellet = 0;
+}
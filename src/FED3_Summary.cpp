@@ -0,0 +1,349 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Hourly and daily summaries
+**************************************************************************************************************************************************/
+// When a clock hour ends, run() appends one row to HOURS###.CSV (### is the device number). The row has the
+// hour's counts from the session statistics (statsHour()) and the mean battery voltage and temperature of the
+// rows logged in that hour. An hour with no logged rows uses one reading taken when it ends. The first wake after
+// midnight appends the day's totals to DAYS###.CSV, with the number of hours they cover. Each bin is written once,
+// when it is complete. The open hour and day are kept in RAM.
+//
+// SUMMARY.DAT holds the open hour, the day's totals so far and the log files the open hour was logged to. It is
+// written once an hour and when a new log file starts. After a reset, begin() reads back the log rows of the open
+// hour through the log index and counts them again. If that hour has ended, its row is written. Hours after the
+// last logged row get no row, because the device may have been off for them. Setting the clock back starts new
+// bins from the new time. The state that closes a bin is saved before its row is appended, so a reset in between
+// loses that row rather than writing it twice.
+
+#define SUMMARY_STATE_FILE "SUMMARY.DAT"
+#define SUMMARY_CHECK 0xFED35EA1UL
+
+static uint32_t summaryCheck(const void *data, size_t size)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261UL;
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 16777619UL;
+    }
+    return hash ^ SUMMARY_CHECK;
+}
+
+static void addSummaryBin(FED3_SummaryBin &total, const FED3_SummaryBin &bin)
+{
+    FED3::addStatsHour(total.events, bin.events);
+    total.batteryV += bin.batteryV;
+    total.temperatureC += bin.temperatureC;
+    total.batteryReadings += bin.batteryReadings;
+    total.temperatureReadings += bin.temperatureReadings;
+}
+
+// Called by run() and logdata(), closes the hours the clock has moved past
+void FED3::serviceSummary(uint32_t unixTime)
+{
+    uint32_t hour = unixTime / 3600;
+    if (hour == summaryHour)
+        return;
+    if (summaryHour != 0 && hour > summaryHour)
+    {
+        // Hours the device slept through are written with no events, the statistics only go back STATS_HOURS
+        uint32_t last = hour - summaryHour < STATS_HOURS ? hour : summaryHour + STATS_HOURS;
+        for (uint32_t h = summaryHour; h < last; h++)
+        {
+            closeSummaryHour(h);
+        }
+    }
+    memset(&summaryBin, 0, sizeof(summaryBin));
+
+    if (hour / 24 != summaryDay)
+    {
+        uint32_t day = summaryDay;
+        uint16_t dayHours = summaryDayHours;
+        FED3_SummaryBin dayBin = summaryDayBin;
+        memset(&summaryDayBin, 0, sizeof(summaryDayBin));
+        summaryDayHours = 0;
+        summaryDay = hour / 24;
+        summaryHour = hour;
+        saveSummaryState();
+        if (dayHours > 0)
+        {
+            writeSummaryRow("DAYS", day * 86400UL, dayHours, dayBin);
+        }
+    }
+    if (summaryHour != hour)
+    {
+        summaryHour = hour;
+        saveSummaryState();
+    }
+}
+
+// Called by logdata() with the battery voltage and temperature (NAN without the sensor) it logged
+void FED3::addSummaryReading(uint32_t unixTime, float batteryV, float temperatureC)
+{
+    serviceSummary(unixTime);
+    summaryBin.batteryV += batteryV;
+    summaryBin.batteryReadings++;
+    if (!isnan(temperatureC))
+    {
+        summaryBin.temperatureC += temperatureC;
+        summaryBin.temperatureReadings++;
+    }
+}
+
+// Closes the open hour, or an hour slept through once the open one is closed
+void FED3::closeSummaryHour(uint32_t hour)
+{
+    FED3_SummaryBin bin = summaryBin;
+    memset(&summaryBin, 0, sizeof(summaryBin)); // the next hour starts empty
+    memset(&bin.events, 0, sizeof(bin.events));
+    if (hour <= statsHourIndex && statsHourIndex - hour < STATS_HOURS)
+    {
+        bin.events = statsHour(statsHourIndex - hour);
+    }
+
+    // An hour with no rows logged gets one reading now
+    if (bin.batteryReadings == 0)
+    {
+        ReadBatteryLevel();
+        bin.batteryV = measuredvbat;
+        bin.batteryReadings = 1;
+        if (tempSensor)
+        {
+            sensors_event_t humidity, temp;
+            aht.getEvent(&humidity, &temp);
+            bin.temperatureC = temp.temperature;
+            bin.temperatureReadings = 1;
+        }
+    }
+
+    addSummaryBin(summaryDayBin, bin);
+    summaryDayHours++;
+    summaryHour = hour + 1;
+    saveSummaryState();
+    writeSummaryRow("HOURS", hour * 3600UL, 1, bin);
+}
+
+void FED3::writeSummaryRow(const char *prefix, uint32_t start, uint16_t hours, const FED3_SummaryBin &bin)
+{
+    char summaryFile[16];
+    snprintf(summaryFile, sizeof(summaryFile), "%s%03d.CSV", prefix, FED);
+
+    SdFile summaryfile;
+    if (!summaryfile.open(summaryFile, O_WRITE | O_CREAT | O_APPEND))
+        return;
+    if (summaryfile.fileSize() == 0)
+    {
+        summaryfile.println("MM:DD:YYYY hh:mm:ss,Library_Version,Session_type,Device_Number,Hours,Left_Pokes,Right_Pokes,Active_Pokes,Pellets,Meals,Retrieval_Mean_s,Timed_Out,Jams,Battery_V,Temp_C");
+    }
+    DateTime time(start);
+    char stamp[FED3_STAMP_CHARS];
+    formatStamp(stamp, time);
+    summaryfile.print(stamp);
+    summaryfile.print(",");
+    summaryfile.print(VER);
+    summaryfile.print(",");
+    summaryfile.print(sessiontype);
+    summaryfile.print(",");
+    summaryfile.print(FED);
+    summaryfile.print(",");
+    summaryfile.print(hours);
+    summaryfile.print(",");
+    summaryfile.print(bin.events.leftPokes);
+    summaryfile.print(",");
+    summaryfile.print(bin.events.rightPokes);
+    summaryfile.print(",");
+    summaryfile.print(bin.events.activePokes);
+    summaryfile.print(",");
+    summaryfile.print(bin.events.pellets);
+    summaryfile.print(",");
+    summaryfile.print(bin.events.meals);
+    summaryfile.print(",");
+    if (bin.events.retrievals > 0)
+        summaryfile.print(bin.events.retrievalMs / 1000.0 / bin.events.retrievals, 2);
+    else
+        summaryfile.print(sqrt(-1));
+    summaryfile.print(",");
+    summaryfile.print(bin.events.timedOut);
+    summaryfile.print(",");
+    summaryfile.print(bin.events.jams);
+    summaryfile.print(",");
+    if (bin.batteryReadings > 0)
+        summaryfile.print(bin.batteryV / bin.batteryReadings, 2);
+    else
+        summaryfile.print(sqrt(-1));
+    summaryfile.print(",");
+    if (bin.temperatureReadings > 0)
+        summaryfile.println(bin.temperatureC / bin.temperatureReadings, 1);
+    else
+        summaryfile.println(sqrt(-1));
+    summaryfile.sync();
+    summaryfile.close();
+    noteSdSync();
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Summary state
+**************************************************************************************************************************************************/
+// Two copies in turn, so a power loss while one is written leaves the other
+void FED3::saveSummaryState()
+{
+    // filename is empty while begin() replays the last log
+    if (filename[0] != 0 && strcmp(summaryLogs[1], filename) != 0)
+    {
+        strcpy(summaryLogs[0], summaryLogs[1]);
+        strcpy(summaryLogs[1], filename);
+    }
+
+    SummaryState state;
+    memset(&state, 0, sizeof(state));
+    state.sequence = ++summarySequence;
+    state.hour = summaryHour;
+    state.day = summaryDay;
+    state.dayHours = summaryDayHours;
+    state.dayBin = summaryDayBin;
+    memcpy(state.logs, summaryLogs, sizeof(state.logs));
+    state.check = summaryCheck(&state, offsetof(SummaryState, check));
+
+    SdFile statefile;
+    if (!statefile.open(SUMMARY_STATE_FILE, O_WRITE | O_CREAT))
+        return;
+    statefile.seekSet((state.sequence & 1) * sizeof(SummaryState));
+    statefile.write((const uint8_t *)&state, sizeof(state));
+    statefile.sync();
+    statefile.close();
+    noteSdSync();
+}
+
+bool FED3::loadSummaryState(SummaryState &state)
+{
+    SdFile statefile;
+    if (!statefile.open(SUMMARY_STATE_FILE, O_READ))
+        return false;
+    bool found = false;
+    for (byte copy = 0; copy < 2; copy++)
+    {
+        SummaryState read;
+        if (statefile.read(&read, sizeof(read)) == (int)sizeof(read) &&
+            read.check == summaryCheck(&read, offsetof(SummaryState, check)) &&
+            (!found || read.sequence > state.sequence))
+        {
+            state = read;
+            found = true;
+        }
+    }
+    statefile.close();
+    return found;
+}
+
+// Called by begin() before the new log file is created
+void FED3::recoverSummary()
+{
+    uint32_t now = rtc.now().unixtime();
+    SummaryState state;
+    if (loadSummaryState(state) && state.hour != 0 && state.hour <= now / 3600)
+    {
+        summarySequence = state.sequence;
+        summaryHour = state.hour;
+        summaryDay = state.day;
+        summaryDayHours = state.dayHours;
+        summaryDayBin = state.dayBin;
+        memcpy(summaryLogs, state.logs, sizeof(summaryLogs));
+
+        for (byte i = 0; i < 2; i++)
+        {
+            if (summaryLogs[i][0] != 0 && (i == 1 || strcmp(summaryLogs[0], summaryLogs[1]) != 0))
+                replaySummaryLog(summaryLogs[i], state.hour * 3600UL, now);
+        }
+
+        // The hour of the last logged row is complete unless it is this hour
+        if (summaryHour < now / 3600)
+        {
+            closeSummaryHour(summaryHour);
+            summaryHour = 0;
+        }
+    }
+    serviceSummary(now);
+}
+
+// Split a row at its commas, in place
+static byte splitRow(char *row, char **fields, byte maxFields)
+{
+    byte n = 0;
+    fields[n++] = row;
+    for (char *p = row; *p && n < maxFields; p++)
+    {
+        if (*p == ',')
+        {
+            *p = 0;
+            fields[n++] = p + 1;
+        }
+    }
+    return n;
+}
+
+static int findColumn(char **fields, byte count, const char *name)
+{
+    for (byte i = 0; i < count; i++)
+    {
+        if (strcmp(fields[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Count the rows of a log from `from` to `to` again, as logdata() did when it wrote them
+void FED3::replaySummaryLog(const char *name, uint32_t from, uint32_t to)
+{
+    const byte maxFields = 32;
+    char row[320];
+    char *fields[maxFields];
+
+    // Columns differ between the Bandit and other layouts and with the temperature sensor
+    if (!logReader.open(name, O_READ))
+        return;
+    int n = readLogRow(row, sizeof(row));
+    closeLog();
+    if (n <= 0)
+        return;
+    byte count = splitRow(row, fields, maxFields);
+    int eventColumn = findColumn(fields, count, "Event");
+    int retrievalColumn = findColumn(fields, count, "Retrieval_Time");
+    int activeColumn = findColumn(fields, count, "Active_Poke");
+    if (activeColumn < 0)
+        activeColumn = findColumn(fields, count, "High_prob_poke");
+    int batteryColumn = findColumn(fields, count, "Battery_Voltage");
+    int temperatureColumn = findColumn(fields, count, "Temp");
+    if (eventColumn < 0 || retrievalColumn < 0 || activeColumn < 0 || batteryColumn < 0)
+        return;
+    int lastColumn = max(max(eventColumn, retrievalColumn), max(activeColumn, max(batteryColumn, temperatureColumn)));
+
+    if (!openLogAt(from, name))
+        return;
+    while (readLogRow(row, sizeof(row)) >= 0)
+    {
+        uint32_t t;
+        if (!rowTime(row, t))
+            continue;
+        if (t > to)
+            break;
+        if (splitRow(row, fields, maxFields) <= lastColumn)
+            continue;
+
+        const char *retrieval = fields[retrievalColumn];
+        int retrievalMs = 0;
+        if (retrieval[0] == 'T')
+            retrievalMs = 60000; // Timed_out
+        else if (retrieval[0] >= '0' && retrieval[0] <= '9')
+            retrievalMs = atof(retrieval) * 1000 + 0.5;
+        countStatsEvent(statsEventType(fields[eventColumn]), t, fields[activeColumn][0] == 'L', retrievalMs);
+
+        float temperature = NAN;
+        if (temperatureColumn >= 0 && fields[temperatureColumn][0] != 'n')
+            temperature = atof(fields[temperatureColumn]);
+        addSummaryReading(t, atof(fields[batteryColumn]), temperature);
+    }
+    closeLog();
+}
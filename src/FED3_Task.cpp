@@ -0,0 +1,241 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Task engine
+**************************************************************************************************************************************************/
+// A task is a table of transitions (state, event, guard, actions, next state). run() turns pokes and the
+// state timer into events, and the first transition matching the current state, the event and its guard
+// is taken. A state timer is armed on entering a state and runs on the deadline table, so the device
+// sleeps between events. Parameters come from the usual FED3 variables (FR, timeout, prob_left, ...).
+//
+//   fed3.FR = 5;
+//   fed3.startTask(FED3_FixedRatio); // before begin(), so the log header has the task's session type
+//   fed3.begin();
+//
+// Sketches can write their own tables in the same format, see examples/3_Beta_Programs/TaskEngine.
+
+// Fixed ratio: FR active pokes deliver a pellet, then a timeout of `timeout` seconds
+static const FED3_Transition fixedRatioTable[] = {
+    {0, TASK_EVENT_ACTIVE, TASK_GUARD_RATIO, TASK_LOG_POKE | TASK_STIMULUS | TASK_FEED | TASK_RESET_COUNT, 1},
+    {0, TASK_EVENT_ACTIVE, TASK_GUARD_NONE, TASK_LOG_POKE | TASK_COUNT, TASK_STAY},
+    {0, TASK_EVENT_INACTIVE, TASK_GUARD_NONE, TASK_LOG_POKE, TASK_STAY},
+    {1, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_TIMEOUT_POKE, TASK_STAY},
+    {1, TASK_EVENT_TIMER, TASK_GUARD_NONE, 0, 0},
+};
+static const byte fixedRatioTimers[] = {TASK_TIMER_NONE, TASK_TIMER_TIMEOUT};
+const FED3_Task FED3_FixedRatio = {NULL, fixedRatioTable, 5, fixedRatioTimers, 2};
+
+// Progressive ratio: the ratio follows prSchedule (Richardson & Roberts by default), pokes short of it click
+static const FED3_Transition progressiveRatioTable[] = {
+    {0, TASK_EVENT_ACTIVE, TASK_GUARD_RATIO, TASK_LOG_POKE | TASK_STIMULUS | TASK_FEED | TASK_RESET_COUNT | TASK_PR_STEP, TASK_STAY},
+    {0, TASK_EVENT_ACTIVE, TASK_GUARD_NONE, TASK_LOG_POKE | TASK_COUNT | TASK_CLICK, TASK_STAY},
+    {0, TASK_EVENT_INACTIVE, TASK_GUARD_NONE, TASK_LOG_POKE, TASK_STAY},
+};
+static const byte progressiveRatioTimers[] = {TASK_TIMER_NONE};
+const FED3_Task FED3_ProgressiveRatio = {"ProgRat", progressiveRatioTable, 3, progressiveRatioTimers, 1};
+
+// Extinction: pokes are logged and nothing is delivered
+static const FED3_Transition extinctionTable[] = {
+    {0, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_POKE, TASK_STAY},
+};
+static const byte extinctionTimers[] = {TASK_TIMER_NONE};
+const FED3_Task FED3_Extinction = {"Ext", extinctionTable, 1, extinctionTimers, 1};
+
+// Pavlovian: after `timeout` seconds a cue plays, taskDelaySec later a pellet drops, pokes are only logged
+static const FED3_Transition pavlovianTable[] = {
+    {0, TASK_EVENT_TIMER, TASK_GUARD_NONE, TASK_STIMULUS, 1},
+    {1, TASK_EVENT_TIMER, TASK_GUARD_NONE, TASK_FEED, 0},
+    {0, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_POKE, TASK_STAY},
+    {1, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_POKE, TASK_STAY},
+};
+static const byte pavlovianTimers[] = {TASK_TIMER_TIMEOUT, TASK_TIMER_DELAY};
+const FED3_Task FED3_Pavlovian = {"Pavlov", pavlovianTable, 4, pavlovianTimers, 2};
+
+// Two-armed bandit: choiceDelayMs after a poke it is rewarded with the probability of its side, misses start
+// a timeout with white noise that restarts on every poke. Blocks follow the bandit plan, see FED3_Bandit.cpp.
+static const FED3_Transition banditTable[] = {
+    {0, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_POKE | TASK_CHOICE, 1},
+    {1, TASK_EVENT_TIMER, TASK_GUARD_CHANCE, TASK_STIMULUS | TASK_FEED | TASK_BLOCK_STEP, 0},
+    {1, TASK_EVENT_TIMER, TASK_GUARD_NONE, TASK_ERROR_TONE | TASK_NOISE_ON, 2},
+    {1, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_TIMEOUT_POKE, TASK_STAY},
+    {2, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_TIMEOUT_POKE, 2},
+    {2, TASK_EVENT_TIMER, TASK_GUARD_NONE, TASK_NOISE_OFF, 0},
+};
+static const byte banditTimers[] = {TASK_TIMER_NONE, TASK_TIMER_CHOICE, TASK_TIMER_TIMEOUT};
+const FED3_Task FED3_Bandit = {"Bandit", banditTable, 6, banditTimers, 3};
+
+// Timed feeding: active pokes are rewarded between timedStart and timedEnd
+static const FED3_Transition timedFeedingTable[] = {
+    {0, TASK_EVENT_ACTIVE, TASK_GUARD_WINDOW, TASK_LOG_POKE | TASK_STIMULUS | TASK_FEED, TASK_STAY},
+    {0, TASK_EVENT_POKE, TASK_GUARD_NONE, TASK_LOG_POKE, TASK_STAY},
+};
+static const byte timedFeedingTimers[] = {TASK_TIMER_NONE};
+const FED3_Task FED3_TimedFeeding = {"Timed", timedFeedingTable, 2, timedFeedingTimers, 1};
+
+static const FED3_Note errorThenNoise[] = {{300, 600}, {AUDIO_NOISE, AUDIO_UNTIL_STOPPED}};
+
+void FED3::startTask(const FED3_Task &newTask)
+{
+    task = &newTask;
+    if (task->name != NULL)
+        sessiontype = task->name;
+    taskPokes = 0;
+
+    // Show the feeding window on screen when the task uses it, start PR tasks on the first ratio and
+    // draw the block plan of bandit tasks
+    bool progressive = false;
+    for (byte i = 0; i < task->transitionCount; i++)
+    {
+        if (task->transitions[i].guard == TASK_GUARD_WINDOW)
+            DisplayTimed = true;
+        if (task->transitions[i].actions & TASK_PR_STEP)
+            progressive = true;
+        if ((task->transitions[i].actions & TASK_BLOCK_STEP) && !banditPlanned)
+            initBanditTask(pelletsToSwitch > 0 ? pelletsToSwitch : 30, allowBlockRepeat);
+    }
+    if (progressive)
+    {
+        if (prSchedule == NULL)
+            prSchedule = &defaultPRSchedule;
+        prSchedule->reset();
+        FR = prSchedule->required();
+    }
+    enterTaskState(0);
+}
+
+void FED3::stopTask()
+{
+    task = NULL;
+    clearDeadline(DEADLINE_TASK);
+}
+
+// Called from run(), turns pokes and the state timer into events
+void FED3::serviceTask()
+{
+    if (task == NULL)
+        return;
+    if (deadlinePassed(DEADLINE_TASK))
+        taskEvent(TASK_EVENT_TIMER);
+    if (Left)
+        taskEvent(TASK_EVENT_LEFT);
+    if (Right)
+        taskEvent(TASK_EVENT_RIGHT);
+}
+
+void FED3::taskEvent(byte event)
+{
+    if (task == NULL)
+        return;
+
+    bool left = (event == TASK_EVENT_LEFT);
+    bool poke = left || event == TASK_EVENT_RIGHT;
+    bool active = poke && (left == (activePoke == 1));
+    if (left)
+        Left = false;
+    else if (event == TASK_EVENT_RIGHT)
+        Right = false;
+    if (poke)
+        taskLastLeft = left;
+
+    for (byte i = 0; i < task->transitionCount; i++)
+    {
+        const FED3_Transition &t = task->transitions[i];
+        if (t.state != taskState)
+            continue;
+
+        bool matches = (t.event == event) ||
+                       (poke && t.event == TASK_EVENT_POKE) ||
+                       (poke && t.event == TASK_EVENT_ACTIVE && active) ||
+                       (poke && t.event == TASK_EVENT_INACTIVE && !active);
+        if (!matches || !taskGuardPasses(t.guard, event))
+            continue;
+
+        runTaskActions(t.actions, left);
+        if (t.next != TASK_STAY)
+            enterTaskState(t.next);
+        return;
+    }
+}
+
+void FED3::enterTaskState(byte state)
+{
+    taskState = state;
+    byte timer = (state < task->stateCount) ? task->stateTimers[state] : TASK_TIMER_NONE;
+    if (timer == TASK_TIMER_TIMEOUT)
+        setDeadline(DEADLINE_TASK, timeout * 1000UL);
+    else if (timer == TASK_TIMER_DELAY)
+        setDeadline(DEADLINE_TASK, taskDelaySec * 1000UL);
+    else if (timer == TASK_TIMER_CHOICE)
+        setDeadline(DEADLINE_TASK, choiceDelayMs);
+    else
+        clearDeadline(DEADLINE_TASK);
+}
+
+bool FED3::taskGuardPasses(byte guard, byte event)
+{
+    switch (guard)
+    {
+    case TASK_GUARD_RATIO:
+        return taskPokes + 1 >= FR;
+    case TASK_GUARD_WINDOW:
+        if (timedStart <= timedEnd)
+            return currentHour >= (unsigned long)timedStart && currentHour < (unsigned long)timedEnd;
+        return currentHour >= (unsigned long)timedStart || currentHour < (unsigned long)timedEnd; // window over midnight
+    case TASK_GUARD_CHANCE:
+        return (int)randomBelow(100) < (taskChoiceLeft ? prob_left : prob_right); // pokes in the choice delay don't change it
+    case TASK_GUARD_CUSTOM:
+        return taskGuard != NULL && taskGuard(taskState, event);
+    default:
+        return true;
+    }
+}
+
+void FED3::runTaskActions(uint16_t actions, bool left)
+{
+    if (actions & TASK_LOG_POKE)
+    {
+        if (left)
+            logLeftPoke();
+        else
+            logRightPoke();
+    }
+    if (actions & TASK_LOG_TIMEOUT_POKE)
+        logTimeoutPoke(left);
+    if (actions & TASK_CHOICE)
+    {
+        taskChoiceLeft = left;
+        countBanditChoice(left);
+    }
+    if (actions & TASK_COUNT)
+        taskPokes++;
+    if (actions & TASK_RESET_COUNT)
+        taskPokes = 0;
+    if (actions & TASK_CLICK)
+        Click();
+    if (actions & TASK_NOISE_OFF)
+        stop();
+    if (actions & TASK_STIMULUS)
+        ConditionedStimulus();
+    if (actions & TASK_FEED)
+        Feed();
+    if ((actions & TASK_ERROR_TONE) && (actions & TASK_NOISE_ON))
+    {
+        play(errorThenNoise, 2); // noise starts when the error tone ends
+    }
+    else if (actions & TASK_ERROR_TONE)
+    {
+        Tone(300, 600);
+    }
+    else if (actions & TASK_NOISE_ON)
+    {
+        playNoise(AUDIO_UNTIL_STOPPED);
+    }
+    if (actions & TASK_PR_STEP)
+        FR = prSchedule->next();
+    if (actions & TASK_BLOCK_STEP)
+    {
+        BlockPelletCount++;
+        banditStats.rewards++;
+        updateBanditBlock();
+    }
+}
@@ -0,0 +1,205 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Hardware timer
+**************************************************************************************************************************************************/
+// One-shot microsecond timer used for outputs that need better timing than delay() and millis().
+// The interrupt calls serviceHardwareTimer(), which services every client and re-arms the timer
+// for the earliest next event.
+//
+// M0:    TC3 clocked from the 48 MHz GCLK0 divided by 16 (tone() uses TC5). Defines TC3_Handler.
+// ESP32: hardware timer on the Arduino core 3.x API, counting at 1 MHz.
+//
+// A second, periodic timer drives the audio engine: TC4 on M0 (TC4_Handler), another hardware timer on ESP32.
+//
+// The Servo library also runs from TC4 on the M0 and defines its own TC4_Handler. FED3's is weak, so a sketch
+// that uses Servo still builds and Servo's handler is the one that runs. Such a sketch must set
+// fed3.audioTimer = false before the first sound, so the library leaves TC4 alone: notes are then played with
+// tone() (TC5) and return when they are done, and sounds that loop until stop(), e.g. the white noise of
+// Timeout(), are not played.
+
+#if defined(ESP32)
+#define IRAM_ISR_ATTR IRAM_ATTR
+static hw_timer_t *fed3Timer = NULL;
+static hw_timer_t *audioHwTimer = NULL; // FED3::audioTimer, the sketch's switch, would hide an audioTimer here
+#elif defined(__arm__)
+#define IRAM_ISR_ATTR
+#define TIMER_TICKS_PER_US 3      // 48 MHz / 16
+#define TIMER_MAX_DELAY_US 21000  // keeps the tick count inside 16 bits, longer waits re-arm
+#endif
+
+static void IRAM_ISR_ATTR hardwareTimerHandler()
+{
+    fed3BoardFED()->serviceHardwareTimer();
+}
+
+static void IRAM_ISR_ATTR audioTimerHandler()
+{
+    fed3BoardFED()->serviceAudio();
+}
+
+#if defined(__arm__)
+static inline void waitTC3Sync()
+{
+    while (TC3->COUNT16.STATUS.bit.SYNCBUSY)
+        ;
+}
+
+static inline void waitTC4Sync()
+{
+    while (TC4->COUNT16.STATUS.bit.SYNCBUSY)
+        ;
+}
+
+extern "C" void TC3_Handler()
+{
+    TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+    TC3->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE; // one shot
+    waitTC3Sync();
+    hardwareTimerHandler();
+}
+
+extern "C" void __attribute__((weak)) TC4_Handler()
+{
+    TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+    audioTimerHandler();
+}
+#endif
+
+void FED3::startHardwareTimer()
+{
+    if (hardwareTimerReady)
+        return;
+
+#if defined(ESP32)
+    fed3Timer = timerBegin(1000000);
+    timerAttachInterrupt(fed3Timer, &hardwareTimerHandler);
+    timerStop(fed3Timer);
+#elif defined(__arm__)
+    PM->APBCMASK.reg |= PM_APBCMASK_TC3;
+    GCLK->CLKCTRL.reg = (uint16_t)(GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID(GCM_TCC2_TC3));
+    while (GCLK->STATUS.bit.SYNCBUSY)
+        ;
+
+    TC3->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    waitTC3Sync();
+    TC3->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER_DIV16;
+    waitTC3Sync();
+    TC3->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+
+    NVIC_SetPriority(TC3_IRQn, 0);
+    NVIC_EnableIRQ(TC3_IRQn);
+#endif
+    hardwareTimerReady = true;
+}
+
+// Fire serviceHardwareTimer() once after delayUs
+void FED3::armHardwareTimer(unsigned long delayUs)
+{
+#if defined(ESP32)
+    timerStop(fed3Timer);
+    timerWrite(fed3Timer, 0);
+    timerAlarm(fed3Timer, delayUs, false, 0);
+    timerStart(fed3Timer);
+#elif defined(__arm__)
+    if (delayUs > TIMER_MAX_DELAY_US)
+        delayUs = TIMER_MAX_DELAY_US; // the clients check the time and re-arm for the rest
+    TC3->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    waitTC3Sync();
+    TC3->COUNT16.COUNT.reg = 0;
+    waitTC3Sync();
+    TC3->COUNT16.CC[0].reg = (uint16_t)(delayUs * TIMER_TICKS_PER_US);
+    waitTC3Sync();
+    TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+    TC3->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+    waitTC3Sync();
+#endif
+}
+
+void FED3::stopHardwareTimer()
+{
+    if (!hardwareTimerReady)
+        return;
+#if defined(ESP32)
+    timerStop(fed3Timer);
+#elif defined(__arm__)
+    TC3->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    waitTC3Sync();
+#endif
+}
+
+// Service every timer client and arm the timer for whichever needs it next
+void FED3::serviceHardwareTimer()
+{
+    unsigned long next = stepPulseTrain();
+    unsigned long trial = stepTrial();
+    if (trial > 0 && (next == 0 || trial < next))
+        next = trial;
+    if (next > 0)
+        armHardwareTimer(next);
+}
+
+/**************************************************************************************************************************************************
+                                                                                               Audio timer
+**************************************************************************************************************************************************/
+void FED3::startAudioTimer()
+{
+    if (audioTimerReady)
+        return;
+
+#if defined(ESP32)
+    audioHwTimer = timerBegin(1000000);
+    timerAttachInterrupt(audioHwTimer, &audioTimerHandler);
+    timerStop(audioHwTimer);
+#elif defined(__arm__)
+    // TC4 and TC5 share a clock, tone() also sets it to GCLK0
+    PM->APBCMASK.reg |= PM_APBCMASK_TC4;
+    GCLK->CLKCTRL.reg = (uint16_t)(GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID(GCM_TC4_TC5));
+    while (GCLK->STATUS.bit.SYNCBUSY)
+        ;
+
+    TC4->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    waitTC4Sync();
+    TC4->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER_DIV16;
+    waitTC4Sync();
+    TC4->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+
+    NVIC_SetPriority(TC4_IRQn, 1); // below the pulse train timer
+    NVIC_EnableIRQ(TC4_IRQn);
+#endif
+    audioTimerReady = true;
+}
+
+// Call serviceAudio() every periodUs until stopAudioTimer(), safe to call from serviceAudio()
+void FED3::setAudioTimerPeriod(unsigned long periodUs)
+{
+#if defined(ESP32)
+    timerStop(audioHwTimer);
+    timerWrite(audioHwTimer, 0);
+    timerAlarm(audioHwTimer, periodUs, true, 0);
+    timerStart(audioHwTimer);
+#elif defined(__arm__)
+    if (periodUs > TIMER_MAX_DELAY_US)
+        periodUs = TIMER_MAX_DELAY_US;
+    TC4->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    waitTC4Sync();
+    TC4->COUNT16.COUNT.reg = 0;
+    waitTC4Sync();
+    TC4->COUNT16.CC[0].reg = (uint16_t)(periodUs * TIMER_TICKS_PER_US - 1);
+    waitTC4Sync();
+    TC4->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+    waitTC4Sync();
+#endif
+}
+
+void FED3::stopAudioTimer()
+{
+    if (!audioTimerReady)
+        return;
+#if defined(ESP32)
+    timerStop(audioHwTimer);
+#elif defined(__arm__)
+    TC4->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    waitTC4Sync();
+#endif
+}
@@ -0,0 +1,193 @@
+#include "FED3.h"
+
+/**************************************************************************************************************************************************
+                                                                                               Trial stimuli
+**************************************************************************************************************************************************/
+// A trial is a list of stimuli at microsecond offsets from a trigger, run from the hardware timer so onsets don't
+// depend on what the sketch is doing. The actual onset of each stimulus is recorded, and the first poke after the
+// trigger is timestamped in the poke interrupt, so reaction times are measured against what the mouse heard or saw.
+// A tone cuts off a sound started with play(), except one looping until stop(), such as the white noise of
+// Timeout(), which goes on after the tone. Tones need the audio timer (fed3.audioTimer, see FED3_Timer.cpp).
+// Pixel frames can't be sent from the timer interrupt, so the timer stages them and run() shows them; their
+// onsets are when the frame was sent, and a frame replaced before run() got to it has none.
+//
+//   const FED3_Stimulus goTrial[] = {
+//       {0, STIMULUS_TONE, 2500, 500},           // cue at the poke
+//       {0, STIMULUS_BNC, 1, 0},                 // and a TTL for the recording
+//       {10000, STIMULUS_BNC, 0, 0},
+//   };
+//   fed3.startTrial(goTrial, 3, fed3.pokeEdgeUs);
+//   ...
+//   long rt = fed3.reactionTimeUs(0);
+
+bool FED3::startTrial(const FED3_Stimulus *stimuli, byte count, unsigned long triggerUs)
+{
+    if (stimuli == NULL || count == 0 || count > MAX_TRIAL_STIMULI)
+        return false;
+
+    // Anything slow is done here, so the timer interrupt only switches outputs
+    bool pixels = false, bnc = false, tone = false;
+    unsigned long toneMs = 0;
+    for (byte i = 0; i < count; i++)
+    {
+        pixels |= (stimuli[i].type == STIMULUS_PIXELS && stimuli[i].value != 0);
+        bnc |= (stimuli[i].type == STIMULUS_BNC);
+        tone |= (stimuli[i].type == STIMULUS_TONE);
+        if (stimuli[i].type == STIMULUS_TONE)
+            toneMs += stimuli[i].durationMs;
+    }
+    if (tone && !audioTimer)
+        return false; // tones need the audio timer, which a sketch using Servo gives up
+    stopTrial();
+    if (pixels && !railOn)
+    {
+        motorEnable(true); // power the pixels now, they need a moment to settle
+        delay(2);
+    }
+    if (bnc)
+    {
+        stopPulseTrain();
+        stopBNCCapture();
+        pinMode(BNC_OUT, OUTPUT);
+    }
+    if (tone)
+    {
+        prepareAudio();
+        noteBuzzer(toneMs); // counted ahead, the interrupt doesn't read millis()
+    }
+
+    noInterrupts();
+    trialStimuli = stimuli;
+    trialCount = count;
+    trialNext = 0;
+    for (byte i = 0; i < count; i++)
+        trialOnsetUs[i] = 0;
+    trialResponded = false;
+    trialTriggerUs = triggerUs ? triggerUs : micros();
+    trialArmed = true;
+    interrupts();
+
+    startHardwareTimer();
+    serviceHardwareTimer(); // runs the stimuli that are already due and arms the timer for the next one
+    return true;
+}
+
+void FED3::stopTrial()
+{
+    noInterrupts();
+    trialArmed = false;
+    trialNext = trialCount;
+    trialPixelsPending = false;
+    if (!pulseRunning)
+        stopHardwareTimer();
+    interrupts();
+}
+
+bool FED3::trialRunning()
+{
+    return (trialStimuli != NULL && trialNext < trialCount) || trialPixelsPending;
+}
+
+unsigned long FED3::stimulusOnsetUs(byte index)
+{
+    return index < trialCount ? trialOnsetUs[index] : 0;
+}
+
+long FED3::reactionTimeUs(byte index)
+{
+    if (!trialResponded || index >= trialCount || trialOnsetUs[index] == 0)
+        return -1;
+    long rt = (long)(trialResponseUs - trialOnsetUs[index]);
+    return rt >= 0 ? rt : -1; // poked before the stimulus
+}
+
+float FED3::stimulusMeanLateUs()
+{
+    return stimuliRun ? (float)stimulusLateSumUs / stimuliRun : 0.0;
+}
+
+// Called from the poke interrupts
+void FED3::notePokeEdge(bool left)
+{
+    unsigned long now = micros();
+    pokeEdgeUs = now;
+    if (trialArmed && !trialResponded && (long)(now - trialTriggerUs) >= 0)
+    {
+        trialResponseUs = now;
+        trialResponseLeft = left;
+        trialResponded = true;
+    }
+}
+
+// Run every stimulus that is due, returns microseconds until the next one or 0 when the trial is done
+unsigned long FED3::stepTrial()
+{
+    while (trialArmed && trialNext < trialCount)
+    {
+        const FED3_Stimulus &stimulus = trialStimuli[trialNext];
+        long wait = (long)(stimulus.offsetUs - (micros() - trialTriggerUs));
+        if (wait > 20)
+            return wait;
+        while (wait > 0) // too close to re-arm the timer, wait it out
+            wait = (long)(stimulus.offsetUs - (micros() - trialTriggerUs));
+
+        unsigned long onset = micros();
+        runStimulus(stimulus);
+        if (stimulus.type != STIMULUS_PIXELS) // shown later by serviceTrialPixels()
+            noteStimulusOnset(trialNext, onset);
+        trialNext++;
+    }
+    return 0;
+}
+
+void FED3::noteStimulusOnset(byte index, unsigned long onset)
+{
+    trialOnsetUs[index] = onset ? onset : 1; // 0 means not run
+
+    unsigned long late = onset - (trialTriggerUs + trialStimuli[index].offsetUs);
+    stimuliRun++;
+    stimulusLateSumUs += late;
+    if (late > stimulusWorstLateUs)
+        stimulusWorstLateUs = late;
+}
+
+// Called by serviceAnimations(): sends the frame the timer staged, from the main loop where strip.show() and
+// switching the rail are safe
+void FED3::serviceTrialPixels()
+{
+    if (!trialPixelsPending)
+        return;
+    noInterrupts();
+    uint32_t color = trialPixelColor;
+    byte index = trialPixelStimulus;
+    trialPixelsPending = false;
+    interrupts();
+
+    fillPixels(color, 0, strip.numPixels());
+    showPixels();
+    noInterrupts();
+    if (trialArmed && index < trialCount)
+        noteStimulusOnset(index, micros());
+    interrupts();
+}
+
+void FED3::runStimulus(const FED3_Stimulus &stimulus)
+{
+    switch (stimulus.type)
+    {
+    case STIMULUS_TONE:
+        startInterruptNote(stimulus.value, stimulus.durationMs);
+        break;
+    case STIMULUS_TONE_OFF:
+        stopInterruptNote();
+        break;
+    case STIMULUS_PIXELS:
+        trialPixelColor = stimulus.value;
+        trialPixelStimulus = trialNext;
+        trialPixelsPending = true;
+        break;
+    case STIMULUS_BNC:
+        digitalWrite(BNC_OUT, stimulus.value ? HIGH : LOW);
+        break;
+    }
+}